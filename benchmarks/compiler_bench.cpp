@@ -0,0 +1,546 @@
+// Compiler benchmarks, in two halves.
+//
+// Throughput: lexes, parses, analyzes and fully compiles generated translation
+// units of increasing size and reports lines/s and tokens/s. Lexing is timed
+// with both the Flex scanner and the hand-written one. Semantic analysis
+// also reports its complexity fit, which should stay linear. AST dumps are
+// timed in both the text and JSON formats, and loading a serialized AST can
+// be compared against parsing the same source. A compile-cache hit and an
+// -fincremental rebuild that reuses every function are timed against the full
+// pipeline, as is the same compile requested from a -daemon server.
+//
+// Symbol tables: compares sema::SymbolTable with the map-per-scope table it
+// replaced on deeply nested scopes that keep shadowing the same names.
+//
+// Kernels: compiles fibonacci.c, matrix_mul.c and quicksort.c with the
+// `compiler` executable at every -O level, links them with the host C compiler
+// and times the resulting binaries. Building out of process means a compiler
+// crash marks one kernel as failed instead of ending the run.
+//
+// Output is JSON unless another --benchmark_format is given; use
+// --benchmark_out=<file> to keep a copy for regression tracking.
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/serialization.h"
+#include "driver/compile_server.h"
+#include "driver/driver.h"
+#include "lexer/lexer.h"
+#include "optimizer/optimizer.h"
+#include "parser/parser.h"
+#include "sema/sema.h"
+#include "sema/symbol_table.h"
+#include "support/buffered_writer.h"
+#include "support/instrumentation.h"
+#include "support/string_interner.h"
+#include "synthetic_source.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+using compiler::optimizer::OptLevel;
+
+struct SyntheticInput {
+  std::string text;
+  std::string path;
+  std::size_t lines = 0;
+  std::size_t tokens = 0;
+};
+
+fs::path scratchDir() {
+  static const fs::path dir = [] {
+    fs::path path = fs::temp_directory_path() / ("compiler_bench_" + std::to_string(getpid()));
+    fs::create_directories(path);
+    return path;
+  }();
+  return dir;
+}
+
+/** Generates each input size once; the file copy feeds the full pipeline. */
+const SyntheticInput& syntheticInput(std::size_t lines) {
+  static std::map<std::size_t, SyntheticInput> cache;
+  auto [it, inserted] = cache.try_emplace(lines);
+  SyntheticInput& input = it->second;
+  if (inserted) {
+    input.text = compiler::bench::makeSyntheticSource(lines);
+    input.path = (scratchDir() / ("synthetic_" + std::to_string(lines) + ".c")).string();
+    std::ofstream(input.path, std::ios::binary) << input.text;
+    for (char c : input.text) {
+      input.lines += c == '\n' ? 1 : 0;
+    }
+    input.tokens = compiler::lexer::Lexer().tokenize(input.text).size();
+  }
+  return input;
+}
+
+void reportThroughput(benchmark::State& state, const SyntheticInput& input) {
+  state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(input.text.size()));
+  state.counters["lines/s"] = benchmark::Counter(static_cast<double>(input.lines),
+                                                 benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(input.tokens),
+                                                  benchmark::Counter::kIsIterationInvariantRate);
+}
+
+OptLevel levelFromArg(std::int64_t arg) {
+  switch (arg) {
+    case 1: return OptLevel::O1;
+    case 2: return OptLevel::O2;
+    case 3: return OptLevel::O3;
+    default: return OptLevel::O0;
+  }
+}
+
+// --- Throughput --------------------------------------------------------------
+
+/** range(1) selects the scanner: 0 is the Flex scanner, 1 the hand-written SIMD one. */
+void BM_Lex(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  const auto scanner = state.range(1) == 0 ? compiler::lexer::ScannerKind::Flex
+                                           : compiler::lexer::ScannerKind::Fast;
+  std::uint64_t allocations = 0;
+  std::uint64_t allocated_bytes = 0;
+  for (auto _ : state) {
+    compiler::lexer::Lexer lexer(nullptr, scanner);
+    const std::uint64_t before = compiler::support::threadAllocationCount();
+    const std::uint64_t bytes_before = compiler::support::threadAllocatedBytes();
+    auto tokens = lexer.tokenize(input.text, "synthetic.c");
+    allocations = compiler::support::threadAllocationCount() - before;
+    allocated_bytes = compiler::support::threadAllocatedBytes() - bytes_before;
+    benchmark::DoNotOptimize(tokens.data());
+  }
+  reportThroughput(state, input);
+  state.counters["allocations"] = static_cast<double>(allocations);
+  state.counters["allocated_bytes"] = static_cast<double>(allocated_bytes);
+}
+BENCHMARK(BM_Lex)
+    ->ArgNames({"lines", "fast"})
+    ->ArgsProduct({{10000, 100000, 1000000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * range(1) selects the parse mode: 0 streams tokens, 1 lexes the whole file first.
+ * range(2) selects the parser: 0 is Bison's, 1 the recursive-descent one.
+ */
+void BM_Parse(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  const auto mode = state.range(1) == 0 ? compiler::parser::ParseMode::Streaming
+                                        : compiler::parser::ParseMode::Batch;
+  const auto kind = state.range(2) == 0 ? compiler::parser::ParserKind::Bison
+                                        : compiler::parser::ParserKind::RecursiveDescent;
+  for (auto _ : state) {
+    compiler::parser::Parser parser(mode, compiler::lexer::ScannerKind::Flex, kind);
+    auto unit = parser.parse(input.text, "synthetic.c");
+    if (unit == nullptr) {
+      state.SkipWithError("synthetic input failed to parse");
+      break;
+    }
+    benchmark::DoNotOptimize(unit->decls.data());
+  }
+  reportThroughput(state, input);
+}
+BENCHMARK(BM_Parse)
+    ->ArgNames({"lines", "batch", "rd"})
+    ->ArgsProduct({{10000, 100000}, {0, 1}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+/** Rebuilds the AST from its binary serialization instead of lexing and parsing it. */
+void BM_Deserialize(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  auto unit = compiler::parser::Parser().parse(input.text, "synthetic.c");
+  std::string bytes;
+  std::string error;
+  {
+    compiler::support::BufferedWriter out(bytes);
+    if (unit == nullptr || !compiler::ast::serialize(*unit, out, error)) {
+      state.SkipWithError("synthetic input failed to parse or serialize");
+      return;
+    }
+  }
+  for (auto _ : state) {
+    auto loaded = compiler::ast::deserialize(bytes, error);
+    if (loaded == nullptr) {
+      state.SkipWithError(error.c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(loaded->decls.data());
+  }
+  reportThroughput(state, input);
+  state.counters["ast_bytes"] = static_cast<double>(bytes.size());
+}
+BENCHMARK(BM_Deserialize)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+/** Semantic analysis alone. It annotates the AST in place, so each iteration parses afresh. */
+void BM_Sema(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto unit = compiler::parser::Parser().parse(input.text, "synthetic.c");
+    state.ResumeTiming();
+    compiler::sema::SemanticAnalyzer analyzer;
+    if (unit == nullptr || !analyzer.analyze(*unit)) {
+      state.SkipWithError("synthetic input failed to parse or analyze");
+      break;
+    }
+    state.PauseTiming();
+    unit.reset();
+    state.ResumeTiming();
+  }
+  reportThroughput(state, input);
+  state.SetComplexityN(static_cast<std::int64_t>(input.lines));
+}
+BENCHMARK(BM_Sema)
+    ->Arg(10000)
+    ->Arg(30000)
+    ->Arg(100000)
+    ->Complexity(benchmark::oN)
+    ->Unit(benchmark::kMillisecond);
+
+/** range(1) selects the dump format: 0 is the indented text tree, 1 is compact JSON. */
+void BM_Dump(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  auto unit = compiler::parser::Parser().parse(input.text, "synthetic.c");
+  compiler::sema::SemanticAnalyzer analyzer;
+  if (unit == nullptr || !analyzer.analyze(*unit)) {
+    state.SkipWithError("synthetic input failed to parse or analyze");
+    return;
+  }
+  const auto format =
+      state.range(1) == 0 ? compiler::ast::DumpFormat::Text : compiler::ast::DumpFormat::JSON;
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    compiler::support::BufferedWriter writer(out);
+    compiler::ast::dump(*unit, writer, format);
+    benchmark::DoNotOptimize(out.data());
+  }
+  reportThroughput(state, input);
+  state.counters["bytes"] = static_cast<double>(out.size());
+}
+BENCHMARK(BM_Dump)
+    ->ArgNames({"lines", "json"})
+    ->ArgsProduct({{10000, 100000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+/** Source file to object file, through sema, folding, codegen and the -O pipeline. */
+void BM_Pipeline(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  compiler::driver::DriverOptions options;
+  options.inputs = {input.path};
+  options.output = (scratchDir() / "pipeline.o").string();
+  options.opt_level = levelFromArg(state.range(1));
+  const compiler::driver::Driver driver(options);
+  for (auto _ : state) {
+    const compiler::driver::UnitResult result = driver.compileUnit(input.path);
+    if (!result.success) {
+      state.SkipWithError(result.diagnostics.c_str());
+      break;
+    }
+  }
+  reportThroughput(state, input);
+}
+BENCHMARK(BM_Pipeline)
+    ->ArgNames({"lines", "O"})
+    ->Args({1000, 0})
+    ->Args({10000, 0})
+    ->Args({100000, 0})
+    ->Args({1000, 2})
+    ->Args({10000, 2})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * The -O2 pipeline with codegen and optimization split over
+ * -fcodegen-partitions workers, linked back into one object or, with
+ * -fsplit-objects, written as one object per partition. One partition is the
+ * serial pipeline. Measured in wall time since the work runs on other threads.
+ */
+void BM_PartitionedCodegen(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  compiler::driver::DriverOptions options;
+  options.inputs = {input.path};
+  options.output = (scratchDir() / "partitioned.o").string();
+  options.opt_level = compiler::optimizer::OptLevel::O2;
+  options.codegen_partitions = static_cast<unsigned>(state.range(1));
+  options.split_objects = state.range(2) != 0;
+  const compiler::driver::Driver driver(options);
+  for (auto _ : state) {
+    const compiler::driver::UnitResult result = driver.compileUnit(input.path);
+    if (!result.success) {
+      state.SkipWithError(result.diagnostics.c_str());
+      break;
+    }
+  }
+  reportThroughput(state, input);
+}
+BENCHMARK(BM_PartitionedCodegen)
+    ->ArgNames({"lines", "partitions", "split"})
+    ->Args({10000, 1, 0})
+    ->Args({10000, 4, 0})
+    ->Args({10000, 8, 0})
+    ->Args({10000, 8, 1})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * BM_Pipeline's -O0 compile sent to a -daemon server over its socket, as a
+ * -connect client would: the round trip plus a compile that finds the
+ * target already registered and a target machine waiting in the pool.
+ */
+void BM_CompileServer(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  const std::string socket = (scratchDir() / "server.sock").string();
+  const std::vector<std::string> args = {"-o", (scratchDir() / "served.o").string(), input.path};
+  compiler::driver::CompileServer server(socket);
+  std::string error;
+  if (!server.open(error)) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+  std::thread serving([&server] { server.serve(); });
+  int status = 0;
+  std::string diagnostics;
+  for (auto _ : state) {
+    if (!compiler::driver::sendCompileRequest(socket, args, status, diagnostics, error) ||
+        status != 0) {
+      state.SkipWithError(error.empty() ? diagnostics.c_str() : error.c_str());
+      break;
+    }
+  }
+  server.stop();
+  serving.join();
+  reportThroughput(state, input);
+}
+BENCHMARK(BM_CompileServer)->Arg(10)->Arg(1000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/** The same compile as a warm -fcache-dir hit: hash the source, copy the stored object. */
+void BM_CacheHit(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  compiler::driver::DriverOptions options;
+  options.inputs = {input.path};
+  options.output = (scratchDir() / "cached.o").string();
+  options.cache_dir = (scratchDir() / "cache").string();
+  const compiler::driver::Driver driver(options);
+  const compiler::driver::UnitResult warmup = driver.compileUnit(input.path);
+  if (!warmup.success) {
+    state.SkipWithError(warmup.diagnostics.c_str());
+    return;
+  }
+  for (auto _ : state) {
+    if (!driver.compileUnit(input.path).cache_hit) {
+      state.SkipWithError("compile cache missed");
+      break;
+    }
+  }
+  reportThroughput(state, input);
+}
+BENCHMARK(BM_CacheHit)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+/**
+ * An -O2 -fincremental compile after an edit that changes no function: every
+ * function's optimized IR comes from the cache, so only the front end, the
+ * link and the backend run. A trailing comment defeats the whole-unit entry.
+ */
+void BM_Incremental(benchmark::State& state) {
+  const SyntheticInput& input = syntheticInput(static_cast<std::size_t>(state.range(0)));
+  const std::string path = (scratchDir() / "incremental.c").string();
+  compiler::driver::DriverOptions options;
+  options.inputs = {path};
+  options.output = (scratchDir() / "incremental.o").string();
+  options.opt_level = compiler::optimizer::OptLevel::O2;
+  options.cache_dir = (scratchDir() / "incremental_cache").string();
+  options.incremental = true;
+  const compiler::driver::Driver driver(options);
+  // Benchmark runs the function more than once; every edit must be new.
+  static std::size_t edits = 0;
+  const auto edit = [&] {
+    std::ofstream(path, std::ios::binary) << input.text << "// edit " << edits++ << "\n";
+  };
+  edit();
+  const compiler::driver::UnitResult warmup = driver.compileUnit(path);
+  if (!warmup.success) {
+    state.SkipWithError(warmup.diagnostics.c_str());
+    return;
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    edit();
+    state.ResumeTiming();
+    const compiler::driver::UnitResult result = driver.compileUnit(path);
+    if (result.cache_hit || result.functions_reused == 0) {
+      state.SkipWithError("incremental build reused nothing");
+      break;
+    }
+  }
+  reportThroughput(state, input);
+}
+BENCHMARK(BM_Incremental)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// --- Symbol tables -----------------------------------------------------------
+
+/** The previous sema::SymbolTable: one hash map per scope, searched innermost first. */
+class MapPerScopeSymbolTable {
+ public:
+  void enterScope() { scopes_.emplace_back(); }
+  void exitScope() {
+    if (scopes_.size() > 1) {
+      scopes_.pop_back();
+    }
+  }
+  bool declare(compiler::support::Symbol name, const compiler::ast::Type* type) {
+    return scopes_.back().emplace(name, type).second;
+  }
+  const compiler::ast::Type* lookup(compiler::support::Symbol name) const {
+    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
+      auto found = it->find(name);
+      if (found != it->end()) {
+        return found->second;
+      }
+    }
+    return nullptr;
+  }
+
+ private:
+  std::vector<std::unordered_map<compiler::support::Symbol, const compiler::ast::Type*>> scopes_{
+      {}};
+};
+
+/**
+ * Nests range(0) scopes, each declaring a few names from a small shared pool
+ * and then resolving a mix of local, shadowed and global names.
+ */
+template <typename Table>
+void BM_SymbolTable(benchmark::State& state) {
+  constexpr int kPool = 64;
+  constexpr int kDeclsPerScope = 4;
+  constexpr int kLookupsPerScope = 32;
+  const auto depth = static_cast<int>(state.range(0));
+
+  compiler::support::StringInterner interner;
+  std::vector<compiler::support::Symbol> names;
+  for (int i = 0; i < kPool; ++i) {
+    names.push_back(interner.intern("name" + std::to_string(i)));
+  }
+  compiler::ast::TypeContext types;
+  const compiler::ast::Type* type = types.intType();
+
+  std::size_t found = 0;
+  for (auto _ : state) {
+    Table table;
+    for (int i = 0; i < kPool; i += 2) {
+      table.declare(names[i], type);
+    }
+    for (int level = 0; level < depth; ++level) {
+      table.enterScope();
+      for (int d = 0; d < kDeclsPerScope; ++d) {
+        table.declare(names[(level * 7 + d * 13) % kPool], type);
+      }
+      for (int l = 0; l < kLookupsPerScope; ++l) {
+        found += table.lookup(names[(level * 31 + l * 17) % kPool]) ? 1 : 0;
+      }
+    }
+    for (int level = 0; level < depth; ++level) {
+      table.exitScope();
+    }
+  }
+  benchmark::DoNotOptimize(found);
+  state.counters["lookups/s"] =
+      benchmark::Counter(static_cast<double>(depth * kLookupsPerScope),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(BM_SymbolTable, compiler::sema::SymbolTable)->Arg(4)->Arg(32)->Arg(256);
+BENCHMARK_TEMPLATE(BM_SymbolTable, MapPerScopeSymbolTable)->Arg(4)->Arg(32)->Arg(256);
+
+// --- Kernels -----------------------------------------------------------------
+
+struct Kernel {
+  const char* name;
+  const char* file;
+};
+
+constexpr Kernel kKernels[] = {
+    {"fibonacci", "fibonacci.c"},
+    {"matrix_mul", "matrix_mul.c"},
+    {"quicksort", "quicksort.c"},
+};
+
+constexpr const char* kLevels[] = {"O0", "O1", "O2", "O3", "Os"};
+
+/** Builds the kernel once, then times whole runs of the binary, process start included. */
+void runKernel(benchmark::State& state, const Kernel& kernel, const char* level) {
+  const std::string stem = std::string(kernel.name) + "_" + level;
+  const std::string object = (scratchDir() / (stem + ".o")).string();
+  const std::string binary = (scratchDir() / stem).string();
+
+  const std::string compile = std::string(COMPILER_BENCH_COMPILER) + " -" + level + " -o " +
+                              object + " " + COMPILER_BENCH_KERNEL_DIR + "/" + kernel.file;
+  const auto start = std::chrono::steady_clock::now();
+  const int status = std::system(compile.c_str());
+  const auto compiled = std::chrono::steady_clock::now();
+  if (status != 0) {
+    state.SkipWithError(("compile failed: " + compile).c_str());
+    return;
+  }
+  const std::string link = std::string(COMPILER_BENCH_CC) + " " + object + " -o " + binary;
+  if (std::system(link.c_str()) != 0) {
+    state.SkipWithError(("link failed: " + link).c_str());
+    return;
+  }
+
+  const std::string run = binary + " > /dev/null";
+  for (auto _ : state) {
+    if (std::system(run.c_str()) != 0) {
+      state.SkipWithError(("kernel exited with an error: " + binary).c_str());
+      break;
+    }
+  }
+  state.counters["compile_ms"] =
+      std::chrono::duration<double, std::milli>(compiled - start).count();
+  state.counters["object_bytes"] = static_cast<double>(fs::file_size(object));
+}
+
+void registerKernels() {
+  for (const Kernel& kernel : kKernels) {
+    for (const char* level : kLevels) {
+      const std::string name = std::string("BM_Kernel/") + kernel.name + "/" + level;
+      benchmark::RegisterBenchmark(name.c_str(), runKernel, kernel, level)
+          ->Unit(benchmark::kMillisecond)
+          ->UseRealTime();
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Default to JSON; a --benchmark_format later on the command line still wins.
+  std::string json_format = "--benchmark_format=json";
+  std::vector<char*> args(argv, argv + argc);
+  args.insert(args.begin() + 1, json_format.data());
+  int count = static_cast<int>(args.size());
+
+  registerKernels();
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  std::error_code ec;
+  fs::remove_all(scratchDir(), ec);
+  return 0;
+}
@@ -1 +1,17 @@
-int main(void) { return 0; }
+// Recursive Fibonacci: call-heavy, exercises inlining and tail handling.
+
+int fib(int n) {
+  if (n < 2) {
+    return n;
+  }
+  return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+  int total = 0;
+  for (int i = 0; i < 4; i += 1) {
+    total += fib(30 + i % 2);
+  }
+  printf("fib checksum %d\n", total);
+  return 0;
+}
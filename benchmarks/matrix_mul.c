@@ -1 +1,34 @@
-int main(void) { return 0; }
+// Dense float matrix multiply: loop nests, array indexing and vectorization.
+
+float a[160][160];
+float b[160][160];
+float c[160][160];
+
+int main() {
+  int n = 160;
+  for (int i = 0; i < n; i += 1) {
+    for (int j = 0; j < n; j += 1) {
+      a[i][j] = (i * 7 + j) % 13;
+      b[i][j] = (i + j * 3) % 11;
+    }
+  }
+  for (int rep = 0; rep < 4; rep += 1) {
+    for (int i = 0; i < n; i += 1) {
+      for (int j = 0; j < n; j += 1) {
+        c[i][j] = 0;
+      }
+      for (int k = 0; k < n; k += 1) {
+        float aik = a[i][k];
+        for (int j = 0; j < n; j += 1) {
+          c[i][j] += aik * b[k][j];
+        }
+      }
+    }
+  }
+  float trace = 0;
+  for (int i = 0; i < n; i += 1) {
+    trace += c[i][i];
+  }
+  printf("matmul trace %f\n", trace);
+  return 0;
+}
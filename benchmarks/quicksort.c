@@ -1 +1,58 @@
-int main(void) { return 0; }
+// In-place quicksort over pseudo-random data: branches, swaps and recursion.
+
+int data[200000];
+
+void swap(int* values, int i, int j) {
+  int tmp = values[i];
+  values[i] = values[j];
+  values[j] = tmp;
+}
+
+int partition(int* values, int lo, int hi) {
+  int pivot = values[(lo + hi) / 2];
+  swap(values, (lo + hi) / 2, hi);
+  int store = lo;
+  for (int i = lo; i < hi; i += 1) {
+    if (values[i] < pivot) {
+      swap(values, i, store);
+      store += 1;
+    }
+  }
+  swap(values, store, hi);
+  return store;
+}
+
+void quicksort(int* values, int lo, int hi) {
+  while (lo < hi) {
+    int p = partition(values, lo, hi);
+    // Recurse into the smaller half to bound stack depth.
+    if (p - lo < hi - p) {
+      quicksort(values, lo, p - 1);
+      lo = p + 1;
+    } else {
+      quicksort(values, p + 1, hi);
+      hi = p - 1;
+    }
+  }
+}
+
+int main() {
+  int n = 200000;
+  int seed = 12345;
+  for (int i = 0; i < n; i += 1) {
+    seed = (seed * 1103 + 12345) % 65536;
+    data[i] = seed;
+  }
+  quicksort(data, 0, n - 1);
+  int sorted = 1;
+  for (int i = 1; i < n; i += 1) {
+    if (data[i - 1] > data[i]) {
+      sorted = 0;
+    }
+  }
+  printf("quicksort sorted %d first %d last %d\n", sorted, data[0], data[n - 1]);
+  if (!sorted) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace compiler::bench {
+
+/**
+ * Generates a syntactically valid C source of roughly `lines` lines made of
+ * repeated function bodies with loops, branches and arithmetic.
+ */
+inline std::string makeSyntheticSource(std::size_t lines) {
+  std::string src;
+  src.reserve(lines * 32);
+  std::size_t emitted = 0;
+  for (std::size_t fn = 0; emitted < lines; ++fn) {
+    const std::string id = std::to_string(fn);
+    src += "struct S" + id + " { int x; float y; };\n";
+    src += "int f" + id + "(int a, int b) {\n";
+    src += "  int acc = a * 3 + b / 2 - 7;\n";
+    src += "  float scale = 1.5;\n";
+    src += "  for (a = 0; a < 100; a += 1) {\n";
+    src += "    if (acc >= b && a != 3) { acc = acc - a * 2; } else { acc += 1; }\n";
+    src += "    while (acc > 1000) { acc /= 2; }\n";
+    src += "  }\n";
+    src += "  // trailing comment " + id + "\n";
+    src += "  return acc + f" + id + "(a, 'c');\n";
+    src += "}\n";
+    emitted += 11;
+  }
+  return src;
+}
+
+}  // namespace compiler::bench
@@ -1,6 +1,8 @@
 #include "ast/ast.h"
 
-#include <sstream>
+#include <cmath>
+
+#include "support/buffered_writer.h"
 
 namespace compiler::ast {
 
@@ -24,192 +26,545 @@ void FloatLiteral::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void CharLiteral::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void StringLiteral::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void VarRef::accept(ASTVisitor& visitor) { visitor.visit(*this); }
+void ImplicitCastExpr::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 
-namespace {
-
-void indent(std::ostringstream& out, int level) {
-  for (int i = 0; i < level; ++i) {
-    out << "  ";
+const char* spelling(BinaryOp op) {
+  switch (op) {
+    case BinaryOp::Add: return "+";
+    case BinaryOp::Sub: return "-";
+    case BinaryOp::Mul: return "*";
+    case BinaryOp::Div: return "/";
+    case BinaryOp::Mod: return "%";
+    case BinaryOp::Eq: return "==";
+    case BinaryOp::Ne: return "!=";
+    case BinaryOp::Lt: return "<";
+    case BinaryOp::Gt: return ">";
+    case BinaryOp::Le: return "<=";
+    case BinaryOp::Ge: return ">=";
+    case BinaryOp::LogicalAnd: return "&&";
+    case BinaryOp::LogicalOr: return "||";
+    case BinaryOp::Assign: return "=";
+    case BinaryOp::AddAssign: return "+=";
+    case BinaryOp::SubAssign: return "-=";
+    case BinaryOp::MulAssign: return "*=";
+    case BinaryOp::DivAssign: return "/=";
   }
+  return "?";
 }
 
-void printNode(const ASTNode* node, std::ostringstream& out, int depth) {
-  if (node == nullptr) {
-    indent(out, depth);
-    out << "<null>\n";
-    return;
+const char* spelling(UnaryOp op) {
+  switch (op) {
+    case UnaryOp::Neg: return "-";
+    case UnaryOp::Not: return "!";
+    case UnaryOp::AddressOf: return "&";
+    case UnaryOp::Deref: return "*";
   }
+  return "?";
+}
 
-  if (const auto* tu = dynamic_cast<const TranslationUnit*>(node)) {
-    indent(out, depth);
-    out << "TranslationUnit\n";
-    for (const auto& decl : tu->decls) {
-      printNode(decl.get(), out, depth + 1);
-    }
-    return;
+BinaryOp arithmeticOf(BinaryOp op) {
+  switch (op) {
+    case BinaryOp::AddAssign: return BinaryOp::Add;
+    case BinaryOp::SubAssign: return BinaryOp::Sub;
+    case BinaryOp::MulAssign: return BinaryOp::Mul;
+    case BinaryOp::DivAssign: return BinaryOp::Div;
+    default: return op;
   }
+}
 
-  if (const auto* fn = dynamic_cast<const FunctionDecl*>(node)) {
-    indent(out, depth);
-    out << "FunctionDecl " << fn->name << " -> " << fn->return_type.name << "\n";
-    for (const auto& param : fn->params) {
-      indent(out, depth + 1);
-      out << "Param " << param.name << ":" << param.type.name << "\n";
-    }
-    printNode(fn->body.get(), out, depth + 1);
-    return;
+const char* spelling(CastKind kind) {
+  switch (kind) {
+    case CastKind::ArrayToPointerDecay: return "ArrayToPointerDecay";
+    case CastKind::IntegralCast: return "IntegralCast";
+    case CastKind::IntegralToFloating: return "IntegralToFloating";
+    case CastKind::FloatingToIntegral: return "FloatingToIntegral";
+    case CastKind::NullToPointer: return "NullToPointer";
+    case CastKind::BitCast: return "BitCast";
   }
+  return "?";
+}
 
-  if (const auto* var = dynamic_cast<const VarDecl*>(node)) {
-    indent(out, depth);
-    out << "VarDecl " << var->name << ":" << var->type.name << "\n";
-    if (var->init) {
-      printNode(var->init.get(), out, depth + 1);
-    }
-    return;
+const char* spelling(NodeKind kind) {
+  switch (kind) {
+    case NodeKind::TranslationUnit: return "TranslationUnit";
+    case NodeKind::FunctionDecl: return "FunctionDecl";
+    case NodeKind::VarDecl: return "VarDecl";
+    case NodeKind::StructDecl: return "StructDecl";
+    case NodeKind::CompoundStmt: return "CompoundStmt";
+    case NodeKind::IfStmt: return "IfStmt";
+    case NodeKind::WhileStmt: return "WhileStmt";
+    case NodeKind::ForStmt: return "ForStmt";
+    case NodeKind::ReturnStmt: return "ReturnStmt";
+    case NodeKind::ExprStmt: return "ExprStmt";
+    case NodeKind::BinaryExpr: return "BinaryExpr";
+    case NodeKind::UnaryExpr: return "UnaryExpr";
+    case NodeKind::CallExpr: return "CallExpr";
+    case NodeKind::MemberExpr: return "MemberExpr";
+    case NodeKind::ArraySubscript: return "ArraySubscript";
+    case NodeKind::IntLiteral: return "IntLiteral";
+    case NodeKind::FloatLiteral: return "FloatLiteral";
+    case NodeKind::CharLiteral: return "CharLiteral";
+    case NodeKind::StringLiteral: return "StringLiteral";
+    case NodeKind::VarRef: return "VarRef";
+    case NodeKind::ImplicitCastExpr: return "ImplicitCastExpr";
   }
+  return "?";
+}
 
-  if (const auto* st = dynamic_cast<const StructDecl*>(node)) {
-    indent(out, depth);
-    out << "StructDecl " << st->name << "\n";
-    for (const auto& field : st->fields) {
-      indent(out, depth + 1);
-      out << "Field " << field.name << ":" << field.type.name << "\n";
-    }
-    return;
-  }
+namespace {
+
+// --- Text dump -------------------------------------------------------------
+
+class TextDumper {
+ public:
+  explicit TextDumper(support::BufferedWriter& out) : out_(out) {}
 
-  if (const auto* cs = dynamic_cast<const CompoundStmt*>(node)) {
-    indent(out, depth);
-    out << "CompoundStmt\n";
-    for (const auto& stmt : cs->stmts) {
-      printNode(stmt.get(), out, depth + 1);
+  void print(const ASTNode* node, int depth) {
+    if (node == nullptr) {
+      open(depth, "<null>");
+      out_.put('\n');
+      return;
     }
-    return;
-  }
 
-  if (const auto* ifs = dynamic_cast<const IfStmt*>(node)) {
-    indent(out, depth);
-    out << "IfStmt\n";
-    printNode(ifs->cond.get(), out, depth + 1);
-    printNode(ifs->then_branch.get(), out, depth + 1);
-    if (ifs->else_branch) {
-      printNode(ifs->else_branch.get(), out, depth + 1);
+    open(depth, spelling(node->kind()));
+    switch (node->kind()) {
+      case NodeKind::TranslationUnit:
+        out_.put('\n');
+        children(cast<TranslationUnit>(*node).decls, depth + 1);
+        break;
+      case NodeKind::FunctionDecl: {
+        const auto& fn = cast<FunctionDecl>(*node);
+        out_.put(' ');
+        out_.write(fn.name.str());
+        out_.write(" -> ");
+        out_.write(fn.return_type->str());
+        out_.put('\n');
+        for (const auto& param : fn.params) {
+          open(depth + 1, "Param ");
+          typed(param.name, param.type);
+        }
+        print(fn.body, depth + 1);
+        break;
+      }
+      case NodeKind::VarDecl: {
+        const auto& var = cast<VarDecl>(*node);
+        out_.put(' ');
+        typed(var.name, var.type);
+        if (var.init != nullptr) {
+          print(var.init, depth + 1);
+        }
+        break;
+      }
+      case NodeKind::StructDecl: {
+        const auto& st = cast<StructDecl>(*node);
+        out_.put(' ');
+        out_.write(st.name.str());
+        out_.put('\n');
+        for (const auto& field : st.fields) {
+          open(depth + 1, "Field ");
+          typed(field.name, field.type);
+        }
+        break;
+      }
+      case NodeKind::CompoundStmt:
+        out_.put('\n');
+        children(cast<CompoundStmt>(*node).stmts, depth + 1);
+        break;
+      case NodeKind::IfStmt: {
+        const auto& stmt = cast<IfStmt>(*node);
+        out_.put('\n');
+        print(stmt.cond, depth + 1);
+        print(stmt.then_branch, depth + 1);
+        if (stmt.else_branch != nullptr) {
+          print(stmt.else_branch, depth + 1);
+        }
+        break;
+      }
+      case NodeKind::WhileStmt: {
+        const auto& stmt = cast<WhileStmt>(*node);
+        out_.put('\n');
+        print(stmt.cond, depth + 1);
+        print(stmt.body, depth + 1);
+        break;
+      }
+      case NodeKind::ForStmt: {
+        const auto& stmt = cast<ForStmt>(*node);
+        out_.put('\n');
+        print(stmt.init, depth + 1);
+        print(stmt.cond, depth + 1);
+        print(stmt.incr, depth + 1);
+        print(stmt.body, depth + 1);
+        break;
+      }
+      case NodeKind::ReturnStmt:
+        out_.put('\n');
+        print(cast<ReturnStmt>(*node).value, depth + 1);
+        break;
+      case NodeKind::ExprStmt:
+        out_.put('\n');
+        print(cast<ExprStmt>(*node).expr, depth + 1);
+        break;
+      case NodeKind::BinaryExpr: {
+        const auto& expr = cast<BinaryExpr>(*node);
+        out_.put(' ');
+        out_.write(spelling(expr.op));
+        out_.put('\n');
+        print(expr.lhs, depth + 1);
+        print(expr.rhs, depth + 1);
+        break;
+      }
+      case NodeKind::UnaryExpr: {
+        const auto& expr = cast<UnaryExpr>(*node);
+        out_.put(' ');
+        out_.write(spelling(expr.op));
+        out_.put('\n');
+        print(expr.operand, depth + 1);
+        break;
+      }
+      case NodeKind::CallExpr: {
+        const auto& call = cast<CallExpr>(*node);
+        out_.put(' ');
+        out_.write(call.callee.str());
+        out_.put('\n');
+        for (const ASTNode* arg : call.args) {
+          print(arg, depth + 1);
+        }
+        break;
+      }
+      case NodeKind::MemberExpr: {
+        const auto& member = cast<MemberExpr>(*node);
+        out_.write(member.is_arrow ? " ->" : " .");
+        out_.write(member.member.str());
+        out_.put('\n');
+        print(member.object, depth + 1);
+        break;
+      }
+      case NodeKind::ArraySubscript: {
+        const auto& sub = cast<ArraySubscript>(*node);
+        out_.put('\n');
+        print(sub.array, depth + 1);
+        print(sub.index, depth + 1);
+        break;
+      }
+      case NodeKind::IntLiteral:
+        out_.put(' ');
+        out_.writeInt(cast<IntLiteral>(*node).value);
+        out_.put('\n');
+        break;
+      case NodeKind::FloatLiteral:
+        out_.put(' ');
+        out_.writeDouble(cast<FloatLiteral>(*node).value);
+        out_.put('\n');
+        break;
+      case NodeKind::CharLiteral:
+        out_.put(' ');
+        out_.writeInt(cast<CharLiteral>(*node).value);
+        out_.put('\n');
+        break;
+      case NodeKind::StringLiteral:
+        out_.write(" \"");
+        out_.write(cast<StringLiteral>(*node).value);
+        out_.write("\"\n");
+        break;
+      case NodeKind::VarRef:
+        out_.put(' ');
+        out_.write(cast<VarRef>(*node).name.str());
+        out_.put('\n');
+        break;
+      case NodeKind::ImplicitCastExpr: {
+        const auto& expr = cast<ImplicitCastExpr>(*node);
+        out_.put(' ');
+        out_.write(spelling(expr.cast_kind));
+        out_.write(" -> ");
+        out_.write(expr.type->str());
+        out_.put('\n');
+        print(expr.operand, depth + 1);
+        break;
+      }
     }
-    return;
   }
 
-  if (const auto* wh = dynamic_cast<const WhileStmt*>(node)) {
-    indent(out, depth);
-    out << "WhileStmt\n";
-    printNode(wh->cond.get(), out, depth + 1);
-    printNode(wh->body.get(), out, depth + 1);
-    return;
+ private:
+  void open(int depth, std::string_view label) {
+    out_.fill(' ', static_cast<std::size_t>(depth) * 2);
+    out_.write(label);
   }
 
-  if (const auto* fs = dynamic_cast<const ForStmt*>(node)) {
-    indent(out, depth);
-    out << "ForStmt\n";
-    printNode(fs->init.get(), out, depth + 1);
-    printNode(fs->cond.get(), out, depth + 1);
-    printNode(fs->incr.get(), out, depth + 1);
-    printNode(fs->body.get(), out, depth + 1);
-    return;
+  void typed(Symbol name, const Type* type) {
+    out_.write(name.str());
+    out_.put(':');
+    out_.write(type->str());
+    out_.put('\n');
   }
 
-  if (const auto* rs = dynamic_cast<const ReturnStmt*>(node)) {
-    indent(out, depth);
-    out << "ReturnStmt\n";
-    printNode(rs->value.get(), out, depth + 1);
-    return;
+  void children(const std::vector<ASTNode*>& nodes, int depth) {
+    for (const ASTNode* child : nodes) {
+      print(child, depth);
+    }
   }
 
-  if (const auto* es = dynamic_cast<const ExprStmt*>(node)) {
-    indent(out, depth);
-    out << "ExprStmt\n";
-    printNode(es->expr.get(), out, depth + 1);
-    return;
-  }
+  support::BufferedWriter& out_;
+};
 
-  if (const auto* be = dynamic_cast<const BinaryExpr*>(node)) {
-    indent(out, depth);
-    out << "BinaryExpr " << be->op << "\n";
-    printNode(be->lhs.get(), out, depth + 1);
-    printNode(be->rhs.get(), out, depth + 1);
-    return;
-  }
+// --- JSON dump -------------------------------------------------------------
 
-  if (const auto* ue = dynamic_cast<const UnaryExpr*>(node)) {
-    indent(out, depth);
-    out << "UnaryExpr " << ue->op << "\n";
-    printNode(ue->operand.get(), out, depth + 1);
-    return;
-  }
+/**
+ * Every node becomes {"kind": ..., "line": ..., fields...}. Child nodes are
+ * nested objects (null when absent), lists are arrays, and expressions carry
+ * "type" and "lvalue" once sema has annotated them.
+ */
+class JsonDumper {
+ public:
+  explicit JsonDumper(support::BufferedWriter& out) : out_(out) {}
 
-  if (const auto* ce = dynamic_cast<const CallExpr*>(node)) {
-    indent(out, depth);
-    out << "CallExpr " << ce->callee << "\n";
-    for (const auto& arg : ce->args) {
-      printNode(arg.get(), out, depth + 1);
+  void print(const ASTNode* node) {
+    if (node == nullptr) {
+      out_.write("null");
+      return;
+    }
+    out_.write("{\"kind\":");
+    string(spelling(node->kind()));
+    out_.write(",\"line\":");
+    out_.writeInt(node->line);
+    if (const auto* expr = dyn_cast<Expr>(node)) {
+      if (expr->type != nullptr) {
+        key("type");
+        string(expr->type->str());
+      }
+      if (expr->is_lvalue) {
+        key("lvalue");
+        out_.write("true");
+      }
     }
-    return;
-  }
 
-  if (const auto* me = dynamic_cast<const MemberExpr*>(node)) {
-    indent(out, depth);
-    out << "MemberExpr " << (me->is_arrow ? "->" : ".") << me->member << "\n";
-    printNode(me->object.get(), out, depth + 1);
-    return;
+    switch (node->kind()) {
+      case NodeKind::TranslationUnit:
+        key("decls");
+        array(cast<TranslationUnit>(*node).decls);
+        break;
+      case NodeKind::FunctionDecl: {
+        const auto& fn = cast<FunctionDecl>(*node);
+        field("name", fn.name.str());
+        field("returnType", fn.return_type->str());
+        key("params");
+        out_.put('[');
+        for (std::size_t i = 0; i < fn.params.size(); ++i) {
+          if (i != 0) {
+            out_.put(',');
+          }
+          declaration(fn.params[i].name, fn.params[i].type);
+        }
+        out_.put(']');
+        child("body", fn.body);
+        break;
+      }
+      case NodeKind::VarDecl: {
+        const auto& var = cast<VarDecl>(*node);
+        field("name", var.name.str());
+        field("declType", var.type->str());
+        child("init", var.init);
+        break;
+      }
+      case NodeKind::StructDecl: {
+        const auto& st = cast<StructDecl>(*node);
+        field("name", st.name.str());
+        key("fields");
+        out_.put('[');
+        for (std::size_t i = 0; i < st.fields.size(); ++i) {
+          if (i != 0) {
+            out_.put(',');
+          }
+          declaration(st.fields[i].name, st.fields[i].type);
+        }
+        out_.put(']');
+        break;
+      }
+      case NodeKind::CompoundStmt:
+        key("stmts");
+        array(cast<CompoundStmt>(*node).stmts);
+        break;
+      case NodeKind::IfStmt: {
+        const auto& stmt = cast<IfStmt>(*node);
+        child("cond", stmt.cond);
+        child("then", stmt.then_branch);
+        child("else", stmt.else_branch);
+        break;
+      }
+      case NodeKind::WhileStmt: {
+        const auto& stmt = cast<WhileStmt>(*node);
+        child("cond", stmt.cond);
+        child("body", stmt.body);
+        break;
+      }
+      case NodeKind::ForStmt: {
+        const auto& stmt = cast<ForStmt>(*node);
+        child("init", stmt.init);
+        child("cond", stmt.cond);
+        child("incr", stmt.incr);
+        child("body", stmt.body);
+        break;
+      }
+      case NodeKind::ReturnStmt:
+        child("value", cast<ReturnStmt>(*node).value);
+        break;
+      case NodeKind::ExprStmt:
+        child("expr", cast<ExprStmt>(*node).expr);
+        break;
+      case NodeKind::BinaryExpr: {
+        const auto& expr = cast<BinaryExpr>(*node);
+        field("op", spelling(expr.op));
+        if (expr.computation_type != nullptr) {
+          field("computationType", expr.computation_type->str());
+        }
+        child("lhs", expr.lhs);
+        child("rhs", expr.rhs);
+        break;
+      }
+      case NodeKind::UnaryExpr: {
+        const auto& expr = cast<UnaryExpr>(*node);
+        field("op", spelling(expr.op));
+        child("operand", expr.operand);
+        break;
+      }
+      case NodeKind::CallExpr: {
+        const auto& call = cast<CallExpr>(*node);
+        field("callee", call.callee.str());
+        key("args");
+        array(call.args);
+        break;
+      }
+      case NodeKind::MemberExpr: {
+        const auto& member = cast<MemberExpr>(*node);
+        field("member", member.member.str());
+        key("arrow");
+        out_.write(member.is_arrow ? "true" : "false");
+        if (member.field != nullptr) {
+          key("offset");
+          out_.writeInt(static_cast<long long>(member.field->offset));
+        }
+        child("object", member.object);
+        break;
+      }
+      case NodeKind::ArraySubscript: {
+        const auto& sub = cast<ArraySubscript>(*node);
+        child("array", sub.array);
+        child("index", sub.index);
+        break;
+      }
+      case NodeKind::IntLiteral:
+        key("value");
+        out_.writeInt(cast<IntLiteral>(*node).value);
+        break;
+      case NodeKind::FloatLiteral: {
+        const double value = cast<FloatLiteral>(*node).value;
+        key("value");
+        // JSON has no spelling for infinities or NaN, which folding can produce.
+        if (std::isfinite(value)) {
+          out_.writeDouble(value, 17);
+        } else {
+          out_.write("null");
+        }
+        break;
+      }
+      case NodeKind::CharLiteral:
+        key("value");
+        out_.writeInt(cast<CharLiteral>(*node).value);
+        break;
+      case NodeKind::StringLiteral:
+        field("value", cast<StringLiteral>(*node).value);
+        break;
+      case NodeKind::VarRef:
+        field("name", cast<VarRef>(*node).name.str());
+        break;
+      case NodeKind::ImplicitCastExpr: {
+        const auto& expr = cast<ImplicitCastExpr>(*node);
+        field("castKind", spelling(expr.cast_kind));
+        child("operand", expr.operand);
+        break;
+      }
+    }
+    out_.put('}');
   }
 
-  if (const auto* as = dynamic_cast<const ArraySubscript*>(node)) {
-    indent(out, depth);
-    out << "ArraySubscript\n";
-    printNode(as->array.get(), out, depth + 1);
-    printNode(as->index.get(), out, depth + 1);
-    return;
+ private:
+  void key(std::string_view name) {
+    out_.write(",\"");
+    out_.write(name);
+    out_.write("\":");
   }
 
-  if (const auto* il = dynamic_cast<const IntLiteral*>(node)) {
-    indent(out, depth);
-    out << "IntLiteral " << il->value << "\n";
-    return;
+  void field(std::string_view name, std::string_view value) {
+    key(name);
+    string(value);
   }
 
-  if (const auto* fl = dynamic_cast<const FloatLiteral*>(node)) {
-    indent(out, depth);
-    out << "FloatLiteral " << fl->value << "\n";
-    return;
+  void child(std::string_view name, const ASTNode* node) {
+    key(name);
+    print(node);
   }
 
-  if (const auto* cl = dynamic_cast<const CharLiteral*>(node)) {
-    indent(out, depth);
-    out << "CharLiteral " << static_cast<int>(cl->value) << "\n";
-    return;
+  void array(const std::vector<ASTNode*>& nodes) {
+    out_.put('[');
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      if (i != 0) {
+        out_.put(',');
+      }
+      print(nodes[i]);
+    }
+    out_.put(']');
   }
 
-  if (const auto* sl = dynamic_cast<const StringLiteral*>(node)) {
-    indent(out, depth);
-    out << "StringLiteral \"" << sl->value << "\"\n";
-    return;
+  void declaration(Symbol name, const Type* type) {
+    out_.write("{\"name\":");
+    string(name.str());
+    out_.write(",\"type\":");
+    string(type->str());
+    out_.put('}');
   }
 
-  if (const auto* vr = dynamic_cast<const VarRef*>(node)) {
-    indent(out, depth);
-    out << "VarRef " << vr->name << "\n";
-    return;
+  /** Writes `text` as a JSON string, copying runs that need no escaping in one go. */
+  void string(std::string_view text) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    out_.put('"');
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+      const auto byte = static_cast<unsigned char>(text[i]);
+      if (byte >= 0x20 && byte != '"' && byte != '\\') {
+        continue;
+      }
+      out_.write(text.substr(run, i - run));
+      run = i + 1;
+      if (byte < 0x20) {
+        const char escape[] = {'\\', 'u', '0', '0', kHex[byte >> 4], kHex[byte & 0xF]};
+        out_.write(std::string_view(escape, sizeof(escape)));
+      } else {
+        const char escape[] = {'\\', static_cast<char>(byte)};
+        out_.write(std::string_view(escape, sizeof(escape)));
+      }
+    }
+    out_.write(text.substr(run));
+    out_.put('"');
   }
 
-  indent(out, depth);
-  out << "<unknown-node>\n";
-}
+  support::BufferedWriter& out_;
+};
 
 }  // namespace
 
+void dump(const ASTNode& node, support::BufferedWriter& out, DumpFormat format) {
+  if (format == DumpFormat::JSON) {
+    JsonDumper(out).print(&node);
+    out.put('\n');
+  } else {
+    TextDumper(out).print(&node, 0);
+  }
+}
+
 std::string prettyPrint(const ASTNode& node) {
-  std::ostringstream out;
-  printNode(&node, out, 0);
-  return out.str();
+  std::string text;
+  support::BufferedWriter out(text);
+  dump(node, out, DumpFormat::Text);
+  return text;
 }
 
 }  // namespace compiler::ast
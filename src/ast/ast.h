@@ -1,156 +1,374 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "ast/ast_context.h"
+#include "ast/type.h"
+#include "support/string_interner.h"
+
+namespace compiler::support {
+class BufferedWriter;
+}
+
 namespace compiler::ast {
 
 struct ASTVisitor;
 
-/** Base AST node. */
+using support::Symbol;
+
+/** Binary and assignment operators. */
+enum class BinaryOp : std::uint8_t {
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Mod,
+  Eq,
+  Ne,
+  Lt,
+  Gt,
+  Le,
+  Ge,
+  LogicalAnd,
+  LogicalOr,
+  Assign,
+  AddAssign,
+  SubAssign,
+  MulAssign,
+  DivAssign,
+};
+
+/** Prefix unary operators. */
+enum class UnaryOp : std::uint8_t {
+  Neg,
+  Not,
+  AddressOf,
+  Deref,
+};
+
+/** Conversions made explicit by semantic analysis. */
+enum class CastKind : std::uint8_t {
+  ArrayToPointerDecay,
+  IntegralCast,
+  IntegralToFloating,
+  FloatingToIntegral,
+  NullToPointer,
+  BitCast,
+};
+
+/** Returns the source spelling of an operator, e.g. "+=", or the name of a cast kind. */
+const char* spelling(BinaryOp op);
+const char* spelling(UnaryOp op);
+const char* spelling(CastKind kind);
+
+/** Returns the operator a compound assignment applies (Add for +=); others map to themselves. */
+BinaryOp arithmeticOf(BinaryOp op);
+
+/** Concrete node types. Expression kinds are contiguous, from BinaryExpr to ImplicitCastExpr. */
+enum class NodeKind : std::uint8_t {
+  TranslationUnit,
+  FunctionDecl,
+  VarDecl,
+  StructDecl,
+  CompoundStmt,
+  IfStmt,
+  WhileStmt,
+  ForStmt,
+  ReturnStmt,
+  ExprStmt,
+  BinaryExpr,
+  UnaryExpr,
+  CallExpr,
+  MemberExpr,
+  ArraySubscript,
+  IntLiteral,
+  FloatLiteral,
+  CharLiteral,
+  StringLiteral,
+  VarRef,
+  ImplicitCastExpr,
+};
+
+/** Returns the class name of a node kind, e.g. "BinaryExpr". */
+const char* spelling(NodeKind kind);
+
+/**
+ * Base AST node. Nodes are arena-allocated and referenced by raw pointer.
+ * Every node records its concrete kind, so passes can test and downcast it
+ * with isa/cast/dyn_cast below instead of dynamic_cast.
+ */
 struct ASTNode {
   virtual ~ASTNode() = default;
   virtual void accept(ASTVisitor& visitor) = 0;
+  NodeKind kind() const { return kind_; }
   int line = 1;
-};
 
-struct TypeInfo {
-  std::string name;
+ protected:
+  explicit ASTNode(NodeKind kind) : kind_(kind) {}
+
+ private:
+  NodeKind kind_;
 };
 
-struct ParamDecl {
-  std::string name;
-  TypeInfo type;
+/** A named object: a variable or a parameter. Name lookup resolves to one of these. */
+struct ValueDecl {
+  Symbol name;
+  const Type* type = nullptr;
 };
 
+struct ParamDecl : ValueDecl {};
+
 struct FieldDecl {
-  std::string name;
-  TypeInfo type;
+  Symbol name;
+  const Type* type = nullptr;
 };
 
 struct CompoundStmt;
 
+/** Root node; owns the context whose arena holds every other node. */
 struct TranslationUnit : ASTNode {
-  std::vector<std::unique_ptr<ASTNode>> decls;
+  TranslationUnit() : ASTNode(NodeKind::TranslationUnit) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::TranslationUnit; }
+
+  std::unique_ptr<ASTContext> context;
+  std::vector<ASTNode*> decls;
+  /** Set once semantic analysis has annotated every expression without errors. */
+  bool analyzed = false;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct FunctionDecl : ASTNode {
-  std::string name;
-  TypeInfo return_type;
+  FunctionDecl() : ASTNode(NodeKind::FunctionDecl) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::FunctionDecl; }
+
+  Symbol name;
+  const Type* return_type = nullptr;
   std::vector<ParamDecl> params;
-  std::unique_ptr<CompoundStmt> body;
+  CompoundStmt* body = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct VarDecl : ASTNode {
-  std::string name;
-  TypeInfo type;
-  std::unique_ptr<ASTNode> init;
+struct VarDecl : ASTNode, ValueDecl {
+  VarDecl() : ASTNode(NodeKind::VarDecl) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::VarDecl; }
+
+  ASTNode* init = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct StructDecl : ASTNode {
-  std::string name;
+  StructDecl() : ASTNode(NodeKind::StructDecl) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::StructDecl; }
+
+  Symbol name;
   std::vector<FieldDecl> fields;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct CompoundStmt : ASTNode {
-  std::vector<std::unique_ptr<ASTNode>> stmts;
+  CompoundStmt() : ASTNode(NodeKind::CompoundStmt) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::CompoundStmt; }
+
+  std::vector<ASTNode*> stmts;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct IfStmt : ASTNode {
-  std::unique_ptr<ASTNode> cond;
-  std::unique_ptr<ASTNode> then_branch;
-  std::unique_ptr<ASTNode> else_branch;
+  IfStmt() : ASTNode(NodeKind::IfStmt) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::IfStmt; }
+
+  ASTNode* cond = nullptr;
+  ASTNode* then_branch = nullptr;
+  ASTNode* else_branch = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct WhileStmt : ASTNode {
-  std::unique_ptr<ASTNode> cond;
-  std::unique_ptr<ASTNode> body;
+  WhileStmt() : ASTNode(NodeKind::WhileStmt) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::WhileStmt; }
+
+  ASTNode* cond = nullptr;
+  ASTNode* body = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct ForStmt : ASTNode {
-  std::unique_ptr<ASTNode> init;
-  std::unique_ptr<ASTNode> cond;
-  std::unique_ptr<ASTNode> incr;
-  std::unique_ptr<ASTNode> body;
+  ForStmt() : ASTNode(NodeKind::ForStmt) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::ForStmt; }
+
+  ASTNode* init = nullptr;
+  ASTNode* cond = nullptr;
+  ASTNode* incr = nullptr;
+  ASTNode* body = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct ReturnStmt : ASTNode {
-  std::unique_ptr<ASTNode> value;
+  ReturnStmt() : ASTNode(NodeKind::ReturnStmt) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::ReturnStmt; }
+
+  ASTNode* value = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
 struct ExprStmt : ASTNode {
-  std::unique_ptr<ASTNode> expr;
+  ExprStmt() : ASTNode(NodeKind::ExprStmt) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::ExprStmt; }
+
+  ASTNode* expr = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct BinaryExpr : ASTNode {
-  std::string op;
-  std::unique_ptr<ASTNode> lhs;
-  std::unique_ptr<ASTNode> rhs;
+/** Base of every expression. The annotations are filled in by semantic analysis. */
+struct Expr : ASTNode {
+  static bool classof(const ASTNode* node) {
+    return node->kind() >= NodeKind::BinaryExpr && node->kind() <= NodeKind::ImplicitCastExpr;
+  }
+
+  /** Type of the value, or of the object an lvalue designates. */
+  const Type* type = nullptr;
+  /** True if the expression designates an object that can be assigned or addressed. */
+  bool is_lvalue = false;
+
+ protected:
+  explicit Expr(NodeKind kind) : ASTNode(kind) {}
+};
+
+struct BinaryExpr : Expr {
+  BinaryExpr() : Expr(NodeKind::BinaryExpr) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::BinaryExpr; }
+
+  BinaryOp op = BinaryOp::Add;
+  ASTNode* lhs = nullptr;
+  ASTNode* rhs = nullptr;
+  /** For compound assignments, the type the operation is carried out in. */
+  const Type* computation_type = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct UnaryExpr : ASTNode {
-  std::string op;
-  std::unique_ptr<ASTNode> operand;
+struct UnaryExpr : Expr {
+  UnaryExpr() : Expr(NodeKind::UnaryExpr) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::UnaryExpr; }
+
+  UnaryOp op = UnaryOp::Neg;
+  ASTNode* operand = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct CallExpr : ASTNode {
-  std::string callee;
-  std::vector<std::unique_ptr<ASTNode>> args;
+struct CallExpr : Expr {
+  CallExpr() : Expr(NodeKind::CallExpr) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::CallExpr; }
+
+  Symbol callee;
+  std::vector<ASTNode*> args;
+  /** The called function, or null for an implicitly declared `int callee(...)`. */
+  const FunctionDecl* function = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct MemberExpr : ASTNode {
-  std::unique_ptr<ASTNode> object;
-  std::string member;
+struct MemberExpr : Expr {
+  MemberExpr() : Expr(NodeKind::MemberExpr) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::MemberExpr; }
+
+  ASTNode* object = nullptr;
+  Symbol member;
   bool is_arrow = false;
+  const Field* field = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct ArraySubscript : ASTNode {
-  std::unique_ptr<ASTNode> array;
-  std::unique_ptr<ASTNode> index;
+struct ArraySubscript : Expr {
+  ArraySubscript() : Expr(NodeKind::ArraySubscript) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::ArraySubscript; }
+
+  ASTNode* array = nullptr;
+  ASTNode* index = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct IntLiteral : ASTNode {
+struct IntLiteral : Expr {
+  IntLiteral() : Expr(NodeKind::IntLiteral) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::IntLiteral; }
+
   long long value = 0;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct FloatLiteral : ASTNode {
+struct FloatLiteral : Expr {
+  FloatLiteral() : Expr(NodeKind::FloatLiteral) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::FloatLiteral; }
+
   double value = 0.0;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct CharLiteral : ASTNode {
+struct CharLiteral : Expr {
+  CharLiteral() : Expr(NodeKind::CharLiteral) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::CharLiteral; }
+
   char value = '\0';
   void accept(ASTVisitor& visitor) override;
 };
 
-struct StringLiteral : ASTNode {
+struct StringLiteral : Expr {
+  StringLiteral() : Expr(NodeKind::StringLiteral) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::StringLiteral; }
+
   std::string value;
   void accept(ASTVisitor& visitor) override;
 };
 
-struct VarRef : ASTNode {
-  std::string name;
+struct VarRef : Expr {
+  VarRef() : Expr(NodeKind::VarRef) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::VarRef; }
+
+  Symbol name;
+  const ValueDecl* decl = nullptr;
   void accept(ASTVisitor& visitor) override;
 };
 
+/** A conversion inserted by semantic analysis; `type` is the converted-to type. */
+struct ImplicitCastExpr : Expr {
+  ImplicitCastExpr() : Expr(NodeKind::ImplicitCastExpr) {}
+  static bool classof(const ASTNode* node) { return node->kind() == NodeKind::ImplicitCastExpr; }
+
+  CastKind cast_kind = CastKind::IntegralCast;
+  ASTNode* operand = nullptr;
+  void accept(ASTVisitor& visitor) override;
+};
+
+/** True if `node` is non-null and a T (or, for Expr, any expression). */
+template <typename T>
+bool isa(const ASTNode* node) {
+  return node != nullptr && T::classof(node);
+}
+
+/** Downcasts a node known to be a T. */
+template <typename T>
+T& cast(ASTNode& node) {
+  return static_cast<T&>(node);
+}
+
+template <typename T>
+const T& cast(const ASTNode& node) {
+  return static_cast<const T&>(node);
+}
+
+/** Downcasts `node` if it is a T; null otherwise, including for a null node. */
+template <typename T>
+T* dyn_cast(ASTNode* node) {
+  return isa<T>(node) ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* dyn_cast(const ASTNode* node) {
+  return isa<T>(node) ? static_cast<const T*>(node) : nullptr;
+}
+
 /** AST visitor interface. */
 struct ASTVisitor {
   virtual ~ASTVisitor() = default;
@@ -174,8 +392,20 @@ struct ASTVisitor {
   virtual void visit(CharLiteral&) = 0;
   virtual void visit(StringLiteral&) = 0;
   virtual void visit(VarRef&) = 0;
+  virtual void visit(ImplicitCastExpr&) = 0;
 };
 
+/** Output formats for dump(). */
+enum class DumpFormat : std::uint8_t {
+  /** Indented outline, one node per line; what prettyPrint returns. */
+  Text,
+  /** One compact JSON object per node, including sema annotations, for external tools. */
+  JSON,
+};
+
+/** Streams a dump of the subtree into `out`. */
+void dump(const ASTNode& node, support::BufferedWriter& out, DumpFormat format = DumpFormat::Text);
+
 /** Pretty-prints an AST subtree. */
 std::string prettyPrint(const ASTNode& node);
 
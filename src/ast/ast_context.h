@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+#include "ast/type.h"
+#include "support/arena.h"
+#include "support/string_interner.h"
+
+namespace compiler::ast {
+
+/**
+ * Owns the memory backing one parsed translation unit. Every AST node is
+ * allocated from the context's arena and released together with it, all
+ * identifiers are interned in the context's string table, and every type is
+ * uniqued in the context's type table.
+ */
+class ASTContext {
+ public:
+  ASTContext() = default;
+
+  ASTContext(const ASTContext&) = delete;
+  ASTContext& operator=(const ASTContext&) = delete;
+
+  /** Allocates and constructs a node in the context arena. */
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    return arena_.create<T>(std::forward<Args>(args)...);
+  }
+
+  /** Interns an identifier or type name. */
+  support::Symbol intern(std::string_view text) { return interner_.intern(text); }
+
+  /** Returns the interner shared by the lexer, parser and symbol table. */
+  support::StringInterner& interner() { return interner_; }
+
+  /** Returns the types referenced by this translation unit. */
+  TypeContext& types() { return types_; }
+
+  /** Returns the bytes reserved for nodes so far. */
+  std::size_t bytesReserved() const { return arena_.bytesReserved(); }
+
+ private:
+  support::StringInterner interner_;
+  support::Arena arena_;
+  TypeContext types_;
+};
+
+}  // namespace compiler::ast
@@ -0,0 +1,231 @@
+#include "ast/fingerprint.h"
+
+#include <cstring>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace compiler::ast {
+
+namespace {
+
+/**
+ * Writes a node as its kind followed by its fields and parenthesized
+ * children. Names and string values are length-prefixed, so no two trees
+ * share an encoding.
+ */
+class Fingerprinter {
+ public:
+  std::string run(const FunctionDecl& fn) {
+    word("fn");
+    name(fn.name.str());
+    type(fn.return_type);
+    for (const auto& param : fn.params) {
+      name(param.name.str());
+      type(param.type);
+    }
+    node(fn.body);
+
+    // Layouts go last: they may only be discovered deep in the body.
+    for (std::size_t i = 0; i < structs_.size(); ++i) {
+      const StructType* record = structs_[i];
+      word("layout");
+      name(record->name().str());
+      number(record->size());
+      number(record->align());
+      for (const Field& field : record->fields()) {
+        name(field.name.str());
+        type(field.type);
+        number(field.offset);
+      }
+    }
+    return std::move(out_);
+  }
+
+ private:
+  void word(std::string_view text) {
+    out_.append(text.data(), text.size());
+    out_.push_back(' ');
+  }
+
+  void number(unsigned long long value) { word(std::to_string(value)); }
+
+  void name(std::string_view text) {
+    number(text.size());
+    word(text);
+  }
+
+  /** Spells the type and queues the layouts of structs it reaches. */
+  void type(const Type* type) {
+    if (type == nullptr) {
+      word("_");
+      return;
+    }
+    word(type->str());
+    noteStructs(type);
+  }
+
+  void noteStructs(const Type* type) {
+    while (type->element() != nullptr) {
+      type = type->element();
+    }
+    if (const FunctionType* fn = type->asFunction()) {
+      noteStructs(fn->result());
+      for (const Type* param : fn->params()) {
+        noteStructs(param);
+      }
+    } else if (const StructType* record = type->asStruct()) {
+      if (seen_.insert(record).second) {
+        structs_.push_back(record);
+        for (const Field& field : record->fields()) {
+          noteStructs(field.type);
+        }
+      }
+    }
+  }
+
+  void children(const std::vector<ASTNode*>& nodes) {
+    number(nodes.size());
+    for (const ASTNode* child : nodes) {
+      node(child);
+    }
+  }
+
+  void node(const ASTNode* node) {
+    if (node == nullptr) {
+      word("_");
+      return;
+    }
+    word("(");
+    word(spelling(node->kind()));
+    if (const auto* expr = dyn_cast<Expr>(node)) {
+      type(expr->type);
+      word(expr->is_lvalue ? "l" : "r");
+    }
+
+    switch (node->kind()) {
+      case NodeKind::TranslationUnit:
+      case NodeKind::FunctionDecl:
+      case NodeKind::StructDecl:
+        // Only reachable at the top level, never inside a body.
+        break;
+      case NodeKind::VarDecl: {
+        const auto& var = cast<VarDecl>(*node);
+        name(var.name.str());
+        type(var.type);
+        this->node(var.init);
+        break;
+      }
+      case NodeKind::CompoundStmt:
+        children(cast<CompoundStmt>(*node).stmts);
+        break;
+      case NodeKind::IfStmt: {
+        const auto& stmt = cast<IfStmt>(*node);
+        this->node(stmt.cond);
+        this->node(stmt.then_branch);
+        this->node(stmt.else_branch);
+        break;
+      }
+      case NodeKind::WhileStmt: {
+        const auto& stmt = cast<WhileStmt>(*node);
+        this->node(stmt.cond);
+        this->node(stmt.body);
+        break;
+      }
+      case NodeKind::ForStmt: {
+        const auto& stmt = cast<ForStmt>(*node);
+        this->node(stmt.init);
+        this->node(stmt.cond);
+        this->node(stmt.incr);
+        this->node(stmt.body);
+        break;
+      }
+      case NodeKind::ReturnStmt:
+        this->node(cast<ReturnStmt>(*node).value);
+        break;
+      case NodeKind::ExprStmt:
+        this->node(cast<ExprStmt>(*node).expr);
+        break;
+      case NodeKind::BinaryExpr: {
+        const auto& expr = cast<BinaryExpr>(*node);
+        word(spelling(expr.op));
+        type(expr.computation_type);
+        this->node(expr.lhs);
+        this->node(expr.rhs);
+        break;
+      }
+      case NodeKind::UnaryExpr: {
+        const auto& expr = cast<UnaryExpr>(*node);
+        word(spelling(expr.op));
+        this->node(expr.operand);
+        break;
+      }
+      case NodeKind::CallExpr: {
+        // The call is lowered against the callee's prototype, not its body.
+        const auto& call = cast<CallExpr>(*node);
+        name(call.callee.str());
+        if (call.function == nullptr) {
+          word("implicit");
+        } else {
+          type(call.function->return_type);
+          number(call.function->params.size());
+          for (const auto& param : call.function->params) {
+            type(param.type);
+          }
+        }
+        children(call.args);
+        break;
+      }
+      case NodeKind::MemberExpr: {
+        const auto& member = cast<MemberExpr>(*node);
+        name(member.member.str());
+        word(member.is_arrow ? "->" : ".");
+        this->node(member.object);
+        break;
+      }
+      case NodeKind::ArraySubscript: {
+        const auto& sub = cast<ArraySubscript>(*node);
+        this->node(sub.array);
+        this->node(sub.index);
+        break;
+      }
+      case NodeKind::IntLiteral:
+        word(std::to_string(cast<IntLiteral>(*node).value));
+        break;
+      case NodeKind::FloatLiteral: {
+        // The bit pattern, so that every distinct value has its own spelling.
+        unsigned long long bits = 0;
+        const double value = cast<FloatLiteral>(*node).value;
+        std::memcpy(&bits, &value, sizeof(bits));
+        number(bits);
+        break;
+      }
+      case NodeKind::CharLiteral:
+        number(static_cast<unsigned char>(cast<CharLiteral>(*node).value));
+        break;
+      case NodeKind::StringLiteral:
+        name(cast<StringLiteral>(*node).value);
+        break;
+      case NodeKind::VarRef:
+        name(cast<VarRef>(*node).name.str());
+        break;
+      case NodeKind::ImplicitCastExpr: {
+        const auto& expr = cast<ImplicitCastExpr>(*node);
+        word(spelling(expr.cast_kind));
+        this->node(expr.operand);
+        break;
+      }
+    }
+    word(")");
+  }
+
+  std::string out_;
+  std::vector<const StructType*> structs_;
+  std::unordered_set<const StructType*> seen_;
+};
+
+}  // namespace
+
+std::string fingerprint(const FunctionDecl& fn) { return Fingerprinter().run(fn); }
+
+}  // namespace compiler::ast
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+#include "ast/ast.h"
+
+namespace compiler::ast {
+
+/**
+ * Returns a canonical encoding of everything an analyzed function's IR
+ * depends on: its signature and body with every sema annotation, the
+ * signatures of the functions it calls and the layouts of the structs it
+ * touches. Line numbers are left out, so edits elsewhere in the file do not
+ * change it. Two functions with equal fingerprints lower to the same IR; hash
+ * the result for a compact key.
+ */
+std::string fingerprint(const FunctionDecl& fn);
+
+}  // namespace compiler::ast
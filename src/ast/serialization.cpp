@@ -0,0 +1,753 @@
+#include "ast/serialization.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "support/buffered_writer.h"
+#include "support/instrumentation.h"
+#include "support/source_buffer.h"
+
+namespace compiler::ast {
+
+namespace {
+
+constexpr char kMagic[] = {'C', 'A', 'S', 'T'};
+constexpr std::uint8_t kNullNode = 0xFF;
+/**
+ * Deepest node the decoder accepts. Far deeper than real code nests, and
+ * shallow enough for the recursive reader to fit a worker thread's stack.
+ */
+constexpr std::size_t kMaxNodeDepth = 10000;
+
+void putVarint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void putByte(std::string& out, std::uint8_t value) { out.push_back(static_cast<char>(value)); }
+
+void putBytes(std::string& out, std::string_view bytes) {
+  putVarint(out, bytes.size());
+  out.append(bytes.data(), bytes.size());
+}
+
+// --- Encoder ---
+
+/**
+ * Encodes the node tree into one buffer while collecting the symbols and
+ * types it references into two others, so each table can be written ahead
+ * of its first use.
+ */
+class Encoder {
+ public:
+  bool encode(const TranslationUnit& unit, std::string& error) {
+    node(&unit);
+    if (analyzed_) {
+      error = "translation unit has already been semantically analyzed";
+      return false;
+    }
+    return true;
+  }
+
+  void writeTo(support::BufferedWriter& out) const {
+    std::string header(kMagic, sizeof(kMagic));
+    putByte(header, kASTFormatVersion);
+    putVarint(header, symbol_ids_.size());
+    out.write(header);
+    out.write(symbols_);
+    header.clear();
+    putVarint(header, type_ids_.size());
+    out.write(header);
+    out.write(types_);
+    out.write(nodes_);
+  }
+
+ private:
+  std::uint64_t symbol(Symbol name) {
+    if (name.empty()) {
+      return 0;
+    }
+    const auto [it, inserted] = symbol_ids_.try_emplace(name, symbol_ids_.size() + 1);
+    if (inserted) {
+      putBytes(symbols_, name.str());
+    }
+    return it->second;
+  }
+
+  std::uint64_t type(const Type* type) {
+    if (type == nullptr) {
+      return 0;
+    }
+    if (const auto it = type_ids_.find(type); it != type_ids_.end()) {
+      return it->second;
+    }
+
+    // Referenced types get their ids first, so a record only points backwards.
+    std::string record;
+    putByte(record, static_cast<std::uint8_t>(type->kind()));
+    switch (type->kind()) {
+      case Type::Kind::Void:
+      case Type::Kind::Char:
+      case Type::Kind::Int:
+      case Type::Kind::Float:
+        break;
+      case Type::Kind::Pointer:
+        putVarint(record, this->type(type->element()));
+        break;
+      case Type::Kind::Array:
+        putVarint(record, this->type(type->element()));
+        putVarint(record, type->count());
+        break;
+      case Type::Kind::Struct:
+        putVarint(record, symbol(type->asStruct()->name()));
+        break;
+      case Type::Kind::Function: {
+        const FunctionType* fn = type->asFunction();
+        putVarint(record, this->type(fn->result()));
+        putVarint(record, fn->params().size());
+        for (const Type* param : fn->params()) {
+          putVarint(record, this->type(param));
+        }
+        putByte(record, fn->isVariadic() ? 1 : 0);
+        break;
+      }
+    }
+    types_ += record;
+    const std::uint64_t id = type_ids_.size() + 1;
+    type_ids_.emplace(type, id);
+    return id;
+  }
+
+  void declaration(Symbol name, const Type* type) {
+    putVarint(nodes_, symbol(name));
+    putVarint(nodes_, this->type(type));
+  }
+
+  void list(const std::vector<ASTNode*>& nodes) {
+    putVarint(nodes_, nodes.size());
+    for (const ASTNode* child : nodes) {
+      node(child);
+    }
+  }
+
+  void node(const ASTNode* node) {
+    if (node == nullptr) {
+      putByte(nodes_, kNullNode);
+      return;
+    }
+    putByte(nodes_, static_cast<std::uint8_t>(node->kind()));
+    putVarint(nodes_, static_cast<std::uint32_t>(node->line));
+
+    switch (node->kind()) {
+      case NodeKind::TranslationUnit: {
+        const auto& unit = cast<TranslationUnit>(*node);
+        analyzed_ = analyzed_ || unit.analyzed;
+        list(unit.decls);
+        break;
+      }
+      case NodeKind::FunctionDecl: {
+        const auto& fn = cast<FunctionDecl>(*node);
+        declaration(fn.name, fn.return_type);
+        putVarint(nodes_, fn.params.size());
+        for (const auto& param : fn.params) {
+          declaration(param.name, param.type);
+        }
+        this->node(fn.body);
+        break;
+      }
+      case NodeKind::VarDecl: {
+        const auto& var = cast<VarDecl>(*node);
+        declaration(var.name, var.type);
+        this->node(var.init);
+        break;
+      }
+      case NodeKind::StructDecl: {
+        const auto& st = cast<StructDecl>(*node);
+        putVarint(nodes_, symbol(st.name));
+        putVarint(nodes_, st.fields.size());
+        for (const auto& field : st.fields) {
+          declaration(field.name, field.type);
+        }
+        break;
+      }
+      case NodeKind::CompoundStmt:
+        list(cast<CompoundStmt>(*node).stmts);
+        break;
+      case NodeKind::IfStmt: {
+        const auto& stmt = cast<IfStmt>(*node);
+        this->node(stmt.cond);
+        this->node(stmt.then_branch);
+        this->node(stmt.else_branch);
+        break;
+      }
+      case NodeKind::WhileStmt: {
+        const auto& stmt = cast<WhileStmt>(*node);
+        this->node(stmt.cond);
+        this->node(stmt.body);
+        break;
+      }
+      case NodeKind::ForStmt: {
+        const auto& stmt = cast<ForStmt>(*node);
+        this->node(stmt.init);
+        this->node(stmt.cond);
+        this->node(stmt.incr);
+        this->node(stmt.body);
+        break;
+      }
+      case NodeKind::ReturnStmt:
+        this->node(cast<ReturnStmt>(*node).value);
+        break;
+      case NodeKind::ExprStmt:
+        this->node(cast<ExprStmt>(*node).expr);
+        break;
+      case NodeKind::BinaryExpr: {
+        const auto& expr = cast<BinaryExpr>(*node);
+        putByte(nodes_, static_cast<std::uint8_t>(expr.op));
+        this->node(expr.lhs);
+        this->node(expr.rhs);
+        break;
+      }
+      case NodeKind::UnaryExpr: {
+        const auto& expr = cast<UnaryExpr>(*node);
+        putByte(nodes_, static_cast<std::uint8_t>(expr.op));
+        this->node(expr.operand);
+        break;
+      }
+      case NodeKind::CallExpr: {
+        const auto& call = cast<CallExpr>(*node);
+        putVarint(nodes_, symbol(call.callee));
+        list(call.args);
+        break;
+      }
+      case NodeKind::MemberExpr: {
+        const auto& member = cast<MemberExpr>(*node);
+        putVarint(nodes_, symbol(member.member));
+        putByte(nodes_, member.is_arrow ? 1 : 0);
+        this->node(member.object);
+        break;
+      }
+      case NodeKind::ArraySubscript: {
+        const auto& sub = cast<ArraySubscript>(*node);
+        this->node(sub.array);
+        this->node(sub.index);
+        break;
+      }
+      case NodeKind::IntLiteral: {
+        const auto value = static_cast<std::uint64_t>(cast<IntLiteral>(*node).value);
+        // Zigzag keeps small negative values small.
+        putVarint(nodes_, (value << 1) ^ (value >> 63 != 0 ? ~std::uint64_t{0} : 0));
+        break;
+      }
+      case NodeKind::FloatLiteral: {
+        std::uint64_t bits = 0;
+        const double value = cast<FloatLiteral>(*node).value;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int shift = 0; shift < 64; shift += 8) {
+          putByte(nodes_, static_cast<std::uint8_t>(bits >> shift));
+        }
+        break;
+      }
+      case NodeKind::CharLiteral:
+        putByte(nodes_, static_cast<std::uint8_t>(cast<CharLiteral>(*node).value));
+        break;
+      case NodeKind::StringLiteral:
+        putBytes(nodes_, cast<StringLiteral>(*node).value);
+        break;
+      case NodeKind::VarRef:
+        putVarint(nodes_, symbol(cast<VarRef>(*node).name));
+        break;
+      case NodeKind::ImplicitCastExpr:
+        // Only semantic analysis inserts these.
+        analyzed_ = true;
+        this->node(cast<ImplicitCastExpr>(*node).operand);
+        break;
+    }
+  }
+
+  std::string symbols_;
+  std::string types_;
+  std::string nodes_;
+  std::unordered_map<Symbol, std::uint64_t> symbol_ids_;
+  std::unordered_map<const Type*, std::uint64_t> type_ids_;
+  bool analyzed_ = false;
+};
+
+// --- Decoder ---
+
+/**
+ * Reads the format back with bounds checks on every field. The first
+ * problem is recorded and turns all further reads into no-ops that return
+ * zero, so callers check ok() once at the end instead of after each field.
+ */
+class Decoder {
+ public:
+  explicit Decoder(std::string_view bytes) : bytes_(bytes) {}
+
+  std::unique_ptr<TranslationUnit> decode(std::string& error) {
+    auto unit = std::make_unique<TranslationUnit>();
+    unit->context = std::make_unique<ASTContext>();
+    context_ = unit->context.get();
+
+    if (bytes_.substr(0, sizeof(kMagic)) != std::string_view(kMagic, sizeof(kMagic))) {
+      error = "not a serialized AST";
+      return nullptr;
+    }
+    pos_ = sizeof(kMagic);
+    if (byte() != kASTFormatVersion) {
+      error = "unsupported AST format version";
+      return nullptr;
+    }
+    readSymbols();
+    readTypes();
+
+    if (byte() != static_cast<std::uint8_t>(NodeKind::TranslationUnit)) {
+      fail("expected a translation unit");
+    }
+    unit->line = line();
+    const std::uint64_t count = length();
+    for (std::uint64_t i = 0; i < count && error_.empty(); ++i) {
+      ASTNode* decl = node();
+      if (!isa<FunctionDecl>(decl) && !isa<VarDecl>(decl) && !isa<StructDecl>(decl)) {
+        fail("expected a top-level declaration");
+      }
+      unit->decls.push_back(decl);
+    }
+    if (error_.empty() && pos_ != bytes_.size()) {
+      fail("trailing bytes after the translation unit");
+    }
+    if (!error_.empty()) {
+      error = error_;
+      return nullptr;
+    }
+    return unit;
+  }
+
+ private:
+  void fail(const char* message) {
+    if (error_.empty()) {
+      error_ = std::string("corrupt AST file: ") + message;
+    }
+    pos_ = bytes_.size();
+  }
+
+  std::uint8_t byte() {
+    if (pos_ >= bytes_.size()) {
+      fail("unexpected end of file");
+      return 0;
+    }
+    return static_cast<std::uint8_t>(bytes_[pos_++]);
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const std::uint8_t b = byte();
+      value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80) == 0) {
+        return value;
+      }
+    }
+    fail("overlong integer");
+    return 0;
+  }
+
+  /** A count of items that each take at least one byte, so it cannot exceed what is left. */
+  std::uint64_t length() {
+    const std::uint64_t count = varint();
+    if (count > bytes_.size() - pos_) {
+      fail("length exceeds file size");
+      return 0;
+    }
+    return count;
+  }
+
+  std::string_view bytes() {
+    const std::uint64_t size = length();
+    const std::string_view result = bytes_.substr(pos_, size);
+    pos_ += size;
+    return result;
+  }
+
+  int line() {
+    const std::uint64_t value = varint();
+    if (value > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) {
+      fail("line number out of range");
+      return 1;
+    }
+    return static_cast<int>(value);
+  }
+
+  template <typename Enum>
+  Enum enumerator(Enum last) {
+    const std::uint8_t value = byte();
+    if (value > static_cast<std::uint8_t>(last)) {
+      fail("operator out of range");
+      return Enum{};
+    }
+    return static_cast<Enum>(value);
+  }
+
+  void readSymbols() {
+    const std::uint64_t count = length();
+    symbols_.reserve(count);
+    for (std::uint64_t i = 0; i < count && error_.empty(); ++i) {
+      symbols_.push_back(context_->intern(bytes()));
+    }
+  }
+
+  Symbol symbol() {
+    const std::uint64_t id = varint();
+    if (id > symbols_.size()) {
+      fail("symbol index out of range");
+      return Symbol();
+    }
+    return id == 0 ? Symbol() : symbols_[id - 1];
+  }
+
+  /** Reads a type reference; only types already in the table can be named. */
+  const Type* type() {
+    const std::uint64_t id = varint();
+    if (id > types_.size()) {
+      fail("type index out of range");
+      return nullptr;
+    }
+    return id == 0 ? nullptr : types_[id - 1];
+  }
+
+  const Type* requiredType() {
+    const Type* result = type();
+    if (result == nullptr) {
+      fail("missing type");
+    }
+    return result;
+  }
+
+  void readTypes() {
+    TypeContext& types = context_->types();
+    const std::uint64_t count = length();
+    types_.reserve(count);
+    for (std::uint64_t i = 0; i < count && error_.empty(); ++i) {
+      const auto kind = enumerator(Type::Kind::Struct);
+      const Type* result = nullptr;
+      switch (kind) {
+        case Type::Kind::Void:
+          result = types.voidType();
+          break;
+        case Type::Kind::Char:
+          result = types.charType();
+          break;
+        case Type::Kind::Int:
+          result = types.intType();
+          break;
+        case Type::Kind::Float:
+          result = types.floatType();
+          break;
+        case Type::Kind::Pointer: {
+          const Type* element = requiredType();
+          if (error_.empty()) {
+            result = types.pointerTo(element);
+          }
+          break;
+        }
+        case Type::Kind::Array: {
+          const Type* element = requiredType();
+          const std::uint64_t size = varint();
+          if (error_.empty()) {
+            result = types.arrayOf(element, size);
+          }
+          break;
+        }
+        case Type::Kind::Struct: {
+          const Symbol name = symbol();
+          if (name.empty()) {
+            fail("unnamed struct type");
+            break;
+          }
+          result = types.structNamed(name);
+          break;
+        }
+        case Type::Kind::Function: {
+          const Type* fn_result = requiredType();
+          std::vector<const Type*> params(length());
+          for (auto& param : params) {
+            param = requiredType();
+          }
+          const bool variadic = byte() != 0;
+          if (error_.empty()) {
+            result = types.functionType(fn_result, std::move(params), variadic);
+          }
+          break;
+        }
+      }
+      types_.push_back(result);
+    }
+  }
+
+  void list(std::vector<ASTNode*>& nodes) {
+    const std::uint64_t count = length();
+    nodes.reserve(count);
+    for (std::uint64_t i = 0; i < count && error_.empty(); ++i) {
+      nodes.push_back(node());
+    }
+  }
+
+  /** Reads an optional expression. */
+  ASTNode* expr() {
+    ASTNode* result = node();
+    if (result != nullptr && !isa<Expr>(result)) {
+      fail("expected an expression");
+    }
+    return result;
+  }
+
+  ASTNode* requiredExpr() {
+    ASTNode* result = expr();
+    if (result == nullptr) {
+      fail("missing operand");
+    }
+    return result;
+  }
+
+  template <typename T>
+  T* make(int line) {
+    T* node = context_->create<T>();
+    node->line = line;
+    return node;
+  }
+
+  /** Reads any node below the root; statements may be expressions or declarations. */
+  ASTNode* node() {
+    // Nodes are read recursively, so a corrupt file could otherwise nest deep
+    // enough to overflow the stack before any field check fails.
+    if (depth_ == kMaxNodeDepth) {
+      fail("nesting too deep");
+      return nullptr;
+    }
+    ++depth_;
+    ASTNode* result = readNode();
+    --depth_;
+    return result;
+  }
+
+  ASTNode* readNode() {
+    const std::uint8_t tag = byte();
+    if (tag == kNullNode || !error_.empty()) {
+      return nullptr;
+    }
+    // Implicit casts come from semantic analysis, which is never serialized.
+    if (tag == static_cast<std::uint8_t>(NodeKind::TranslationUnit) ||
+        tag >= static_cast<std::uint8_t>(NodeKind::ImplicitCastExpr)) {
+      fail("unexpected node kind");
+      return nullptr;
+    }
+    const int line = this->line();
+
+    switch (static_cast<NodeKind>(tag)) {
+      case NodeKind::FunctionDecl: {
+        auto* fn = make<FunctionDecl>(line);
+        fn->name = symbol();
+        fn->return_type = requiredType();
+        fn->params.resize(length());
+        for (auto& param : fn->params) {
+          param.name = symbol();
+          param.type = requiredType();
+        }
+        fn->body = dyn_cast<CompoundStmt>(node());
+        if (fn->body == nullptr) {
+          fail("function without a body");
+        }
+        return fn;
+      }
+      case NodeKind::VarDecl: {
+        auto* var = make<VarDecl>(line);
+        var->name = symbol();
+        var->type = requiredType();
+        var->init = expr();
+        return var;
+      }
+      case NodeKind::StructDecl: {
+        auto* st = make<StructDecl>(line);
+        st->name = symbol();
+        st->fields.resize(length());
+        for (auto& field : st->fields) {
+          field.name = symbol();
+          field.type = requiredType();
+        }
+        return st;
+      }
+      case NodeKind::CompoundStmt: {
+        auto* stmt = make<CompoundStmt>(line);
+        list(stmt->stmts);
+        return stmt;
+      }
+      case NodeKind::IfStmt: {
+        auto* stmt = make<IfStmt>(line);
+        stmt->cond = requiredExpr();
+        stmt->then_branch = node();
+        stmt->else_branch = node();
+        return stmt;
+      }
+      case NodeKind::WhileStmt: {
+        auto* stmt = make<WhileStmt>(line);
+        stmt->cond = requiredExpr();
+        stmt->body = node();
+        return stmt;
+      }
+      case NodeKind::ForStmt: {
+        auto* stmt = make<ForStmt>(line);
+        stmt->init = node();
+        stmt->cond = expr();
+        stmt->incr = expr();
+        stmt->body = node();
+        return stmt;
+      }
+      case NodeKind::ReturnStmt: {
+        auto* stmt = make<ReturnStmt>(line);
+        stmt->value = expr();
+        return stmt;
+      }
+      case NodeKind::ExprStmt: {
+        auto* stmt = make<ExprStmt>(line);
+        stmt->expr = expr();
+        return stmt;
+      }
+      case NodeKind::BinaryExpr: {
+        auto* expr = make<BinaryExpr>(line);
+        expr->op = enumerator(BinaryOp::DivAssign);
+        expr->lhs = requiredExpr();
+        expr->rhs = requiredExpr();
+        return expr;
+      }
+      case NodeKind::UnaryExpr: {
+        auto* expr = make<UnaryExpr>(line);
+        expr->op = enumerator(UnaryOp::Deref);
+        expr->operand = requiredExpr();
+        return expr;
+      }
+      case NodeKind::CallExpr: {
+        auto* call = make<CallExpr>(line);
+        call->callee = symbol();
+        list(call->args);
+        for (const ASTNode* arg : call->args) {
+          if (!isa<Expr>(arg)) {
+            fail("expected an expression");
+          }
+        }
+        return call;
+      }
+      case NodeKind::MemberExpr: {
+        auto* member = make<MemberExpr>(line);
+        member->member = symbol();
+        member->is_arrow = byte() != 0;
+        member->object = requiredExpr();
+        return member;
+      }
+      case NodeKind::ArraySubscript: {
+        auto* sub = make<ArraySubscript>(line);
+        sub->array = requiredExpr();
+        sub->index = requiredExpr();
+        return sub;
+      }
+      case NodeKind::IntLiteral: {
+        auto* lit = make<IntLiteral>(line);
+        const std::uint64_t value = varint();
+        lit->value = static_cast<long long>((value >> 1) ^ (~(value & 1) + 1));
+        return lit;
+      }
+      case NodeKind::FloatLiteral: {
+        auto* lit = make<FloatLiteral>(line);
+        std::uint64_t bits = 0;
+        for (int shift = 0; shift < 64; shift += 8) {
+          bits |= static_cast<std::uint64_t>(byte()) << shift;
+        }
+        std::memcpy(&lit->value, &bits, sizeof(bits));
+        return lit;
+      }
+      case NodeKind::CharLiteral: {
+        auto* lit = make<CharLiteral>(line);
+        lit->value = static_cast<char>(byte());
+        return lit;
+      }
+      case NodeKind::StringLiteral: {
+        auto* lit = make<StringLiteral>(line);
+        lit->value = std::string(bytes());
+        return lit;
+      }
+      case NodeKind::VarRef: {
+        auto* ref = make<VarRef>(line);
+        ref->name = symbol();
+        return ref;
+      }
+      case NodeKind::TranslationUnit:
+      case NodeKind::ImplicitCastExpr:
+        break;
+    }
+    return nullptr;
+  }
+
+  std::string_view bytes_;
+  std::size_t pos_ = 0;
+  std::string error_;
+  /** Nodes being read between the root and the current one. */
+  std::size_t depth_ = 0;
+  ASTContext* context_ = nullptr;
+  std::vector<Symbol> symbols_;
+  std::vector<const Type*> types_;
+};
+
+}  // namespace
+
+bool serialize(const TranslationUnit& unit, support::BufferedWriter& out, std::string& error) {
+  Encoder encoder;
+  if (!encoder.encode(unit, error)) {
+    return false;
+  }
+  encoder.writeTo(out);
+  return true;
+}
+
+std::unique_ptr<TranslationUnit> deserialize(std::string_view bytes, std::string& error) {
+  return Decoder(bytes).decode(error);
+}
+
+bool saveAST(const TranslationUnit& unit, const std::string& path, std::string& error) {
+  support::TimeScope scope("serialize", path);
+  Encoder encoder;
+  if (!encoder.encode(unit, error)) {
+    return false;
+  }
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    error = "cannot open '" + path + "' for writing";
+    return false;
+  }
+  bool ok = false;
+  {
+    support::BufferedWriter out(file);
+    encoder.writeTo(out);
+    ok = out.flush();
+  }
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    error = "cannot write AST to '" + path + "'";
+  }
+  return ok;
+}
+
+std::unique_ptr<TranslationUnit> loadAST(const std::string& path, std::string& error) {
+  support::TimeScope scope("deserialize", path);
+  support::SourceBuffer buffer;
+  if (!buffer.open(path, error)) {
+    return nullptr;
+  }
+  return deserialize(buffer.contents(), error);
+}
+
+}  // namespace compiler::ast
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "ast/ast.h"
+
+namespace compiler::support {
+class BufferedWriter;
+}
+
+namespace compiler::ast {
+
+/** Bumped whenever the encoding below changes; loaders reject other versions. */
+constexpr std::uint8_t kASTFormatVersion = 1;
+
+/**
+ * Writes a parsed translation unit in the binary AST format:
+ *
+ *   "CAST" version
+ *   symbol table   count, then (length, bytes) per interned string
+ *   type table     count, then one record per type, elements before users
+ *   node tree      pre-order; kind byte (0xFF for null), line, then fields
+ *
+ * Integers are LEB128 varints (int literals zigzag-encoded), floats their
+ * eight IEEE bytes, and symbols and types are 1-based table indices with 0
+ * for none, so the file holds no pointers and can be mapped anywhere.
+ *
+ * Only syntax is stored. Sema annotations are recomputed after loading, so
+ * an already analyzed unit is refused: its implicit conversions would be
+ * inserted a second time.
+ */
+bool serialize(const TranslationUnit& unit, support::BufferedWriter& out, std::string& error);
+
+/**
+ * Rebuilds a translation unit from serialized bytes, interning its strings
+ * and types into a fresh context. Returns null and describes the problem in
+ * `error` for truncated, corrupt or other-version input.
+ */
+std::unique_ptr<TranslationUnit> deserialize(std::string_view bytes, std::string& error);
+
+/** Serializes `unit` to the file at `path`. */
+bool saveAST(const TranslationUnit& unit, const std::string& path, std::string& error);
+
+/** Memory-maps the file at `path` and deserializes it without re-lexing the source. */
+std::unique_ptr<TranslationUnit> loadAST(const std::string& path, std::string& error);
+
+}  // namespace compiler::ast
@@ -0,0 +1,182 @@
+#include "ast/type.h"
+
+#include <algorithm>
+
+#include "ast/ast.h"
+
+namespace compiler::ast {
+
+namespace {
+
+std::uint64_t alignTo(std::uint64_t value, std::uint64_t align) {
+  return align == 0 ? value : (value + align - 1) / align * align;
+}
+
+/** Spells a derived type, keeping array suffixes in declaration order: int* then int*[4][8]. */
+std::string derivedSpelling(const Type* element, const std::string& suffix) {
+  const std::string& base = element->str();
+  const auto bracket = base.find('[');
+  if (bracket == std::string::npos) {
+    return base + suffix;
+  }
+  if (suffix.front() == '*') {
+    return base.substr(0, bracket) + "(*)" + base.substr(bracket);
+  }
+  return base.substr(0, bracket) + suffix + base.substr(bracket);
+}
+
+}  // namespace
+
+// --- Type ---
+
+bool Type::isComplete() const {
+  switch (kind_) {
+    case Kind::Void:
+    case Kind::Function:
+      return false;
+    case Kind::Array:
+      return element_->isComplete();
+    case Kind::Struct:
+      return asStruct()->definition() != nullptr;
+    default:
+      return true;
+  }
+}
+
+std::uint64_t Type::size() const {
+  if (kind_ == Kind::Array) {
+    return count_ * element_->size();
+  }
+  return size_;
+}
+
+std::uint64_t Type::align() const {
+  if (kind_ == Kind::Array) {
+    return element_->align();
+  }
+  return align_;
+}
+
+const Field* StructType::field(Symbol name) const {
+  auto it = field_index_.find(name);
+  return it != field_index_.end() ? &fields_[it->second] : nullptr;
+}
+
+// --- TypeContext ---
+
+TypeContext::TypeContext()
+    : void_(builtin(Type::Kind::Void, "void", 0)),
+      char_(builtin(Type::Kind::Char, "char", 1)),
+      int_(builtin(Type::Kind::Int, "int", 4)),
+      float_(builtin(Type::Kind::Float, "float", 4)) {}
+
+const Type* TypeContext::builtin(Type::Kind kind, const char* spelling, std::uint64_t size) {
+  auto type = std::unique_ptr<Type>(new Type(kind, spelling));
+  type->size_ = size;
+  type->align_ = size;
+  return own(std::move(type));
+}
+
+const Type* TypeContext::pointerTo(const Type* element) {
+  auto [it, inserted] = pointers_.try_emplace(element, nullptr);
+  if (inserted) {
+    auto type = std::unique_ptr<Type>(new Type(Type::Kind::Pointer,
+                                               derivedSpelling(element, "*")));
+    type->element_ = element;
+    type->size_ = kPointerSize;
+    type->align_ = kPointerSize;
+    it->second = own(std::move(type));
+  }
+  return it->second;
+}
+
+const Type* TypeContext::arrayOf(const Type* element, std::uint64_t count) {
+  auto [it, inserted] = arrays_.try_emplace({element, count}, nullptr);
+  if (inserted) {
+    auto type = std::unique_ptr<Type>(
+        new Type(Type::Kind::Array, derivedSpelling(element, "[" + std::to_string(count) + "]")));
+    type->element_ = element;
+    type->count_ = count;
+    it->second = own(std::move(type));
+  }
+  return it->second;
+}
+
+const FunctionType* TypeContext::functionType(const Type* result,
+                                              std::vector<const Type*> params, bool variadic) {
+  std::vector<const Type*> key;
+  key.reserve(params.size() + 1);
+  key.push_back(result);
+  key.insert(key.end(), params.begin(), params.end());
+  auto [it, inserted] = functions_.try_emplace({std::move(key), variadic}, nullptr);
+  if (inserted) {
+    std::string spelling = result->str() + "(";
+    for (std::size_t i = 0; i < params.size(); ++i) {
+      spelling += (i == 0 ? "" : ", ") + params[i]->str();
+    }
+    if (variadic) {
+      spelling += params.empty() ? "..." : ", ...";
+    }
+    spelling += ")";
+    it->second = own(std::unique_ptr<FunctionType>(
+        new FunctionType(std::move(spelling), result, std::move(params), variadic)));
+  }
+  return it->second;
+}
+
+const StructType* TypeContext::structNamed(Symbol name) { return mutableStruct(name); }
+
+const StructType* TypeContext::findStruct(Symbol name) const {
+  auto it = structs_.find(name);
+  return it != structs_.end() ? it->second : nullptr;
+}
+
+StructType* TypeContext::mutableStruct(Symbol name) {
+  auto [it, inserted] = structs_.try_emplace(name, nullptr);
+  if (inserted) {
+    it->second = own(std::unique_ptr<StructType>(new StructType(name)));
+  }
+  return it->second;
+}
+
+bool TypeContext::defineStruct(const StructDecl& decl, std::string& error) {
+  StructType* type = mutableStruct(decl.name);
+  if (type->definition_ == &decl) {
+    return true;
+  }
+  if (type->definition_ != nullptr) {
+    error = "redefinition of '" + type->str() + "'";
+    return false;
+  }
+
+  std::vector<Field> fields;
+  std::unordered_map<Symbol, unsigned> index;
+  fields.reserve(decl.fields.size());
+  std::uint64_t offset = 0;
+  std::uint64_t align = 1;
+  for (const FieldDecl& member : decl.fields) {
+    if (member.type == nullptr || !member.type->isComplete()) {
+      error = "field '" + std::string(member.name.str()) + "' has incomplete type '" +
+              (member.type != nullptr ? member.type->str() : std::string("<unknown>")) + "'";
+      return false;
+    }
+    const auto position = static_cast<unsigned>(fields.size());
+    if (!index.emplace(member.name, position).second) {
+      error = "duplicate member '" + std::string(member.name.str()) + "'";
+      return false;
+    }
+    offset = alignTo(offset, member.type->align());
+    fields.push_back({member.name, member.type, offset, position});
+    offset += member.type->size();
+    align = std::max(align, member.type->align());
+  }
+
+  type->fields_ = std::move(fields);
+  type->field_index_ = std::move(index);
+  type->size_ = alignTo(offset, align);
+  type->align_ = align;
+  type->definition_ = &decl;
+  return true;
+}
+
+}  // namespace compiler::ast
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "support/string_interner.h"
+
+namespace compiler::ast {
+
+using support::Symbol;
+
+struct StructDecl;
+class StructType;
+class FunctionType;
+
+/**
+ * A C type. Types are uniqued by their TypeContext, so two types are the same
+ * exactly when their pointers are equal.
+ */
+class Type {
+ public:
+  enum class Kind : std::uint8_t { Void, Char, Int, Float, Pointer, Array, Function, Struct };
+
+  virtual ~Type() = default;
+
+  Type(const Type&) = delete;
+  Type& operator=(const Type&) = delete;
+
+  Kind kind() const { return kind_; }
+  bool isVoid() const { return kind_ == Kind::Void; }
+  bool isInteger() const { return kind_ == Kind::Char || kind_ == Kind::Int; }
+  bool isArithmetic() const { return isInteger() || kind_ == Kind::Float; }
+  bool isPointer() const { return kind_ == Kind::Pointer; }
+  bool isArray() const { return kind_ == Kind::Array; }
+  bool isScalar() const { return isArithmetic() || isPointer(); }
+
+  /** Pointee of a pointer or element of an array; null for other types. */
+  const Type* element() const { return element_; }
+
+  /** Number of elements of an array type. */
+  std::uint64_t count() const { return count_; }
+
+  /** False for void, functions, undefined structs and arrays of those. */
+  bool isComplete() const;
+
+  /** Size and alignment in bytes; zero while the type is incomplete. */
+  std::uint64_t size() const;
+  std::uint64_t align() const;
+
+  /** C spelling, e.g. "int", "struct Node*" or "char[4][8]". */
+  const std::string& str() const { return spelling_; }
+
+  /** Returns this type as a struct or function type, or null if it is not one. */
+  const StructType* asStruct() const;
+  const FunctionType* asFunction() const;
+
+ protected:
+  friend class TypeContext;
+
+  Type(Kind kind, std::string spelling) : kind_(kind), spelling_(std::move(spelling)) {}
+
+  Kind kind_;
+  const Type* element_ = nullptr;
+  std::uint64_t count_ = 0;
+  std::uint64_t size_ = 0;
+  std::uint64_t align_ = 0;
+  std::string spelling_;
+};
+
+/** A struct member with its position in the laid-out record. */
+struct Field {
+  Symbol name;
+  const Type* type = nullptr;
+  std::uint64_t offset = 0;
+  unsigned index = 0;
+};
+
+/** A named struct. It stays incomplete until its declaration is laid out. */
+class StructType : public Type {
+ public:
+  Symbol name() const { return name_; }
+  const std::vector<Field>& fields() const { return fields_; }
+
+  /** Returns the member called `name`, or null. Constant time, however wide the struct. */
+  const Field* field(Symbol name) const;
+
+  /** The declaration that defined the struct, or null while it is incomplete. */
+  const StructDecl* definition() const { return definition_; }
+
+ private:
+  friend class TypeContext;
+
+  explicit StructType(Symbol name) : Type(Kind::Struct, "struct " + std::string(name.str())),
+                                     name_(name) {}
+
+  Symbol name_;
+  std::vector<Field> fields_;
+  std::unordered_map<Symbol, unsigned> field_index_;
+  const StructDecl* definition_ = nullptr;
+};
+
+class FunctionType : public Type {
+ public:
+  const Type* result() const { return result_; }
+  const std::vector<const Type*>& params() const { return params_; }
+  bool isVariadic() const { return variadic_; }
+
+ private:
+  friend class TypeContext;
+
+  FunctionType(std::string spelling, const Type* result, std::vector<const Type*> params,
+               bool variadic)
+      : Type(Kind::Function, std::move(spelling)),
+        result_(result),
+        params_(std::move(params)),
+        variadic_(variadic) {}
+
+  const Type* result_;
+  std::vector<const Type*> params_;
+  bool variadic_;
+};
+
+inline const StructType* Type::asStruct() const {
+  return kind_ == Kind::Struct ? static_cast<const StructType*>(this) : nullptr;
+}
+
+inline const FunctionType* Type::asFunction() const {
+  return kind_ == Kind::Function ? static_cast<const FunctionType*>(this) : nullptr;
+}
+
+/**
+ * Creates and owns the uniqued types of one translation unit. Layout follows
+ * the LP64 data model of the targets the code generator emits for.
+ */
+class TypeContext {
+ public:
+  static constexpr std::uint64_t kPointerSize = 8;
+
+  TypeContext();
+
+  TypeContext(const TypeContext&) = delete;
+  TypeContext& operator=(const TypeContext&) = delete;
+
+  const Type* voidType() const { return void_; }
+  const Type* charType() const { return char_; }
+  const Type* intType() const { return int_; }
+  const Type* floatType() const { return float_; }
+
+  const Type* pointerTo(const Type* element);
+  const Type* arrayOf(const Type* element, std::uint64_t count);
+  const FunctionType* functionType(const Type* result, std::vector<const Type*> params,
+                                   bool variadic);
+
+  /** Returns the struct called `name`, declaring it incomplete on first use. */
+  const StructType* structNamed(Symbol name);
+
+  /**
+   * Returns the struct called `name`, or null if nothing has mentioned it.
+   * Unlike structNamed this never adds a type, so code generators working
+   * on one analyzed unit from several threads may share the context.
+   */
+  const StructType* findStruct(Symbol name) const;
+
+  /**
+   * Completes the struct declared by `decl` and computes its field offsets,
+   * size and alignment. Repeating the call for the same declaration is a
+   * no-op, so every phase shares one layout. On failure (redefinition, an
+   * incomplete or duplicate member) returns false and describes why in `error`.
+   */
+  bool defineStruct(const StructDecl& decl, std::string& error);
+
+ private:
+  template <typename T>
+  T* own(std::unique_ptr<T> type) {
+    T* raw = type.get();
+    types_.push_back(std::move(type));
+    return raw;
+  }
+
+  const Type* builtin(Type::Kind kind, const char* spelling, std::uint64_t size);
+  StructType* mutableStruct(Symbol name);
+
+  std::vector<std::unique_ptr<Type>> types_;
+  const Type* void_;
+  const Type* char_;
+  const Type* int_;
+  const Type* float_;
+  std::unordered_map<const Type*, const Type*> pointers_;
+  std::map<std::pair<const Type*, std::uint64_t>, const Type*> arrays_;
+  std::map<std::pair<std::vector<const Type*>, bool>, const FunctionType*> functions_;
+  std::unordered_map<Symbol, StructType*> structs_;
+};
+
+}  // namespace compiler::ast
@@ -1 +1,693 @@
 #include "codegen/codegen.h"
+
+#include <string_view>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+
+#include "support/instrumentation.h"
+
+namespace compiler::codegen {
+
+namespace {
+
+std::string unescape(std::string_view text) {
+  std::string out;
+  out.reserve(text.size());
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    if (text[i] != '\\' || i + 1 == text.size()) {
+      out.push_back(text[i]);
+      continue;
+    }
+    switch (text[++i]) {
+      case 'n': out.push_back('\n'); break;
+      case 't': out.push_back('\t'); break;
+      case 'r': out.push_back('\r'); break;
+      case '0': out.push_back('\0'); break;
+      default: out.push_back(text[i]); break;
+    }
+  }
+  return out;
+}
+
+const ast::Type* typeOf(const ast::ASTNode& node) {
+  return ast::cast<ast::Expr>(node).type;
+}
+
+/** Looks through the casts sema wrapped around a constant initializer. */
+ast::ASTNode* peelCasts(ast::ASTNode* node) {
+  while (auto* cast = ast::dyn_cast<ast::ImplicitCastExpr>(node)) {
+    node = cast->operand;
+  }
+  return node;
+}
+
+llvm::CmpInst::Predicate integerPredicate(ast::BinaryOp op, bool is_signed) {
+  switch (op) {
+    case ast::BinaryOp::Eq: return llvm::CmpInst::ICMP_EQ;
+    case ast::BinaryOp::Ne: return llvm::CmpInst::ICMP_NE;
+    case ast::BinaryOp::Lt: return is_signed ? llvm::CmpInst::ICMP_SLT : llvm::CmpInst::ICMP_ULT;
+    case ast::BinaryOp::Gt: return is_signed ? llvm::CmpInst::ICMP_SGT : llvm::CmpInst::ICMP_UGT;
+    case ast::BinaryOp::Le: return is_signed ? llvm::CmpInst::ICMP_SLE : llvm::CmpInst::ICMP_ULE;
+    default: return is_signed ? llvm::CmpInst::ICMP_SGE : llvm::CmpInst::ICMP_UGE;
+  }
+}
+
+llvm::CmpInst::Predicate floatPredicate(ast::BinaryOp op) {
+  switch (op) {
+    case ast::BinaryOp::Eq: return llvm::CmpInst::FCMP_OEQ;
+    case ast::BinaryOp::Ne: return llvm::CmpInst::FCMP_UNE;
+    case ast::BinaryOp::Lt: return llvm::CmpInst::FCMP_OLT;
+    case ast::BinaryOp::Gt: return llvm::CmpInst::FCMP_OGT;
+    case ast::BinaryOp::Le: return llvm::CmpInst::FCMP_OLE;
+    default: return llvm::CmpInst::FCMP_OGE;
+  }
+}
+
+}  // namespace
+
+CodeGenerator::CodeGenerator(llvm::LLVMContext& context, const std::string& module_name)
+    : context_(context),
+      module_(std::make_unique<llvm::Module>(module_name, context)),
+      builder_(context) {}
+
+CodeGenerator::~CodeGenerator() = default;
+
+bool CodeGenerator::generate(ast::TranslationUnit& unit,
+                             const std::unordered_set<const ast::FunctionDecl*>* bodies) {
+  support::TimeScope scope("codegen", module_->getModuleIdentifier());
+  errors_.clear();
+  if (!unit.analyzed) {
+    error(0, "internal error: translation unit has not been semantically analyzed");
+    return false;
+  }
+  types_ = &unit.context->types();
+  bodies_ = bodies;
+  unit.accept(*this);
+  bodies_ = nullptr;
+  if (errors_.empty()) {
+    std::string message;
+    llvm::raw_string_ostream out(message);
+    if (llvm::verifyModule(*module_, &out)) {
+      error(0, "internal error: generated invalid IR: " + out.str());
+    }
+  }
+  return errors_.empty();
+}
+
+const std::vector<CodegenError>& CodeGenerator::errors() const { return errors_; }
+
+llvm::Module& CodeGenerator::module() { return *module_; }
+
+std::unique_ptr<llvm::Module> CodeGenerator::takeModule() { return std::move(module_); }
+
+// --- Types -----------------------------------------------------------------
+
+llvm::Type* CodeGenerator::lowerType(const ast::Type* type) {
+  llvm::Type*& slot = llvm_types_[type];
+  if (slot == nullptr) {
+    switch (type->kind()) {
+      case ast::Type::Kind::Void: slot = llvm::Type::getVoidTy(context_); break;
+      case ast::Type::Kind::Char: slot = llvm::Type::getInt8Ty(context_); break;
+      case ast::Type::Kind::Int: slot = llvm::Type::getInt32Ty(context_); break;
+      case ast::Type::Kind::Float: slot = llvm::Type::getFloatTy(context_); break;
+      case ast::Type::Kind::Pointer: slot = llvm::PointerType::get(context_, 0); break;
+      case ast::Type::Kind::Array:
+        slot = llvm::ArrayType::get(lowerType(type->element()), type->count());
+        break;
+      case ast::Type::Kind::Function: {
+        const ast::FunctionType* fn = type->asFunction();
+        std::vector<llvm::Type*> params;
+        for (const ast::Type* param : fn->params()) {
+          params.push_back(lowerType(param));
+        }
+        slot = llvm::FunctionType::get(lowerType(fn->result()), params, fn->isVariadic());
+        break;
+      }
+      case ast::Type::Kind::Struct:
+        slot = llvm::StructType::create(context_,
+                                        "struct." + std::string(type->asStruct()->name().str()));
+        break;
+    }
+  }
+  // Struct bodies follow the TypeContext layout and are filled in once it exists.
+  auto* record = llvm::dyn_cast<llvm::StructType>(slot);
+  if (record != nullptr && record->isOpaque() && type->isComplete()) {
+    std::vector<llvm::Type*> body;
+    for (const ast::Field& field : type->asStruct()->fields()) {
+      body.push_back(lowerType(field.type));
+    }
+    record->setBody(body);
+  }
+  return slot;
+}
+
+// --- Declarations ----------------------------------------------------------
+
+void CodeGenerator::visit(ast::TranslationUnit& unit) {
+  std::vector<ast::FunctionDecl*> bodies;
+  for (ast::ASTNode* decl : unit.decls) {
+    if (auto* fn = ast::dyn_cast<ast::FunctionDecl>(decl)) {
+      declareFunction(*fn);
+      if (bodies_ == nullptr || bodies_->count(fn) != 0) {
+        bodies.push_back(fn);
+      }
+    } else if (auto* var = ast::dyn_cast<ast::VarDecl>(decl)) {
+      emitGlobal(*var);
+    } else {
+      decl->accept(*this);
+    }
+  }
+  for (ast::FunctionDecl* fn : bodies) {
+    fn->accept(*this);
+  }
+}
+
+void CodeGenerator::declareFunction(ast::FunctionDecl& decl) {
+  // Lowered directly rather than through TypeContext::functionType, which
+  // would add to the context: generation only ever reads it.
+  std::vector<llvm::Type*> params;
+  for (const auto& param : decl.params) {
+    params.push_back(lowerType(param.type));
+  }
+  auto* type = llvm::FunctionType::get(lowerType(decl.return_type), params, false);
+  functions_[&decl] = llvm::Function::Create(type, llvm::Function::ExternalLinkage,
+                                             std::string(decl.name.str()), module_.get());
+}
+
+llvm::Function* CodeGenerator::implicitFunction(ast::Symbol name) {
+  // C89-style implicit declaration: `int name(...)`, resolved at link time.
+  const std::string spelling(name.str());
+  if (llvm::Function* existing = module_->getFunction(spelling)) {
+    return existing;
+  }
+  auto* type = llvm::FunctionType::get(lowerType(types_->intType()), {}, true);
+  return llvm::Function::Create(type, llvm::Function::ExternalLinkage, spelling, module_.get());
+}
+
+void CodeGenerator::visit(ast::FunctionDecl& decl) {
+  support::TimeScope scope("codegen", decl.name.str(), /*per_function=*/true);
+  current_function_ = functions_.at(&decl);
+  current_return_type_ = decl.return_type;
+  builder_.SetInsertPoint(llvm::BasicBlock::Create(context_, "entry", current_function_));
+
+  for (std::size_t i = 0; i < decl.params.size(); ++i) {
+    const ast::ParamDecl& param = decl.params[i];
+    const std::string name(param.name.str());
+    llvm::Argument* arg = current_function_->getArg(static_cast<unsigned>(i));
+    arg->setName(name);
+    llvm::AllocaInst* slot = createEntryAlloca(lowerType(param.type), name + ".addr");
+    builder_.CreateStore(arg, slot);
+    storage_[&param] = slot;
+  }
+  for (ast::ASTNode* stmt : decl.body->stmts) {
+    stmt->accept(*this);
+  }
+
+  finishFunction();
+  current_function_ = nullptr;
+  current_return_type_ = nullptr;
+}
+
+void CodeGenerator::finishFunction() {
+  for (llvm::BasicBlock& block : *current_function_) {
+    if (block.getTerminator() != nullptr) {
+      continue;
+    }
+    builder_.SetInsertPoint(&block);
+    if (current_return_type_->isVoid()) {
+      builder_.CreateRetVoid();
+    } else {
+      // Falling off the end returns zero, which is what C requires of main().
+      builder_.CreateRet(llvm::Constant::getNullValue(lowerType(current_return_type_)));
+    }
+  }
+  llvm::EliminateUnreachableBlocks(*current_function_);
+  builder_.ClearInsertionPoint();
+}
+
+void CodeGenerator::visit(ast::StructDecl& decl) {
+  // Sema laid the struct out; this only creates the named LLVM type.
+  lowerType(types_->findStruct(decl.name));
+}
+
+llvm::Constant* CodeGenerator::emitConstant(ast::ASTNode& node, const ast::Type* type, int line) {
+  ast::ASTNode* literal = peelCasts(&node);
+  if (auto* str = ast::dyn_cast<ast::StringLiteral>(literal)) {
+    if (type->isPointer() && type->element() == types_->charType()) {
+      return stringConstant(unescape(str->value));
+    }
+  } else if (type->isArithmetic() || type->isPointer()) {
+    bool negate = false;
+    if (auto* unary = ast::dyn_cast<ast::UnaryExpr>(literal)) {
+      if (unary->op == ast::UnaryOp::Neg) {
+        negate = true;
+        literal = peelCasts(unary->operand);
+      }
+    }
+
+    double value = 0.0;
+    bool integral = true;
+    bool is_literal = true;
+    if (auto* lit = ast::dyn_cast<ast::IntLiteral>(literal)) {
+      value = static_cast<double>(lit->value);
+    } else if (auto* ch = ast::dyn_cast<ast::CharLiteral>(literal)) {
+      value = ch->value;
+    } else if (auto* fp = ast::dyn_cast<ast::FloatLiteral>(literal)) {
+      value = fp->value;
+      integral = false;
+    } else {
+      is_literal = false;
+    }
+
+    if (is_literal) {
+      if (negate) {
+        value = -value;
+      }
+      if (type == types_->floatType()) {
+        return llvm::ConstantFP::get(lowerType(type), value);
+      }
+      if (type->isInteger()) {
+        return llvm::ConstantInt::get(lowerType(type),
+                                      static_cast<std::uint64_t>(static_cast<long long>(value)),
+                                      true);
+      }
+      if (integral && value == 0.0) {
+        return llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(lowerType(type)));
+      }
+    }
+  }
+  error(line, "initializer element is not a compile-time constant");
+  return nullptr;
+}
+
+llvm::Constant* CodeGenerator::stringConstant(const std::string& text) {
+  auto* data = llvm::ConstantDataArray::getString(context_, text, true);
+  auto* global = new llvm::GlobalVariable(*module_, data->getType(), true,
+                                          llvm::GlobalValue::PrivateLinkage, data, ".str");
+  global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  global->setAlignment(llvm::Align(1));
+  return global;
+}
+
+void CodeGenerator::emitGlobal(ast::VarDecl& decl) {
+  llvm::Type* type = lowerType(decl.type);
+  llvm::Constant* init = llvm::Constant::getNullValue(type);
+  // A rejected initializer leaves the global zeroed, so uses of it still lower.
+  if (decl.init != nullptr) {
+    if (llvm::Constant* value = emitConstant(*decl.init, decl.type, decl.line)) {
+      init = value;
+    }
+  }
+  storage_[&decl] = new llvm::GlobalVariable(*module_, type, false,
+                                             llvm::GlobalValue::ExternalLinkage, init,
+                                             std::string(decl.name.str()));
+}
+
+void CodeGenerator::visit(ast::VarDecl& decl) {
+  if (current_function_ == nullptr) {
+    emitGlobal(decl);
+    return;
+  }
+  llvm::AllocaInst* slot = createEntryAlloca(lowerType(decl.type), std::string(decl.name.str()));
+  storage_[&decl] = slot;
+  if (decl.init != nullptr) {
+    builder_.CreateStore(emitExpr(*decl.init), slot);
+  }
+}
+
+llvm::AllocaInst* CodeGenerator::createEntryAlloca(llvm::Type* type, const std::string& name) {
+  llvm::BasicBlock& entry = current_function_->getEntryBlock();
+  llvm::IRBuilder<> builder(&entry, entry.begin());
+  return builder.CreateAlloca(type, nullptr, name);
+}
+
+// --- Statements ------------------------------------------------------------
+
+void CodeGenerator::startBlock(llvm::BasicBlock* block) {
+  block->insertInto(current_function_);
+  builder_.SetInsertPoint(block);
+}
+
+void CodeGenerator::branchTo(llvm::BasicBlock* target) {
+  if (builder_.GetInsertBlock()->getTerminator() == nullptr) {
+    builder_.CreateBr(target);
+  }
+}
+
+void CodeGenerator::visit(ast::CompoundStmt& stmt) {
+  for (ast::ASTNode* child : stmt.stmts) {
+    child->accept(*this);
+  }
+}
+
+void CodeGenerator::visit(ast::IfStmt& stmt) {
+  llvm::Value* cond = emitCondition(*stmt.cond);
+  auto* then_block = llvm::BasicBlock::Create(context_, "if.then");
+  auto* merge_block = llvm::BasicBlock::Create(context_, "if.end");
+  auto* else_block =
+      stmt.else_branch != nullptr ? llvm::BasicBlock::Create(context_, "if.else") : merge_block;
+  builder_.CreateCondBr(cond, then_block, else_block);
+
+  startBlock(then_block);
+  stmt.then_branch->accept(*this);
+  branchTo(merge_block);
+  if (stmt.else_branch != nullptr) {
+    startBlock(else_block);
+    stmt.else_branch->accept(*this);
+    branchTo(merge_block);
+  }
+  startBlock(merge_block);
+}
+
+void CodeGenerator::visit(ast::WhileStmt& stmt) {
+  auto* cond_block = llvm::BasicBlock::Create(context_, "while.cond");
+  auto* body_block = llvm::BasicBlock::Create(context_, "while.body");
+  auto* end_block = llvm::BasicBlock::Create(context_, "while.end");
+  builder_.CreateBr(cond_block);
+
+  startBlock(cond_block);
+  builder_.CreateCondBr(emitCondition(*stmt.cond), body_block, end_block);
+  startBlock(body_block);
+  stmt.body->accept(*this);
+  branchTo(cond_block);
+  startBlock(end_block);
+}
+
+void CodeGenerator::visit(ast::ForStmt& stmt) {
+  if (ast::isa<ast::VarDecl>(stmt.init)) {
+    stmt.init->accept(*this);
+  } else if (stmt.init != nullptr) {
+    emitExpr(*stmt.init);
+  }
+
+  auto* cond_block = llvm::BasicBlock::Create(context_, "for.cond");
+  auto* body_block = llvm::BasicBlock::Create(context_, "for.body");
+  auto* incr_block = llvm::BasicBlock::Create(context_, "for.inc");
+  auto* end_block = llvm::BasicBlock::Create(context_, "for.end");
+  builder_.CreateBr(cond_block);
+
+  startBlock(cond_block);
+  if (stmt.cond != nullptr) {
+    builder_.CreateCondBr(emitCondition(*stmt.cond), body_block, end_block);
+  } else {
+    builder_.CreateBr(body_block);
+  }
+  startBlock(body_block);
+  stmt.body->accept(*this);
+  branchTo(incr_block);
+  startBlock(incr_block);
+  if (stmt.incr != nullptr) {
+    emitExpr(*stmt.incr);
+  }
+  builder_.CreateBr(cond_block);
+  startBlock(end_block);
+}
+
+void CodeGenerator::visit(ast::ReturnStmt& stmt) {
+  if (stmt.value == nullptr) {
+    builder_.CreateRetVoid();
+  } else {
+    builder_.CreateRet(emitExpr(*stmt.value));
+  }
+  // Anything after the return is unreachable; give it a block so emission can continue.
+  startBlock(llvm::BasicBlock::Create(context_, "return.cont"));
+}
+
+void CodeGenerator::visit(ast::ExprStmt& stmt) {
+  if (stmt.expr != nullptr) {
+    emitExpr(*stmt.expr);
+  }
+}
+
+// --- Expressions -----------------------------------------------------------
+
+llvm::Value* CodeGenerator::emitExpr(ast::ASTNode& node) {
+  result_ = nullptr;
+  node.accept(*this);
+  return result_;
+}
+
+llvm::Value* CodeGenerator::emitLValue(ast::ASTNode& node) {
+  if (auto* ref = ast::dyn_cast<ast::VarRef>(&node)) {
+    return storage_.at(ref->decl);
+  }
+  if (auto* member = ast::dyn_cast<ast::MemberExpr>(&node)) {
+    llvm::Value* base =
+        member->is_arrow ? emitExpr(*member->object) : emitLValue(*member->object);
+    const ast::Type* record = typeOf(*member->object);
+    if (member->is_arrow) {
+      record = record->element();
+    }
+    return builder_.CreateStructGEP(lowerType(record), base, member->field->index,
+                                    std::string(member->member.str()));
+  }
+  if (auto* sub = ast::dyn_cast<ast::ArraySubscript>(&node)) {
+    llvm::Value* base = emitExpr(*sub->array);
+    llvm::Value* offset = builder_.CreateSExt(emitExpr(*sub->index), builder_.getInt64Ty());
+    return builder_.CreateInBoundsGEP(lowerType(sub->type), base, offset);
+  }
+  // Sema only marks dereferences as lvalues otherwise.
+  return emitExpr(*ast::cast<ast::UnaryExpr>(node).operand);
+}
+
+llvm::Value* CodeGenerator::emitConversion(llvm::Value* value, const ast::Type* from,
+                                           const ast::Type* to) {
+  if (from == to || !from->isArithmetic()) {
+    return value;  // Pointer conversions need no instructions with opaque pointers.
+  }
+  if (from->isInteger() && to->isInteger()) {
+    return builder_.CreateSExtOrTrunc(value, lowerType(to));
+  }
+  if (from->isInteger()) {
+    return builder_.CreateSIToFP(value, lowerType(to));
+  }
+  return builder_.CreateFPToSI(value, lowerType(to));
+}
+
+void CodeGenerator::visit(ast::ImplicitCastExpr& node) {
+  switch (node.cast_kind) {
+    case ast::CastKind::ArrayToPointerDecay:
+      result_ = builder_.CreateConstInBoundsGEP2_64(lowerType(typeOf(*node.operand)),
+                                                    emitLValue(*node.operand), 0, 0);
+      break;
+    case ast::CastKind::NullToPointer:
+      result_ = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(lowerType(node.type)));
+      break;
+    default:
+      result_ = emitConversion(emitExpr(*node.operand), typeOf(*node.operand), node.type);
+      break;
+  }
+}
+
+llvm::Value* CodeGenerator::emitCondition(ast::ASTNode& node) {
+  llvm::Value* value = emitExpr(node);
+  const ast::Type* type = typeOf(node);
+  if (type->isPointer()) {
+    return builder_.CreateIsNotNull(value);
+  }
+  if (type == types_->floatType()) {
+    return builder_.CreateFCmpUNE(value, llvm::Constant::getNullValue(value->getType()));
+  }
+  return builder_.CreateICmpNE(value, llvm::Constant::getNullValue(value->getType()));
+}
+
+llvm::Value* CodeGenerator::emitArithmetic(ast::BinaryOp op, const ast::Type* type,
+                                           llvm::Value* lhs, const ast::Type* lhs_type,
+                                           llvm::Value* rhs) {
+  if (type->isPointer()) {
+    llvm::Value* offset = builder_.CreateSExt(rhs, builder_.getInt64Ty());
+    if (op == ast::BinaryOp::Sub) {
+      offset = builder_.CreateNeg(offset);
+    }
+    return builder_.CreateInBoundsGEP(lowerType(type->element()), lhs, offset);
+  }
+  if (lhs_type->isPointer()) {
+    // Pointer difference, in elements.
+    llvm::Value* left = builder_.CreatePtrToInt(lhs, builder_.getInt64Ty());
+    llvm::Value* right = builder_.CreatePtrToInt(rhs, builder_.getInt64Ty());
+    llvm::Value* bytes = builder_.CreateSub(left, right);
+    llvm::Value* count = builder_.CreateExactSDiv(
+        bytes, llvm::ConstantExpr::getSizeOf(lowerType(lhs_type->element())));
+    return builder_.CreateTrunc(count, builder_.getInt32Ty());
+  }
+  if (type == types_->floatType()) {
+    switch (op) {
+      case ast::BinaryOp::Add: return builder_.CreateFAdd(lhs, rhs);
+      case ast::BinaryOp::Sub: return builder_.CreateFSub(lhs, rhs);
+      case ast::BinaryOp::Mul: return builder_.CreateFMul(lhs, rhs);
+      default: return builder_.CreateFDiv(lhs, rhs);
+    }
+  }
+  switch (op) {
+    case ast::BinaryOp::Add: return builder_.CreateNSWAdd(lhs, rhs);
+    case ast::BinaryOp::Sub: return builder_.CreateNSWSub(lhs, rhs);
+    case ast::BinaryOp::Mul: return builder_.CreateNSWMul(lhs, rhs);
+    case ast::BinaryOp::Div: return builder_.CreateSDiv(lhs, rhs);
+    default: return builder_.CreateSRem(lhs, rhs);
+  }
+}
+
+llvm::Value* CodeGenerator::emitComparison(ast::BinaryExpr& node) {
+  llvm::Value* lhs = emitExpr(*node.lhs);
+  llvm::Value* rhs = emitExpr(*node.rhs);
+  // Sema converted both operands to one type.
+  const ast::Type* type = typeOf(*node.lhs);
+  llvm::Value* result = nullptr;
+  if (type == types_->floatType()) {
+    result = builder_.CreateFCmp(floatPredicate(node.op), lhs, rhs);
+  } else {
+    result = builder_.CreateICmp(integerPredicate(node.op, !type->isPointer()), lhs, rhs);
+  }
+  return builder_.CreateZExt(result, builder_.getInt32Ty());
+}
+
+llvm::Value* CodeGenerator::emitLogical(ast::BinaryExpr& node) {
+  const bool is_and = node.op == ast::BinaryOp::LogicalAnd;
+  llvm::Value* lhs = emitCondition(*node.lhs);
+  llvm::BasicBlock* lhs_block = builder_.GetInsertBlock();
+  auto* rhs_block = llvm::BasicBlock::Create(context_, is_and ? "land.rhs" : "lor.rhs");
+  auto* end_block = llvm::BasicBlock::Create(context_, is_and ? "land.end" : "lor.end");
+  if (is_and) {
+    builder_.CreateCondBr(lhs, rhs_block, end_block);
+  } else {
+    builder_.CreateCondBr(lhs, end_block, rhs_block);
+  }
+
+  startBlock(rhs_block);
+  llvm::Value* rhs = emitCondition(*node.rhs);
+  llvm::BasicBlock* rhs_end = builder_.GetInsertBlock();
+  builder_.CreateBr(end_block);
+
+  startBlock(end_block);
+  llvm::PHINode* phi = builder_.CreatePHI(builder_.getInt1Ty(), 2);
+  phi->addIncoming(is_and ? builder_.getFalse() : builder_.getTrue(), lhs_block);
+  phi->addIncoming(rhs, rhs_end);
+  return builder_.CreateZExt(phi, builder_.getInt32Ty());
+}
+
+llvm::Value* CodeGenerator::emitAssignment(ast::BinaryExpr& node) {
+  llvm::Value* target = emitLValue(*node.lhs);
+  llvm::Value* value = nullptr;
+  if (node.op == ast::BinaryOp::Assign) {
+    value = emitExpr(*node.rhs);
+  } else {
+    const ast::Type* computation = node.computation_type;
+    llvm::Value* current = builder_.CreateLoad(lowerType(node.type), target);
+    current = emitConversion(current, node.type, computation);
+    value = emitArithmetic(ast::arithmeticOf(node.op), computation, current, computation,
+                           emitExpr(*node.rhs));
+    value = emitConversion(value, computation, node.type);
+  }
+  builder_.CreateStore(value, target);
+  return value;
+}
+
+void CodeGenerator::visit(ast::BinaryExpr& node) {
+  switch (node.op) {
+    case ast::BinaryOp::Assign:
+    case ast::BinaryOp::AddAssign:
+    case ast::BinaryOp::SubAssign:
+    case ast::BinaryOp::MulAssign:
+    case ast::BinaryOp::DivAssign:
+      result_ = emitAssignment(node);
+      break;
+    case ast::BinaryOp::LogicalAnd:
+    case ast::BinaryOp::LogicalOr:
+      result_ = emitLogical(node);
+      break;
+    case ast::BinaryOp::Eq:
+    case ast::BinaryOp::Ne:
+    case ast::BinaryOp::Lt:
+    case ast::BinaryOp::Gt:
+    case ast::BinaryOp::Le:
+    case ast::BinaryOp::Ge:
+      result_ = emitComparison(node);
+      break;
+    default: {
+      llvm::Value* lhs = emitExpr(*node.lhs);
+      llvm::Value* rhs = emitExpr(*node.rhs);
+      result_ = emitArithmetic(node.op, node.type, lhs, typeOf(*node.lhs), rhs);
+      break;
+    }
+  }
+}
+
+void CodeGenerator::visit(ast::UnaryExpr& node) {
+  switch (node.op) {
+    case ast::UnaryOp::Neg: {
+      llvm::Value* value = emitExpr(*node.operand);
+      result_ = node.type == types_->floatType() ? builder_.CreateFNeg(value)
+                                                 : builder_.CreateNSWNeg(value);
+      break;
+    }
+    case ast::UnaryOp::Not: {
+      llvm::Value* cond = emitCondition(*node.operand);
+      result_ = builder_.CreateZExt(builder_.CreateNot(cond), builder_.getInt32Ty());
+      break;
+    }
+    case ast::UnaryOp::AddressOf:
+      result_ = emitLValue(*node.operand);
+      break;
+    case ast::UnaryOp::Deref:
+      result_ = builder_.CreateLoad(lowerType(node.type), emitLValue(node));
+      break;
+  }
+}
+
+void CodeGenerator::visit(ast::CallExpr& node) {
+  llvm::Function* callee =
+      node.function != nullptr ? functions_.at(node.function) : implicitFunction(node.callee);
+  std::vector<llvm::Value*> args;
+  for (ast::ASTNode* arg : node.args) {
+    llvm::Value* value = emitExpr(*arg);
+    if (node.function == nullptr && typeOf(*arg) == types_->floatType()) {
+      // Variadic arguments are promoted; double has no C type of its own here.
+      value = builder_.CreateFPExt(value, builder_.getDoubleTy());
+    }
+    args.push_back(value);
+  }
+  result_ = builder_.CreateCall(callee->getFunctionType(), callee, args);
+}
+
+void CodeGenerator::visit(ast::MemberExpr& node) {
+  result_ = builder_.CreateLoad(lowerType(node.type), emitLValue(node));
+}
+
+void CodeGenerator::visit(ast::ArraySubscript& node) {
+  result_ = builder_.CreateLoad(lowerType(node.type), emitLValue(node));
+}
+
+void CodeGenerator::visit(ast::VarRef& node) {
+  result_ = builder_.CreateLoad(lowerType(node.type), emitLValue(node));
+}
+
+void CodeGenerator::visit(ast::IntLiteral& node) {
+  result_ = builder_.getInt32(static_cast<std::uint32_t>(node.value));
+}
+
+void CodeGenerator::visit(ast::FloatLiteral& node) {
+  result_ = llvm::ConstantFP::get(builder_.getFloatTy(), node.value);
+}
+
+void CodeGenerator::visit(ast::CharLiteral& node) {
+  result_ = builder_.getInt8(static_cast<std::uint8_t>(node.value));
+}
+
+void CodeGenerator::visit(ast::StringLiteral& node) {
+  result_ = stringConstant(unescape(node.value));
+}
+
+// --- Diagnostics -----------------------------------------------------------
+
+void CodeGenerator::error(int line, std::string message) {
+  errors_.push_back({line, std::move(message)});
+}
+
+}  // namespace compiler::codegen
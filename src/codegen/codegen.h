@@ -1,12 +1,125 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include "ast/ast.h"
+
 namespace compiler::codegen {
 
-/** Code generation stub. */
-class CodeGenerator {
+/** Diagnostic produced while lowering the AST to LLVM IR. */
+struct CodegenError {
+  int line = 0;
+  std::string message;
+};
+
+/**
+ * Lowers an analyzed translation unit to an LLVM module.
+ *
+ * Every expression must already carry the types, declarations and implicit
+ * casts recorded by sema::SemanticAnalyzer; the generator lowers them as they
+ * are and reports only what semantic analysis cannot see, such as
+ * non-constant global initializers. Declarations are emitted in two passes:
+ * struct layouts, globals and function prototypes first, then function
+ * bodies, so functions may call each other regardless of definition order.
+ * Locals live in entry-block allocas.
+ */
+class CodeGenerator : public ast::ASTVisitor {
  public:
-  /** Creates a new code generator. */
-  CodeGenerator() = default;
+  CodeGenerator(llvm::LLVMContext& context, const std::string& module_name);
+  ~CodeGenerator() override;
+
+  /**
+   * Emits IR for the unit, which must have been analyzed without errors;
+   * returns false if any diagnostic was produced. When `bodies` is given,
+   * only those functions are defined and the rest are merely declared, for
+   * callers that supply the other definitions from elsewhere.
+   */
+  bool generate(ast::TranslationUnit& unit,
+                const std::unordered_set<const ast::FunctionDecl*>* bodies = nullptr);
+
+  /** Returns diagnostics accumulated during generation. */
+  const std::vector<CodegenError>& errors() const;
+
+  /** Returns the module being populated. */
+  llvm::Module& module();
+
+  /** Transfers ownership of the generated module to the caller. */
+  std::unique_ptr<llvm::Module> takeModule();
+
+  void visit(ast::TranslationUnit&) override;
+  void visit(ast::FunctionDecl&) override;
+  void visit(ast::VarDecl&) override;
+  void visit(ast::StructDecl&) override;
+  void visit(ast::CompoundStmt&) override;
+  void visit(ast::IfStmt&) override;
+  void visit(ast::WhileStmt&) override;
+  void visit(ast::ForStmt&) override;
+  void visit(ast::ReturnStmt&) override;
+  void visit(ast::ExprStmt&) override;
+  void visit(ast::BinaryExpr&) override;
+  void visit(ast::UnaryExpr&) override;
+  void visit(ast::CallExpr&) override;
+  void visit(ast::MemberExpr&) override;
+  void visit(ast::ArraySubscript&) override;
+  void visit(ast::IntLiteral&) override;
+  void visit(ast::FloatLiteral&) override;
+  void visit(ast::CharLiteral&) override;
+  void visit(ast::StringLiteral&) override;
+  void visit(ast::VarRef&) override;
+  void visit(ast::ImplicitCastExpr&) override;
+
+ private:
+  // Types.
+  llvm::Type* lowerType(const ast::Type* type);
+
+  // Expressions. emitExpr yields an rvalue; emitLValue the address of an lvalue.
+  llvm::Value* emitExpr(ast::ASTNode& node);
+  llvm::Value* emitLValue(ast::ASTNode& node);
+  llvm::Value* emitConversion(llvm::Value* value, const ast::Type* from, const ast::Type* to);
+  llvm::Value* emitCondition(ast::ASTNode& node);
+  llvm::Value* emitArithmetic(ast::BinaryOp op, const ast::Type* type, llvm::Value* lhs,
+                              const ast::Type* lhs_type, llvm::Value* rhs);
+  llvm::Value* emitComparison(ast::BinaryExpr& node);
+  llvm::Value* emitLogical(ast::BinaryExpr& node);
+  llvm::Value* emitAssignment(ast::BinaryExpr& node);
+
+  // Declarations and control flow.
+  void declareFunction(ast::FunctionDecl& decl);
+  llvm::Function* implicitFunction(ast::Symbol name);
+  void emitGlobal(ast::VarDecl& decl);
+  llvm::Constant* emitConstant(ast::ASTNode& node, const ast::Type* type, int line);
+  llvm::Constant* stringConstant(const std::string& text);
+  llvm::AllocaInst* createEntryAlloca(llvm::Type* type, const std::string& name);
+  void startBlock(llvm::BasicBlock* block);
+  void branchTo(llvm::BasicBlock* target);
+  void finishFunction();
+
+  void error(int line, std::string message);
+
+  llvm::LLVMContext& context_;
+  std::unique_ptr<llvm::Module> module_;
+  llvm::IRBuilder<> builder_;
+
+  const ast::TypeContext* types_ = nullptr;
+  std::unordered_map<const ast::Type*, llvm::Type*> llvm_types_;
+
+  std::unordered_map<const ast::FunctionDecl*, llvm::Function*> functions_;
+  const std::unordered_set<const ast::FunctionDecl*>* bodies_ = nullptr;
+  /** Address of every global and local, keyed by the declaration sema resolved to. */
+  std::unordered_map<const ast::ValueDecl*, llvm::Value*> storage_;
+  llvm::Function* current_function_ = nullptr;
+  const ast::Type* current_return_type_ = nullptr;
+
+  llvm::Value* result_ = nullptr;
+  std::vector<CodegenError> errors_;
 };
 
 }  // namespace compiler::codegen
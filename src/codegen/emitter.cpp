@@ -0,0 +1,156 @@
+#include "codegen/emitter.h"
+
+#include <mutex>
+
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+
+#include "support/instrumentation.h"
+
+namespace compiler::codegen {
+
+namespace {
+
+void initializeNativeTarget() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+  });
+}
+
+}  // namespace
+
+const char* extensionFor(EmitKind kind) {
+  switch (kind) {
+    case EmitKind::Object: return ".o";
+    case EmitKind::LLVMIR: return ".ll";
+    case EmitKind::Bitcode: return ".bc";
+  }
+  return "";
+}
+
+std::unique_ptr<llvm::TargetMachine> createHostTargetMachine(std::string& error) {
+  initializeNativeTarget();
+  const std::string triple = llvm::sys::getDefaultTargetTriple();
+  const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+  if (target == nullptr) {
+    return nullptr;
+  }
+  llvm::TargetOptions options;
+  return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+      triple, llvm::sys::getHostCPUName(), "", options, llvm::Reloc::PIC_));
+}
+
+std::string hostTargetName() {
+  return llvm::sys::getDefaultTargetTriple() + " " + llvm::sys::getHostCPUName().str();
+}
+
+void configureModule(llvm::Module& module, llvm::TargetMachine& target) {
+  module.setTargetTriple(target.getTargetTriple().str());
+  module.setDataLayout(target.createDataLayout());
+}
+
+bool emitModule(llvm::Module& module, EmitKind kind, const std::string& path,
+                llvm::TargetMachine* target, std::string& error) {
+  support::TimeScope scope("emit", path);
+  std::error_code ec;
+  const auto flags = kind == EmitKind::LLVMIR ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None;
+  llvm::raw_fd_ostream out(path, ec, flags);
+  if (ec) {
+    error = "cannot open '" + path + "': " + ec.message();
+    return false;
+  }
+
+  switch (kind) {
+    case EmitKind::LLVMIR:
+      module.print(out, nullptr);
+      break;
+    case EmitKind::Bitcode:
+      llvm::WriteBitcodeToFile(module, out);
+      break;
+    case EmitKind::Object: {
+      if (target == nullptr) {
+        error = "object emission requires a target machine";
+        return false;
+      }
+      llvm::legacy::PassManager passes;
+      if (target->addPassesToEmitFile(passes, out, nullptr, llvm::CGFT_ObjectFile)) {
+        error = "target cannot emit object files";
+        return false;
+      }
+      passes.run(module);
+      break;
+    }
+  }
+
+  out.flush();
+  if (out.has_error()) {
+    error = "error writing '" + path + "': " + out.error().message();
+    out.clear_error();
+    return false;
+  }
+  return true;
+}
+
+bool runMain(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context,
+             const std::vector<std::string>& args, int& status, std::string& error) {
+  initializeNativeTarget();
+  const std::string name = module->getModuleIdentifier();
+  auto jit = llvm::orc::LLLazyJITBuilder().create();
+  if (!jit) {
+    error = "cannot create JIT: " + llvm::toString(jit.takeError());
+    return false;
+  }
+  (*jit)->setPartitionFunction(llvm::orc::CompileOnDemandLayer::compileRequested);
+
+  auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*jit)->getDataLayout().getGlobalPrefix());
+  if (!process) {
+    error = "cannot search the host process: " + llvm::toString(process.takeError());
+    return false;
+  }
+  (*jit)->getMainJITDylib().addGenerator(std::move(*process));
+
+  if (llvm::Error err = (*jit)->addLazyIRModule(
+          llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+    error = "cannot load '" + name + "' into the JIT: " + llvm::toString(std::move(err));
+    return false;
+  }
+  auto main = (*jit)->lookup("main");
+  if (!main) {
+    llvm::consumeError(main.takeError());
+    error = "'" + name + "' has no 'main' function";
+    return false;
+  }
+
+  // argv is NUL-terminated like the one exec passes; main may modify it.
+  std::vector<std::string> storage(args);
+  std::vector<char*> argv;
+  for (std::string& arg : storage) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  support::TimeScope scope("run", name);
+  auto* entry = main->toPtr<int (*)(int, char**)>();
+  status = entry(static_cast<int>(storage.size()), argv.data());
+  return true;
+}
+
+}  // namespace compiler::codegen
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class LLVMContext;
+class Module;
+class TargetMachine;
+}  // namespace llvm
+
+namespace compiler::codegen {
+
+/** Output format written by `emitModule`. */
+enum class EmitKind {
+  Object,
+  LLVMIR,
+  Bitcode,
+};
+
+/** Returns the conventional file extension for an output kind, e.g. ".o". */
+const char* extensionFor(EmitKind kind);
+
+/**
+ * Creates a target machine for the host triple and CPU. Native target
+ * registration happens once per process. Returns null and sets `error` if the
+ * host target is unavailable.
+ */
+std::unique_ptr<llvm::TargetMachine> createHostTargetMachine(std::string& error);
+
+/** Returns the triple and CPU that createHostTargetMachine targets, separated by a space. */
+std::string hostTargetName();
+
+/** Stamps the module with the target's triple and data layout. */
+void configureModule(llvm::Module& module, llvm::TargetMachine& target);
+
+/**
+ * Writes the module to `path`. Object emission requires `target`; textual IR
+ * and bitcode do not.
+ */
+bool emitModule(llvm::Module& module, EmitKind kind, const std::string& path,
+                llvm::TargetMachine* target, std::string& error);
+
+/**
+ * JIT-compiles the module with ORC's LLLazyJIT and calls its main() in this
+ * process, passing `args` as argv. Each function is compiled the first time
+ * it is called, so code that main() never reaches is never compiled.
+ * Symbols the module does not define, such as libc functions, resolve
+ * against the host process. Sets `status` to main's return value; returns
+ * false and sets `error` if the module cannot be loaded or has no main().
+ */
+bool runMain(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context,
+             const std::vector<std::string>& args, int& status, std::string& error);
+
+}  // namespace compiler::codegen
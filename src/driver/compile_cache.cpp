@@ -0,0 +1,233 @@
+#include "driver/compile_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/xxhash.h>
+
+#include "support/instrumentation.h"
+
+namespace compiler::driver {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/** Bump when a change alters generated code without changing the executable's identity. */
+constexpr char kVersion[] = "0.1.0";
+
+/** Marks temporary files; their names never collide with a 32-digit entry name. */
+constexpr char kTempInfix[] = ".tmp.";
+
+/** Temporaries this old were left by a process that died while storing. */
+constexpr auto kStaleTempAge = std::chrono::hours(1);
+
+/** Holds an exclusive flock on the cache's lock file for its lifetime. */
+class DirectoryLock {
+ public:
+  explicit DirectoryLock(const std::string& directory)
+      : fd_(::open((directory + "/lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+    if (fd_ >= 0 && ::flock(fd_, LOCK_EX) != 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  ~DirectoryLock() {
+    if (fd_ >= 0) {
+      ::flock(fd_, LOCK_UN);
+      ::close(fd_);
+    }
+  }
+
+  DirectoryLock(const DirectoryLock&) = delete;
+  DirectoryLock& operator=(const DirectoryLock&) = delete;
+
+  bool held() const { return fd_ >= 0; }
+
+ private:
+  int fd_;
+};
+
+}  // namespace
+
+CompileCache::CompileCache(std::string directory, std::uint64_t limit)
+    : directory_(std::move(directory)), limit_(limit) {}
+
+std::string CompileCache::key(std::string_view contents, std::string_view configuration) {
+  char name[33];
+  std::snprintf(name, sizeof(name), "%016llx%016llx",
+                static_cast<unsigned long long>(llvm::xxHash64(contents)),
+                static_cast<unsigned long long>(llvm::xxHash64(configuration)));
+  return name;
+}
+
+const std::string& CompileCache::compilerIdentity() {
+  static const std::string identity = [] {
+    std::string text = std::string("compiler ") + kVersion + " llvm " + LLVM_VERSION_STRING;
+    struct stat info {};
+    if (::stat("/proc/self/exe", &info) == 0) {
+      text += " exe " + std::to_string(info.st_ino) + ":" + std::to_string(info.st_size) + ":" +
+              std::to_string(info.st_mtime);
+    }
+    return text;
+  }();
+  return identity;
+}
+
+bool CompileCache::fetch(const std::string& key, const std::string& output) const {
+  support::TimeScope scope("cache", key);
+  std::error_code ec;
+  fs::copy_file(fs::path(directory_) / key, output, fs::copy_options::overwrite_existing, ec);
+  if (ec) {
+    return false;
+  }
+  touch(key);
+  return true;
+}
+
+bool CompileCache::load(const std::string& key, std::string& contents) const {
+  std::ifstream in(fs::path(directory_) / key, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  if (in.bad()) {
+    return false;
+  }
+  touch(key);
+  return true;
+}
+
+bool CompileCache::store(const std::string& key, const std::string& output,
+                         std::string& error) const {
+  support::TimeScope scope("cache", key);
+  const std::string temp = temporaryPath(key, error);
+  if (temp.empty()) {
+    return false;
+  }
+  std::error_code ec;
+  fs::copy_file(output, temp, fs::copy_options::overwrite_existing, ec);
+  if (ec) {
+    error = "cannot store '" + output + "' in the cache: " + ec.message();
+    fs::remove(temp, ec);
+    return false;
+  }
+  return publish(temp, key, error);
+}
+
+bool CompileCache::save(const std::string& key, std::string_view contents,
+                        std::string& error) const {
+  const std::string temp = temporaryPath(key, error);
+  if (temp.empty()) {
+    return false;
+  }
+  std::ofstream out(temp, std::ios::binary);
+  out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+  out.close();
+  if (!out) {
+    error = "cannot write cache entry '" + temp + "'";
+    std::error_code ec;
+    fs::remove(temp, ec);
+    return false;
+  }
+  return publish(temp, key, error);
+}
+
+std::string CompileCache::temporaryPath(const std::string& key, std::string& error) const {
+  static std::atomic<unsigned> counter{0};
+  std::error_code ec;
+  fs::create_directories(directory_, ec);
+  if (ec) {
+    error = "cannot create cache directory '" + directory_ + "': " + ec.message();
+    return "";
+  }
+  return (fs::path(directory_) / (key + kTempInfix + std::to_string(::getpid()) + "." +
+                                  std::to_string(counter++)))
+      .string();
+}
+
+bool CompileCache::publish(const std::string& temp, const std::string& key,
+                           std::string& error) const {
+  std::error_code ec;
+  fs::rename(temp, fs::path(directory_) / key, ec);
+  if (ec) {
+    error = "cannot publish cache entry '" + key + "': " + ec.message();
+    fs::remove(temp, ec);
+    return false;
+  }
+  return true;
+}
+
+void CompileCache::touch(const std::string& key) const {
+  // The entry may be evicted meanwhile; then there is simply nothing to refresh.
+  std::error_code ec;
+  fs::last_write_time(fs::path(directory_) / key, fs::file_time_type::clock::now(), ec);
+}
+
+void CompileCache::trim() const {
+  DirectoryLock lock(directory_);
+  if (!lock.held()) {
+    return;
+  }
+
+  struct Entry {
+    fs::path path;
+    std::uint64_t size;
+    fs::file_time_type used;
+  };
+  std::vector<Entry> entries;
+  std::uint64_t total = 0;
+  const auto now = fs::file_time_type::clock::now();
+  std::error_code ec;
+  for (fs::directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+    std::error_code item_ec;
+    const std::string name = it->path().filename().string();
+    if (name == "lock" || !it->is_regular_file(item_ec)) {
+      continue;
+    }
+    const auto used = it->last_write_time(item_ec);
+    const std::uint64_t size = it->file_size(item_ec);
+    if (item_ec) {
+      continue;
+    }
+    if (name.find(kTempInfix) != std::string::npos) {
+      if (now - used > kStaleTempAge) {
+        fs::remove(it->path(), item_ec);
+      }
+      continue;
+    }
+    entries.push_back({it->path(), size, used});
+    total += size;
+  }
+  if (total <= limit_) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& lhs, const Entry& rhs) { return lhs.used < rhs.used; });
+  for (const auto& entry : entries) {
+    if (total <= limit_) {
+      break;
+    }
+    if (fs::remove(entry.path, ec)) {
+      total -= entry.size;
+    }
+  }
+}
+
+}  // namespace compiler::driver
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace compiler::driver {
+
+/**
+ * On-disk cache of compiler outputs, addressed by content. An entry is
+ * named after hashes of the input bytes and of a configuration string
+ * that spells out everything else the output depends on, so a hit can be
+ * copied to the output path without running any phase.
+ *
+ * Several processes may share one directory. Entries are written to a
+ * private temporary file and renamed into place, so readers only ever see
+ * complete entries. Eviction runs under an exclusive flock and removes the
+ * least recently used entries, by modification time, which every hit
+ * refreshes.
+ */
+class CompileCache {
+ public:
+  static constexpr std::uint64_t kDefaultLimit = std::uint64_t{512} << 20;
+
+  CompileCache(std::string directory, std::uint64_t limit);
+
+  /** Returns the entry name for `contents` compiled under `configuration`. */
+  static std::string key(std::string_view contents, std::string_view configuration);
+
+  /**
+   * Identifies this compiler build for use in configurations: its version,
+   * the LLVM it links and, where the platform exposes it, the identity of
+   * the running executable, so a rebuilt compiler never reuses old entries.
+   */
+  static const std::string& compilerIdentity();
+
+  /** Copies the entry for `key` to `output` and marks it used; false on a miss. */
+  bool fetch(const std::string& key, const std::string& output) const;
+
+  /** Adds the file at `output` under `key`. */
+  bool store(const std::string& key, const std::string& output, std::string& error) const;
+
+  /** Reads the entry for `key` into `contents` and marks it used; false on a miss. */
+  bool load(const std::string& key, std::string& contents) const;
+
+  /** Adds `contents` under `key`. */
+  bool save(const std::string& key, std::string_view contents, std::string& error) const;
+
+  /**
+   * Removes least recently used entries until the total size fits the limit.
+   * It scans the whole directory, so call it once after a batch of stores.
+   */
+  void trim() const;
+
+  const std::string& directory() const { return directory_; }
+
+ private:
+  /** Creates the directory if needed and returns a temporary path no other writer uses. */
+  std::string temporaryPath(const std::string& key, std::string& error) const;
+
+  /** Renames a finished temporary into place as `key`. */
+  bool publish(const std::string& temp, const std::string& key, std::string& error) const;
+
+  /** Refreshes the entry's modification time, which orders eviction. */
+  void touch(const std::string& key) const;
+
+  std::string directory_;
+  std::uint64_t limit_;
+};
+
+}  // namespace compiler::driver
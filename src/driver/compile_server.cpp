@@ -0,0 +1,372 @@
+#include "driver/compile_server.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace compiler::driver {
+
+namespace {
+
+/** Longest argument or reply accepted from the other end of the socket. */
+constexpr std::uint32_t kMaxMessage = 64u << 20;
+
+/** Most arguments a request may carry, its working directory included. */
+constexpr std::uint32_t kMaxArguments = 1u << 16;
+
+/** How long the server waits on a client that has stopped sending, in milliseconds. */
+constexpr int kRequestTimeout = 10000;
+
+bool socketAddress(const std::string& path, sockaddr_un& address, std::string& error) {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    error = "invalid socket path '" + path + "'";
+    return false;
+  }
+  std::memcpy(address.sun_path, path.data(), path.size());
+  return true;
+}
+
+/**
+ * Removes a socket file left behind by a server that is gone. A path that
+ * is not a socket, or a socket some server still accepts on, is an error
+ * and is left in place.
+ */
+bool removeStaleSocket(const std::string& path, const sockaddr_un& address, std::string& error) {
+  struct stat info;
+  if (::lstat(path.c_str(), &info) != 0) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    error = "cannot inspect '" + path + "': " + std::strerror(errno);
+    return false;
+  }
+  if (!S_ISSOCK(info.st_mode)) {
+    error = "'" + path + "' exists and is not a socket";
+    return false;
+  }
+  const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (probe < 0) {
+    error = std::string("cannot create socket: ") + std::strerror(errno);
+    return false;
+  }
+  const bool connected =
+      ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+  const int probe_errno = errno;
+  ::close(probe);
+  if (connected) {
+    error = "socket '" + path + "' is in use by another server";
+    return false;
+  }
+  if (probe_errno != ECONNREFUSED) {
+    error = "cannot probe socket '" + path + "': " + std::strerror(probe_errno);
+    return false;
+  }
+  if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
+    error = "cannot remove stale socket '" + path + "': " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool writeAll(int fd, const void* data, std::size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t written = ::write(fd, bytes, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+/**
+ * Reads exactly `size` bytes. Given a `wakeup` descriptor, as the server
+ * is, it also gives up when that becomes readable or when no byte arrives
+ * for kRequestTimeout; the client waits for as long as its compile takes.
+ */
+bool readAll(int fd, void* data, std::size_t size, int wakeup = -1) {
+  char* bytes = static_cast<char*>(data);
+  while (size > 0) {
+    if (wakeup >= 0) {
+      pollfd fds[2] = {{fd, POLLIN, 0}, {wakeup, POLLIN, 0}};
+      const int ready = ::poll(fds, 2, kRequestTimeout);
+      if (ready < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ready <= 0 || (fds[1].revents & POLLIN) != 0) {
+        return false;
+      }
+    }
+    const ssize_t got = ::read(fd, bytes, size);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    bytes += got;
+    size -= static_cast<std::size_t>(got);
+  }
+  return true;
+}
+
+// Messages are host-endian: both ends run on the same machine.
+
+bool writeWord(int fd, std::uint32_t word) { return writeAll(fd, &word, sizeof(word)); }
+
+bool readWord(int fd, std::uint32_t& word, int wakeup = -1) {
+  return readAll(fd, &word, sizeof(word), wakeup);
+}
+
+bool writeString(int fd, const std::string& text) {
+  return writeWord(fd, static_cast<std::uint32_t>(text.size())) &&
+         writeAll(fd, text.data(), text.size());
+}
+
+bool readString(int fd, std::string& text, int wakeup = -1) {
+  std::uint32_t size = 0;
+  if (!readWord(fd, size, wakeup) || size > kMaxMessage) {
+    return false;
+  }
+  text.resize(size);
+  return readAll(fd, text.data(), size, wakeup);
+}
+
+/**
+ * Runs a request in the client's working directory and returns to the
+ * server's own once it is done. Paths keep the spelling the client gave
+ * them, since diagnostics and outputs record it.
+ */
+class RequestDirectory {
+ public:
+  RequestDirectory() = default;
+  ~RequestDirectory() {
+    if (!previous_.empty()) {
+      std::error_code ignored;
+      std::filesystem::current_path(previous_, ignored);
+    }
+  }
+
+  RequestDirectory(const RequestDirectory&) = delete;
+  RequestDirectory& operator=(const RequestDirectory&) = delete;
+
+  bool enter(const std::string& directory, std::error_code& ec) {
+    std::filesystem::path previous = std::filesystem::current_path(ec);
+    if (!ec) {
+      std::filesystem::current_path(directory, ec);
+    }
+    if (ec) {
+      return false;
+    }
+    previous_ = std::move(previous);
+    return true;
+  }
+
+ private:
+  std::filesystem::path previous_;
+};
+
+/** Compiles one request in the server process; returns the exit status. */
+int compileRequest(const std::string& directory, const std::vector<std::string>& args,
+                   TargetMachinePool& targets, std::ostream& diag) {
+  RequestDirectory scope;
+  std::error_code ec;
+  if (!scope.enter(directory, ec)) {
+    diag << "error: cannot enter '" << directory << "': " << ec.message() << "\n";
+    return 1;
+  }
+  DriverOptions options;
+  std::string error;
+  if (!parseArguments(args, options, error)) {
+    diag << "error: " << error << "\n";
+    return 1;
+  }
+  // The server's own stdout and process are not the client's.
+  if (options.run) {
+    diag << "error: '-run' is not available through the compile server\n";
+    return 1;
+  }
+  if (options.ast_dump && options.output.empty()) {
+    diag << "error: '-ast-dump' needs '-o' through the compile server\n";
+    return 1;
+  }
+  if (options.output == "-") {
+    diag << "error: '-o -' is not available through the compile server\n";
+    return 1;
+  }
+  return Driver(std::move(options), &targets).run(diag);
+}
+
+}  // namespace
+
+CompileServer::CompileServer(std::string socket_path) : socket_path_(std::move(socket_path)) {
+  // The destructor removes the socket, whatever directory it runs in.
+  std::error_code ec;
+  std::filesystem::path absolute = std::filesystem::absolute(socket_path_, ec);
+  if (!socket_path_.empty() && !ec) {
+    socket_path_ = absolute.string();
+  }
+}
+
+CompileServer::~CompileServer() {
+  if (listener_ >= 0) {
+    ::close(listener_);
+    ::unlink(socket_path_.c_str());
+  }
+  for (int fd : wakeup_) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+}
+
+bool CompileServer::open(std::string& error) {
+  sockaddr_un address;
+  if (!socketAddress(socket_path_, address, error) ||
+      !removeStaleSocket(socket_path_, address, error)) {
+    return false;
+  }
+  if (::pipe(wakeup_) != 0) {
+    error = std::string("cannot create pipe: ") + std::strerror(errno);
+    return false;
+  }
+  // A client that goes away mid-reply must not take the server with it.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  listener_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener_ < 0) {
+    error = std::string("cannot create socket: ") + std::strerror(errno);
+    return false;
+  }
+  ::fcntl(listener_, F_SETFD, FD_CLOEXEC);
+  // Requests run with this user's permissions, so only this user may connect.
+  // Nobody can connect before listen(), so the mode is in place first.
+  if (::bind(listener_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      ::chmod(socket_path_.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+      ::listen(listener_, SOMAXCONN) != 0) {
+    error = "cannot listen on '" + socket_path_ + "': " + std::strerror(errno);
+    ::close(listener_);
+    listener_ = -1;
+    return false;
+  }
+  return true;
+}
+
+void CompileServer::serve() {
+  pollfd fds[2] = {{listener_, POLLIN, 0}, {wakeup_[0], POLLIN, 0}};
+  while (!stopping_.load()) {
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if ((fds[1].revents & POLLIN) != 0) {
+      return;
+    }
+    if ((fds[0].revents & POLLIN) == 0) {
+      continue;
+    }
+    const int client = ::accept(listener_, nullptr, nullptr);
+    if (client < 0) {
+      continue;
+    }
+    ucred peer{};
+    socklen_t size = sizeof(peer);
+    if (::getsockopt(client, SOL_SOCKET, SO_PEERCRED, &peer, &size) == 0 &&
+        peer.uid == ::geteuid()) {
+      handle(client);
+    }
+    ::close(client);
+  }
+}
+
+void CompileServer::stop() {
+  stopping_.store(true);
+  if (wakeup_[1] >= 0) {
+    const char byte = 0;
+    // Only write() is allowed here; a full pipe already wakes serve().
+    [[maybe_unused]] const ssize_t written = ::write(wakeup_[1], &byte, 1);
+  }
+}
+
+void CompileServer::handle(int client) {
+  // A malformed request is dropped without a reply; the client reports it.
+  // A stop() also cuts short a request that is still arriving.
+  std::uint32_t count = 0;
+  std::string directory;
+  if (!readWord(client, count, wakeup_[0]) || count == 0 || count > kMaxArguments ||
+      !readString(client, directory, wakeup_[0])) {
+    return;
+  }
+  std::vector<std::string> args;
+  for (std::uint32_t i = 1; i < count; ++i) {
+    std::string arg;
+    if (!readString(client, arg, wakeup_[0])) {
+      return;
+    }
+    args.push_back(std::move(arg));
+  }
+
+  std::ostringstream diag;
+  const int status = compileRequest(directory, args, targets_, diag);
+  if (writeWord(client, static_cast<std::uint32_t>(status))) {
+    writeString(client, diag.str());
+  }
+}
+
+bool sendCompileRequest(const std::string& socket_path, const std::vector<std::string>& args,
+                        int& status, std::string& diagnostics, std::string& error) {
+  sockaddr_un address;
+  if (!socketAddress(socket_path, address, error)) {
+    return false;
+  }
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    error = std::string("cannot create socket: ") + std::strerror(errno);
+    return false;
+  }
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    error = "cannot connect to '" + socket_path + "': " + std::strerror(errno);
+    ::close(fd);
+    return false;
+  }
+
+  std::error_code ec;
+  const std::string directory = std::filesystem::current_path(ec).string();
+  bool sent = writeWord(fd, static_cast<std::uint32_t>(args.size() + 1)) &&
+              writeString(fd, directory);
+  for (std::size_t i = 0; sent && i < args.size(); ++i) {
+    sent = writeString(fd, args[i]);
+  }
+  std::uint32_t word = 0;
+  const bool answered = sent && readWord(fd, word) && readString(fd, diagnostics);
+  ::close(fd);
+  if (!answered) {
+    error = "compile server at '" + socket_path + "' dropped the request";
+    return false;
+  }
+  status = static_cast<int>(word);
+  return true;
+}
+
+}  // namespace compiler::driver
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "driver/driver.h"
+
+namespace compiler::driver {
+
+/**
+ * Resident compiler behind -daemon=<socket>. It accepts compile requests on
+ * a Unix domain socket and runs each through a Driver in this process, so a
+ * request skips process startup and LLVM target registration, and takes
+ * its target machines from a pool kept warm across requests.
+ *
+ * A request carries the client's working directory and its command-line
+ * arguments; the reply carries the exit status and the diagnostics the
+ * client would have printed. Requests are served one at a time, each in the
+ * client's working directory, and may still compile their inputs on
+ * several threads. A client that stops sending mid-request is dropped after
+ * a few seconds, so it cannot hold up the others.
+ */
+class CompileServer {
+ public:
+  /** A relative `socket_path` is resolved against the current directory. */
+  explicit CompileServer(std::string socket_path);
+  ~CompileServer();
+
+  CompileServer(const CompileServer&) = delete;
+  CompileServer& operator=(const CompileServer&) = delete;
+
+  /**
+   * Binds and listens on the socket, replacing a stale socket file left by
+   * an earlier server. A live server's socket or a file that is not a
+   * socket is never replaced. Only the server's user may use the socket,
+   * and requests from other users are closed unanswered. Returns false and
+   * sets `error` on failure.
+   */
+  bool open(std::string& error);
+
+  /** Serves requests until stop() is called. Requires a successful open(). */
+  void serve();
+
+  /** Makes serve() return after the current request; safe from a signal handler. */
+  void stop();
+
+ private:
+  void handle(int client);
+
+  std::string socket_path_;
+  int listener_ = -1;
+  /** Pipe whose read end wakes serve() when stop() writes to it. */
+  int wakeup_[2] = {-1, -1};
+  std::atomic<bool> stopping_{false};
+  TargetMachinePool targets_;
+};
+
+/**
+ * Client side of -connect=<socket>: sends `args` and the working directory
+ * to the server, then sets `status` and `diagnostics` from its reply.
+ * Returns false and sets `error` if the server cannot be reached.
+ */
+bool sendCompileRequest(const std::string& socket_path, const std::vector<std::string>& args,
+                        int& status, std::string& diagnostics, std::string& error);
+
+}  // namespace compiler::driver
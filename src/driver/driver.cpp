@@ -0,0 +1,604 @@
+#include "driver/driver.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+#include <utility>
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "ast/serialization.h"
+#include "codegen/codegen.h"
+#include "driver/incremental.h"
+#include "driver/partitioned_codegen.h"
+#include "driver/thread_pool.h"
+#include "optimizer/constant_folder.h"
+#include "parser/parser.h"
+#include "sema/sema.h"
+#include "support/buffered_writer.h"
+#include "support/instrumentation.h"
+#include "support/source_buffer.h"
+
+namespace compiler::driver {
+
+namespace {
+
+bool parseJobs(const std::string& text, unsigned& jobs) {
+  if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  jobs = static_cast<unsigned>(std::stoul(text));
+  return true;
+}
+
+/** Parses a byte count with an optional K, M or G suffix. */
+bool parseSize(const std::string& text, std::uint64_t& bytes) {
+  const std::size_t digits = text.find_first_not_of("0123456789");
+  if (digits == 0 || text.empty()) {
+    return false;
+  }
+  unsigned shift = 0;
+  if (digits != std::string::npos) {
+    const std::string suffix = text.substr(digits);
+    if (suffix == "K" || suffix == "k") {
+      shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+      shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+      shift = 30;
+    } else {
+      return false;
+    }
+  }
+  const std::uint64_t value = std::stoull(text.substr(0, digits));
+  if (value > (~std::uint64_t{0} >> shift)) {
+    return false;
+  }
+  bytes = value << shift;
+  return true;
+}
+
+/** Derives the default output path by swapping the input's extension. */
+std::string defaultOutputPath(const std::string& input, codegen::EmitKind kind) {
+  std::filesystem::path path(input);
+  path.replace_extension(codegen::extensionFor(kind));
+  return path.string();
+}
+
+/**
+ * Spells out everything besides the input bytes that compileUnit's output
+ * depends on. The input path is part of it because every output records it
+ * as the module's source file name.
+ */
+std::string cacheConfiguration(const DriverOptions& options, const std::string& input) {
+  std::ostringstream config;
+  config << CompileCache::compilerIdentity() << "\n"
+         << "input " << input << "\n"
+         << "target " << codegen::hostTargetName() << "\n"
+         << "opt " << static_cast<int>(options.opt_level) << " passes " << options.passes
+         << " parallel-opt " << options.parallel_opt << " emit " << static_cast<int>(options.emit)
+         << " load-ast " << options.load_ast << " incremental " << options.incremental
+         << " codegen-partitions " << options.codegen_partitions << "\n";
+  return config.str();
+}
+
+/**
+ * Returns how many threads one unit's codegen partitions may use: the units
+ * that run side by side under -j share the machine's cores, so -j N with P
+ * partitions does not start N * P threads.
+ */
+unsigned partitionThreads(const DriverOptions& options) {
+  const std::size_t units = std::max<std::size_t>(
+      1, std::min<std::size_t>(ThreadPool::defaultConcurrency(options.jobs),
+                               options.inputs.size()));
+  return std::max(1U, ThreadPool::defaultConcurrency(0) / static_cast<unsigned>(units));
+}
+
+/** Deletes a unit's target machine, or hands it back to the pool it came from. */
+struct ReleaseTarget {
+  TargetMachinePool* pool = nullptr;
+
+  void operator()(llvm::TargetMachine* target) const {
+    if (pool != nullptr) {
+      pool->release(std::unique_ptr<llvm::TargetMachine>(target));
+    } else {
+      delete target;
+    }
+  }
+};
+
+/**
+ * Parses `contents`, or decodes them as a binary AST under -load-ast.
+ * Returns null after writing the reasons to `diag`.
+ */
+std::unique_ptr<ast::TranslationUnit> readUnit(const std::string& input,
+                                               std::string_view contents,
+                                               const DriverOptions& options, std::ostream& diag) {
+  if (options.load_ast) {
+    std::string error;
+    auto unit = ast::deserialize(contents, error);
+    if (unit == nullptr) {
+      diag << "error: cannot load '" << input << "': " << error << "\n";
+    }
+    return unit;
+  }
+
+  parser::Parser parser(parser::ParseMode::Streaming, options.scanner, options.parser);
+  auto unit = parser.parse(contents, input);
+  for (const auto& err : parser.errors()) {
+    diag << err.filename << ":" << err.line << ": error: " << err.message << "\n";
+  }
+  return unit;
+}
+
+/**
+ * Streams the AST dump to `path`, or to stdout when it is empty or "-".
+ * Dumps of different inputs share stdout one whole unit at a time.
+ */
+bool writeASTDump(const ast::TranslationUnit& unit, ast::DumpFormat format,
+                  const std::string& path, std::string& error) {
+  support::TimeScope scope("dump", path);
+  if (path.empty() || path == "-") {
+    static std::mutex stdout_mutex;
+    std::lock_guard<std::mutex> lock(stdout_mutex);
+    support::BufferedWriter out(stdout);
+    ast::dump(unit, out, format);
+    if (!out.flush()) {
+      error = "cannot write AST dump to standard output";
+      return false;
+    }
+    return true;
+  }
+
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    error = "cannot open '" + path + "' for writing";
+    return false;
+  }
+  bool ok = false;
+  {
+    support::BufferedWriter out(file);
+    ast::dump(unit, out, format);
+    ok = out.flush();
+  }
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    error = "cannot write AST dump to '" + path + "'";
+  }
+  return ok;
+}
+
+}  // namespace
+
+bool parseArguments(const std::vector<std::string>& args, DriverOptions& options,
+                    std::string& error) {
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+    if (arg == "-o") {
+      if (i + 1 >= args.size()) {
+        error = "missing file name after '-o'";
+        return false;
+      }
+      options.output = args[++i];
+    } else if (arg == "-j") {
+      if (i + 1 >= args.size() || !parseJobs(args[i + 1], options.jobs)) {
+        error = "'-j' expects a job count";
+        return false;
+      }
+      ++i;
+    } else if (arg.rfind("-j", 0) == 0) {
+      if (!parseJobs(arg.substr(2), options.jobs)) {
+        error = "invalid job count '" + arg + "'";
+        return false;
+      }
+    } else if (arg == "-O") {
+      options.opt_level = optimizer::OptLevel::O1;
+    } else if (arg.rfind("-O", 0) == 0) {
+      if (!optimizer::parseOptLevel(arg.substr(2), options.opt_level)) {
+        error = "invalid optimization level '" + arg + "'";
+        return false;
+      }
+    } else if (arg.rfind("-fpasses=", 0) == 0) {
+      options.passes = arg.substr(9);
+    } else if (arg == "-fparallel-opt") {
+      options.parallel_opt = true;
+    } else if (arg == "-ftime-report") {
+      options.time_report = true;
+    } else if (arg == "-ftime-trace") {
+      options.time_trace = true;
+    } else if (arg.rfind("-ftime-trace=", 0) == 0) {
+      options.time_trace = true;
+      options.time_trace_path = arg.substr(13);
+    } else if (arg == "-ast-dump" || arg == "-ast-dump=text") {
+      options.ast_dump = true;
+      options.ast_dump_format = ast::DumpFormat::Text;
+    } else if (arg == "-ast-dump=json") {
+      options.ast_dump = true;
+      options.ast_dump_format = ast::DumpFormat::JSON;
+    } else if (arg == "-emit-ast") {
+      options.emit_ast = true;
+    } else if (arg == "-load-ast") {
+      options.load_ast = true;
+    } else if (arg.rfind("-fcache-dir=", 0) == 0) {
+      options.cache_dir = arg.substr(12);
+    } else if (arg == "-fincremental") {
+      options.incremental = true;
+    } else if (arg.rfind("-fcodegen-partitions=", 0) == 0) {
+      if (!parseJobs(arg.substr(21), options.codegen_partitions)) {
+        error = "invalid partition count '" + arg + "'";
+        return false;
+      }
+    } else if (arg == "-fsplit-objects") {
+      options.split_objects = true;
+    } else if (arg.rfind("-fcache-size=", 0) == 0) {
+      if (!parseSize(arg.substr(13), options.cache_limit)) {
+        error = "invalid cache size '" + arg + "'";
+        return false;
+      }
+    } else if (arg == "-fscanner=flex") {
+      options.scanner = lexer::ScannerKind::Flex;
+    } else if (arg == "-fscanner=fast") {
+      options.scanner = lexer::ScannerKind::Fast;
+    } else if (arg == "-fparser=bison") {
+      options.parser = parser::ParserKind::Bison;
+    } else if (arg == "-fparser=rd") {
+      options.parser = parser::ParserKind::RecursiveDescent;
+    } else if (arg == "-run") {
+      options.run = true;
+    } else if (arg == "--") {
+      options.run_args.assign(args.begin() + static_cast<std::ptrdiff_t>(i) + 1, args.end());
+      break;
+    } else if (arg == "-emit-llvm") {
+      options.emit = codegen::EmitKind::LLVMIR;
+    } else if (arg == "-emit-bc") {
+      options.emit = codegen::EmitKind::Bitcode;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      error = "unknown option '" + arg + "'";
+      return false;
+    } else {
+      options.inputs.push_back(arg);
+    }
+  }
+
+  if (options.inputs.empty()) {
+    error = "no input files";
+    return false;
+  }
+  if (options.emit_ast && options.ast_dump) {
+    error = "cannot combine '-emit-ast' with '-ast-dump'";
+    return false;
+  }
+  if (options.incremental && options.cache_dir.empty()) {
+    error = "'-fincremental' requires '-fcache-dir'";
+    return false;
+  }
+  if (options.incremental && options.codegen_partitions != 0) {
+    error = "cannot combine '-fincremental' with '-fcodegen-partitions'";
+    return false;
+  }
+  if (options.split_objects && options.codegen_partitions == 0) {
+    error = "'-fsplit-objects' requires '-fcodegen-partitions'";
+    return false;
+  }
+  if (options.run && options.inputs.size() > 1) {
+    error = "'-run' expects a single input file";
+    return false;
+  }
+  if (options.run && options.split_objects) {
+    error = "cannot combine '-run' with '-fsplit-objects'";
+    return false;
+  }
+  if (!options.run_args.empty() && !options.run) {
+    error = "arguments after '--' require '-run'";
+    return false;
+  }
+  if (!options.output.empty() && options.inputs.size() > 1) {
+    error = "cannot specify '-o' with multiple input files";
+    return false;
+  }
+  return true;
+}
+
+void printUsage(std::ostream& out) {
+  out << "Usage: compiler [options] <input-file>...\n"
+      << "Options:\n"
+      << "  --help        Show this help message\n"
+      << "  -o <file>     Output file path\n"
+      << "  -O<level>     Optimization level: 0, 1, 2, 3 or s (-O alone means -O1)\n"
+      << "  -fpasses=<p>  Run a custom LLVM pass pipeline instead of the -O pipeline\n"
+      << "  -fparallel-opt\n"
+      << "                Optimize functions concurrently (disables cross-function inlining)\n"
+      << "  -fcodegen-partitions=<n>\n"
+      << "                Generate and optimize functions in <n> partitions concurrently\n"
+      << "  -fsplit-objects\n"
+      << "                Write each partition to <output>.<i>.o instead of linking them\n"
+      << "  -run [-- <args>]\n"
+      << "                JIT-compile the input and run its main() with <args> in-process\n"
+      << "  -emit-llvm    Write textual LLVM IR (.ll) instead of an object file\n"
+      << "  -emit-bc      Write LLVM bitcode (.bc) instead of an object file\n"
+      << "  -emit-ast     Write the parsed AST in binary form (.ast) instead of compiling\n"
+      << "  -load-ast     Read inputs as binary ASTs written by -emit-ast instead of parsing\n"
+      << "  -ast-dump[=json]\n"
+      << "                Write the analyzed AST as text or JSON (to -o, default stdout)\n"
+      << "  -fcache-dir=<dir>\n"
+      << "                Reuse outputs of identical earlier compiles stored in <dir>\n"
+      << "  -fincremental Reuse optimized IR of unchanged functions from -fcache-dir\n"
+      << "  -fcache-size=<bytes>[K|M|G]\n"
+      << "                Evict least recently used cache entries beyond this size (default 512M)\n"
+      << "  -fscanner=flex|fast\n"
+      << "                Tokenize with the Flex scanner (default) or the hand-written SIMD one\n"
+      << "  -fparser=bison|rd\n"
+      << "                Parse with the Bison parser (default) or the recursive-descent one\n"
+      << "  -ftime-report Print wall/CPU time, allocations and peak RSS per phase\n"
+      << "  -ftime-trace[=<file>]\n"
+      << "                Write a Chrome trace-event JSON file (default: <output>.json)\n"
+      << "  -j <N>        Compile up to N files in parallel (default: all cores)\n"
+      << "  -daemon=<socket>\n"
+      << "                Stay resident and serve compile requests on a Unix socket\n"
+      << "  -connect=<socket> <args>\n"
+      << "                Have the server on <socket> compile with <args>\n";
+}
+
+TargetMachinePool::TargetMachinePool() = default;
+
+TargetMachinePool::~TargetMachinePool() = default;
+
+std::unique_ptr<llvm::TargetMachine> TargetMachinePool::acquire(std::string& error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      std::unique_ptr<llvm::TargetMachine> target = std::move(idle_.back());
+      idle_.pop_back();
+      return target;
+    }
+  }
+  return codegen::createHostTargetMachine(error);
+}
+
+void TargetMachinePool::release(std::unique_ptr<llvm::TargetMachine> target) {
+  if (target != nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(std::move(target));
+  }
+}
+
+Driver::Driver(DriverOptions options, TargetMachinePool* targets)
+    : options_(std::move(options)), targets_(targets) {}
+
+int Driver::run(std::ostream& diag) {
+  support::Instrumentation instrumentation;
+  const bool instrumented = options_.time_report || options_.time_trace;
+  if (instrumented) {
+    instrumentation.install();
+  }
+
+  std::vector<UnitResult> results(options_.inputs.size());
+  {
+    ThreadPool pool(options_.jobs);
+    for (std::size_t i = 0; i < options_.inputs.size(); ++i) {
+      pool.submit([this, &results, i] { results[i] = compileUnit(options_.inputs[i]); });
+    }
+    pool.wait();
+  }
+
+  // Trimming scans the whole cache, so it runs once for the batch.
+  const auto stored = [](const UnitResult& result) { return result.cache_stored; };
+  if (std::any_of(results.begin(), results.end(), stored)) {
+    CompileCache(options_.cache_dir, options_.cache_limit).trim();
+  }
+
+  int status = 0;
+  for (const auto& result : results) {
+    diag << result.diagnostics;
+    if (!result.success) {
+      status = 1;
+    } else if (options_.run) {
+      status = result.exit_code;
+    }
+  }
+
+  if (instrumented) {
+    instrumentation.uninstall();
+    if (options_.time_report) {
+      instrumentation.writeReport(diag);
+    }
+    if (options_.time_trace) {
+      std::string path = options_.time_trace_path;
+      if (path.empty()) {
+        path = options_.output.empty() ? options_.inputs.front() : options_.output;
+        path = std::filesystem::path(path).replace_extension(".json").string();
+      }
+      std::ofstream trace(path);
+      instrumentation.writeTrace(trace);
+      if (!trace) {
+        diag << "error: cannot write time trace '" << path << "'\n";
+        status = 1;
+      }
+    }
+  }
+  return status;
+}
+
+UnitResult Driver::compileUnit(const std::string& input) const {
+  support::TimeScope scope("compile", input);
+  UnitResult result;
+  result.input = input;
+  std::ostringstream diag;
+
+  support::SourceBuffer source;
+  std::string error;
+  if (!source.open(input, error)) {
+    diag << "error: cannot open '" << input << "': " << error << "\n";
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  // Only full compiles to a single output file are cached; a hit skips
+  // every phase below.
+  const std::string output =
+      options_.output.empty() ? defaultOutputPath(input, options_.emit) : options_.output;
+  const bool cached = !options_.cache_dir.empty() && !options_.emit_ast && !options_.ast_dump &&
+                      !options_.split_objects && !options_.run && output != "-";
+  const CompileCache cache(options_.cache_dir, options_.cache_limit);
+  std::string cache_key;
+  if (cached) {
+    cache_key = CompileCache::key(source.contents(), cacheConfiguration(options_, input));
+    if (cache.fetch(cache_key, output)) {
+      result.success = true;
+      result.cache_hit = true;
+      return result;
+    }
+  }
+
+  auto unit = readUnit(input, source.contents(), options_, diag);
+  if (unit == nullptr) {
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  if (options_.emit_ast) {
+    const std::string ast_output =
+        options_.output.empty() ? std::filesystem::path(input).replace_extension(".ast").string()
+                                : options_.output;
+    result.success = ast::saveAST(*unit, ast_output, error);
+    if (!result.success) {
+      diag << "error: " << error << "\n";
+    }
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  sema::SemanticAnalyzer analyzer;
+  const bool sema_ok = analyzer.analyze(*unit);
+  for (const auto& err : analyzer.diagnostics()) {
+    diag << input << ":" << err.line << ": error: " << err.message << "\n";
+  }
+
+  // The dump is written even after sema errors; it then shows what was resolved.
+  if (options_.ast_dump) {
+    const bool written = writeASTDump(*unit, options_.ast_dump_format, options_.output, error);
+    if (!written) {
+      diag << "error: " << error << "\n";
+    }
+    result.success = sema_ok && written;
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  if (!sema_ok) {
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  if (options_.opt_level != optimizer::OptLevel::O0) {
+    optimizer::ConstantFolder().run(*unit);
+  }
+
+  std::unique_ptr<llvm::TargetMachine, ReleaseTarget> target(
+      (targets_ != nullptr ? targets_->acquire(error) : codegen::createHostTargetMachine(error))
+          .release(),
+      ReleaseTarget{targets_});
+  if (target != nullptr) {
+    optimizer::applyCodegenLevel(*target, options_.opt_level);
+  } else if (options_.emit == codegen::EmitKind::Object) {
+    diag << "error: cannot create target machine: " << error << "\n";
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  // Each unit gets its own LLVM context so workers never share IR state. It
+  // lives on the heap so that -run can hand it to the JIT with the module.
+  auto context = std::make_unique<llvm::LLVMContext>();
+  std::unique_ptr<llvm::Module> module;
+  if (options_.incremental) {
+    IncrementalBuilder builder(cache, {options_.opt_level, options_.passes}, target.get());
+    module = builder.build(*unit, *context, input, diag);
+    result.functions_reused = builder.reused();
+    result.cache_stored = builder.rebuilt() > 0;
+    if (module == nullptr) {
+      result.diagnostics = diag.str();
+      return result;
+    }
+  } else if (options_.split_objects) {
+    PartitionedCodegen partitioned({options_.opt_level, options_.passes},
+                                   options_.codegen_partitions, partitionThreads(options_),
+                                   targets_);
+    result.success = partitioned.emit(*unit, input, options_.emit, output, diag);
+    result.diagnostics = diag.str();
+    return result;
+  } else if (options_.codegen_partitions > 1) {
+    PartitionedCodegen partitioned({options_.opt_level, options_.passes},
+                                   options_.codegen_partitions, partitionThreads(options_),
+                                   targets_);
+    module = partitioned.build(*unit, *context, input, diag);
+    if (module == nullptr) {
+      result.diagnostics = diag.str();
+      return result;
+    }
+  } else {
+    codegen::CodeGenerator generator(*context, input);
+    if (!generator.generate(*unit)) {
+      for (const auto& err : generator.errors()) {
+        diag << input << ":" << err.line << ": error: " << err.message << "\n";
+      }
+      result.diagnostics = diag.str();
+      return result;
+    }
+
+    module = generator.takeModule();
+    if (target != nullptr) {
+      codegen::configureModule(*module, *target);
+    }
+
+    optimizer::Optimizer optimizer({options_.opt_level, options_.passes}, target.get());
+    if (options_.parallel_opt) {
+      module = optimizer.runParallel(std::move(module),
+                                     ThreadPool::defaultConcurrency(options_.jobs), error);
+    } else if (!optimizer.run(*module, error)) {
+      module.reset();
+    }
+    if (module == nullptr) {
+      diag << "error: " << error << "\n";
+      result.diagnostics = diag.str();
+      return result;
+    }
+  }
+
+  if (options_.run) {
+    std::vector<std::string> args{input};
+    args.insert(args.end(), options_.run_args.begin(), options_.run_args.end());
+    result.success =
+        codegen::runMain(std::move(module), std::move(context), args, result.exit_code, error);
+    if (!result.success) {
+      diag << "error: " << error << "\n";
+    }
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  if (!codegen::emitModule(*module, options_.emit, output, target.get(), error)) {
+    diag << "error: " << error << "\n";
+    result.diagnostics = diag.str();
+    return result;
+  }
+
+  // A cache that cannot be written only costs the next build time.
+  if (cached && cache.store(cache_key, output, error)) {
+    result.cache_stored = true;
+  }
+
+  result.success = true;
+  result.diagnostics = diag.str();
+  return result;
+}
+
+}  // namespace compiler::driver
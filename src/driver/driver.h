@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+#include "codegen/emitter.h"
+#include "driver/compile_cache.h"
+#include "lexer/lexer.h"
+#include "optimizer/optimizer.h"
+#include "parser/parser.h"
+
+namespace llvm {
+class TargetMachine;
+}  // namespace llvm
+
+namespace compiler::driver {
+
+/** Command-line configuration for a compiler invocation. */
+struct DriverOptions {
+  std::vector<std::string> inputs;
+  std::string output;
+  unsigned jobs = 0;
+  optimizer::OptLevel opt_level = optimizer::OptLevel::O0;
+  std::string passes;
+  bool parallel_opt = false;
+  codegen::EmitKind emit = codegen::EmitKind::Object;
+  /** Print per-phase timings to the diagnostic stream (-ftime-report). */
+  bool time_report = false;
+  /** Write a Chrome trace-event file (-ftime-trace[=<file>]). */
+  bool time_trace = false;
+  /** Trace path; empty means next to the output, with a .json extension. */
+  std::string time_trace_path;
+  /** Dump the analyzed AST instead of compiling (-ast-dump[=json]). */
+  bool ast_dump = false;
+  ast::DumpFormat ast_dump_format = ast::DumpFormat::Text;
+  /** Write the parsed AST in binary form instead of compiling (-emit-ast). */
+  bool emit_ast = false;
+  /** Scanner that tokenizes sources (-fscanner=flex|fast). */
+  lexer::ScannerKind scanner = lexer::ScannerKind::Flex;
+  /** Parser that builds the AST (-fparser=bison|rd). */
+  parser::ParserKind parser = parser::ParserKind::Bison;
+  /** Read inputs as binary ASTs written by -emit-ast instead of parsing them (-load-ast). */
+  bool load_ast = false;
+  /** Directory of the compile cache (-fcache-dir=<dir>); empty disables caching. */
+  std::string cache_dir;
+  /** Size the cache is trimmed to after each compile (-fcache-size=<bytes>[K|M|G]). */
+  std::uint64_t cache_limit = CompileCache::kDefaultLimit;
+  /**
+   * Cache optimized IR per function and rebuild only changed functions
+   * (-fincremental); requires `cache_dir` and takes precedence over
+   * `parallel_opt`.
+   */
+  bool incremental = false;
+  /**
+   * Generate and optimize functions in this many partitions at once, each in
+   * an LLVM context of its own (-fcodegen-partitions=<n>); 0 and 1 generate
+   * the unit whole. Partitions run on the cores left to their unit under
+   * -j, not on a thread each. Takes precedence over `parallel_opt`.
+   */
+  unsigned codegen_partitions = 0;
+  /** Write each codegen partition to an output of its own (-fsplit-objects). */
+  bool split_objects = false;
+  /** JIT-compile the input and call its main() instead of writing output (-run). */
+  bool run = false;
+  /** Arguments after "--", passed to main() after the input path under -run. */
+  std::vector<std::string> run_args;
+};
+
+/** Outcome of compiling one translation unit. */
+struct UnitResult {
+  std::string input;
+  bool success = false;
+  std::string diagnostics;
+  /** True when the output was copied from the compile cache. */
+  bool cache_hit = false;
+  /** Functions whose optimized IR came from the cache under -fincremental. */
+  std::size_t functions_reused = 0;
+  /** True when the unit added entries to the compile cache. */
+  bool cache_stored = false;
+  /** What main() returned under -run. */
+  int exit_code = 0;
+};
+
+/** Parses command-line arguments (excluding argv[0]) into driver options. */
+bool parseArguments(const std::vector<std::string>& args, DriverOptions& options,
+                    std::string& error);
+
+/** Writes the command-line usage summary. */
+void printUsage(std::ostream& out);
+
+/**
+ * Host target machines kept between compiles by a long-lived process such as
+ * the compile server, which would otherwise create one per unit. Machines
+ * may be shared between threads, each used by one unit at a time.
+ */
+class TargetMachinePool {
+ public:
+  TargetMachinePool();
+  ~TargetMachinePool();
+
+  TargetMachinePool(const TargetMachinePool&) = delete;
+  TargetMachinePool& operator=(const TargetMachinePool&) = delete;
+
+  /** Returns an idle machine, or a new one when none is left; null sets `error`. */
+  std::unique_ptr<llvm::TargetMachine> acquire(std::string& error);
+
+  /** Returns a machine to the pool once its unit is done with it. */
+  void release(std::unique_ptr<llvm::TargetMachine> target);
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<llvm::TargetMachine>> idle_;
+};
+
+/** Runs the per-file pipeline for every input on a work-stealing thread pool. */
+class Driver {
+ public:
+  /** Units take their target machines from `targets` when it is given. */
+  explicit Driver(DriverOptions options, TargetMachinePool* targets = nullptr);
+
+  /**
+   * Compiles all inputs and writes their diagnostics to `diag` in input order,
+   * so the output does not depend on the number of jobs. Returns the exit code,
+   * which under -run is the one main() returned.
+   */
+  int run(std::ostream& diag);
+
+  /** Compiles a single translation unit; safe to call from several threads. */
+  UnitResult compileUnit(const std::string& input) const;
+
+ private:
+  DriverOptions options_;
+  TargetMachinePool* targets_;
+};
+
+}  // namespace compiler::driver
@@ -0,0 +1,249 @@
+#include "driver/incremental.h"
+
+#include <ostream>
+#include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+#include "ast/fingerprint.h"
+#include "codegen/codegen.h"
+#include "codegen/emitter.h"
+#include "support/instrumentation.h"
+
+namespace compiler::driver {
+
+namespace {
+
+/**
+ * Copies `roots` into the empty module `target`: functions with their bodies,
+ * global variables with their initializers. Local-linkage globals they reach,
+ * such as string constants, are copied along since they cannot be declared;
+ * every other global they refer to is only declared. Unlike llvm::CloneModule
+ * this costs the size of what is copied, not of the whole source module.
+ */
+void copyInto(llvm::Module& target, const std::vector<const llvm::GlobalValue*>& roots) {
+  std::vector<const llvm::GlobalValue*> defined;
+  std::vector<const llvm::GlobalValue*> declared;
+  std::unordered_set<const llvm::GlobalValue*> seen(roots.begin(), roots.end());
+  std::vector<const llvm::Value*> worklist;
+
+  const auto define = [&](const llvm::GlobalValue* global) {
+    defined.push_back(global);
+    if (const auto* fn = llvm::dyn_cast<llvm::Function>(global)) {
+      for (const llvm::BasicBlock& block : *fn) {
+        for (const llvm::Instruction& inst : block) {
+          worklist.insert(worklist.end(), inst.op_begin(), inst.op_end());
+        }
+      }
+    } else if (const auto* var = llvm::dyn_cast<llvm::GlobalVariable>(global)) {
+      if (var->hasInitializer()) {
+        worklist.push_back(var->getInitializer());
+      }
+    }
+  };
+
+  for (const llvm::GlobalValue* root : roots) {
+    define(root);
+  }
+  while (!worklist.empty()) {
+    const llvm::Value* value = worklist.back();
+    worklist.pop_back();
+    if (const auto* global = llvm::dyn_cast<llvm::GlobalValue>(value)) {
+      if (seen.insert(global).second) {
+        if (global->hasLocalLinkage()) {
+          define(global);
+        } else {
+          declared.push_back(global);
+        }
+      }
+    } else if (const auto* constant = llvm::dyn_cast<llvm::Constant>(value)) {
+      worklist.insert(worklist.end(), constant->op_begin(), constant->op_end());
+    }
+  }
+
+  // Create every global before filling any in, so bodies and initializers
+  // can refer to each other in any order.
+  llvm::ValueToValueMapTy map;
+  const auto create = [&](const llvm::GlobalValue* global, bool definition) {
+    const auto linkage = definition ? global->getLinkage() : llvm::GlobalValue::ExternalLinkage;
+    llvm::GlobalValue* copy = nullptr;
+    if (const auto* fn = llvm::dyn_cast<llvm::Function>(global)) {
+      auto* created = llvm::Function::Create(fn->getFunctionType(), linkage,
+                                             fn->getAddressSpace(), fn->getName(), &target);
+      created->copyAttributesFrom(fn);
+      copy = created;
+    } else {
+      const auto* var = llvm::cast<llvm::GlobalVariable>(global);
+      auto* created = new llvm::GlobalVariable(
+          target, var->getValueType(), var->isConstant(), linkage, nullptr, var->getName(),
+          nullptr, var->getThreadLocalMode(), var->getAddressSpace());
+      created->copyAttributesFrom(var);
+      copy = created;
+    }
+    map[global] = copy;
+  };
+  for (const llvm::GlobalValue* global : defined) {
+    create(global, true);
+  }
+  for (const llvm::GlobalValue* global : declared) {
+    create(global, false);
+  }
+
+  for (const llvm::GlobalValue* global : defined) {
+    if (const auto* fn = llvm::dyn_cast<llvm::Function>(global)) {
+      auto* copy = llvm::cast<llvm::Function>(map[fn]);
+      auto arg = copy->arg_begin();
+      for (const llvm::Argument& param : fn->args()) {
+        arg->setName(param.getName());
+        map[&param] = &*arg++;
+      }
+      llvm::SmallVector<llvm::ReturnInst*, 4> returns;
+      llvm::CloneFunctionInto(copy, fn, map, llvm::CloneFunctionChangeType::DifferentModule,
+                              returns);
+    } else {
+      const auto* var = llvm::cast<llvm::GlobalVariable>(global);
+      if (var->hasInitializer()) {
+        llvm::cast<llvm::GlobalVariable>(map[var])->setInitializer(
+            llvm::MapValue(var->getInitializer(), map));
+      }
+    }
+  }
+
+  // Cloning across modules adds an empty compile-unit list, which would
+  // make the bitcode reader warn about debug info the piece does not have.
+  llvm::NamedMDNode* units = target.getNamedMetadata("llvm.dbg.cu");
+  if (units != nullptr && units->getNumOperands() == 0) {
+    target.eraseNamedMetadata(units);
+  }
+}
+
+/** Returns an empty module with the same name and target settings as `module`. */
+std::unique_ptr<llvm::Module> emptyLike(const llvm::Module& module) {
+  auto copy = std::make_unique<llvm::Module>(module.getModuleIdentifier(), module.getContext());
+  copy->setSourceFileName(module.getSourceFileName());
+  copy->setTargetTriple(module.getTargetTriple());
+  copy->setDataLayout(module.getDataLayout());
+  return copy;
+}
+
+}  // namespace
+
+IncrementalBuilder::IncrementalBuilder(const CompileCache& cache,
+                                       optimizer::OptimizerOptions options,
+                                       llvm::TargetMachine* target)
+    : cache_(cache), options_(std::move(options)), target_(target) {
+  // Unlike whole-unit entries these leave out the input path: a function
+  // compiles the same wherever it appears, so files can share entries.
+  std::ostringstream config;
+  config << CompileCache::compilerIdentity() << "\n"
+         << "function\n"
+         << "target " << (target_ != nullptr ? codegen::hostTargetName() : "none") << "\n"
+         << "opt " << static_cast<int>(options_.level) << " passes " << options_.passes << "\n";
+  configuration_ = config.str();
+}
+
+std::unique_ptr<llvm::Module> IncrementalBuilder::build(ast::TranslationUnit& unit,
+                                                        llvm::LLVMContext& context,
+                                                        const std::string& input,
+                                                        std::ostream& diag) {
+  support::TimeScope scope("incremental", input);
+  reused_ = 0;
+  rebuilt_ = 0;
+
+  std::vector<const ast::FunctionDecl*> functions;
+  for (const ast::ASTNode* decl : unit.decls) {
+    if (const auto* fn = ast::dyn_cast<ast::FunctionDecl>(decl)) {
+      functions.push_back(fn);
+    }
+  }
+
+  // Pieces stay in source order so that the linked module does too.
+  std::vector<std::string> keys(functions.size());
+  std::vector<std::unique_ptr<llvm::Module>> pieces(functions.size());
+  std::unordered_set<const ast::FunctionDecl*> stale;
+  std::string bitcode;
+  for (std::size_t i = 0; i < functions.size(); ++i) {
+    keys[i] = CompileCache::key(ast::fingerprint(*functions[i]), configuration_);
+    if (cache_.load(keys[i], bitcode)) {
+      auto piece = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, keys[i]), context);
+      if (piece) {
+        pieces[i] = std::move(*piece);
+        ++reused_;
+        continue;
+      }
+      // A damaged entry is rebuilt and overwritten below.
+      llvm::consumeError(piece.takeError());
+    }
+    stale.insert(functions[i]);
+  }
+
+  codegen::CodeGenerator generator(context, input);
+  if (!generator.generate(unit, &stale)) {
+    for (const auto& err : generator.errors()) {
+      diag << input << ":" << err.line << ": error: " << err.message << "\n";
+    }
+    return nullptr;
+  }
+  std::unique_ptr<llvm::Module> module = generator.takeModule();
+  if (target_ != nullptr) {
+    codegen::configureModule(*module, *target_);
+  }
+
+  optimizer::Optimizer optimizer(options_, target_);
+  std::string error;
+  llvm::SmallVector<char, 0> buffer;
+  for (std::size_t i = 0; i < functions.size(); ++i) {
+    if (pieces[i] != nullptr) {
+      continue;
+    }
+    const llvm::Function* fn = module->getFunction(functions[i]->name.str());
+    pieces[i] = emptyLike(*module);
+    copyInto(*pieces[i], {fn});
+    if (!optimizer.run(*pieces[i], error)) {
+      diag << "error: " << error << "\n";
+      return nullptr;
+    }
+    buffer.clear();
+    llvm::raw_svector_ostream out(buffer);
+    llvm::WriteBitcodeToFile(*pieces[i], out);
+    // An entry that cannot be saved only costs the next build time.
+    cache_.save(keys[i], std::string_view(buffer.data(), buffer.size()), error);
+    ++rebuilt_;
+  }
+
+  support::TimeScope link_scope("link", input);
+  std::vector<const llvm::GlobalValue*> globals;
+  for (const llvm::GlobalVariable& var : module->globals()) {
+    if (!var.hasLocalLinkage() && !var.isDeclaration()) {
+      globals.push_back(&var);
+    }
+  }
+  auto merged = emptyLike(*module);
+  copyInto(*merged, globals);
+  for (std::size_t i = 0; i < pieces.size(); ++i) {
+    if (llvm::Linker::linkModules(*merged, std::move(pieces[i]))) {
+      diag << "error: cannot link function '" << functions[i]->name.str() << "'\n";
+      return nullptr;
+    }
+  }
+  return merged;
+}
+
+}  // namespace compiler::driver
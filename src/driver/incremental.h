@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "ast/ast.h"
+#include "driver/compile_cache.h"
+#include "optimizer/optimizer.h"
+
+namespace llvm {
+class LLVMContext;
+class Module;
+class TargetMachine;
+}  // namespace llvm
+
+namespace compiler::driver {
+
+/**
+ * Builds a module one function at a time, reusing optimized IR kept in a
+ * CompileCache (-fincremental). Each function's entry is keyed by its
+ * ast::fingerprint, so only functions whose fingerprint changed go through
+ * codegen and the optimizer. Each of those is split into a module of its
+ * own, optimized and stored, then linked with the cached functions onto a
+ * module holding the globals.
+ *
+ * Functions are optimized in isolation, so as with -fparallel-opt no
+ * function is inlined into another.
+ */
+class IncrementalBuilder {
+ public:
+  IncrementalBuilder(const CompileCache& cache, optimizer::OptimizerOptions options,
+                     llvm::TargetMachine* target);
+
+  /**
+   * Builds the optimized module for an analyzed unit. Returns null after
+   * writing diagnostics to `diag`. New entries are stored but the cache is
+   * not trimmed.
+   */
+  std::unique_ptr<llvm::Module> build(ast::TranslationUnit& unit, llvm::LLVMContext& context,
+                                      const std::string& input, std::ostream& diag);
+
+  /** Functions the last build took from the cache. */
+  std::size_t reused() const { return reused_; }
+
+  /** Functions the last build generated and optimized. */
+  std::size_t rebuilt() const { return rebuilt_; }
+
+ private:
+  const CompileCache& cache_;
+  optimizer::OptimizerOptions options_;
+  llvm::TargetMachine* target_;
+  /** Everything besides the fingerprint that a function's optimized IR depends on. */
+  std::string configuration_;
+  std::size_t reused_ = 0;
+  std::size_t rebuilt_ = 0;
+};
+
+}  // namespace compiler::driver
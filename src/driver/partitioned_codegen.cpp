@@ -0,0 +1,196 @@
+#include "driver/partitioned_codegen.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <ostream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "codegen/codegen.h"
+#include "driver/driver.h"
+#include "driver/thread_pool.h"
+#include "support/instrumentation.h"
+
+namespace compiler::driver {
+
+namespace {
+
+/**
+ * Turns the module's global variable definitions into declarations, for
+ * every partition but the one that defines them. Constants that only their
+ * initializers used, such as string literals, go with them.
+ */
+void declareGlobals(llvm::Module& module) {
+  std::vector<llvm::GlobalVariable*> unused;
+  for (llvm::GlobalVariable& var : module.globals()) {
+    if (var.hasLocalLinkage() || var.isDeclaration()) {
+      continue;
+    }
+    var.setInitializer(nullptr);
+    var.setLinkage(llvm::GlobalValue::ExternalLinkage);
+  }
+  for (llvm::GlobalVariable& var : module.globals()) {
+    var.removeDeadConstantUsers();
+    if (var.hasLocalLinkage() && var.use_empty()) {
+      unused.push_back(&var);
+    }
+  }
+  for (llvm::GlobalVariable* var : unused) {
+    var->eraseFromParent();
+  }
+}
+
+}  // namespace
+
+PartitionedCodegen::PartitionedCodegen(optimizer::OptimizerOptions options, unsigned partitions,
+                                       unsigned threads, TargetMachinePool* targets)
+    : options_(std::move(options)),
+      partitions_(std::max(partitions, 1U)),
+      threads_(std::max(threads, 1U)),
+      targets_(targets) {}
+
+std::string PartitionedCodegen::partitionPath(const std::string& output, std::size_t index) {
+  std::filesystem::path path(output);
+  path.replace_extension(std::to_string(index) + path.extension().string());
+  return path.string();
+}
+
+std::size_t PartitionedCodegen::run(ast::TranslationUnit& unit, const std::string& input,
+                                    const Finish& finish, std::ostream& diag) {
+  std::vector<const ast::FunctionDecl*> functions;
+  for (const ast::ASTNode* decl : unit.decls) {
+    if (const auto* fn = ast::dyn_cast<ast::FunctionDecl>(decl)) {
+      functions.push_back(fn);
+    }
+  }
+  const std::size_t count = std::max<std::size_t>(
+      1, std::min<std::size_t>(partitions_, functions.size()));
+  std::vector<std::unordered_set<const ast::FunctionDecl*>> bodies(count);
+  for (std::size_t i = 0; i < functions.size(); ++i) {
+    bodies[i * count / functions.size()].insert(functions[i]);
+  }
+
+  // Generators only read the analyzed unit, so every worker shares it; all
+  // IR it builds stays in the worker's own context.
+  std::vector<std::vector<codegen::CodegenError>> codegen_errors(count);
+  std::vector<std::string> errors(count);
+  TargetMachinePool own_targets;
+  TargetMachinePool& targets = targets_ != nullptr ? *targets_ : own_targets;
+  {
+    ThreadPool pool(static_cast<unsigned>(std::min<std::size_t>(count, threads_)));
+    for (std::size_t i = 0; i < count; ++i) {
+      pool.submit([&, i] {
+        support::TimeScope scope("partition", input + "#" + std::to_string(i));
+        llvm::LLVMContext context;
+        codegen::CodeGenerator generator(context, input);
+        if (!generator.generate(unit, &bodies[i])) {
+          codegen_errors[i] = generator.errors();
+          return;
+        }
+        std::unique_ptr<llvm::Module> module = generator.takeModule();
+        if (i != 0) {
+          declareGlobals(*module);
+        }
+
+        // Target machines are not safe to share, so each worker holds one
+        // for the length of its partition.
+        std::string unavailable;
+        std::unique_ptr<llvm::TargetMachine> target = targets.acquire(unavailable);
+        if (target != nullptr) {
+          optimizer::applyCodegenLevel(*target, options_.level);
+          codegen::configureModule(*module, *target);
+        }
+        optimizer::Optimizer optimizer(options_, target.get());
+        if (optimizer.run(*module, errors[i])) {
+          finish(i, *module, target.get(), errors[i]);
+        }
+        targets.release(std::move(target));
+      });
+    }
+    pool.wait();
+  }
+
+  // Every partition lowers the globals, so their diagnostics repeat.
+  std::unordered_set<std::string> reported;
+  bool failed = false;
+  for (std::size_t i = 0; i < count; ++i) {
+    for (const auto& err : codegen_errors[i]) {
+      std::string line = input + ":" + std::to_string(err.line) + ": error: " + err.message;
+      if (reported.insert(line).second) {
+        diag << line << "\n";
+      }
+      failed = true;
+    }
+    if (!errors[i].empty()) {
+      diag << "error: " << errors[i] << "\n";
+      failed = true;
+    }
+  }
+  return failed ? 0 : count;
+}
+
+std::unique_ptr<llvm::Module> PartitionedCodegen::build(ast::TranslationUnit& unit,
+                                                        llvm::LLVMContext& context,
+                                                        const std::string& input,
+                                                        std::ostream& diag) {
+  // Partitions travel between contexts as bitcode; an LLVMContext must never
+  // be touched by two threads at once.
+  std::vector<llvm::SmallVector<char, 0>> buffers(partitions_);
+  const std::size_t count = run(
+      unit, input,
+      [&buffers](std::size_t index, llvm::Module& module, llvm::TargetMachine*, std::string&) {
+        llvm::raw_svector_ostream out(buffers[index]);
+        llvm::WriteBitcodeToFile(module, out);
+        return true;
+      },
+      diag);
+  if (count == 0) {
+    return nullptr;
+  }
+
+  support::TimeScope scope("link", input);
+  std::unique_ptr<llvm::Module> merged;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto part = llvm::parseBitcodeFile(
+        llvm::MemoryBufferRef(llvm::StringRef(buffers[i].data(), buffers[i].size()), input),
+        context);
+    if (!part) {
+      diag << "error: " << llvm::toString(part.takeError()) << "\n";
+      return nullptr;
+    }
+    if (merged == nullptr) {
+      merged = std::move(*part);
+    } else if (llvm::Linker::linkModules(*merged, std::move(*part))) {
+      diag << "error: cannot link code generation partition " << i << "\n";
+      return nullptr;
+    }
+  }
+  return merged;
+}
+
+bool PartitionedCodegen::emit(ast::TranslationUnit& unit, const std::string& input,
+                              codegen::EmitKind kind, const std::string& output,
+                              std::ostream& diag) {
+  return run(
+             unit, input,
+             [kind, &output](std::size_t index, llvm::Module& module,
+                             llvm::TargetMachine* target, std::string& error) {
+               return codegen::emitModule(module, kind, partitionPath(output, index), target,
+                                          error);
+             },
+             diag) != 0;
+}
+
+}  // namespace compiler::driver
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "ast/ast.h"
+#include "codegen/emitter.h"
+#include "optimizer/optimizer.h"
+
+namespace llvm {
+class LLVMContext;
+class Module;
+class TargetMachine;
+}  // namespace llvm
+
+namespace compiler::driver {
+
+class TargetMachinePool;
+
+/**
+ * Lowers a unit's functions in partitions, each in an LLVMContext and module
+ * of its own, running codegen and the optimizer for all partitions at once
+ * on a thread pool (-fcodegen-partitions). Functions are split into
+ * contiguous runs of the unit, so linking the partitions back together
+ * keeps source order. The first partition defines the globals; the others
+ * only declare them.
+ *
+ * As with -fparallel-opt, functions in different partitions are not inlined
+ * into each other.
+ *
+ * Partitions run on a pool of at most `threads` workers rather than one
+ * thread each, so that units compiled side by side under -j can split the
+ * machine between them instead of multiplying their partitions. Workers
+ * take target machines from `targets` when it is given, and otherwise share
+ * the ones this unit creates, one per worker at most.
+ */
+class PartitionedCodegen {
+ public:
+  PartitionedCodegen(optimizer::OptimizerOptions options, unsigned partitions,
+                     unsigned threads, TargetMachinePool* targets = nullptr);
+
+  /**
+   * Generates and optimizes the partitions of an analyzed unit and links
+   * them into one module in `context`. Returns null after writing
+   * diagnostics to `diag`.
+   */
+  std::unique_ptr<llvm::Module> build(ast::TranslationUnit& unit, llvm::LLVMContext& context,
+                                      const std::string& input, std::ostream& diag);
+
+  /**
+   * Like build, but each worker also writes its partition to
+   * partitionPath(output, index) instead of handing it back for linking
+   * (-fsplit-objects). Returns false after writing diagnostics to `diag`.
+   */
+  bool emit(ast::TranslationUnit& unit, const std::string& input, codegen::EmitKind kind,
+            const std::string& output, std::ostream& diag);
+
+  /** Where emit writes partition `index` of `output`: "out.o" becomes "out.<index>.o". */
+  static std::string partitionPath(const std::string& output, std::size_t index);
+
+ private:
+  /** Finishes an optimized partition on its worker thread; false sets `error`. */
+  using Finish = std::function<bool(std::size_t index, llvm::Module& module,
+                                    llvm::TargetMachine* target, std::string& error)>;
+
+  /** Returns the number of partitions, or zero after writing diagnostics to `diag`. */
+  std::size_t run(ast::TranslationUnit& unit, const std::string& input, const Finish& finish,
+                  std::ostream& diag);
+
+  optimizer::OptimizerOptions options_;
+  unsigned partitions_;
+  unsigned threads_;
+  TargetMachinePool* targets_;
+};
+
+}  // namespace compiler::driver
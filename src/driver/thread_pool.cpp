@@ -0,0 +1,115 @@
+#include "driver/thread_pool.h"
+
+#include <utility>
+
+namespace compiler::driver {
+
+namespace {
+
+/** Identifies the pool and queue owned by the current worker thread, if any. */
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local std::size_t t_queue = 0;
+
+}  // namespace
+
+unsigned ThreadPool::defaultConcurrency(unsigned requested) {
+  if (requested != 0) {
+    return requested;
+  }
+  const unsigned hardware = std::thread::hardware_concurrency();
+  return hardware == 0 ? 1 : hardware;
+}
+
+ThreadPool::ThreadPool(unsigned threads) {
+  const unsigned count = defaultConcurrency(threads);
+  for (unsigned i = 0; i < count; ++i) {
+    queues_.push_back(std::make_unique<WorkQueue>());
+  }
+  for (unsigned i = 0; i < count; ++i) {
+    workers_.emplace_back([this, i] { workerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  const std::size_t index =
+      (t_pool == this) ? t_queue : next_queue_.fetch_add(1) % queues_.size();
+  pending_.fetch_add(1);
+  // Count the task before publishing it: a worker may pop it as soon as it is
+  // in the deque, and its decrement must not run ahead of this increment.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_.fetch_add(1);
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  work_available_.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  all_done_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+bool ThreadPool::popLocal(std::size_t index, Task& task) {
+  auto& queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::steal(std::size_t thief, Task& task) {
+  for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+    auto& queue = *queues_[(thief + offset) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      steals_.fetch_add(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+  t_pool = this;
+  t_queue = index;
+  for (;;) {
+    Task task;
+    if (popLocal(index, task) || steal(index, task)) {
+      queued_.fetch_sub(1);
+      task();
+      if (pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        all_done_.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_available_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+    if (stopping_ && queued_.load() == 0) {
+      return;
+    }
+  }
+}
+
+}  // namespace compiler::driver
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace compiler::driver {
+
+/**
+ * Fixed-size work-stealing thread pool. Each worker owns a deque: it pops its
+ * own work LIFO and steals FIFO from the other workers when it runs dry.
+ */
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /** Starts the given number of workers; zero means hardware concurrency. */
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /** Queues a task; tasks submitted from a worker land on that worker's deque. */
+  void submit(Task task);
+
+  /** Blocks until every submitted task has finished running. */
+  void wait();
+
+  /** Returns the number of worker threads. */
+  unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+  /** Returns how many tasks were taken from another worker's deque. */
+  std::size_t stealCount() const { return steals_.load(); }
+
+  /** Resolves a requested job count, mapping zero to hardware concurrency. */
+  static unsigned defaultConcurrency(unsigned requested);
+
+ private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popLocal(std::size_t index, Task& task);
+  bool steal(std::size_t thief, Task& task);
+  void workerLoop(std::size_t index);
+
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+  std::atomic<std::size_t> queued_{0};
+  std::atomic<std::size_t> pending_{0};
+  std::atomic<std::size_t> steals_{0};
+  std::atomic<std::size_t> next_queue_{0};
+  bool stopping_ = false;
+};
+
+}  // namespace compiler::driver
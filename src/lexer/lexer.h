@@ -1,13 +1,23 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "support/string_interner.h"
+
 namespace compiler::lexer {
 
-/** Represents a lexical token. */
+/**
+ * Represents a lexical token. The lexeme is a view into the source buffer
+ * passed to the lexer, so tokens are only valid while that buffer is alive.
+ */
 struct Token {
-  enum class Kind {
+  enum class Kind : std::uint8_t {
     KwInt,
     KwFloat,
     KwChar,
@@ -58,8 +68,11 @@ struct Token {
   };
 
   Kind kind = Kind::Invalid;
-  std::string lexeme;
   int line = 1;
+  /** Token text; for string literals, the body between the quotes. */
+  std::string_view lexeme;
+  /** Interned spelling of identifiers when the lexer has an interner. */
+  support::Symbol symbol;
   union {
     long long int_val;
     double float_val;
@@ -73,26 +86,94 @@ struct LexError {
   std::string message;
 };
 
+/** Per-scanner state threaded through the reentrant Flex scanner as its extra data. */
 struct LexContext {
   std::vector<Token>* tokens = nullptr;
   std::vector<LexError>* errors = nullptr;
+  support::StringInterner* interner = nullptr;
   std::string filename;
-  std::string string_buffer;
+  std::string_view source;
+  std::size_t offset = 0;
+  std::size_t string_start = 0;
   int string_start_line = 1;
   int comment_start_line = 1;
 };
 
-/** Flex-backed lexer entry point. */
+/** Selects the scanner that turns source text into tokens; both produce the same tokens. */
+enum class ScannerKind {
+  /** The Flex scanner generated from lexer.l. */
+  Flex,
+  /** The hand-written Scanner, with perfect-hash keywords and SIMD skipping. */
+  Fast,
+};
+
+class Scanner;
+
+/**
+ * Lexer entry point. Every tokenize call runs its own scanner, so distinct
+ * Lexer instances may be used concurrently.
+ */
 class Lexer {
  public:
-  /** Tokenizes the given input source. */
-  std::vector<Token> tokenize(const std::string& input, const std::string& filename = "<input>");
+  /** Creates a lexer; identifiers are interned into `interner` when given. */
+  explicit Lexer(support::StringInterner* interner = nullptr,
+                 ScannerKind scanner = ScannerKind::Flex)
+      : interner_(interner), scanner_(scanner) {}
+
+  /** Tokenizes the given input source; token lexemes point into `input`. */
+  std::vector<Token> tokenize(std::string_view input, const std::string& filename = "<input>");
 
   /** Returns diagnostics produced by the last tokenize call. */
   const std::vector<LexError>& errors() const;
 
  private:
+  support::StringInterner* interner_ = nullptr;
+  ScannerKind scanner_;
+  std::vector<LexError> errors_;
+};
+
+/**
+ * Pull-based token source: scans the input on demand and keeps at most
+ * kMaxLookahead tokens buffered, so memory does not grow with input size.
+ */
+class TokenStream {
+ public:
+  static constexpr std::size_t kMaxLookahead = 4;
+
+  /** Starts scanning `input`, which must outlive the stream. */
+  TokenStream(std::string_view input, const std::string& filename = "<input>",
+              support::StringInterner* interner = nullptr,
+              ScannerKind scanner = ScannerKind::Flex);
+  ~TokenStream();
+
+  TokenStream(const TokenStream&) = delete;
+  TokenStream& operator=(const TokenStream&) = delete;
+
+  /** Returns the token `ahead` positions past the current one (< kMaxLookahead). */
+  const Token& peek(std::size_t ahead = 0);
+
+  /**
+   * Consumes the current token. The reference stays valid until the next
+   * call to peek or next. Keeps returning EndOfFile once the input is done.
+   */
+  const Token& next();
+
+  /** Returns diagnostics produced so far. */
+  const std::vector<LexError>& errors() const { return errors_; }
+
+ private:
+  void scanOne(Token& slot);
+
+  LexContext context_;
+  /** The Flex scanner, or null when `fast_` is used instead. */
+  void* scanner_ = nullptr;
+  std::unique_ptr<Scanner> fast_;
+  bool finished_ = false;
+  std::vector<Token> scanned_;
   std::vector<LexError> errors_;
+  std::array<Token, kMaxLookahead + 1> window_{};
+  std::size_t head_ = 0;
+  std::size_t count_ = 0;
 };
 
 }  // namespace compiler::lexer
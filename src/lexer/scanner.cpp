@@ -0,0 +1,561 @@
+#include "lexer/scanner.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace compiler::lexer {
+
+namespace {
+
+using Kind = Token::Kind;
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool isIdentifierStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isIdentifierChar(char c) { return isIdentifierStart(c) || isDigit(c); }
+
+bool isWhitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// --- Keywords ----------------------------------------------------------------
+
+struct Keyword {
+  std::string_view spelling;
+  Kind kind;
+};
+
+/**
+ * (length + 3 * first + 4 * second) & 15 sends each keyword to its own slot,
+ * so a lookup is one hash and at most one compare.
+ */
+constexpr unsigned keywordSlot(const char* text, std::size_t length) {
+  return (static_cast<unsigned>(length) + 3 * static_cast<unsigned char>(text[0]) +
+          4 * static_cast<unsigned char>(text[1])) &
+         15;
+}
+
+constexpr Keyword kKeywordList[] = {
+    {"int", Kind::KwInt},   {"float", Kind::KwFloat}, {"char", Kind::KwChar},
+    {"void", Kind::KwVoid}, {"struct", Kind::KwStruct}, {"if", Kind::KwIf},
+    {"else", Kind::KwElse}, {"while", Kind::KwWhile}, {"for", Kind::KwFor},
+    {"return", Kind::KwReturn},
+};
+
+struct KeywordTable {
+  Keyword slots[16] = {};
+
+  constexpr KeywordTable() {
+    for (const Keyword& keyword : kKeywordList) {
+      slots[keywordSlot(keyword.spelling.data(), keyword.spelling.size())] = keyword;
+    }
+  }
+};
+
+constexpr KeywordTable kKeywords;
+
+static_assert([] {
+  for (const Keyword& keyword : kKeywordList) {
+    const Keyword& slot =
+        kKeywords.slots[keywordSlot(keyword.spelling.data(), keyword.spelling.size())];
+    if (slot.kind != keyword.kind) {
+      return false;
+    }
+  }
+  return true;
+}(), "keyword hash is not perfect");
+
+/** Returns the keyword spelled by [text, text + length), or Identifier. */
+Kind classifyWord(const char* text, std::size_t length) {
+  if (length < 2 || length > 6) {
+    return Kind::Identifier;
+  }
+  const Keyword& slot = kKeywords.slots[keywordSlot(text, length)];
+  if (slot.spelling.size() == length && std::memcmp(slot.spelling.data(), text, length) == 0) {
+    return slot.kind;
+  }
+  return Kind::Identifier;
+}
+
+// --- Byte scans --------------------------------------------------------------
+//
+// Each scan has a scalar form for the tail and for targets without SSE2.
+// Whitespace and identifier runs are short, so they stop at 16-byte SSE2
+// blocks; comments and string bodies can be long and use 32-byte AVX2 blocks
+// when the CPU has them.
+
+const char* skipWhitespaceScalar(const char* p, const char* end, int& line) {
+  for (; p != end && isWhitespace(*p); ++p) {
+    line += *p == '\n' ? 1 : 0;
+  }
+  return p;
+}
+
+const char* skipIdentifierScalar(const char* p, const char* end) {
+  while (p != end && isIdentifierChar(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+const char* findAnyScalar(const char* p, const char* end, char a, char b, char c) {
+  while (p != end && *p != a && *p != b && *p != c) {
+    ++p;
+  }
+  return p;
+}
+
+const char* findStarScalar(const char* p, const char* end, int& line) {
+  for (; p != end && *p != '*'; ++p) {
+    line += *p == '\n' ? 1 : 0;
+  }
+  return p;
+}
+
+#if defined(__SSE2__)
+
+/** Bits of `mask` below bit `n`, where n < 32. */
+unsigned below(unsigned mask, unsigned n) { return mask & ((1U << n) - 1); }
+
+__m128i inRange16(__m128i v, char low, char high) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(low - 1))),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(high + 1))));
+}
+
+const char* skipWhitespace(const char* p, const char* end, int& line) {
+  while (end - p >= 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i newline = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    const __m128i space =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), newline),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    const auto lines = static_cast<unsigned>(_mm_movemask_epi8(newline));
+    const unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(space)) & 0xFFFF;
+    if (stop != 0) {
+      const auto n = static_cast<unsigned>(__builtin_ctz(stop));
+      line += __builtin_popcount(below(lines, n));
+      return p + n;
+    }
+    line += __builtin_popcount(lines);
+    p += 16;
+  }
+  return skipWhitespaceScalar(p, end, line);
+}
+
+const char* skipIdentifier(const char* p, const char* end) {
+  while (end - p >= 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // Setting bit 5 folds upper case onto lower case. Bytes >= 0x80 compare
+    // as negative and so fall outside every range.
+    const __m128i letter = inRange16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    const __m128i word = _mm_or_si128(_mm_or_si128(letter, inRange16(v, '0', '9')),
+                                      _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    const unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(word)) & 0xFFFF;
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+    p += 16;
+  }
+  return skipIdentifierScalar(p, end);
+}
+
+const char* findAnySse2(const char* p, const char* end, char a, char b, char c) {
+  while (end - p >= 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(a)),
+                                                  _mm_cmpeq_epi8(v, _mm_set1_epi8(b))),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+    const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  return findAnyScalar(p, end, a, b, c);
+}
+
+const char* findStarSse2(const char* p, const char* end, int& line) {
+  while (end - p >= 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const auto stars = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('*'))));
+    const auto lines = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    if (stars != 0) {
+      const auto n = static_cast<unsigned>(__builtin_ctz(stars));
+      line += __builtin_popcount(below(lines, n));
+      return p + n;
+    }
+    line += __builtin_popcount(lines);
+    p += 16;
+  }
+  return findStarScalar(p, end, line);
+}
+
+__attribute__((target("avx2"))) const char* findAnyAvx2(const char* p, const char* end,
+                                                        char a, char b, char c) {
+  while (end - p >= 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hit =
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(a)),
+                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(b))),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+    const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+  return findAnySse2(p, end, a, b, c);
+}
+
+__attribute__((target("avx2"))) const char* findStarAvx2(const char* p, const char* end,
+                                                         int& line) {
+  while (end - p >= 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const auto stars = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*'))));
+    const auto lines = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    if (stars != 0) {
+      const auto n = static_cast<unsigned>(__builtin_ctz(stars));
+      line += __builtin_popcount(below(lines, n));
+      return p + n;
+    }
+    line += __builtin_popcount(lines);
+    p += 32;
+  }
+  return findStarSse2(p, end, line);
+}
+
+bool hasAVX2() {
+  static const bool available = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return available;
+}
+
+/** Returns the first of `a`, `b` or `c` in [p, end), or `end`. */
+const char* findAny(const char* p, const char* end, char a, char b, char c) {
+  return hasAVX2() ? findAnyAvx2(p, end, a, b, c) : findAnySse2(p, end, a, b, c);
+}
+
+/** Returns the first '*' in [p, end), or `end`, counting the newlines before it. */
+const char* findStar(const char* p, const char* end, int& line) {
+  return hasAVX2() ? findStarAvx2(p, end, line) : findStarSse2(p, end, line);
+}
+
+#else
+
+const char* skipWhitespace(const char* p, const char* end, int& line) {
+  return skipWhitespaceScalar(p, end, line);
+}
+
+const char* skipIdentifier(const char* p, const char* end) {
+  return skipIdentifierScalar(p, end);
+}
+
+const char* findAny(const char* p, const char* end, char a, char b, char c) {
+  return findAnyScalar(p, end, a, b, c);
+}
+
+const char* findStar(const char* p, const char* end, int& line) {
+  return findStarScalar(p, end, line);
+}
+
+#endif
+
+// --- Literal values ----------------------------------------------------------
+
+/** Matches strtoll, which the Flex scanner uses: out-of-range values saturate. */
+long long parseInt(const char* p, const char* end) {
+  unsigned long long value = 0;
+  for (; p != end; ++p) {
+    value = value * 10 + static_cast<unsigned>(*p - '0');
+    if (value > static_cast<unsigned long long>(LLONG_MAX)) {
+      return LLONG_MAX;
+    }
+  }
+  return static_cast<long long>(value);
+}
+
+double parseFloat(const char* p, const char* end) {
+  // strtod needs a terminator; literals are short, so copy onto the stack.
+  char buffer[64];
+  const auto length = static_cast<std::size_t>(end - p);
+  if (length < sizeof(buffer)) {
+    std::memcpy(buffer, p, length);
+    buffer[length] = '\0';
+    return std::strtod(buffer, nullptr);
+  }
+  return std::strtod(std::string(p, length).c_str(), nullptr);
+}
+
+char unescape(char c) {
+  switch (c) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case '0': return '\0';
+    default: return c;
+  }
+}
+
+bool isCharEscape(char c) {
+  switch (c) {
+    case 'n':
+    case 't':
+    case 'r':
+    case '\\':
+    case '\'':
+    case '"':
+    case '0':
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** Returns the end of an exponent `[eE][+-]?[0-9]+` at `p`, or `p` itself if none is there. */
+const char* exponentEnd(const char* p, const char* end) {
+  if (p == end || (*p != 'e' && *p != 'E')) {
+    return p;
+  }
+  const char* q = p + 1;
+  if (q != end && (*q == '+' || *q == '-')) {
+    ++q;
+  }
+  if (q == end || !isDigit(*q)) {
+    return p;
+  }
+  while (q != end && isDigit(*q)) {
+    ++q;
+  }
+  return q;
+}
+
+}  // namespace
+
+Scanner::Scanner(LexContext& context)
+    : context_(context),
+      cursor_(context.source.data()),
+      end_(context.source.data() + context.source.size()) {}
+
+void Scanner::push(Token::Kind kind, const char* start, const char* end) {
+  Token token;
+  token.kind = kind;
+  token.lexeme = std::string_view(start, static_cast<std::size_t>(end - start));
+  token.line = line_;
+  context_.tokens->push_back(token);
+}
+
+void Scanner::error(int line, std::string message) {
+  LexError err;
+  err.filename = context_.filename;
+  err.line = line;
+  err.message = std::move(message);
+  context_.errors->push_back(std::move(err));
+}
+
+void Scanner::number(const char* start) {
+  // Longest match, as Flex picks between {FLOAT} and {INT}: a fraction makes
+  // a float, and so does an exponent, but only one with digits.
+  const char* p = start;
+  while (p != end_ && isDigit(*p)) {
+    ++p;
+  }
+  bool is_float = false;
+  if (p != end_ && *p == '.') {
+    is_float = true;
+    ++p;
+    while (p != end_ && isDigit(*p)) {
+      ++p;
+    }
+  }
+  const char* exponent = exponentEnd(p, end_);
+  is_float = is_float || exponent != p;
+  cursor_ = exponent;
+
+  push(is_float ? Kind::FloatLiteral : Kind::IntLiteral, start, cursor_);
+  Token& token = context_.tokens->back();
+  if (is_float) {
+    token.value.float_val = parseFloat(start, cursor_);
+  } else {
+    token.value.int_val = parseInt(start, cursor_);
+  }
+}
+
+bool Scanner::string(const char* start) {
+  const int start_line = line_;
+  const char* p = start + 1;
+  for (;;) {
+    p = findAny(p, end_, '"', '\\', '\n');
+    if (p == end_) {
+      error(start_line, "unterminated string literal");
+      cursor_ = end_;
+      finished_ = true;
+      return false;
+    }
+    if (*p == '"') {
+      cursor_ = p + 1;
+      push(Kind::StringLiteral, start + 1, p);
+      context_.tokens->back().line = start_line;
+      return true;
+    }
+    if (*p == '\n') {
+      // The literal is dropped and scanning resumes on the next line.
+      error(start_line, "unterminated string literal");
+      ++line_;
+      cursor_ = p + 1;
+      return false;
+    }
+    // An escape takes the next character, which cannot be a newline. A
+    // backslash before a newline or the end of the input escapes nothing.
+    p += (p + 1 != end_ && p[1] != '\n') ? 2 : 1;
+  }
+}
+
+bool Scanner::next() {
+  while (!finished_) {
+    cursor_ = skipWhitespace(cursor_, end_, line_);
+    if (cursor_ == end_) {
+      finished_ = true;
+      break;
+    }
+
+    const char* start = cursor_;
+    const char c = *start;
+    const char following = start + 1 != end_ ? start[1] : '\0';
+    const auto single = [&](Kind kind) {
+      cursor_ = start + 1;
+      push(kind, start, cursor_);
+      return true;
+    };
+    const auto pair = [&](char second, Kind matched, Kind otherwise) {
+      if (start + 1 != end_ && following == second) {
+        cursor_ = start + 2;
+        push(matched, start, cursor_);
+        return true;
+      }
+      return single(otherwise);
+    };
+
+    if (isIdentifierStart(c)) {
+      cursor_ = skipIdentifier(start + 1, end_);
+      const auto length = static_cast<std::size_t>(cursor_ - start);
+      const Kind kind = classifyWord(start, length);
+      push(kind, start, cursor_);
+      if (kind == Kind::Identifier && context_.interner != nullptr) {
+        Token& token = context_.tokens->back();
+        token.symbol = context_.interner->intern(token.lexeme);
+      }
+      return true;
+    }
+    if (isDigit(c) || (c == '.' && start + 1 != end_ && isDigit(following))) {
+      number(start);
+      return true;
+    }
+
+    switch (c) {
+      case '/':
+        if (start + 1 != end_ && following == '/') {
+          // The newline is left for the whitespace scan to count.
+          cursor_ = findAny(start + 2, end_, '\n', '\n', '\n');
+          continue;
+        }
+        if (start + 1 != end_ && following == '*') {
+          const int comment_line = line_;
+          const char* p = start + 2;
+          for (;;) {
+            p = findStar(p, end_, line_);
+            if (p == end_) {
+              error(comment_line, "unterminated block comment");
+              cursor_ = end_;
+              finished_ = true;
+              return false;
+            }
+            if (p + 1 != end_ && p[1] == '/') {
+              break;
+            }
+            ++p;
+          }
+          cursor_ = p + 2;
+          continue;
+        }
+        return pair('=', Kind::SlashAssign, Kind::Slash);
+      case '"':
+        if (string(start)) {
+          return true;
+        }
+        continue;
+      case '\'':
+        // '{any but backslash or newline}' or '\{escape}'; anything else is
+        // a stray quote, which the fallback below reports.
+        if (end_ - start >= 3 && following != '\\' && following != '\n' && start[2] == '\'') {
+          cursor_ = start + 3;
+          push(Kind::CharLiteral, start, cursor_);
+          context_.tokens->back().value.int_val = static_cast<long long>(following);
+          return true;
+        }
+        if (end_ - start >= 4 && following == '\\' && isCharEscape(start[2]) &&
+            start[3] == '\'') {
+          cursor_ = start + 4;
+          push(Kind::CharLiteral, start, cursor_);
+          context_.tokens->back().value.int_val = static_cast<long long>(unescape(start[2]));
+          return true;
+        }
+        break;
+      case '=': return pair('=', Kind::EqEq, Kind::Assign);
+      case '!': return pair('=', Kind::NotEq, Kind::Not);
+      case '<': return pair('=', Kind::Le, Kind::Lt);
+      case '>': return pair('=', Kind::Ge, Kind::Gt);
+      case '&': return pair('&', Kind::AndAnd, Kind::Amp);
+      case '+': return pair('=', Kind::PlusAssign, Kind::Plus);
+      case '*': return pair('=', Kind::StarAssign, Kind::Star);
+      case '-':
+        if (start + 1 != end_ && following == '>') {
+          cursor_ = start + 2;
+          push(Kind::Arrow, start, cursor_);
+          return true;
+        }
+        return pair('=', Kind::MinusAssign, Kind::Minus);
+      case '|':
+        if (start + 1 != end_ && following == '|') {
+          cursor_ = start + 2;
+          push(Kind::OrOr, start, cursor_);
+          return true;
+        }
+        break;
+      case '%': return single(Kind::Percent);
+      case '(': return single(Kind::LParen);
+      case ')': return single(Kind::RParen);
+      case '{': return single(Kind::LBrace);
+      case '}': return single(Kind::RBrace);
+      case '[': return single(Kind::LBracket);
+      case ']': return single(Kind::RBracket);
+      case ';': return single(Kind::Semicolon);
+      case ',': return single(Kind::Comma);
+      case '.': return single(Kind::Dot);
+      default:
+        break;
+    }
+
+    single(Kind::Invalid);
+    error(line_, "invalid token: " + std::string(start, 1));
+    return true;
+  }
+  return false;
+}
+
+}  // namespace compiler::lexer
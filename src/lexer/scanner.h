@@ -0,0 +1,48 @@
+#pragma once
+
+#include "lexer/lexer.h"
+
+namespace compiler::lexer {
+
+/**
+ * Hand-written scanner behind ScannerKind::Fast. It accepts the language of
+ * lexer.l and produces the same tokens, lines and diagnostics, but looks
+ * keywords up in a perfect hash instead of running them through the DFA, and
+ * skips whitespace, identifier characters, comments and string bodies with
+ * SSE2 compares, widened to AVX2 for the long runs when the CPU supports it.
+ *
+ * Like the Flex scanner it reads the source from a LexContext and appends
+ * to the context's token and error vectors, one token per call to next().
+ */
+class Scanner {
+ public:
+  explicit Scanner(LexContext& context);
+
+  /**
+   * Scans up to and including the next token. Returns false, without adding
+   * a token, once the input is exhausted or an unterminated comment or
+   * string runs into its end.
+   */
+  bool next();
+
+  /** Line of the scan position: one plus the newlines consumed so far. */
+  int line() const { return line_; }
+
+ private:
+  void push(Token::Kind kind, const char* start, const char* end);
+  void error(int line, std::string message);
+
+  /** Scans an int or float literal starting at `start`. */
+  void number(const char* start);
+
+  /** Scans a string literal; returns whether it produced a token. */
+  bool string(const char* start);
+
+  LexContext& context_;
+  const char* cursor_;
+  const char* end_;
+  int line_ = 1;
+  bool finished_ = false;
+};
+
+}  // namespace compiler::lexer
@@ -1,16 +1,81 @@
+#include <csignal>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "driver/compile_server.h"
+#include "driver/driver.h"
+
+namespace {
+
+compiler::driver::CompileServer* g_server = nullptr;
+
+void stopServer(int) { g_server->stop(); }
+
+/** Runs the compile server until SIGINT or SIGTERM. */
+int runDaemon(const std::string& socket_path) {
+  compiler::driver::CompileServer server(socket_path);
+  std::string error;
+  if (!server.open(error)) {
+    std::cerr << "error: " << error << "\n";
+    return 1;
+  }
+  g_server = &server;
+  std::signal(SIGINT, stopServer);
+  std::signal(SIGTERM, stopServer);
+  server.serve();
+  return 0;
+}
+
+/** Forwards the arguments to the compile server and prints its reply. */
+int runClient(const std::string& socket_path, const std::vector<std::string>& args) {
+  int status = 1;
+  std::string diagnostics;
+  std::string error;
+  if (!compiler::driver::sendCompileRequest(socket_path, args, status, diagnostics, error)) {
+    std::cerr << "error: " << error << "\n";
+    return 1;
+  }
+  std::cerr << diagnostics;
+  return status;
+}
+
+}  // namespace
 
 int main(int argc, char** argv) {
-  if (argc > 1 && std::string(argv[1]) == "--help") {
-    std::cout << "Usage: compiler [options] <input-file>\n"
-              << "Options:\n"
-              << "  --help        Show this help message\n"
-              << "  -o <file>     Output file path\n"
-              << "  -O            Enable optimizations\n";
-    return 0;
+  std::vector<std::string> args(argv + 1, argv + argc);
+  for (const auto& arg : args) {
+    if (arg == "--help") {
+      compiler::driver::printUsage(std::cout);
+      return 0;
+    }
+  }
+
+  if (args.empty()) {
+    std::cerr << "No input provided. Use --help for usage.\n";
+    return 1;
+  }
+
+  if (args.front().rfind("-daemon=", 0) == 0) {
+    if (args.size() > 1) {
+      std::cerr << "error: '-daemon' takes no other arguments\n";
+      return 1;
+    }
+    return runDaemon(args.front().substr(8));
+  }
+  if (args.front().rfind("-connect=", 0) == 0) {
+    const std::string socket_path = args.front().substr(9);
+    return runClient(socket_path, std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+
+  compiler::driver::DriverOptions options;
+  std::string error;
+  if (!compiler::driver::parseArguments(args, options, error)) {
+    std::cerr << "error: " << error << "\n";
+    return 1;
   }
 
-  std::cerr << "No input provided. Use --help for usage.\n";
-  return 1;
+  compiler::driver::Driver driver(std::move(options));
+  return driver.run(std::cerr);
 }
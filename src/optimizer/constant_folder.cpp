@@ -0,0 +1,537 @@
+#include "optimizer/constant_folder.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "support/instrumentation.h"
+
+namespace compiler::optimizer {
+
+namespace {
+
+/** A literal value as the code generator would see it. */
+struct Constant {
+  bool is_float = false;
+  std::int32_t i = 0;
+  float f = 0.0F;
+
+  bool truthy() const { return is_float ? f != 0.0F : i != 0; }
+  float asFloat() const { return is_float ? f : static_cast<float>(i); }
+};
+
+std::optional<Constant> constantOf(const ast::ASTNode* node) {
+  Constant value;
+  if (const auto* cast = ast::dyn_cast<ast::ImplicitCastExpr>(node)) {
+    // Arithmetic conversions of a constant are constant; the cast node itself
+    // is left in place unless the expression around it folds.
+    auto operand = constantOf(cast->operand);
+    if (!operand) {
+      return std::nullopt;
+    }
+    switch (cast->cast_kind) {
+      case ast::CastKind::IntegralCast:
+        value.i = cast->type->kind() == ast::Type::Kind::Char
+                      ? static_cast<std::int8_t>(static_cast<std::uint8_t>(operand->i))
+                      : operand->i;
+        return value;
+      case ast::CastKind::IntegralToFloating:
+        value.is_float = true;
+        value.f = static_cast<float>(operand->i);
+        return value;
+      case ast::CastKind::FloatingToIntegral: {
+        // Out-of-range conversions are poison in IR; leave them to run time.
+        const bool is_char = cast->type->kind() == ast::Type::Kind::Char;
+        const double limit = is_char ? 128.0 : 2147483648.0;
+        if (!(operand->f > -limit - 1.0 && operand->f < limit)) {
+          return std::nullopt;
+        }
+        value.i = static_cast<std::int32_t>(operand->f);
+        return value;
+      }
+      default:
+        return std::nullopt;
+    }
+  }
+  if (const auto* lit = ast::dyn_cast<ast::IntLiteral>(node)) {
+    // IntLiteral lowers to an i32, so wider values wrap exactly as they do in IR.
+    value.i = static_cast<std::int32_t>(static_cast<std::uint32_t>(lit->value));
+  } else if (const auto* ch = ast::dyn_cast<ast::CharLiteral>(node)) {
+    value.i = ch->value;
+  } else if (const auto* fp = ast::dyn_cast<ast::FloatLiteral>(node)) {
+    value.is_float = true;
+    value.f = static_cast<float>(fp->value);
+  } else {
+    return std::nullopt;
+  }
+  return value;
+}
+
+bool isIntegerLiteral(const ast::ASTNode* node, std::int32_t expected) {
+  auto value = constantOf(node);
+  return value && !value->is_float && value->i == expected;
+}
+
+Constant intConstant(std::int64_t value) {
+  Constant result;
+  result.i = static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+  return result;
+}
+
+Constant floatConstant(float value) {
+  Constant result;
+  result.is_float = true;
+  result.f = value;
+  return result;
+}
+
+bool isAssignment(ast::BinaryOp op) {
+  switch (op) {
+    case ast::BinaryOp::Assign:
+    case ast::BinaryOp::AddAssign:
+    case ast::BinaryOp::SubAssign:
+    case ast::BinaryOp::MulAssign:
+    case ast::BinaryOp::DivAssign:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isComparison(ast::BinaryOp op) {
+  switch (op) {
+    case ast::BinaryOp::Eq:
+    case ast::BinaryOp::Ne:
+    case ast::BinaryOp::Lt:
+    case ast::BinaryOp::Gt:
+    case ast::BinaryOp::Le:
+    case ast::BinaryOp::Ge:
+      return true;
+    default:
+      return false;
+  }
+}
+
+template <typename T>
+bool compare(ast::BinaryOp op, T lhs, T rhs) {
+  switch (op) {
+    case ast::BinaryOp::Eq: return lhs == rhs;
+    case ast::BinaryOp::Ne: return lhs != rhs;
+    case ast::BinaryOp::Lt: return lhs < rhs;
+    case ast::BinaryOp::Gt: return lhs > rhs;
+    case ast::BinaryOp::Le: return lhs <= rhs;
+    default: return lhs >= rhs;
+  }
+}
+
+/** Evaluates an arithmetic or comparison operator; nullopt if the result is not a constant. */
+std::optional<Constant> evaluate(ast::BinaryOp op, Constant lhs, Constant rhs) {
+  if (isComparison(op)) {
+    if (lhs.is_float || rhs.is_float) {
+      return intConstant(compare(op, lhs.asFloat(), rhs.asFloat()) ? 1 : 0);
+    }
+    return intConstant(compare(op, lhs.i, rhs.i) ? 1 : 0);
+  }
+
+  if (lhs.is_float || rhs.is_float) {
+    const float a = lhs.asFloat();
+    const float b = rhs.asFloat();
+    switch (op) {
+      case ast::BinaryOp::Add: return floatConstant(a + b);
+      case ast::BinaryOp::Sub: return floatConstant(a - b);
+      case ast::BinaryOp::Mul: return floatConstant(a * b);
+      case ast::BinaryOp::Div: return floatConstant(a / b);
+      default: return std::nullopt;
+    }
+  }
+
+  const std::int64_t a = lhs.i;
+  const std::int64_t b = rhs.i;
+  switch (op) {
+    case ast::BinaryOp::Add: return intConstant(a + b);
+    case ast::BinaryOp::Sub: return intConstant(a - b);
+    case ast::BinaryOp::Mul: return intConstant(a * b);
+    case ast::BinaryOp::Div:
+    case ast::BinaryOp::Mod:
+      // Division by zero and INT_MIN / -1 trap at run time; leave them alone.
+      if (b == 0 || (a == std::numeric_limits<std::int32_t>::min() && b == -1)) {
+        return std::nullopt;
+      }
+      return intConstant(op == ast::BinaryOp::Div ? a / b : a % b);
+    default:
+      return std::nullopt;
+  }
+}
+
+/** True if evaluating the expression cannot have side effects. */
+bool isPure(const ast::ASTNode* node) {
+  if (node == nullptr) {
+    return true;
+  }
+  if (const auto* be = ast::dyn_cast<ast::BinaryExpr>(node)) {
+    return !isAssignment(be->op) && isPure(be->lhs) && isPure(be->rhs);
+  }
+  if (const auto* ue = ast::dyn_cast<ast::UnaryExpr>(node)) {
+    return isPure(ue->operand);
+  }
+  if (const auto* me = ast::dyn_cast<ast::MemberExpr>(node)) {
+    return isPure(me->object);
+  }
+  if (const auto* as = ast::dyn_cast<ast::ArraySubscript>(node)) {
+    return isPure(as->array) && isPure(as->index);
+  }
+  if (const auto* cast = ast::dyn_cast<ast::ImplicitCastExpr>(node)) {
+    return isPure(cast->operand);
+  }
+  return !ast::isa<ast::CallExpr>(node);
+}
+
+/** Counts the nodes in a subtree. */
+std::size_t countNodes(const ast::ASTNode* node) {
+  const auto countAll = [](const std::vector<ast::ASTNode*>& nodes) {
+    std::size_t total = 1;
+    for (const ast::ASTNode* child : nodes) {
+      total += countNodes(child);
+    }
+    return total;
+  };
+  if (node == nullptr) {
+    return 0;
+  }
+  switch (node->kind()) {
+    case ast::NodeKind::TranslationUnit:
+      return countAll(ast::cast<ast::TranslationUnit>(*node).decls);
+    case ast::NodeKind::FunctionDecl:
+      return 1 + countNodes(ast::cast<ast::FunctionDecl>(*node).body);
+    case ast::NodeKind::VarDecl:
+      return 1 + countNodes(ast::cast<ast::VarDecl>(*node).init);
+    case ast::NodeKind::CompoundStmt:
+      return countAll(ast::cast<ast::CompoundStmt>(*node).stmts);
+    case ast::NodeKind::IfStmt: {
+      const auto& stmt = ast::cast<ast::IfStmt>(*node);
+      return 1 + countNodes(stmt.cond) + countNodes(stmt.then_branch) +
+             countNodes(stmt.else_branch);
+    }
+    case ast::NodeKind::WhileStmt: {
+      const auto& stmt = ast::cast<ast::WhileStmt>(*node);
+      return 1 + countNodes(stmt.cond) + countNodes(stmt.body);
+    }
+    case ast::NodeKind::ForStmt: {
+      const auto& stmt = ast::cast<ast::ForStmt>(*node);
+      return 1 + countNodes(stmt.init) + countNodes(stmt.cond) + countNodes(stmt.incr) +
+             countNodes(stmt.body);
+    }
+    case ast::NodeKind::ReturnStmt:
+      return 1 + countNodes(ast::cast<ast::ReturnStmt>(*node).value);
+    case ast::NodeKind::ExprStmt:
+      return 1 + countNodes(ast::cast<ast::ExprStmt>(*node).expr);
+    case ast::NodeKind::BinaryExpr: {
+      const auto& expr = ast::cast<ast::BinaryExpr>(*node);
+      return 1 + countNodes(expr.lhs) + countNodes(expr.rhs);
+    }
+    case ast::NodeKind::UnaryExpr:
+      return 1 + countNodes(ast::cast<ast::UnaryExpr>(*node).operand);
+    case ast::NodeKind::CallExpr:
+      return countAll(ast::cast<ast::CallExpr>(*node).args);
+    case ast::NodeKind::MemberExpr:
+      return 1 + countNodes(ast::cast<ast::MemberExpr>(*node).object);
+    case ast::NodeKind::ArraySubscript: {
+      const auto& expr = ast::cast<ast::ArraySubscript>(*node);
+      return 1 + countNodes(expr.array) + countNodes(expr.index);
+    }
+    case ast::NodeKind::ImplicitCastExpr:
+      return 1 + countNodes(ast::cast<ast::ImplicitCastExpr>(*node).operand);
+    default:
+      return 1;
+  }
+}
+
+}  // namespace
+
+FoldStats ConstantFolder::run(ast::TranslationUnit& unit) {
+  support::TimeScope scope("fold");
+  unit_ = &unit;
+  stats_ = FoldStats{};
+  dropped_ = 0;
+  created_ = 0;
+  unit.accept(*this);
+  stats_.nodes_removed = dropped_ - created_;
+  unit_ = nullptr;
+  return stats_;
+}
+
+void ConstantFolder::rewrite(ast::ASTNode*& slot) {
+  if (slot == nullptr) {
+    return;
+  }
+  replaced_ = false;
+  slot->accept(*this);
+  if (replaced_) {
+    slot = replacement_;
+    replaced_ = false;
+  }
+}
+
+void ConstantFolder::rewriteBody(ast::ASTNode*& slot, int line) {
+  rewrite(slot);
+  if (slot == nullptr) {
+    slot = make<ast::CompoundStmt>(line);
+  }
+}
+
+void ConstantFolder::replace(ast::ASTNode* with) {
+  replacement_ = with;
+  replaced_ = true;
+}
+
+ast::ASTNode* ConstantFolder::scoped(ast::ASTNode* stmt, int line) {
+  if (!ast::isa<ast::VarDecl>(stmt)) {
+    return stmt;
+  }
+  auto* block = make<ast::CompoundStmt>(line);
+  block->stmts.push_back(stmt);
+  return block;
+}
+
+void ConstantFolder::drop(const ast::ASTNode* node) { dropped_ += countNodes(node); }
+
+ast::ASTNode* ConstantFolder::makeInt(int line, long long value) {
+  auto* lit = make<ast::IntLiteral>(line);
+  lit->value = value;
+  lit->type = unit_->context->types().intType();
+  return lit;
+}
+
+ast::ASTNode* ConstantFolder::makeFloat(int line, double value) {
+  auto* lit = make<ast::FloatLiteral>(line);
+  lit->value = value;
+  lit->type = unit_->context->types().floatType();
+  return lit;
+}
+
+bool ConstantFolder::isIntegral(const ast::ASTNode* node) const {
+  const auto* expr = ast::dyn_cast<ast::Expr>(node);
+  return expr != nullptr && expr->type != nullptr && expr->type->isInteger();
+}
+
+// --- Declarations ----------------------------------------------------------
+
+void ConstantFolder::visit(ast::TranslationUnit& unit) {
+  for (ast::ASTNode* decl : unit.decls) {
+    decl->accept(*this);
+  }
+}
+
+void ConstantFolder::visit(ast::FunctionDecl& fn) {
+  support::TimeScope scope("fold", fn.name.str(), /*per_function=*/true);
+  fn.body->accept(*this);
+}
+
+void ConstantFolder::visit(ast::VarDecl& decl) { rewrite(decl.init); }
+
+void ConstantFolder::visit(ast::StructDecl&) {}
+
+// --- Statements ------------------------------------------------------------
+
+void ConstantFolder::visit(ast::CompoundStmt& block) {
+  std::size_t kept = 0;
+  for (ast::ASTNode* stmt : block.stmts) {
+    rewrite(stmt);
+    if (stmt != nullptr) {
+      block.stmts[kept++] = stmt;
+    }
+  }
+  block.stmts.resize(kept);
+}
+
+void ConstantFolder::visit(ast::IfStmt& stmt) {
+  rewrite(stmt.cond);
+  auto cond = constantOf(stmt.cond);
+  if (!cond) {
+    rewriteBody(stmt.then_branch, stmt.line);
+    rewrite(stmt.else_branch);
+    return;
+  }
+
+  ast::ASTNode* taken = cond->truthy() ? stmt.then_branch : stmt.else_branch;
+  ast::ASTNode* skipped = cond->truthy() ? stmt.else_branch : stmt.then_branch;
+  dropped_ += 1;
+  drop(stmt.cond);
+  drop(skipped);
+  ++stats_.pruned;
+  rewrite(taken);
+  replace(scoped(taken, stmt.line));
+}
+
+void ConstantFolder::visit(ast::WhileStmt& stmt) {
+  rewrite(stmt.cond);
+  auto cond = constantOf(stmt.cond);
+  if (cond && !cond->truthy()) {
+    drop(&stmt);
+    ++stats_.pruned;
+    replace(nullptr);
+    return;
+  }
+  rewriteBody(stmt.body, stmt.line);
+}
+
+void ConstantFolder::visit(ast::ForStmt& stmt) {
+  rewrite(stmt.init);
+  rewrite(stmt.cond);
+  auto cond = constantOf(stmt.cond);
+  if (cond && !cond->truthy()) {
+    // The body and increment never run, but the initializer still does.
+    ast::ASTNode* init = stmt.init;
+    dropped_ += 1;
+    drop(stmt.cond);
+    drop(stmt.incr);
+    drop(stmt.body);
+    ++stats_.pruned;
+    if (init != nullptr && !ast::isa<ast::VarDecl>(init)) {
+      auto* expr = make<ast::ExprStmt>(stmt.line);
+      expr->expr = init;
+      init = expr;
+    }
+    replace(init == nullptr ? nullptr : scoped(init, stmt.line));
+    return;
+  }
+  rewrite(stmt.incr);
+  rewriteBody(stmt.body, stmt.line);
+}
+
+void ConstantFolder::visit(ast::ReturnStmt& stmt) { rewrite(stmt.value); }
+
+void ConstantFolder::visit(ast::ExprStmt& stmt) { rewrite(stmt.expr); }
+
+// --- Expressions -----------------------------------------------------------
+
+void ConstantFolder::visit(ast::BinaryExpr& expr) {
+  rewrite(expr.lhs);
+  rewrite(expr.rhs);
+  if (isAssignment(expr.op)) {
+    return;
+  }
+
+  auto lhs = constantOf(expr.lhs);
+  auto rhs = constantOf(expr.rhs);
+
+  if (expr.op == ast::BinaryOp::LogicalAnd || expr.op == ast::BinaryOp::LogicalOr) {
+    if (!lhs) {
+      return;
+    }
+    // A deciding left operand short-circuits, so the right side is never evaluated.
+    const bool decided = (expr.op == ast::BinaryOp::LogicalAnd) != lhs->truthy();
+    if (!decided && !rhs) {
+      return;
+    }
+    const bool truthy = decided ? lhs->truthy() : rhs->truthy();
+    drop(&expr);
+    ++stats_.folded;
+    replace(makeInt(expr.line, truthy ? 1 : 0));
+    return;
+  }
+
+  if (lhs && rhs) {
+    auto value = evaluate(expr.op, *lhs, *rhs);
+    if (!value) {
+      return;
+    }
+    ast::ASTNode* lit =
+        value->is_float ? makeFloat(expr.line, value->f) : makeInt(expr.line, value->i);
+    drop(&expr);
+    ++stats_.folded;
+    replace(lit);
+    return;
+  }
+
+  // Identities only apply to integer operands: for floats `x + 0` is not `x`
+  // when x is -0.0, and `x * 0` is not 0 when x is NaN.
+  ast::ASTNode* keep = nullptr;
+  ast::ASTNode* discard = nullptr;
+  switch (expr.op) {
+    case ast::BinaryOp::Add:
+      if (isIntegerLiteral(expr.rhs, 0)) {
+        keep = expr.lhs;
+        discard = expr.rhs;
+      } else if (isIntegerLiteral(expr.lhs, 0)) {
+        keep = expr.rhs;
+        discard = expr.lhs;
+      }
+      break;
+    case ast::BinaryOp::Sub:
+    case ast::BinaryOp::Div:
+      if (isIntegerLiteral(expr.rhs, expr.op == ast::BinaryOp::Sub ? 0 : 1)) {
+        keep = expr.lhs;
+        discard = expr.rhs;
+      }
+      break;
+    case ast::BinaryOp::Mul:
+      if (isIntegerLiteral(expr.rhs, 1)) {
+        keep = expr.lhs;
+        discard = expr.rhs;
+      } else if (isIntegerLiteral(expr.lhs, 1)) {
+        keep = expr.rhs;
+        discard = expr.lhs;
+      } else if (isIntegerLiteral(expr.rhs, 0) && isPure(expr.lhs)) {
+        keep = expr.rhs;
+        discard = expr.lhs;
+      } else if (isIntegerLiteral(expr.lhs, 0) && isPure(expr.rhs)) {
+        keep = expr.lhs;
+        discard = expr.rhs;
+      }
+      break;
+    default:
+      break;
+  }
+  if (keep == nullptr || !isIntegral(constantOf(keep) ? discard : keep)) {
+    return;
+  }
+  dropped_ += 1;
+  drop(discard);
+  ++stats_.simplified;
+  replace(keep);
+}
+
+void ConstantFolder::visit(ast::UnaryExpr& expr) {
+  rewrite(expr.operand);
+  auto operand = constantOf(expr.operand);
+  if (!operand || (expr.op != ast::UnaryOp::Neg && expr.op != ast::UnaryOp::Not)) {
+    return;
+  }
+
+  ast::ASTNode* lit = nullptr;
+  if (expr.op == ast::UnaryOp::Not) {
+    lit = makeInt(expr.line, operand->truthy() ? 0 : 1);
+  } else if (operand->is_float) {
+    lit = makeFloat(expr.line, -operand->f);
+  } else {
+    lit = makeInt(expr.line, intConstant(-static_cast<std::int64_t>(operand->i)).i);
+  }
+  drop(&expr);
+  ++stats_.folded;
+  replace(lit);
+}
+
+void ConstantFolder::visit(ast::CallExpr& expr) {
+  for (ast::ASTNode*& arg : expr.args) {
+    rewrite(arg);
+  }
+}
+
+void ConstantFolder::visit(ast::MemberExpr& expr) { rewrite(expr.object); }
+
+void ConstantFolder::visit(ast::ArraySubscript& expr) {
+  rewrite(expr.array);
+  rewrite(expr.index);
+}
+
+void ConstantFolder::visit(ast::IntLiteral&) {}
+void ConstantFolder::visit(ast::FloatLiteral&) {}
+void ConstantFolder::visit(ast::CharLiteral&) {}
+void ConstantFolder::visit(ast::StringLiteral&) {}
+void ConstantFolder::visit(ast::VarRef&) {}
+
+void ConstantFolder::visit(ast::ImplicitCastExpr& expr) { rewrite(expr.operand); }
+
+}  // namespace compiler::optimizer
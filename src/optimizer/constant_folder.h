@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ast/ast.h"
+
+namespace compiler::optimizer {
+
+/** What one run of the constant folder changed. */
+struct FoldStats {
+  /** Operator nodes replaced by a literal. */
+  std::size_t folded = 0;
+  /** Identities such as `x * 1` or `x + 0` rewritten to their operand. */
+  std::size_t simplified = 0;
+  /** `if`/`while`/`for` statements resolved by a constant condition. */
+  std::size_t pruned = 0;
+  /** Net number of nodes no longer reachable from the translation unit. */
+  std::size_t nodes_removed = 0;
+};
+
+/**
+ * AST rewriting pass run between semantic analysis and IR emission. Folds
+ * literal arithmetic, including the implicit conversions sema inserted, with
+ * the code generator's semantics (32-bit wrapping ints, single-precision
+ * floats), simplifies integer identities and removes statements guarded by
+ * constant conditions. Replacement literals come from the unit's arena and are
+ * annotated like the nodes they replace; dropped nodes stay there until the
+ * unit is destroyed.
+ */
+class ConstantFolder : public ast::ASTVisitor {
+ public:
+  /** Rewrites the unit in place and returns what changed. */
+  FoldStats run(ast::TranslationUnit& unit);
+
+  void visit(ast::TranslationUnit&) override;
+  void visit(ast::FunctionDecl&) override;
+  void visit(ast::VarDecl&) override;
+  void visit(ast::StructDecl&) override;
+  void visit(ast::CompoundStmt&) override;
+  void visit(ast::IfStmt&) override;
+  void visit(ast::WhileStmt&) override;
+  void visit(ast::ForStmt&) override;
+  void visit(ast::ReturnStmt&) override;
+  void visit(ast::ExprStmt&) override;
+  void visit(ast::BinaryExpr&) override;
+  void visit(ast::UnaryExpr&) override;
+  void visit(ast::CallExpr&) override;
+  void visit(ast::MemberExpr&) override;
+  void visit(ast::ArraySubscript&) override;
+  void visit(ast::IntLiteral&) override;
+  void visit(ast::FloatLiteral&) override;
+  void visit(ast::CharLiteral&) override;
+  void visit(ast::StringLiteral&) override;
+  void visit(ast::VarRef&) override;
+  void visit(ast::ImplicitCastExpr&) override;
+
+ private:
+  /** Visits `*slot` and stores its replacement back (possibly null for statements). */
+  void rewrite(ast::ASTNode*& slot);
+  /** Like rewrite, but a removed statement becomes an empty block. */
+  void rewriteBody(ast::ASTNode*& slot, int line);
+  void replace(ast::ASTNode* with);
+  /** Wraps a lone declaration in a block so hoisting it does not widen its scope. */
+  ast::ASTNode* scoped(ast::ASTNode* stmt, int line);
+  void drop(const ast::ASTNode* node);
+
+  bool isIntegral(const ast::ASTNode* node) const;
+
+  template <typename T>
+  T* make(int line) {
+    T* node = unit_->context->create<T>();
+    node->line = line;
+    ++created_;
+    return node;
+  }
+  ast::ASTNode* makeInt(int line, long long value);
+  ast::ASTNode* makeFloat(int line, double value);
+
+  ast::TranslationUnit* unit_ = nullptr;
+  ast::ASTNode* replacement_ = nullptr;
+  bool replaced_ = false;
+  std::size_t dropped_ = 0;
+  std::size_t created_ = 0;
+  FoldStats stats_;
+};
+
+}  // namespace compiler::optimizer
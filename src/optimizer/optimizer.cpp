@@ -1 +1,191 @@
 #include "optimizer/optimizer.h"
+
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+#include "driver/thread_pool.h"
+#include "support/instrumentation.h"
+
+namespace compiler::optimizer {
+
+namespace {
+
+llvm::OptimizationLevel toLLVM(OptLevel level) {
+  switch (level) {
+    case OptLevel::O0: return llvm::OptimizationLevel::O0;
+    case OptLevel::O1: return llvm::OptimizationLevel::O1;
+    case OptLevel::O2: return llvm::OptimizationLevel::O2;
+    case OptLevel::O3: return llvm::OptimizationLevel::O3;
+    case OptLevel::Os: return llvm::OptimizationLevel::Os;
+  }
+  return llvm::OptimizationLevel::O0;
+}
+
+/** Target machines are not safe to share between threads; each worker gets a copy. */
+std::unique_ptr<llvm::TargetMachine> cloneTarget(const llvm::TargetMachine& target) {
+  return std::unique_ptr<llvm::TargetMachine>(target.getTarget().createTargetMachine(
+      target.getTargetTriple().str(), target.getTargetCPU(), target.getTargetFeatureString(),
+      target.Options, target.getRelocationModel(), target.getCodeModel(),
+      target.getOptLevel()));
+}
+
+void writeBitcode(const llvm::Module& module, llvm::SmallVectorImpl<char>& buffer) {
+  buffer.clear();
+  llvm::raw_svector_ostream out(buffer);
+  llvm::WriteBitcodeToFile(module, out);
+}
+
+llvm::Expected<std::unique_ptr<llvm::Module>> readBitcode(const llvm::SmallVectorImpl<char>& buffer,
+                                                          llvm::LLVMContext& context) {
+  return llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(llvm::StringRef(buffer.data(), buffer.size()), "partition"), context);
+}
+
+}  // namespace
+
+bool parseOptLevel(const std::string& text, OptLevel& level) {
+  if (text == "0") {
+    level = OptLevel::O0;
+  } else if (text == "1") {
+    level = OptLevel::O1;
+  } else if (text == "2") {
+    level = OptLevel::O2;
+  } else if (text == "3") {
+    level = OptLevel::O3;
+  } else if (text == "s") {
+    level = OptLevel::Os;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void applyCodegenLevel(llvm::TargetMachine& target, OptLevel level) {
+  switch (level) {
+    case OptLevel::O0: target.setOptLevel(llvm::CodeGenOpt::None); break;
+    case OptLevel::O1: target.setOptLevel(llvm::CodeGenOpt::Less); break;
+    case OptLevel::O2:
+    case OptLevel::Os: target.setOptLevel(llvm::CodeGenOpt::Default); break;
+    case OptLevel::O3: target.setOptLevel(llvm::CodeGenOpt::Aggressive); break;
+  }
+}
+
+Optimizer::Optimizer(OptimizerOptions options, llvm::TargetMachine* target)
+    : options_(std::move(options)), target_(target) {}
+
+bool Optimizer::run(llvm::Module& module, std::string& error) {
+  support::TimeScope scope("optimize", module.getModuleIdentifier());
+  llvm::LoopAnalysisManager loop_analyses;
+  llvm::FunctionAnalysisManager function_analyses;
+  llvm::CGSCCAnalysisManager cgscc_analyses;
+  llvm::ModuleAnalysisManager module_analyses;
+
+  llvm::PassBuilder builder(target_);
+  builder.registerModuleAnalyses(module_analyses);
+  builder.registerCGSCCAnalyses(cgscc_analyses);
+  builder.registerFunctionAnalyses(function_analyses);
+  builder.registerLoopAnalyses(loop_analyses);
+  builder.crossRegisterProxies(loop_analyses, function_analyses, cgscc_analyses,
+                               module_analyses);
+
+  llvm::ModulePassManager passes;
+  if (!options_.passes.empty()) {
+    if (llvm::Error err = builder.parsePassPipeline(passes, options_.passes)) {
+      error = "invalid pass pipeline '" + options_.passes + "': " + llvm::toString(std::move(err));
+      return false;
+    }
+  } else if (options_.level == OptLevel::O0) {
+    passes = builder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+  } else {
+    passes = builder.buildPerModuleDefaultPipeline(toLLVM(options_.level));
+  }
+  passes.run(module, module_analyses);
+  return true;
+}
+
+std::unique_ptr<llvm::Module> Optimizer::runParallel(std::unique_ptr<llvm::Module> module,
+                                                     unsigned partitions, std::string& error) {
+  unsigned defined = 0;
+  for (const llvm::Function& fn : module->functions()) {
+    defined += fn.isDeclaration() ? 0 : 1;
+  }
+  if (partitions < 2 || defined < 2) {
+    return run(*module, error) ? std::move(module) : nullptr;
+  }
+
+  // Partitions travel between contexts as bitcode; an LLVMContext must never be
+  // touched by two threads at once.
+  std::vector<llvm::SmallVector<char, 0>> buffers;
+  {
+    support::TimeScope scope("split", module->getModuleIdentifier());
+    llvm::SplitModule(
+        *module, partitions,
+        [&buffers](std::unique_ptr<llvm::Module> part) {
+          buffers.emplace_back();
+          writeBitcode(*part, buffers.back());
+        },
+        /*PreserveLocals=*/true);
+  }
+
+  std::vector<std::string> errors(buffers.size());
+  {
+    driver::ThreadPool pool(static_cast<unsigned>(buffers.size()));
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      pool.submit([this, &buffers, &errors, i] {
+        llvm::LLVMContext context;
+        auto part = readBitcode(buffers[i], context);
+        if (!part) {
+          errors[i] = llvm::toString(part.takeError());
+          return;
+        }
+        std::unique_ptr<llvm::TargetMachine> target =
+            target_ != nullptr ? cloneTarget(*target_) : nullptr;
+        Optimizer worker(options_, target.get());
+        if (worker.run(**part, errors[i])) {
+          writeBitcode(**part, buffers[i]);
+        }
+      });
+    }
+    pool.wait();
+  }
+  for (const std::string& message : errors) {
+    if (!message.empty()) {
+      error = message;
+      return nullptr;
+    }
+  }
+
+  support::TimeScope scope("link", module->getModuleIdentifier());
+  auto merged = std::make_unique<llvm::Module>(module->getModuleIdentifier(), module->getContext());
+  merged->setSourceFileName(module->getSourceFileName());
+  merged->setTargetTriple(module->getTargetTriple());
+  merged->setDataLayout(module->getDataLayout());
+  for (const auto& buffer : buffers) {
+    auto part = readBitcode(buffer, module->getContext());
+    if (!part) {
+      error = llvm::toString(part.takeError());
+      return nullptr;
+    }
+    if (llvm::Linker::linkModules(*merged, std::move(*part))) {
+      error = "failed to link optimized partitions";
+      return nullptr;
+    }
+  }
+  return merged;
+}
+
+}  // namespace compiler::optimizer
@@ -1,12 +1,59 @@
 #pragma once
 
+#include <memory>
+#include <string>
+
+namespace llvm {
+class Module;
+class TargetMachine;
+}  // namespace llvm
+
 namespace compiler::optimizer {
 
-/** Optimizer stub. */
+/** Optimization levels, mirroring the usual -O flags. */
+enum class OptLevel {
+  O0,
+  O1,
+  O2,
+  O3,
+  Os,
+};
+
+/** Parses "0".."3" or "s" (the text after "-O"); returns false if unrecognised. */
+bool parseOptLevel(const std::string& text, OptLevel& level);
+
+struct OptimizerOptions {
+  OptLevel level = OptLevel::O0;
+  /** Custom new-pass-manager pipeline (e.g. "mem2reg,instcombine"); overrides `level`. */
+  std::string passes;
+};
+
+/** Sets the target's code generation level to match the IR optimization level. */
+void applyCodegenLevel(llvm::TargetMachine& target, OptLevel level);
+
+/**
+ * Runs LLVM new-pass-manager pipelines over a module. When a target machine is
+ * supplied, its cost model drives target-aware transforms such as vectorization.
+ */
 class Optimizer {
  public:
-  /** Creates a new optimizer. */
-  Optimizer() = default;
+  explicit Optimizer(OptimizerOptions options, llvm::TargetMachine* target = nullptr);
+
+  /** Optimizes the module in place. Fails only if the custom pipeline is invalid. */
+  bool run(llvm::Module& module, std::string& error);
+
+  /**
+   * Splits the module into up to `partitions` pieces, optimizes each one in
+   * its own LLVMContext on a thread pool, then links the results back into a
+   * fresh module in the original context. Cross-partition inlining is lost,
+   * which is the price of the concurrency. Returns null on failure.
+   */
+  std::unique_ptr<llvm::Module> runParallel(std::unique_ptr<llvm::Module> module,
+                                            unsigned partitions, std::string& error);
+
+ private:
+  OptimizerOptions options_;
+  llvm::TargetMachine* target_;
 };
 
 }  // namespace compiler::optimizer
@@ -1,7 +1,11 @@
 #include "parser/parser.h"
 
+#include <cstdint>
+
 #include "lexer/lexer.h"
 #include "parser.hpp"
+#include "parser/rd_parser.h"
+#include "support/instrumentation.h"
 
 namespace compiler::parser {
 
@@ -16,16 +20,35 @@ void ParseDriver::report(const std::string& message, int line) {
   errors->push_back(std::move(err));
 }
 
-const lexer::Token& ParseDriver::peek() const {
-  static lexer::Token eof;
-  eof.kind = lexer::Token::Kind::EndOfFile;
+const ast::Type* ParseDriver::applyDimensions(const ast::Type* base,
+                                              const std::vector<long long>& dimensions) {
+  for (auto it = dimensions.rbegin(); it != dimensions.rend(); ++it) {
+    base = types().arrayOf(base, static_cast<std::uint64_t>(*it));
+  }
+  return base;
+}
+
+const lexer::Token& ParseDriver::peek() {
+  if (stream != nullptr) {
+    return stream->peek();
+  }
+  static const lexer::Token eof = [] {
+    lexer::Token token;
+    token.kind = lexer::Token::Kind::EndOfFile;
+    return token;
+  }();
   if (index >= tokens.size()) {
     return eof;
   }
   return tokens[index];
 }
 
-lexer::Token ParseDriver::consume() {
+const lexer::Token& ParseDriver::consume() {
+  if (stream != nullptr) {
+    const lexer::Token& token = stream->next();
+    last_line = token.line;
+    return token;
+  }
   const lexer::Token& token = peek();
   if (index < tokens.size()) {
     ++index;
@@ -39,7 +62,7 @@ lexer::Token ParseDriver::consume() {
 namespace yy {
 
 parser::symbol_type yylex(compiler::parser::ParseDriver& driver) {
-  const auto token = driver.consume();
+  const compiler::lexer::Token& token = driver.consume();
   using Kind = compiler::lexer::Token::Kind;
 
   switch (token.kind) {
@@ -133,12 +156,12 @@ parser::symbol_type yylex(compiler::parser::ParseDriver& driver) {
     case Kind::CharLiteral:
       return parser::make_CHAR_LITERAL(token.value.int_val);
     case Kind::StringLiteral:
-      return parser::make_STRING_LITERAL(token.lexeme);
+      return parser::make_STRING_LITERAL(std::string(token.lexeme));
     case Kind::Identifier:
-      return parser::make_IDENTIFIER(token.lexeme);
+      return parser::make_IDENTIFIER(token.symbol);
 
     case Kind::Invalid:
-      driver.report("invalid token: " + token.lexeme, token.line);
+      driver.report("invalid token: " + std::string(token.lexeme), token.line);
       return parser::make_INVALID();
 
     case Kind::EndOfFile:
@@ -153,30 +176,60 @@ parser::symbol_type yylex(compiler::parser::ParseDriver& driver) {
 
 namespace compiler::parser {
 
-std::unique_ptr<ast::TranslationUnit> Parser::parse(const std::string& input,
+std::unique_ptr<ast::TranslationUnit> Parser::parse(std::string_view input,
                                                     const std::string& filename) {
+  support::TimeScope scope("parse", filename);
   errors_.clear();
 
-  lexer::Lexer lexer;
   ParseDriver driver;
-  driver.tokens = lexer.tokenize(input, filename);
   driver.filename = filename;
   driver.errors = &errors_;
 
-  for (const auto& lex_error : lexer.errors()) {
+  const auto run = [this, &driver] {
+    if (kind_ == ParserKind::RecursiveDescent) {
+      return RecursiveDescentParser(driver).parse() ? 0 : 1;
+    }
+    yy::parser parser(driver);
+    return parser.parse();
+  };
+
+  std::vector<lexer::LexError> lex_errors;
+  int parse_status = 0;
+  if (mode_ == ParseMode::Batch) {
+    lexer::Lexer lexer(&driver.context->interner(), scanner_);
+    driver.tokens = lexer.tokenize(input, filename);
+    lex_errors = lexer.errors();
+    parse_status = run();
+  } else {
+    lexer::TokenStream stream(input, filename, &driver.context->interner(), scanner_);
+    driver.stream = &stream;
+    parse_status = run();
+    // Drain the rest of the input so lexical diagnostics match batch mode.
+    while (stream.next().kind != lexer::Token::Kind::EndOfFile) {
+    }
+    driver.stream = nullptr;
+    lex_errors = stream.errors();
+  }
+
+  // Lexical diagnostics precede syntax diagnostics regardless of mode.
+  std::vector<ParseError> merged;
+  merged.reserve(lex_errors.size() + errors_.size());
+  for (const auto& lex_error : lex_errors) {
     ParseError err;
     err.filename = lex_error.filename;
     err.line = lex_error.line;
     err.message = lex_error.message;
-    errors_.push_back(std::move(err));
+    merged.push_back(std::move(err));
   }
+  for (auto& err : errors_) {
+    merged.push_back(std::move(err));
+  }
+  errors_ = std::move(merged);
 
-  yy::parser parser(driver);
-  const int parse_status = parser.parse();
-
-  if (parse_status != 0 || !errors_.empty()) {
+  if (parse_status != 0 || !errors_.empty() || driver.result == nullptr) {
     return nullptr;
   }
+  driver.result->context = std::move(driver.context);
   return std::move(driver.result);
 }
 
@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "ast/ast.h"
@@ -17,36 +18,79 @@ struct ParseError {
   std::string message;
 };
 
-/** Shared parse state used by Bison parser and lexer bridge. */
+/** How the parser obtains tokens from the lexer. */
+enum class ParseMode {
+  /** Pull tokens from a TokenStream as the parser needs them. */
+  Streaming,
+  /** Tokenize the whole input up front, then parse the token vector. */
+  Batch,
+};
+
+/** Which parser turns the token stream into an AST. */
+enum class ParserKind {
+  /** The LALR(1) parser Bison generates from parser.y. */
+  Bison,
+  /** The hand-written RecursiveDescentParser. */
+  RecursiveDescent,
+};
+
+/** Shared parse state used by both parsers and the Bison lexer bridge. */
 struct ParseDriver {
   std::vector<lexer::Token> tokens;
   std::size_t index = 0;
+  lexer::TokenStream* stream = nullptr;
   std::string filename;
   int last_line = 1;
   std::vector<ParseError>* errors = nullptr;
+  std::unique_ptr<ast::ASTContext> context = std::make_unique<ast::ASTContext>();
   std::unique_ptr<ast::TranslationUnit> result;
 
+  /** Interns a name in the translation unit's string table. */
+  support::Symbol intern(std::string_view text) { return context->intern(text); }
+
+  /** Returns the translation unit's type table. */
+  ast::TypeContext& types() { return context->types(); }
+
+  /** Applies `int a[3][8]` dimensions innermost-last: an array of 3 arrays of 8 ints. */
+  const ast::Type* applyDimensions(const ast::Type* base, const std::vector<long long>& dimensions);
+
+  /** Allocates an AST node from the translation unit's arena, stamped with the current line. */
+  template <typename T>
+  T* make() {
+    T* node = context->create<T>();
+    node->line = last_line;
+    return node;
+  }
+
   /** Adds a line-numbered parser diagnostic. */
   void report(const std::string& message, int line = -1);
 
   /** Returns the current token without consuming it. */
-  const lexer::Token& peek() const;
+  const lexer::Token& peek();
 
-  /** Returns and consumes the current token. */
-  lexer::Token consume();
+  /** Returns and consumes the current token without copying it. */
+  const lexer::Token& consume();
 };
 
-/** Bison-backed parser entry point. */
+/** Parser entry point; Bison-backed unless another ParserKind is chosen. */
 class Parser {
  public:
+  explicit Parser(ParseMode mode = ParseMode::Streaming,
+                  lexer::ScannerKind scanner = lexer::ScannerKind::Flex,
+                  ParserKind kind = ParserKind::Bison)
+      : mode_(mode), scanner_(scanner), kind_(kind) {}
+
   /** Parses source text into an AST translation unit. */
-  std::unique_ptr<ast::TranslationUnit> parse(const std::string& input,
+  std::unique_ptr<ast::TranslationUnit> parse(std::string_view input,
                                               const std::string& filename = "<input>");
 
   /** Returns diagnostics produced by the last parse call. */
   const std::vector<ParseError>& errors() const;
 
  private:
+  ParseMode mode_;
+  lexer::ScannerKind scanner_;
+  ParserKind kind_;
   std::vector<ParseError> errors_;
 };
 
@@ -35,10 +35,13 @@ parser::symbol_type yylex(compiler::parser::ParseDriver& driver);
 
 namespace {
 
-std::unique_ptr<compiler::ast::BinaryExpr> make_binary(
-    const std::string& op, std::unique_ptr<compiler::ast::ASTNode> lhs,
-    std::unique_ptr<compiler::ast::ASTNode> rhs, int line) {
-  auto node = std::make_unique<compiler::ast::BinaryExpr>();
+using compiler::ast::BinaryOp;
+using compiler::ast::UnaryOp;
+
+compiler::ast::BinaryExpr* make_binary(
+    compiler::parser::ParseDriver& driver, BinaryOp op,
+    compiler::ast::ASTNode* lhs, compiler::ast::ASTNode* rhs, int line) {
+  auto* node = driver.make<compiler::ast::BinaryExpr>();
   node->op = op;
   node->lhs = std::move(lhs);
   node->rhs = std::move(rhs);
@@ -46,9 +49,10 @@ std::unique_ptr<compiler::ast::BinaryExpr> make_binary(
   return node;
 }
 
-std::unique_ptr<compiler::ast::UnaryExpr> make_unary(
-    const std::string& op, std::unique_ptr<compiler::ast::ASTNode> operand, int line) {
-  auto node = std::make_unique<compiler::ast::UnaryExpr>();
+compiler::ast::UnaryExpr* make_unary(
+    compiler::parser::ParseDriver& driver, UnaryOp op,
+    compiler::ast::ASTNode* operand, int line) {
+  auto* node = driver.make<compiler::ast::UnaryExpr>();
   node->op = op;
   node->operand = std::move(operand);
   node->line = line;
@@ -69,17 +73,19 @@ std::unique_ptr<compiler::ast::UnaryExpr> make_unary(
 
 %token <long long> INT_LITERAL CHAR_LITERAL
 %token <double> FLOAT_LITERAL
-%token <std::string> IDENTIFIER STRING_LITERAL
+%token <compiler::support::Symbol> IDENTIFIER
+%token <std::string> STRING_LITERAL
 
-%type <compiler::ast::TypeInfo> type_specifier
+%type <const compiler::ast::Type*> type_specifier
 %type <compiler::ast::ParamDecl> parameter_declaration
 %type <compiler::ast::FieldDecl> field_declaration
+%type <std::vector<long long>> array_dimensions
 
 %type <std::vector<compiler::ast::ParamDecl>> parameter_list parameter_list_opt
 %type <std::vector<compiler::ast::FieldDecl>> field_declaration_list
-%type <std::vector<std::unique_ptr<compiler::ast::ASTNode>>> external_declaration_list block_item_list argument_expression_list argument_expression_list_opt
+%type <std::vector<compiler::ast::ASTNode*>> external_declaration_list block_item_list argument_expression_list argument_expression_list_opt
 
-%type <std::unique_ptr<compiler::ast::ASTNode>>
+%type <compiler::ast::ASTNode*>
   external_declaration
   function_definition
   declaration
@@ -104,7 +110,7 @@ std::unique_ptr<compiler::ast::UnaryExpr> make_unary(
   postfix_expression
   primary_expression
 
-%type <std::unique_ptr<compiler::ast::TranslationUnit>> translation_unit
+%type <compiler::ast::TranslationUnit*> translation_unit
 
 %right ASSIGN PLUSEQ MINUSEQ STAREQ SLASHEQ
 %left OROR
@@ -130,7 +136,7 @@ translation_unit
   ;
 
 external_declaration_list
-  : /* empty */ { $$ = std::vector<std::unique_ptr<compiler::ast::ASTNode>>(); }
+  : /* empty */ { $$ = std::vector<compiler::ast::ASTNode*>(); }
   | external_declaration_list external_declaration
     {
       $$ = std::move($1);
@@ -155,16 +161,16 @@ external_declaration
 function_definition
   : type_specifier IDENTIFIER LPAREN parameter_list_opt RPAREN compound_stmt
     {
-      auto fn = std::make_unique<compiler::ast::FunctionDecl>();
+      auto* fn = driver.make<compiler::ast::FunctionDecl>();
       fn->return_type = std::move($1);
       fn->name = std::move($2);
       fn->params = std::move($4);
-      auto* body = dynamic_cast<compiler::ast::CompoundStmt*>($6.release());
+      auto* body = compiler::ast::dyn_cast<compiler::ast::CompoundStmt>($6);
       if (body == nullptr) {
         driver.report("function body must be a compound statement");
         $$ = nullptr;
       } else {
-        fn->body.reset(body);
+        fn->body = body;
         fn->line = body->line;
         $$ = std::move(fn);
       }
@@ -212,12 +218,19 @@ field_declaration
       field.name = std::move($2);
       $$ = std::move(field);
     }
+  | type_specifier IDENTIFIER array_dimensions SEMICOLON
+    {
+      compiler::ast::FieldDecl field;
+      field.type = driver.applyDimensions($1, $3);
+      field.name = std::move($2);
+      $$ = std::move(field);
+    }
   ;
 
 struct_declaration
   : KW_STRUCT IDENTIFIER LBRACE field_declaration_list RBRACE
     {
-      auto st = std::make_unique<compiler::ast::StructDecl>();
+      auto* st = driver.make<compiler::ast::StructDecl>();
       st->name = std::move($2);
       st->fields = std::move($4);
       $$ = std::move(st);
@@ -225,29 +238,41 @@ struct_declaration
   ;
 
 type_specifier
-  : KW_INT { compiler::ast::TypeInfo t; t.name = "int"; $$ = std::move(t); }
-  | KW_FLOAT { compiler::ast::TypeInfo t; t.name = "float"; $$ = std::move(t); }
-  | KW_CHAR { compiler::ast::TypeInfo t; t.name = "char"; $$ = std::move(t); }
-  | KW_VOID { compiler::ast::TypeInfo t; t.name = "void"; $$ = std::move(t); }
-  | KW_STRUCT IDENTIFIER
+  : KW_INT { $$ = driver.types().intType(); }
+  | KW_FLOAT { $$ = driver.types().floatType(); }
+  | KW_CHAR { $$ = driver.types().charType(); }
+  | KW_VOID { $$ = driver.types().voidType(); }
+  | KW_STRUCT IDENTIFIER { $$ = driver.types().structNamed($2); }
+  | type_specifier STAR { $$ = driver.types().pointerTo($1); }
+  ;
+
+array_dimensions
+  : LBRACKET INT_LITERAL RBRACKET { $$ = {$2}; }
+  | array_dimensions LBRACKET INT_LITERAL RBRACKET
     {
-      compiler::ast::TypeInfo t;
-      t.name = "struct " + $2;
-      $$ = std::move(t);
+      $$ = std::move($1);
+      $$.push_back($3);
     }
   ;
 
 declaration
   : type_specifier IDENTIFIER
     {
-      auto decl = std::make_unique<compiler::ast::VarDecl>();
+      auto* decl = driver.make<compiler::ast::VarDecl>();
       decl->type = std::move($1);
       decl->name = std::move($2);
       $$ = std::move(decl);
     }
+  | type_specifier IDENTIFIER array_dimensions
+    {
+      auto* decl = driver.make<compiler::ast::VarDecl>();
+      decl->type = driver.applyDimensions($1, $3);
+      decl->name = std::move($2);
+      $$ = std::move(decl);
+    }
   | type_specifier IDENTIFIER ASSIGN expression
     {
-      auto decl = std::make_unique<compiler::ast::VarDecl>();
+      auto* decl = driver.make<compiler::ast::VarDecl>();
       decl->type = std::move($1);
       decl->name = std::move($2);
       decl->init = std::move($4);
@@ -258,7 +283,7 @@ declaration
 compound_stmt
   : LBRACE block_item_list RBRACE
     {
-      auto compound = std::make_unique<compiler::ast::CompoundStmt>();
+      auto* compound = driver.make<compiler::ast::CompoundStmt>();
       compound->stmts = std::move($2);
       $$ = std::move(compound);
     }
@@ -266,12 +291,12 @@ compound_stmt
     {
       driver.report("invalid compound statement");
       yyerrok;
-      $$ = std::make_unique<compiler::ast::CompoundStmt>();
+      $$ = driver.make<compiler::ast::CompoundStmt>();
     }
   ;
 
 block_item_list
-  : /* empty */ { $$ = std::vector<std::unique_ptr<compiler::ast::ASTNode>>(); }
+  : /* empty */ { $$ = std::vector<compiler::ast::ASTNode*>(); }
   | block_item_list statement
     {
       $$ = std::move($1);
@@ -292,21 +317,21 @@ statement
     {
       driver.report("invalid statement");
       yyerrok;
-      $$ = std::make_unique<compiler::ast::ExprStmt>();
+      $$ = driver.make<compiler::ast::ExprStmt>();
     }
   ;
 
 selection_stmt
   : KW_IF LPAREN expression RPAREN statement %prec LOWER_THAN_ELSE
     {
-      auto node = std::make_unique<compiler::ast::IfStmt>();
+      auto* node = driver.make<compiler::ast::IfStmt>();
       node->cond = std::move($3);
       node->then_branch = std::move($5);
       $$ = std::move(node);
     }
   | KW_IF LPAREN expression RPAREN statement KW_ELSE statement
     {
-      auto node = std::make_unique<compiler::ast::IfStmt>();
+      auto* node = driver.make<compiler::ast::IfStmt>();
       node->cond = std::move($3);
       node->then_branch = std::move($5);
       node->else_branch = std::move($7);
@@ -317,14 +342,14 @@ selection_stmt
 iteration_stmt
   : KW_WHILE LPAREN expression RPAREN statement
     {
-      auto node = std::make_unique<compiler::ast::WhileStmt>();
+      auto* node = driver.make<compiler::ast::WhileStmt>();
       node->cond = std::move($3);
       node->body = std::move($5);
       $$ = std::move(node);
     }
   | KW_FOR LPAREN for_init_statement opt_expression SEMICOLON opt_expression RPAREN statement
     {
-      auto node = std::make_unique<compiler::ast::ForStmt>();
+      auto* node = driver.make<compiler::ast::ForStmt>();
       node->init = std::move($3);
       node->cond = std::move($4);
       node->incr = std::move($6);
@@ -342,12 +367,12 @@ for_init_statement
 jump_stmt
   : KW_RETURN SEMICOLON
     {
-      auto node = std::make_unique<compiler::ast::ReturnStmt>();
+      auto* node = driver.make<compiler::ast::ReturnStmt>();
       $$ = std::move(node);
     }
   | KW_RETURN expression SEMICOLON
     {
-      auto node = std::make_unique<compiler::ast::ReturnStmt>();
+      auto* node = driver.make<compiler::ast::ReturnStmt>();
       node->value = std::move($2);
       $$ = std::move(node);
     }
@@ -356,11 +381,11 @@ jump_stmt
 expr_stmt
   : SEMICOLON
     {
-      $$ = std::make_unique<compiler::ast::ExprStmt>();
+      $$ = driver.make<compiler::ast::ExprStmt>();
     }
   | expression SEMICOLON
     {
-      auto node = std::make_unique<compiler::ast::ExprStmt>();
+      auto* node = driver.make<compiler::ast::ExprStmt>();
       node->expr = std::move($1);
       $$ = std::move(node);
     }
@@ -378,103 +403,103 @@ expression
 assignment_expression
   : logical_or_expression { $$ = std::move($1); }
   | unary_expression ASSIGN assignment_expression
-    { $$ = make_binary("=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Assign, $1, $3, driver.last_line); }
   | unary_expression PLUSEQ assignment_expression
-    { $$ = make_binary("+=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::AddAssign, $1, $3, driver.last_line); }
   | unary_expression MINUSEQ assignment_expression
-    { $$ = make_binary("-=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::SubAssign, $1, $3, driver.last_line); }
   | unary_expression STAREQ assignment_expression
-    { $$ = make_binary("*=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::MulAssign, $1, $3, driver.last_line); }
   | unary_expression SLASHEQ assignment_expression
-    { $$ = make_binary("/=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::DivAssign, $1, $3, driver.last_line); }
   ;
 
 logical_or_expression
   : logical_and_expression { $$ = std::move($1); }
   | logical_or_expression OROR logical_and_expression
-    { $$ = make_binary("||", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::LogicalOr, $1, $3, driver.last_line); }
   ;
 
 logical_and_expression
   : equality_expression { $$ = std::move($1); }
   | logical_and_expression ANDAND equality_expression
-    { $$ = make_binary("&&", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::LogicalAnd, $1, $3, driver.last_line); }
   ;
 
 equality_expression
   : relational_expression { $$ = std::move($1); }
   | equality_expression EQEQ relational_expression
-    { $$ = make_binary("==", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Eq, $1, $3, driver.last_line); }
   | equality_expression NEQ relational_expression
-    { $$ = make_binary("!=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Ne, $1, $3, driver.last_line); }
   ;
 
 relational_expression
   : additive_expression { $$ = std::move($1); }
   | relational_expression LT additive_expression
-    { $$ = make_binary("<", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Lt, $1, $3, driver.last_line); }
   | relational_expression GT additive_expression
-    { $$ = make_binary(">", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Gt, $1, $3, driver.last_line); }
   | relational_expression LE additive_expression
-    { $$ = make_binary("<=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Le, $1, $3, driver.last_line); }
   | relational_expression GE additive_expression
-    { $$ = make_binary(">=", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Ge, $1, $3, driver.last_line); }
   ;
 
 additive_expression
   : multiplicative_expression { $$ = std::move($1); }
   | additive_expression PLUS multiplicative_expression
-    { $$ = make_binary("+", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Add, $1, $3, driver.last_line); }
   | additive_expression MINUS multiplicative_expression
-    { $$ = make_binary("-", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Sub, $1, $3, driver.last_line); }
   ;
 
 multiplicative_expression
   : unary_expression { $$ = std::move($1); }
   | multiplicative_expression STAR unary_expression
-    { $$ = make_binary("*", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Mul, $1, $3, driver.last_line); }
   | multiplicative_expression SLASH unary_expression
-    { $$ = make_binary("/", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Div, $1, $3, driver.last_line); }
   | multiplicative_expression PERCENT unary_expression
-    { $$ = make_binary("%", std::move($1), std::move($3), driver.last_line); }
+    { $$ = make_binary(driver, BinaryOp::Mod, $1, $3, driver.last_line); }
   ;
 
 unary_expression
   : postfix_expression { $$ = std::move($1); }
   | NOT unary_expression %prec NOT
-    { $$ = make_unary("!", std::move($2), driver.last_line); }
+    { $$ = make_unary(driver, UnaryOp::Not, $2, driver.last_line); }
   | MINUS unary_expression %prec UMINUS
-    { $$ = make_unary("-", std::move($2), driver.last_line); }
+    { $$ = make_unary(driver, UnaryOp::Neg, $2, driver.last_line); }
   | AMP unary_expression %prec AMP
-    { $$ = make_unary("&", std::move($2), driver.last_line); }
+    { $$ = make_unary(driver, UnaryOp::AddressOf, $2, driver.last_line); }
   | STAR unary_expression %prec USTAR
-    { $$ = make_unary("*", std::move($2), driver.last_line); }
+    { $$ = make_unary(driver, UnaryOp::Deref, $2, driver.last_line); }
   ;
 
 postfix_expression
   : primary_expression { $$ = std::move($1); }
   | postfix_expression LPAREN argument_expression_list_opt RPAREN
     {
-      auto call = std::make_unique<compiler::ast::CallExpr>();
-      if (auto* var = dynamic_cast<compiler::ast::VarRef*>($1.get())) {
+      auto* call = driver.make<compiler::ast::CallExpr>();
+      if (auto* var = compiler::ast::dyn_cast<compiler::ast::VarRef>($1)) {
         call->callee = var->name;
       } else {
         driver.report("function call requires identifier callee");
-        call->callee = "<invalid>";
+        call->callee = driver.intern("<invalid>");
       }
       call->args = std::move($3);
       $$ = std::move(call);
     }
   | postfix_expression LBRACKET expression RBRACKET
     {
-      auto sub = std::make_unique<compiler::ast::ArraySubscript>();
+      auto* sub = driver.make<compiler::ast::ArraySubscript>();
       sub->array = std::move($1);
       sub->index = std::move($3);
       $$ = std::move(sub);
     }
   | postfix_expression DOT IDENTIFIER
     {
-      auto member = std::make_unique<compiler::ast::MemberExpr>();
+      auto* member = driver.make<compiler::ast::MemberExpr>();
       member->object = std::move($1);
       member->member = std::move($3);
       member->is_arrow = false;
@@ -482,7 +507,7 @@ postfix_expression
     }
   | postfix_expression ARROW IDENTIFIER
     {
-      auto member = std::make_unique<compiler::ast::MemberExpr>();
+      auto* member = driver.make<compiler::ast::MemberExpr>();
       member->object = std::move($1);
       member->member = std::move($3);
       member->is_arrow = true;
@@ -491,14 +516,14 @@ postfix_expression
   ;
 
 argument_expression_list_opt
-  : /* empty */ { $$ = std::vector<std::unique_ptr<compiler::ast::ASTNode>>(); }
+  : /* empty */ { $$ = std::vector<compiler::ast::ASTNode*>(); }
   | argument_expression_list { $$ = std::move($1); }
   ;
 
 argument_expression_list
   : assignment_expression
     {
-      $$ = std::vector<std::unique_ptr<compiler::ast::ASTNode>>();
+      $$ = std::vector<compiler::ast::ASTNode*>();
       $$.push_back(std::move($1));
     }
   | argument_expression_list COMMA assignment_expression
@@ -511,31 +536,31 @@ argument_expression_list
 primary_expression
   : IDENTIFIER
     {
-      auto ref = std::make_unique<compiler::ast::VarRef>();
+      auto* ref = driver.make<compiler::ast::VarRef>();
       ref->name = std::move($1);
       $$ = std::move(ref);
     }
   | INT_LITERAL
     {
-      auto lit = std::make_unique<compiler::ast::IntLiteral>();
+      auto* lit = driver.make<compiler::ast::IntLiteral>();
       lit->value = $1;
       $$ = std::move(lit);
     }
   | FLOAT_LITERAL
     {
-      auto lit = std::make_unique<compiler::ast::FloatLiteral>();
+      auto* lit = driver.make<compiler::ast::FloatLiteral>();
       lit->value = $1;
       $$ = std::move(lit);
     }
   | CHAR_LITERAL
     {
-      auto lit = std::make_unique<compiler::ast::CharLiteral>();
+      auto* lit = driver.make<compiler::ast::CharLiteral>();
       lit->value = static_cast<char>($1);
       $$ = std::move(lit);
     }
   | STRING_LITERAL
     {
-      auto lit = std::make_unique<compiler::ast::StringLiteral>();
+      auto* lit = driver.make<compiler::ast::StringLiteral>();
       lit->value = std::move($1);
       $$ = std::move(lit);
     }
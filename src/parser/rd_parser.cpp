@@ -0,0 +1,922 @@
+#include "parser/rd_parser.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace compiler::parser {
+
+namespace {
+
+using Kind = lexer::Token::Kind;
+
+/** Names a token the way parser.y's %token declarations do. */
+const char* tokenName(Kind kind) {
+  switch (kind) {
+    case Kind::KwInt:
+      return "KW_INT";
+    case Kind::KwFloat:
+      return "KW_FLOAT";
+    case Kind::KwChar:
+      return "KW_CHAR";
+    case Kind::KwVoid:
+      return "KW_VOID";
+    case Kind::KwStruct:
+      return "KW_STRUCT";
+    case Kind::KwIf:
+      return "KW_IF";
+    case Kind::KwElse:
+      return "KW_ELSE";
+    case Kind::KwWhile:
+      return "KW_WHILE";
+    case Kind::KwFor:
+      return "KW_FOR";
+    case Kind::KwReturn:
+      return "KW_RETURN";
+    case Kind::Plus:
+      return "PLUS";
+    case Kind::Minus:
+      return "MINUS";
+    case Kind::Star:
+      return "STAR";
+    case Kind::Slash:
+      return "SLASH";
+    case Kind::Percent:
+      return "PERCENT";
+    case Kind::EqEq:
+      return "EQEQ";
+    case Kind::NotEq:
+      return "NEQ";
+    case Kind::Lt:
+      return "LT";
+    case Kind::Gt:
+      return "GT";
+    case Kind::Le:
+      return "LE";
+    case Kind::Ge:
+      return "GE";
+    case Kind::AndAnd:
+      return "ANDAND";
+    case Kind::OrOr:
+      return "OROR";
+    case Kind::Not:
+      return "NOT";
+    case Kind::Assign:
+      return "ASSIGN";
+    case Kind::PlusAssign:
+      return "PLUSEQ";
+    case Kind::MinusAssign:
+      return "MINUSEQ";
+    case Kind::StarAssign:
+      return "STAREQ";
+    case Kind::SlashAssign:
+      return "SLASHEQ";
+    case Kind::Arrow:
+      return "ARROW";
+    case Kind::Amp:
+      return "AMP";
+    case Kind::LParen:
+      return "LPAREN";
+    case Kind::RParen:
+      return "RPAREN";
+    case Kind::LBrace:
+      return "LBRACE";
+    case Kind::RBrace:
+      return "RBRACE";
+    case Kind::LBracket:
+      return "LBRACKET";
+    case Kind::RBracket:
+      return "RBRACKET";
+    case Kind::Semicolon:
+      return "SEMICOLON";
+    case Kind::Comma:
+      return "COMMA";
+    case Kind::Dot:
+      return "DOT";
+    case Kind::IntLiteral:
+      return "INT_LITERAL";
+    case Kind::FloatLiteral:
+      return "FLOAT_LITERAL";
+    case Kind::CharLiteral:
+      return "CHAR_LITERAL";
+    case Kind::StringLiteral:
+      return "STRING_LITERAL";
+    case Kind::Identifier:
+      return "IDENTIFIER";
+    case Kind::EndOfFile:
+      return "end of file";
+    case Kind::Invalid:
+      return "INVALID";
+  }
+  return "INVALID";
+}
+
+bool isTypeKeyword(Kind kind) {
+  return kind == Kind::KwInt || kind == Kind::KwFloat || kind == Kind::KwChar ||
+         kind == Kind::KwVoid || kind == Kind::KwStruct;
+}
+
+/** Whether a statement can begin with this token. */
+bool startsStatement(Kind kind) {
+  switch (kind) {
+    case Kind::LBrace:
+    case Kind::KwIf:
+    case Kind::KwWhile:
+    case Kind::KwFor:
+    case Kind::KwReturn:
+    case Kind::Semicolon:
+    case Kind::Identifier:
+    case Kind::IntLiteral:
+    case Kind::FloatLiteral:
+    case Kind::CharLiteral:
+    case Kind::StringLiteral:
+    case Kind::LParen:
+    case Kind::Not:
+    case Kind::Minus:
+    case Kind::Amp:
+    case Kind::Star:
+      return true;
+    default:
+      return isTypeKeyword(kind);
+  }
+}
+
+bool assignmentOp(Kind kind, ast::BinaryOp& op) {
+  switch (kind) {
+    case Kind::Assign:
+      op = ast::BinaryOp::Assign;
+      return true;
+    case Kind::PlusAssign:
+      op = ast::BinaryOp::AddAssign;
+      return true;
+    case Kind::MinusAssign:
+      op = ast::BinaryOp::SubAssign;
+      return true;
+    case Kind::StarAssign:
+      op = ast::BinaryOp::MulAssign;
+      return true;
+    case Kind::SlashAssign:
+      op = ast::BinaryOp::DivAssign;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Returns the binding strength of a binary operator token, following the
+ * %left declarations in parser.y, or 0 if the token is not one.
+ */
+int binaryPrecedence(Kind kind, ast::BinaryOp& op) {
+  switch (kind) {
+    case Kind::OrOr:
+      op = ast::BinaryOp::LogicalOr;
+      return 1;
+    case Kind::AndAnd:
+      op = ast::BinaryOp::LogicalAnd;
+      return 2;
+    case Kind::EqEq:
+      op = ast::BinaryOp::Eq;
+      return 3;
+    case Kind::NotEq:
+      op = ast::BinaryOp::Ne;
+      return 3;
+    case Kind::Lt:
+      op = ast::BinaryOp::Lt;
+      return 4;
+    case Kind::Gt:
+      op = ast::BinaryOp::Gt;
+      return 4;
+    case Kind::Le:
+      op = ast::BinaryOp::Le;
+      return 4;
+    case Kind::Ge:
+      op = ast::BinaryOp::Ge;
+      return 4;
+    case Kind::Plus:
+      op = ast::BinaryOp::Add;
+      return 5;
+    case Kind::Minus:
+      op = ast::BinaryOp::Sub;
+      return 5;
+    case Kind::Star:
+      op = ast::BinaryOp::Mul;
+      return 6;
+    case Kind::Slash:
+      op = ast::BinaryOp::Div;
+      return 6;
+    case Kind::Percent:
+      op = ast::BinaryOp::Mod;
+      return 6;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+bool RecursiveDescentParser::parse() {
+  auto unit = std::make_unique<ast::TranslationUnit>();
+  while (peek().kind != Kind::EndOfFile) {
+    ast::ASTNode* decl = parseExternalDeclaration();
+    if (failed_) {
+      // Bison gives up when its error recovery runs into the end of input.
+      if (!skipStatement()) {
+        return false;
+      }
+      driver_.report("syntax error in top-level declaration");
+      failed_ = false;
+      continue;
+    }
+    if (decl != nullptr) {
+      unit->decls.push_back(decl);
+    }
+  }
+  driver_.result = std::move(unit);
+  return true;
+}
+
+// --- Tokens ---
+
+const lexer::Token& RecursiveDescentParser::peek() {
+  const lexer::Token& token = driver_.peek();
+  // Bison fetches a token the first time it needs to look at it, which is
+  // when the current line moves on and an invalid token gets reported.
+  driver_.last_line = token.line;
+  if (token.kind == Kind::Invalid && !invalid_reported_) {
+    driver_.report("invalid token: " + std::string(token.lexeme), token.line);
+    invalid_reported_ = true;
+  }
+  return token;
+}
+
+const lexer::Token& RecursiveDescentParser::consume() {
+  peek();
+  invalid_reported_ = false;
+  return driver_.consume();
+}
+
+bool RecursiveDescentParser::accept(Kind kind) {
+  if (peek().kind != kind) {
+    return false;
+  }
+  consume();
+  return true;
+}
+
+bool RecursiveDescentParser::expect(Kind kind) {
+  if (accept(kind)) {
+    return true;
+  }
+  syntaxError(tokenName(kind));
+  return false;
+}
+
+void RecursiveDescentParser::syntaxError(const char* expected) {
+  if (failed_) {
+    return;
+  }
+  failed_ = true;
+  std::string message = std::string("syntax error, unexpected ") + tokenName(peek().kind);
+  if (expected != nullptr) {
+    message += std::string(", expecting ") + expected;
+  }
+  driver_.report(message);
+}
+
+bool RecursiveDescentParser::Nesting::exceeded() {
+  if (parser_.depth_ <= kMaxNesting) {
+    return false;
+  }
+  if (!parser_.failed_) {
+    parser_.failed_ = true;
+    parser_.driver_.report("syntax error, nesting exceeds " + std::to_string(kMaxNesting) +
+                           " levels");
+  }
+  return true;
+}
+
+bool RecursiveDescentParser::skipStatement() {
+  for (;;) {
+    const Kind kind = peek().kind;
+    if (kind == Kind::EndOfFile) {
+      return false;
+    }
+    consume();
+    if (kind == Kind::Semicolon) {
+      return true;
+    }
+  }
+}
+
+// --- Declarations ---
+
+ast::ASTNode* RecursiveDescentParser::parseExternalDeclaration() {
+  const ast::Type* type = nullptr;
+  if (peek().kind == Kind::KwStruct) {
+    consume();
+    if (peek().kind != Kind::Identifier) {
+      syntaxError(tokenName(Kind::Identifier));
+      return nullptr;
+    }
+    const support::Symbol tag = consume().symbol;
+    if (peek().kind == Kind::LBrace) {
+      ast::ASTNode* decl = parseStructDeclaration(tag);
+      if (failed_ || !expect(Kind::Semicolon)) {
+        return nullptr;
+      }
+      return decl;
+    }
+    type = parsePointers(driver_.types().structNamed(tag));
+  } else {
+    type = parseTypeSpecifier();
+    if (failed_) {
+      return nullptr;
+    }
+  }
+
+  if (peek().kind != Kind::Identifier) {
+    syntaxError(tokenName(Kind::Identifier));
+    return nullptr;
+  }
+  const support::Symbol name = consume().symbol;
+  if (peek().kind == Kind::LParen) {
+    return parseFunction(type, name);
+  }
+  ast::ASTNode* decl = parseDeclaration(type, name);
+  if (failed_ || !expect(Kind::Semicolon)) {
+    return nullptr;
+  }
+  return decl;
+}
+
+const ast::Type* RecursiveDescentParser::parseTypeSpecifier() {
+  const ast::Type* type = nullptr;
+  switch (peek().kind) {
+    case Kind::KwInt:
+      type = driver_.types().intType();
+      break;
+    case Kind::KwFloat:
+      type = driver_.types().floatType();
+      break;
+    case Kind::KwChar:
+      type = driver_.types().charType();
+      break;
+    case Kind::KwVoid:
+      type = driver_.types().voidType();
+      break;
+    case Kind::KwStruct:
+      consume();
+      if (peek().kind != Kind::Identifier) {
+        syntaxError(tokenName(Kind::Identifier));
+        return nullptr;
+      }
+      type = driver_.types().structNamed(peek().symbol);
+      break;
+    default:
+      syntaxError();
+      return nullptr;
+  }
+  consume();
+  return parsePointers(type);
+}
+
+const ast::Type* RecursiveDescentParser::parsePointers(const ast::Type* type) {
+  while (accept(Kind::Star)) {
+    type = driver_.types().pointerTo(type);
+  }
+  return type;
+}
+
+bool RecursiveDescentParser::parseDimensions(std::vector<long long>& dimensions) {
+  while (accept(Kind::LBracket)) {
+    if (peek().kind != Kind::IntLiteral) {
+      syntaxError(tokenName(Kind::IntLiteral));
+      return false;
+    }
+    dimensions.push_back(consume().value.int_val);
+    if (!expect(Kind::RBracket)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseStructDeclaration(support::Symbol name) {
+  consume();  // '{'
+  std::vector<ast::FieldDecl> fields;
+  while (peek().kind != Kind::RBrace) {
+    ast::FieldDecl field;
+    field.type = parseTypeSpecifier();
+    if (failed_) {
+      return nullptr;
+    }
+    if (peek().kind != Kind::Identifier) {
+      syntaxError(tokenName(Kind::Identifier));
+      return nullptr;
+    }
+    field.name = consume().symbol;
+    std::vector<long long> dimensions;
+    if (!parseDimensions(dimensions) || !expect(Kind::Semicolon)) {
+      return nullptr;
+    }
+    field.type = driver_.applyDimensions(field.type, dimensions);
+    fields.push_back(field);
+  }
+  consume();  // '}'
+
+  auto* decl = driver_.make<ast::StructDecl>();
+  decl->name = name;
+  decl->fields = std::move(fields);
+  return decl;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseFunction(const ast::Type* return_type,
+                                                    support::Symbol name) {
+  consume();  // '('
+  std::vector<ast::ParamDecl> params;
+  if (peek().kind != Kind::RParen) {
+    do {
+      ast::ParamDecl param;
+      param.type = parseTypeSpecifier();
+      if (failed_) {
+        return nullptr;
+      }
+      if (peek().kind != Kind::Identifier) {
+        syntaxError(tokenName(Kind::Identifier));
+        return nullptr;
+      }
+      param.name = consume().symbol;
+      params.push_back(param);
+    } while (accept(Kind::Comma));
+  }
+  if (!expect(Kind::RParen)) {
+    return nullptr;
+  }
+  if (peek().kind != Kind::LBrace) {
+    syntaxError(tokenName(Kind::LBrace));
+    return nullptr;
+  }
+  ast::CompoundStmt* body = parseCompound();
+  if (failed_) {
+    return nullptr;
+  }
+
+  auto* fn = driver_.make<ast::FunctionDecl>();
+  fn->return_type = return_type;
+  fn->name = name;
+  fn->params = std::move(params);
+  fn->body = body;
+  fn->line = body->line;
+  return fn;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseDeclaration(const ast::Type* type,
+                                                       support::Symbol name) {
+  ast::ASTNode* init = nullptr;
+  if (peek().kind == Kind::LBracket) {
+    std::vector<long long> dimensions;
+    if (!parseDimensions(dimensions)) {
+      return nullptr;
+    }
+    type = driver_.applyDimensions(type, dimensions);
+  } else if (accept(Kind::Assign)) {
+    init = parseExpression();
+    if (failed_) {
+      return nullptr;
+    }
+  }
+
+  auto* decl = driver_.make<ast::VarDecl>();
+  decl->type = type;
+  decl->name = name;
+  decl->init = init;
+  return decl;
+}
+
+// --- Statements ---
+
+ast::CompoundStmt* RecursiveDescentParser::parseCompound() {
+  consume();  // '{'
+  std::vector<ast::ASTNode*> stmts;
+  const Kind first = peek().kind;
+  if (first != Kind::RBrace && !startsStatement(first)) {
+    // parser.y's `LBRACE error RBRACE`: a block that cannot even start is
+    // skipped through the next closing brace.
+    syntaxError();
+    for (Kind kind = first; kind != Kind::RBrace; kind = peek().kind) {
+      if (kind == Kind::EndOfFile) {
+        return nullptr;
+      }
+      consume();
+    }
+    consume();  // '}'
+    driver_.report("invalid compound statement");
+    failed_ = false;
+    return driver_.make<ast::CompoundStmt>();
+  }
+  while (peek().kind != Kind::RBrace) {
+    ast::ASTNode* stmt = parseStatement();
+    if (failed_) {
+      return nullptr;
+    }
+    stmts.push_back(stmt);
+  }
+  consume();  // '}'
+
+  auto* compound = driver_.make<ast::CompoundStmt>();
+  compound->stmts = std::move(stmts);
+  return compound;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseStatement() {
+  Nesting nesting(*this);
+  if (nesting.exceeded()) {
+    return nullptr;
+  }
+  ast::ASTNode* stmt = parseStatementBody();
+  if (!failed_) {
+    return stmt;
+  }
+  // Running into the end of input leaves failed_ set, which aborts the parse.
+  if (!skipStatement()) {
+    return nullptr;
+  }
+  driver_.report("invalid statement");
+  failed_ = false;
+  return driver_.make<ast::ExprStmt>();
+}
+
+ast::ASTNode* RecursiveDescentParser::parseStatementBody() {
+  const Kind kind = peek().kind;
+  switch (kind) {
+    case Kind::LBrace:
+      return parseCompound();
+    case Kind::KwIf:
+      return parseIf();
+    case Kind::KwWhile:
+      return parseWhile();
+    case Kind::KwFor:
+      return parseFor();
+    case Kind::KwReturn:
+      return parseReturn();
+    case Kind::Semicolon:
+      consume();
+      return driver_.make<ast::ExprStmt>();
+    default:
+      break;
+  }
+
+  if (isTypeKeyword(kind)) {
+    const ast::Type* type = parseTypeSpecifier();
+    if (failed_) {
+      return nullptr;
+    }
+    if (peek().kind != Kind::Identifier) {
+      syntaxError(tokenName(Kind::Identifier));
+      return nullptr;
+    }
+    const support::Symbol name = consume().symbol;
+    ast::ASTNode* decl = parseDeclaration(type, name);
+    if (failed_ || !expect(Kind::Semicolon)) {
+      return nullptr;
+    }
+    return decl;
+  }
+
+  ast::ASTNode* expr = parseExpression();
+  if (failed_ || !expect(Kind::Semicolon)) {
+    return nullptr;
+  }
+  auto* stmt = driver_.make<ast::ExprStmt>();
+  stmt->expr = expr;
+  return stmt;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseIf() {
+  consume();  // 'if'
+  if (!expect(Kind::LParen)) {
+    return nullptr;
+  }
+  ast::ASTNode* cond = parseExpression();
+  if (failed_ || !expect(Kind::RParen)) {
+    return nullptr;
+  }
+  ast::ASTNode* then_branch = parseStatement();
+  if (failed_) {
+    return nullptr;
+  }
+  // A dangling else binds to the nearest if, as %prec LOWER_THAN_ELSE does.
+  ast::ASTNode* else_branch = nullptr;
+  if (accept(Kind::KwElse)) {
+    else_branch = parseStatement();
+    if (failed_) {
+      return nullptr;
+    }
+  }
+
+  auto* node = driver_.make<ast::IfStmt>();
+  node->cond = cond;
+  node->then_branch = then_branch;
+  node->else_branch = else_branch;
+  return node;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseWhile() {
+  consume();  // 'while'
+  if (!expect(Kind::LParen)) {
+    return nullptr;
+  }
+  ast::ASTNode* cond = parseExpression();
+  if (failed_ || !expect(Kind::RParen)) {
+    return nullptr;
+  }
+  ast::ASTNode* body = parseStatement();
+  if (failed_) {
+    return nullptr;
+  }
+
+  auto* node = driver_.make<ast::WhileStmt>();
+  node->cond = cond;
+  node->body = body;
+  return node;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseFor() {
+  consume();  // 'for'
+  if (!expect(Kind::LParen)) {
+    return nullptr;
+  }
+
+  ast::ASTNode* init = nullptr;
+  if (!accept(Kind::Semicolon)) {
+    if (isTypeKeyword(peek().kind)) {
+      const ast::Type* type = parseTypeSpecifier();
+      if (failed_) {
+        return nullptr;
+      }
+      if (peek().kind != Kind::Identifier) {
+        syntaxError(tokenName(Kind::Identifier));
+        return nullptr;
+      }
+      const support::Symbol name = consume().symbol;
+      init = parseDeclaration(type, name);
+    } else {
+      init = parseExpression();
+    }
+    if (failed_ || !expect(Kind::Semicolon)) {
+      return nullptr;
+    }
+  }
+
+  ast::ASTNode* cond = nullptr;
+  if (peek().kind != Kind::Semicolon) {
+    cond = parseExpression();
+    if (failed_) {
+      return nullptr;
+    }
+  }
+  if (!expect(Kind::Semicolon)) {
+    return nullptr;
+  }
+  ast::ASTNode* incr = nullptr;
+  if (peek().kind != Kind::RParen) {
+    incr = parseExpression();
+    if (failed_) {
+      return nullptr;
+    }
+  }
+  if (!expect(Kind::RParen)) {
+    return nullptr;
+  }
+  ast::ASTNode* body = parseStatement();
+  if (failed_) {
+    return nullptr;
+  }
+
+  auto* node = driver_.make<ast::ForStmt>();
+  node->init = init;
+  node->cond = cond;
+  node->incr = incr;
+  node->body = body;
+  return node;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseReturn() {
+  consume();  // 'return'
+  ast::ASTNode* value = nullptr;
+  if (!accept(Kind::Semicolon)) {
+    value = parseExpression();
+    if (failed_ || !expect(Kind::Semicolon)) {
+      return nullptr;
+    }
+  }
+
+  auto* node = driver_.make<ast::ReturnStmt>();
+  node->value = value;
+  return node;
+}
+
+// --- Expressions ---
+
+ast::ASTNode* RecursiveDescentParser::parseExpression() {
+  Nesting nesting(*this);
+  if (nesting.exceeded()) {
+    return nullptr;
+  }
+  ast::ASTNode* lhs = parseUnary();
+  if (failed_) {
+    return nullptr;
+  }
+  // Only a unary expression may be assigned to, so `a + b = c` stops at '='.
+  ast::BinaryOp op;
+  if (!assignmentOp(peek().kind, op)) {
+    return parseBinary(lhs, 1);
+  }
+  consume();
+  ast::ASTNode* rhs = parseExpression();
+  if (failed_) {
+    return nullptr;
+  }
+  auto* node = driver_.make<ast::BinaryExpr>();
+  node->op = op;
+  node->lhs = lhs;
+  node->rhs = rhs;
+  return node;
+}
+
+ast::ASTNode* RecursiveDescentParser::parseBinary(ast::ASTNode* lhs, int min_precedence) {
+  for (;;) {
+    ast::BinaryOp op;
+    const int precedence = binaryPrecedence(peek().kind, op);
+    if (precedence < min_precedence || precedence == 0) {
+      return lhs;
+    }
+    consume();
+    ast::ASTNode* rhs = parseUnary();
+    if (failed_) {
+      return nullptr;
+    }
+    ast::BinaryOp next;
+    if (binaryPrecedence(peek().kind, next) > precedence) {
+      rhs = parseBinary(rhs, precedence + 1);
+      if (failed_) {
+        return nullptr;
+      }
+    }
+
+    auto* node = driver_.make<ast::BinaryExpr>();
+    node->op = op;
+    node->lhs = lhs;
+    node->rhs = rhs;
+    lhs = node;
+  }
+}
+
+ast::ASTNode* RecursiveDescentParser::parseUnary() {
+  Nesting nesting(*this);
+  if (nesting.exceeded()) {
+    return nullptr;
+  }
+  ast::UnaryOp op;
+  switch (peek().kind) {
+    case Kind::Not:
+      op = ast::UnaryOp::Not;
+      break;
+    case Kind::Minus:
+      op = ast::UnaryOp::Neg;
+      break;
+    case Kind::Amp:
+      op = ast::UnaryOp::AddressOf;
+      break;
+    case Kind::Star:
+      op = ast::UnaryOp::Deref;
+      break;
+    default:
+      return parsePostfix();
+  }
+  consume();
+  ast::ASTNode* operand = parseUnary();
+  if (failed_) {
+    return nullptr;
+  }
+
+  auto* node = driver_.make<ast::UnaryExpr>();
+  node->op = op;
+  node->operand = operand;
+  return node;
+}
+
+ast::ASTNode* RecursiveDescentParser::parsePostfix() {
+  ast::ASTNode* expr = parsePrimary();
+  if (failed_) {
+    return nullptr;
+  }
+  for (;;) {
+    switch (peek().kind) {
+      case Kind::LParen: {
+        consume();
+        std::vector<ast::ASTNode*> args;
+        if (peek().kind != Kind::RParen) {
+          do {
+            ast::ASTNode* arg = parseExpression();
+            if (failed_) {
+              return nullptr;
+            }
+            args.push_back(arg);
+          } while (accept(Kind::Comma));
+        }
+        if (!expect(Kind::RParen)) {
+          return nullptr;
+        }
+        auto* call = driver_.make<ast::CallExpr>();
+        if (auto* var = ast::dyn_cast<ast::VarRef>(expr)) {
+          call->callee = var->name;
+        } else {
+          driver_.report("function call requires identifier callee");
+          call->callee = driver_.intern("<invalid>");
+        }
+        call->args = std::move(args);
+        expr = call;
+        break;
+      }
+      case Kind::LBracket: {
+        consume();
+        ast::ASTNode* index = parseExpression();
+        if (failed_ || !expect(Kind::RBracket)) {
+          return nullptr;
+        }
+        auto* sub = driver_.make<ast::ArraySubscript>();
+        sub->array = expr;
+        sub->index = index;
+        expr = sub;
+        break;
+      }
+      case Kind::Dot:
+      case Kind::Arrow: {
+        const bool is_arrow = consume().kind == Kind::Arrow;
+        if (peek().kind != Kind::Identifier) {
+          syntaxError(tokenName(Kind::Identifier));
+          return nullptr;
+        }
+        const support::Symbol name = consume().symbol;
+        auto* member = driver_.make<ast::MemberExpr>();
+        member->object = expr;
+        member->member = name;
+        member->is_arrow = is_arrow;
+        expr = member;
+        break;
+      }
+      default:
+        return expr;
+    }
+  }
+}
+
+ast::ASTNode* RecursiveDescentParser::parsePrimary() {
+  switch (peek().kind) {
+    case Kind::Identifier: {
+      const support::Symbol name = consume().symbol;
+      auto* ref = driver_.make<ast::VarRef>();
+      ref->name = name;
+      return ref;
+    }
+    case Kind::IntLiteral: {
+      const long long value = consume().value.int_val;
+      auto* lit = driver_.make<ast::IntLiteral>();
+      lit->value = value;
+      return lit;
+    }
+    case Kind::FloatLiteral: {
+      const double value = consume().value.float_val;
+      auto* lit = driver_.make<ast::FloatLiteral>();
+      lit->value = value;
+      return lit;
+    }
+    case Kind::CharLiteral: {
+      const long long value = consume().value.int_val;
+      auto* lit = driver_.make<ast::CharLiteral>();
+      lit->value = static_cast<char>(value);
+      return lit;
+    }
+    case Kind::StringLiteral: {
+      std::string value(consume().lexeme);
+      auto* lit = driver_.make<ast::StringLiteral>();
+      lit->value = std::move(value);
+      return lit;
+    }
+    case Kind::LParen: {
+      consume();
+      ast::ASTNode* expr = parseExpression();
+      if (failed_ || !expect(Kind::RParen)) {
+        return nullptr;
+      }
+      return expr;
+    }
+    default:
+      syntaxError();
+      return nullptr;
+  }
+}
+
+}  // namespace compiler::parser
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+
+#include "ast/ast.h"
+#include "parser/parser.h"
+
+namespace compiler::parser {
+
+/**
+ * Hand-written parser behind ParserKind::RecursiveDescent. It accepts the
+ * grammar of parser.y and builds the same AST: statements and declarations
+ * by recursive descent, binary operators by precedence climbing. Nodes are
+ * stamped with the line of the last token looked at when they are complete,
+ * which is the token Bison would have fetched by the same reduction.
+ *
+ * Like parser.y's error rules, a malformed statement or top-level
+ * declaration is reported and skipped through the next semicolon, and a
+ * block whose first token cannot start a statement through the next closing
+ * brace. Messages use Bison's wording but name at most one expected token.
+ *
+ * Unlike Bison's heap-allocated stack, the recursion here uses the native
+ * stack, so statements and expressions nested deeper than kMaxNesting are
+ * reported as errors and skipped like any other malformed statement.
+ */
+class RecursiveDescentParser {
+ public:
+  explicit RecursiveDescentParser(ParseDriver& driver) : driver_(driver) {}
+
+  /** Parses the whole input into the driver's result; false after syntax errors. */
+  bool parse();
+
+ private:
+  using Kind = lexer::Token::Kind;
+
+  /** Deepest nesting of statements, expressions and unary operators accepted. */
+  static constexpr int kMaxNesting = 1000;
+
+  /** Counts one level of nesting for as long as it lives. */
+  class Nesting {
+   public:
+    explicit Nesting(RecursiveDescentParser& parser) : parser_(parser) { ++parser_.depth_; }
+    ~Nesting() { --parser_.depth_; }
+
+    Nesting(const Nesting&) = delete;
+    Nesting& operator=(const Nesting&) = delete;
+
+    /** Reports a syntax error and returns true past kMaxNesting levels. */
+    bool exceeded();
+
+   private:
+    RecursiveDescentParser& parser_;
+  };
+
+  // Tokens.
+  const lexer::Token& peek();
+  const lexer::Token& consume();
+  bool accept(Kind kind);
+  bool expect(Kind kind);
+  void syntaxError(const char* expected = nullptr);
+  /** Skips through the next semicolon; false if the input ends first. */
+  bool skipStatement();
+
+  // Declarations.
+  ast::ASTNode* parseExternalDeclaration();
+  const ast::Type* parseTypeSpecifier();
+  const ast::Type* parsePointers(const ast::Type* type);
+  bool parseDimensions(std::vector<long long>& dimensions);
+  ast::ASTNode* parseStructDeclaration(support::Symbol name);
+  ast::ASTNode* parseFunction(const ast::Type* return_type, support::Symbol name);
+  ast::ASTNode* parseDeclaration(const ast::Type* type, support::Symbol name);
+
+  // Statements.
+  ast::CompoundStmt* parseCompound();
+  /**
+   * Parses a statement wherever parser.y expects one, which is also where its
+   * `error SEMICOLON` rule recovers: the innermost statement that fails is
+   * skipped through the next semicolon and replaced with an empty one.
+   */
+  ast::ASTNode* parseStatement();
+  ast::ASTNode* parseStatementBody();
+  ast::ASTNode* parseIf();
+  ast::ASTNode* parseWhile();
+  ast::ASTNode* parseFor();
+  ast::ASTNode* parseReturn();
+
+  // Expressions.
+  ast::ASTNode* parseExpression();
+  ast::ASTNode* parseBinary(ast::ASTNode* lhs, int min_precedence);
+  ast::ASTNode* parseUnary();
+  ast::ASTNode* parsePostfix();
+  ast::ASTNode* parsePrimary();
+
+  ParseDriver& driver_;
+  /** Set from a syntax error until the enclosing statement or declaration is skipped. */
+  bool failed_ = false;
+  /** Whether the invalid token under the cursor has been reported. */
+  bool invalid_reported_ = false;
+  /** Levels of Nesting currently alive. */
+  int depth_ = 0;
+};
+
+}  // namespace compiler::parser
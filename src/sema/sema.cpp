@@ -1,36 +1,573 @@
 #include "sema/sema.h"
 
+#include <utility>
+
+#include "support/instrumentation.h"
+
 namespace compiler::sema {
 
+namespace {
+
+ast::Expr& expr(ast::ASTNode* node) { return ast::cast<ast::Expr>(*node); }
+
+const ast::Type* typeOf(const ast::ASTNode* node) {
+  return ast::cast<ast::Expr>(*node).type;
+}
+
+std::string quote(const ast::Type* type) { return "'" + type->str() + "'"; }
+
+/** Integer literals with value zero; C's null pointer constants, minus the casts. */
+bool isNullConstant(const ast::ASTNode* node) {
+  if (const auto* lit = ast::dyn_cast<ast::IntLiteral>(node)) {
+    return lit->value == 0;
+  }
+  if (const auto* ch = ast::dyn_cast<ast::CharLiteral>(node)) {
+    return ch->value == 0;
+  }
+  return false;
+}
+
+std::string invalidOperands(ast::BinaryOp op, const ast::Type* lhs, const ast::Type* rhs) {
+  return std::string("invalid operands to binary '") + ast::spelling(op) + "' (" + quote(lhs) +
+         " and " + quote(rhs) + ")";
+}
+
+}  // namespace
+
 bool SemanticAnalyzer::analyze(ast::TranslationUnit& unit) {
+  support::TimeScope scope("sema");
   diagnostics_.clear();
+  if (unit.analyzed) {
+    return true;
+  }
+  context_ = unit.context.get();
+  types_ = &context_->types();
+  symbols_ = SymbolTable();
+  functions_.clear();
   unit.accept(*this);
-  return diagnostics_.empty();
-}
-
-const std::vector<std::string>& SemanticAnalyzer::diagnostics() const {
-  return diagnostics_;
-}
-
-void SemanticAnalyzer::visit(ast::TranslationUnit&) {}
-void SemanticAnalyzer::visit(ast::FunctionDecl&) {}
-void SemanticAnalyzer::visit(ast::VarDecl&) {}
-void SemanticAnalyzer::visit(ast::StructDecl&) {}
-void SemanticAnalyzer::visit(ast::CompoundStmt&) {}
-void SemanticAnalyzer::visit(ast::IfStmt&) {}
-void SemanticAnalyzer::visit(ast::WhileStmt&) {}
-void SemanticAnalyzer::visit(ast::ForStmt&) {}
-void SemanticAnalyzer::visit(ast::ReturnStmt&) {}
-void SemanticAnalyzer::visit(ast::ExprStmt&) {}
-void SemanticAnalyzer::visit(ast::BinaryExpr&) {}
-void SemanticAnalyzer::visit(ast::UnaryExpr&) {}
-void SemanticAnalyzer::visit(ast::CallExpr&) {}
-void SemanticAnalyzer::visit(ast::MemberExpr&) {}
-void SemanticAnalyzer::visit(ast::ArraySubscript&) {}
-void SemanticAnalyzer::visit(ast::IntLiteral&) {}
-void SemanticAnalyzer::visit(ast::FloatLiteral&) {}
-void SemanticAnalyzer::visit(ast::CharLiteral&) {}
-void SemanticAnalyzer::visit(ast::StringLiteral&) {}
-void SemanticAnalyzer::visit(ast::VarRef&) {}
+  unit.analyzed = diagnostics_.empty();
+  return unit.analyzed;
+}
+
+const std::vector<SemaError>& SemanticAnalyzer::diagnostics() const { return diagnostics_; }
+
+void SemanticAnalyzer::error(int line, std::string message) {
+  diagnostics_.push_back({line, std::move(message)});
+}
+
+// --- Declarations ----------------------------------------------------------
+
+void SemanticAnalyzer::visit(ast::TranslationUnit& unit) {
+  std::vector<ast::FunctionDecl*> bodies;
+  for (ast::ASTNode* decl : unit.decls) {
+    if (auto* fn = ast::dyn_cast<ast::FunctionDecl>(decl)) {
+      if (declareFunction(*fn)) {
+        bodies.push_back(fn);
+      }
+    } else {
+      decl->accept(*this);
+    }
+  }
+  for (ast::FunctionDecl* fn : bodies) {
+    fn->accept(*this);
+  }
+}
+
+bool SemanticAnalyzer::declareFunction(ast::FunctionDecl& decl) {
+  if (!functions_.emplace(decl.name, &decl).second) {
+    error(decl.line, "redefinition of function '" + std::string(decl.name.str()) + "'");
+    return false;
+  }
+  for (const auto& param : decl.params) {
+    if (!param.type->isComplete()) {
+      error(decl.line, "parameter '" + std::string(param.name.str()) + "' has incomplete type " +
+                           quote(param.type));
+      return false;
+    }
+  }
+  return true;
+}
+
+void SemanticAnalyzer::visit(ast::FunctionDecl& decl) {
+  support::TimeScope scope("sema", decl.name.str(), /*per_function=*/true);
+  current_function_ = &decl;
+  symbols_.enterScope();
+  for (const auto& param : decl.params) {
+    if (!symbols_.declare(param.name, param.type, &param)) {
+      error(decl.line, "redefinition of '" + std::string(param.name.str()) + "'");
+    }
+  }
+  // Parameters share the scope of the outermost block, as in C.
+  for (ast::ASTNode* stmt : decl.body->stmts) {
+    stmt->accept(*this);
+  }
+  symbols_.exitScope();
+  current_function_ = nullptr;
+}
+
+void SemanticAnalyzer::visit(ast::VarDecl& decl) {
+  const std::string name(decl.name.str());
+  if (!decl.type->isComplete()) {
+    error(decl.line, "variable '" + name + "' has incomplete type " + quote(decl.type));
+    return;
+  }
+  if (!symbols_.declare(decl.name, decl.type, &decl)) {
+    error(decl.line, "redefinition of '" + name + "'");
+    return;
+  }
+  if (decl.init != nullptr && checkRValue(decl.init) != nullptr) {
+    convert(decl.init, decl.type, decl.line);
+  }
+}
+
+void SemanticAnalyzer::visit(ast::StructDecl& decl) {
+  std::string message;
+  if (!types_->defineStruct(decl, message)) {
+    error(decl.line, std::move(message));
+  }
+}
+
+// --- Statements ------------------------------------------------------------
+
+void SemanticAnalyzer::visit(ast::CompoundStmt& stmt) {
+  symbols_.enterScope();
+  for (ast::ASTNode* child : stmt.stmts) {
+    child->accept(*this);
+  }
+  symbols_.exitScope();
+}
+
+void SemanticAnalyzer::visit(ast::IfStmt& stmt) {
+  checkCondition(stmt.cond);
+  stmt.then_branch->accept(*this);
+  if (stmt.else_branch != nullptr) {
+    stmt.else_branch->accept(*this);
+  }
+}
+
+void SemanticAnalyzer::visit(ast::WhileStmt& stmt) {
+  checkCondition(stmt.cond);
+  stmt.body->accept(*this);
+}
+
+void SemanticAnalyzer::visit(ast::ForStmt& stmt) {
+  symbols_.enterScope();
+  if (ast::isa<ast::VarDecl>(stmt.init)) {
+    stmt.init->accept(*this);
+  } else if (stmt.init != nullptr) {
+    checkRValue(stmt.init);
+  }
+  if (stmt.cond != nullptr) {
+    checkCondition(stmt.cond);
+  }
+  if (stmt.incr != nullptr) {
+    checkRValue(stmt.incr);
+  }
+  stmt.body->accept(*this);
+  symbols_.exitScope();
+}
+
+void SemanticAnalyzer::visit(ast::ReturnStmt& stmt) {
+  const ast::Type* expected = current_function_->return_type;
+  if (expected->isVoid()) {
+    if (stmt.value != nullptr) {
+      error(stmt.line, "void function should not return a value");
+    }
+  } else if (stmt.value == nullptr) {
+    error(stmt.line, "non-void function should return a value");
+  } else if (checkRValue(stmt.value) != nullptr) {
+    convert(stmt.value, expected, stmt.line);
+  }
+}
+
+void SemanticAnalyzer::visit(ast::ExprStmt& stmt) {
+  if (stmt.expr != nullptr) {
+    checkRValue(stmt.expr);
+  }
+}
+
+// --- Conversions -----------------------------------------------------------
+
+const ast::Type* SemanticAnalyzer::check(ast::ASTNode*& slot) {
+  slot->accept(*this);
+  return typeOf(slot);
+}
+
+const ast::Type* SemanticAnalyzer::checkRValue(ast::ASTNode*& slot) {
+  const ast::Type* type = check(slot);
+  if (type != nullptr && type->isArray()) {
+    castTo(slot, ast::CastKind::ArrayToPointerDecay, types_->pointerTo(type->element()));
+    return typeOf(slot);
+  }
+  return type;
+}
+
+bool SemanticAnalyzer::checkCondition(ast::ASTNode*& slot) {
+  const ast::Type* type = checkRValue(slot);
+  if (type == nullptr) {
+    return false;
+  }
+  if (!type->isScalar()) {
+    error(slot->line, "used type " + quote(type) + " where a scalar is required");
+    return false;
+  }
+  return true;
+}
+
+bool SemanticAnalyzer::convert(ast::ASTNode*& slot, const ast::Type* to, int line) {
+  const ast::Type* from = typeOf(slot);
+  if (from == to) {
+    return true;
+  }
+  if (from->isArithmetic() && to->isArithmetic()) {
+    if (!from->isInteger()) {
+      castTo(slot, ast::CastKind::FloatingToIntegral, to);
+    } else {
+      castTo(slot, to->isInteger() ? ast::CastKind::IntegralCast
+                                   : ast::CastKind::IntegralToFloating, to);
+    }
+    return true;
+  }
+  if (from->isPointer() && to->isPointer()) {
+    castTo(slot, ast::CastKind::BitCast, to);
+    return true;
+  }
+  if (from->isInteger() && to->isPointer() && isNullConstant(slot)) {
+    castTo(slot, ast::CastKind::NullToPointer, to);
+    return true;
+  }
+  error(line, "incompatible types: cannot convert " + quote(from) + " to " + quote(to));
+  return false;
+}
+
+void SemanticAnalyzer::castTo(ast::ASTNode*& slot, ast::CastKind kind, const ast::Type* to) {
+  auto* cast = context_->create<ast::ImplicitCastExpr>();
+  cast->line = slot->line;
+  cast->cast_kind = kind;
+  cast->operand = slot;
+  cast->type = to;
+  slot = cast;
+}
+
+// --- Expressions -----------------------------------------------------------
+
+const ast::Type* SemanticAnalyzer::checkArithmetic(ast::BinaryOp op, ast::ASTNode*& lhs,
+                                                   ast::ASTNode*& rhs, int line) {
+  const ast::Type* left = typeOf(lhs);
+  const ast::Type* right = typeOf(rhs);
+  if (op == ast::BinaryOp::Add && left->isInteger() && right->isPointer()) {
+    std::swap(lhs, rhs);
+    std::swap(left, right);
+  }
+  if ((op == ast::BinaryOp::Add || op == ast::BinaryOp::Sub) && left->isPointer()) {
+    if (!left->element()->isComplete()) {
+      error(line, "arithmetic on a pointer to incomplete type " + quote(left->element()));
+      return nullptr;
+    }
+    if (right->isInteger()) {
+      return left;
+    }
+    if (op == ast::BinaryOp::Sub && right == left) {
+      return types_->intType();
+    }
+  }
+
+  const bool is_float =
+      left == types_->floatType() || right == types_->floatType();
+  if (!left->isArithmetic() || !right->isArithmetic() || (is_float && op == ast::BinaryOp::Mod)) {
+    error(line, invalidOperands(op, left, right));
+    return nullptr;
+  }
+  const ast::Type* common = is_float ? types_->floatType() : types_->intType();
+  convert(lhs, common, line);
+  convert(rhs, common, line);
+  return common;
+}
+
+void SemanticAnalyzer::checkComparison(ast::BinaryExpr& node) {
+  const ast::Type* left = checkRValue(node.lhs);
+  const ast::Type* right = checkRValue(node.rhs);
+  if (left == nullptr || right == nullptr) {
+    return;
+  }
+  if (left->isArithmetic() && right->isArithmetic()) {
+    const bool is_float = left == types_->floatType() || right == types_->floatType();
+    const ast::Type* common = is_float ? types_->floatType() : types_->intType();
+    convert(node.lhs, common, node.line);
+    convert(node.rhs, common, node.line);
+  } else if (left->isPointer() || right->isPointer()) {
+    const ast::Type* pointer = left->isPointer() ? left : right;
+    if (!convert(node.lhs, pointer, node.line) || !convert(node.rhs, pointer, node.line)) {
+      return;
+    }
+  } else {
+    error(node.line, invalidOperands(node.op, left, right));
+    return;
+  }
+  node.type = types_->intType();
+}
+
+void SemanticAnalyzer::checkAssignment(ast::BinaryExpr& node) {
+  const ast::Type* target = check(node.lhs);
+  const ast::Type* value = checkRValue(node.rhs);
+  if (target == nullptr || value == nullptr) {
+    return;
+  }
+  if (!expr(node.lhs).is_lvalue) {
+    error(node.line, "expression is not assignable");
+    return;
+  }
+  if (target->isArray()) {
+    error(node.line, "array type " + quote(target) + " is not assignable");
+    return;
+  }
+
+  if (node.op == ast::BinaryOp::Assign) {
+    if (!convert(node.rhs, target, node.line)) {
+      return;
+    }
+  } else {
+    // `a op= b` computes `a op b` in the usual arithmetic type, then stores it
+    // back converted to the type of `a`; `a` itself is read, not converted.
+    const ast::BinaryOp op = ast::arithmeticOf(node.op);
+    const ast::Type* computation = nullptr;
+    if ((op == ast::BinaryOp::Add || op == ast::BinaryOp::Sub) && target->isPointer() &&
+        value->isInteger()) {
+      if (!target->element()->isComplete()) {
+        error(node.line,
+              "arithmetic on a pointer to incomplete type " + quote(target->element()));
+        return;
+      }
+      computation = target;
+    } else {
+      const bool is_float = target == types_->floatType() || value == types_->floatType();
+      if (!target->isArithmetic() || !value->isArithmetic()) {
+        error(node.line, invalidOperands(op, target, value));
+        return;
+      }
+      computation = is_float ? types_->floatType() : types_->intType();
+      convert(node.rhs, computation, node.line);
+    }
+    node.computation_type = computation;
+  }
+  node.type = target;
+}
+
+void SemanticAnalyzer::visit(ast::BinaryExpr& node) {
+  switch (node.op) {
+    case ast::BinaryOp::Assign:
+    case ast::BinaryOp::AddAssign:
+    case ast::BinaryOp::SubAssign:
+    case ast::BinaryOp::MulAssign:
+    case ast::BinaryOp::DivAssign:
+      checkAssignment(node);
+      break;
+    case ast::BinaryOp::LogicalAnd:
+    case ast::BinaryOp::LogicalOr: {
+      const bool lhs = checkCondition(node.lhs);
+      const bool rhs = checkCondition(node.rhs);
+      if (lhs && rhs) {
+        node.type = types_->intType();
+      }
+      break;
+    }
+    case ast::BinaryOp::Eq:
+    case ast::BinaryOp::Ne:
+    case ast::BinaryOp::Lt:
+    case ast::BinaryOp::Gt:
+    case ast::BinaryOp::Le:
+    case ast::BinaryOp::Ge:
+      checkComparison(node);
+      break;
+    default: {
+      const ast::Type* lhs = checkRValue(node.lhs);
+      const ast::Type* rhs = checkRValue(node.rhs);
+      if (lhs != nullptr && rhs != nullptr) {
+        node.type = checkArithmetic(node.op, node.lhs, node.rhs, node.line);
+      }
+      break;
+    }
+  }
+}
+
+void SemanticAnalyzer::visit(ast::UnaryExpr& node) {
+  switch (node.op) {
+    case ast::UnaryOp::Neg: {
+      const ast::Type* type = checkRValue(node.operand);
+      if (type == nullptr) {
+        return;
+      }
+      if (type == types_->floatType()) {
+        node.type = type;
+      } else if (type->isInteger()) {
+        convert(node.operand, types_->intType(), node.line);
+        node.type = types_->intType();
+      } else {
+        error(node.line, "invalid argument type " + quote(type) + " to unary '-'");
+      }
+      break;
+    }
+    case ast::UnaryOp::Not:
+      if (checkCondition(node.operand)) {
+        node.type = types_->intType();
+      }
+      break;
+    case ast::UnaryOp::AddressOf: {
+      const ast::Type* type = check(node.operand);
+      if (type == nullptr) {
+        return;
+      }
+      if (!expr(node.operand).is_lvalue) {
+        error(node.line, "cannot take the address of an rvalue of type " + quote(type));
+        return;
+      }
+      node.type = types_->pointerTo(type);
+      break;
+    }
+    case ast::UnaryOp::Deref: {
+      const ast::Type* type = checkRValue(node.operand);
+      if (type == nullptr) {
+        return;
+      }
+      if (!type->isPointer() || type->element()->isVoid()) {
+        error(node.line,
+              "indirection requires a non-void pointer operand (" + quote(type) + " invalid)");
+        return;
+      }
+      node.type = type->element();
+      node.is_lvalue = true;
+      break;
+    }
+  }
+}
+
+void SemanticAnalyzer::visit(ast::CallExpr& node) {
+  auto it = functions_.find(node.callee);
+  if (it == functions_.end()) {
+    // C89-style implicit declaration: `int name(...)`, so arguments get the
+    // default promotions. Widening float to double is left to the code generator.
+    bool ok = true;
+    for (ast::ASTNode*& arg : node.args) {
+      const ast::Type* type = checkRValue(arg);
+      if (type == nullptr) {
+        ok = false;
+      } else if (type == types_->charType()) {
+        convert(arg, types_->intType(), node.line);
+      }
+    }
+    if (ok) {
+      node.type = types_->intType();
+    }
+    return;
+  }
+
+  const ast::FunctionDecl& fn = *it->second;
+  if (node.args.size() != fn.params.size()) {
+    error(node.line, std::string(node.args.size() < fn.params.size() ? "too few" : "too many") +
+                         " arguments to function call, expected " +
+                         std::to_string(fn.params.size()) + ", have " +
+                         std::to_string(node.args.size()));
+    return;
+  }
+  bool ok = true;
+  for (std::size_t i = 0; i < node.args.size(); ++i) {
+    ok = checkRValue(node.args[i]) != nullptr &&
+         convert(node.args[i], fn.params[i].type, node.line) && ok;
+  }
+  if (ok) {
+    node.function = &fn;
+    node.type = fn.return_type;
+  }
+}
+
+void SemanticAnalyzer::visit(ast::MemberExpr& node) {
+  const ast::Type* record = nullptr;
+  if (node.is_arrow) {
+    const ast::Type* base = checkRValue(node.object);
+    if (base == nullptr) {
+      return;
+    }
+    if (!base->isPointer() || base->element()->asStruct() == nullptr) {
+      error(node.line, "member reference type " + quote(base) + " is not a pointer to a struct");
+      return;
+    }
+    record = base->element();
+  } else {
+    const ast::Type* base = check(node.object);
+    if (base == nullptr) {
+      return;
+    }
+    if (base->asStruct() == nullptr) {
+      error(node.line, "member reference base type " + quote(base) + " is not a struct");
+      return;
+    }
+    if (!expr(node.object).is_lvalue) {
+      error(node.line, "member access into a struct rvalue is not supported");
+      return;
+    }
+    record = base;
+  }
+
+  if (!record->isComplete()) {
+    error(node.line, "member access into incomplete type " + quote(record));
+    return;
+  }
+  const ast::Field* field = record->asStruct()->field(node.member);
+  if (field == nullptr) {
+    error(node.line, "no member named '" + std::string(node.member.str()) + "' in " +
+                         quote(record));
+    return;
+  }
+  node.field = field;
+  node.type = field->type;
+  node.is_lvalue = true;
+}
+
+void SemanticAnalyzer::visit(ast::ArraySubscript& node) {
+  const ast::Type* base = checkRValue(node.array);
+  const ast::Type* index = checkRValue(node.index);
+  if (base == nullptr || index == nullptr) {
+    return;
+  }
+  // `i[a]` means `a[i]`; keep the pointer on the left for the code generator.
+  if (base->isInteger() && index->isPointer()) {
+    std::swap(node.array, node.index);
+    std::swap(base, index);
+  }
+  if (!base->isPointer() || !index->isInteger()) {
+    error(node.line, "subscripted value is not an array or pointer");
+    return;
+  }
+  if (!base->element()->isComplete()) {
+    error(node.line, "subscript of pointer to incomplete type " + quote(base->element()));
+    return;
+  }
+  node.type = base->element();
+  node.is_lvalue = true;
+}
+
+void SemanticAnalyzer::visit(ast::VarRef& node) {
+  const ast::ValueDecl* decl = symbols_.resolve(node.name);
+  if (decl == nullptr) {
+    error(node.line, "use of undeclared identifier '" + std::string(node.name.str()) + "'");
+    return;
+  }
+  node.decl = decl;
+  node.type = decl->type;
+  node.is_lvalue = true;
+}
+
+void SemanticAnalyzer::visit(ast::IntLiteral& node) { node.type = types_->intType(); }
+
+void SemanticAnalyzer::visit(ast::FloatLiteral& node) { node.type = types_->floatType(); }
+
+void SemanticAnalyzer::visit(ast::CharLiteral& node) { node.type = types_->charType(); }
+
+void SemanticAnalyzer::visit(ast::StringLiteral& node) {
+  node.type = types_->pointerTo(types_->charType());
+}
+
+// Casts only exist once analysis has run, and they are annotated when created.
+void SemanticAnalyzer::visit(ast::ImplicitCastExpr&) {}
 
 }  // namespace compiler::sema
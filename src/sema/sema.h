@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "ast/ast.h"
@@ -8,14 +9,35 @@
 
 namespace compiler::sema {
 
-/** Semantic analyzer stub. */
+/** Diagnostic produced by semantic analysis. */
+struct SemaError {
+  int line = 0;
+  std::string message;
+};
+
+/**
+ * Resolves names, checks types and makes implicit conversions explicit, in a
+ * single traversal. Every expression is annotated with its type and whether it
+ * is an lvalue; variable references, calls and member accesses also record
+ * what they refer to, and ImplicitCastExpr nodes are inserted wherever C
+ * converts a value. The code generator lowers these annotations as they are
+ * and does no type checking of its own.
+ *
+ * As in the code generator, struct layouts, globals and function signatures
+ * are declared before any body is checked, so functions may call each other
+ * regardless of definition order. Each node is visited once and every lookup
+ * is constant time, so analysis is linear in the size of the AST.
+ */
 class SemanticAnalyzer : public ast::ASTVisitor {
  public:
-  /** Analyzes the translation unit and collects diagnostics. */
+  /**
+   * Analyzes the translation unit and collects diagnostics. On success the
+   * unit is marked analyzed; analyzing it again is a no-op.
+   */
   bool analyze(ast::TranslationUnit& unit);
 
   /** Returns diagnostics accumulated during analysis. */
-  const std::vector<std::string>& diagnostics() const;
+  const std::vector<SemaError>& diagnostics() const;
 
   void visit(ast::TranslationUnit&) override;
   void visit(ast::FunctionDecl&) override;
@@ -37,10 +59,37 @@ class SemanticAnalyzer : public ast::ASTVisitor {
   void visit(ast::CharLiteral&) override;
   void visit(ast::StringLiteral&) override;
   void visit(ast::VarRef&) override;
+  void visit(ast::ImplicitCastExpr&) override;
 
  private:
+  bool declareFunction(ast::FunctionDecl& decl);
+
+  // Expressions are checked through the slot that holds them, so conversions
+  // can be wrapped around them in place. Each returns the resulting type, or
+  // null after reporting an error.
+  const ast::Type* check(ast::ASTNode*& slot);
+  /** Like check, but arrays decay to a pointer to their first element. */
+  const ast::Type* checkRValue(ast::ASTNode*& slot);
+  /** Checks a controlling expression, which must be scalar. */
+  bool checkCondition(ast::ASTNode*& slot);
+  /** Converts an already checked rvalue to `to` as if by assignment. */
+  bool convert(ast::ASTNode*& slot, const ast::Type* to, int line);
+  void castTo(ast::ASTNode*& slot, ast::CastKind kind, const ast::Type* to);
+
+  /** Type of `lhs op rhs` for + - * / %; pointer operands end up on the left. */
+  const ast::Type* checkArithmetic(ast::BinaryOp op, ast::ASTNode*& lhs, ast::ASTNode*& rhs,
+                                   int line);
+  void checkComparison(ast::BinaryExpr& node);
+  void checkAssignment(ast::BinaryExpr& node);
+
+  void error(int line, std::string message);
+
+  ast::ASTContext* context_ = nullptr;
+  ast::TypeContext* types_ = nullptr;
   SymbolTable symbols_;
-  std::vector<std::string> diagnostics_;
+  std::unordered_map<ast::Symbol, const ast::FunctionDecl*> functions_;
+  const ast::FunctionDecl* current_function_ = nullptr;
+  std::vector<SemaError> diagnostics_;
 };
 
 }  // namespace compiler::sema
@@ -1,28 +1,117 @@
 #include "sema/symbol_table.h"
 
+#include <utility>
+
 namespace compiler::sema {
 
-void SymbolTable::enterScope() { scopes_.emplace_back(); }
+namespace {
+
+constexpr std::size_t kInitialSlots = 64;
+
+}  // namespace
+
+SymbolTable::SymbolTable() : slots_(kInitialSlots) {}
+
+void SymbolTable::enterScope() {
+  scope_marks_.push_back(static_cast<std::uint32_t>(bindings_.size()));
+}
 
 void SymbolTable::exitScope() {
-  if (scopes_.size() > 1) {
-    scopes_.pop_back();
+  if (scope_marks_.empty()) {
+    return;
+  }
+  const std::uint32_t mark = scope_marks_.back();
+  scope_marks_.pop_back();
+  while (bindings_.size() > mark) {
+    const Binding& binding = bindings_.back();
+    slots_[binding.slot].binding = binding.shadowed;
+    bindings_.pop_back();
+  }
+}
+
+bool SymbolTable::declare(support::Symbol name, const ast::Type* type,
+                          const ast::ValueDecl* decl) {
+  if (name.empty()) {
+    return false;
+  }
+  const std::uint32_t slot = insertSlot(name);
+  const std::uint32_t current = slots_[slot].binding;
+  const auto depth = static_cast<std::uint32_t>(scope_marks_.size());
+  if (current != kNone && bindings_[current].depth == depth) {
+    return false;
+  }
+  slots_[slot].binding = static_cast<std::uint32_t>(bindings_.size());
+  bindings_.push_back({type, decl, slot, depth, current});
+  return true;
+}
+
+const ast::Type* SymbolTable::lookup(support::Symbol name) const {
+  const Binding* binding = find(name);
+  return binding != nullptr ? binding->type : nullptr;
+}
+
+const ast::ValueDecl* SymbolTable::resolve(support::Symbol name) const {
+  const Binding* binding = find(name);
+  return binding != nullptr ? binding->decl : nullptr;
+}
+
+const SymbolTable::Binding* SymbolTable::find(support::Symbol name) const {
+  const std::uint32_t slot = findSlot(name);
+  if (slot == kNone || slots_[slot].binding == kNone) {
+    return nullptr;
   }
+  return &bindings_[slots_[slot].binding];
 }
 
-bool SymbolTable::declare(const std::string& name, const ast::TypeInfo& type) {
-  auto& scope = scopes_.back();
-  return scope.emplace(name, type).second;
+std::uint32_t SymbolTable::findSlot(support::Symbol name) const {
+  if (name.empty()) {
+    return kNone;
+  }
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = name.hash() & mask;; i = (i + 1) & mask) {
+    if (slots_[i].name == name) {
+      return static_cast<std::uint32_t>(i);
+    }
+    if (slots_[i].name.empty()) {
+      return kNone;
+    }
+  }
 }
 
-std::optional<ast::TypeInfo> SymbolTable::lookup(const std::string& name) const {
-  for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
-    auto found = it->find(name);
-    if (found != it->end()) {
-      return found->second;
+std::uint32_t SymbolTable::insertSlot(support::Symbol name) {
+  if ((used_ + 1) * 4 > slots_.size() * 3) {
+    grow();
+  }
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = name.hash() & mask;; i = (i + 1) & mask) {
+    if (slots_[i].name == name) {
+      return static_cast<std::uint32_t>(i);
+    }
+    if (slots_[i].name.empty()) {
+      slots_[i].name = name;
+      ++used_;
+      return static_cast<std::uint32_t>(i);
+    }
+  }
+}
+
+void SymbolTable::grow() {
+  std::vector<Slot> old = std::exchange(slots_, std::vector<Slot>(slots_.size() * 2));
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t from = 0; from < old.size(); ++from) {
+    if (old[from].name.empty()) {
+      continue;
+    }
+    std::size_t i = old[from].name.hash() & mask;
+    while (!slots_[i].name.empty()) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = old[from];
+    // Every live binding of this name, shadowed ones included, points back at its slot.
+    for (std::uint32_t b = slots_[i].binding; b != kNone; b = bindings_[b].shadowed) {
+      bindings_[b].slot = static_cast<std::uint32_t>(i);
     }
   }
-  return std::nullopt;
 }
 
 }  // namespace compiler::sema
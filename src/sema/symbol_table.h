@@ -1,31 +1,76 @@
 #pragma once
 
-#include <optional>
-#include <string>
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include "ast/ast.h"
+#include "support/string_interner.h"
 
 namespace compiler::sema {
 
-/** Scoped symbol table for semantic analysis. */
+/**
+ * Scoped symbol table for semantic analysis. One open-addressing table maps
+ * each name to its innermost binding; a binding remembers the one it shadows,
+ * and the binding stack doubles as the undo log that exitScope unwinds. Scope
+ * entry is O(1), exit is O(declarations in the scope), and lookup is a single
+ * probe no matter how deeply the current scope is nested.
+ */
 class SymbolTable {
  public:
+  SymbolTable();
+
   /** Enters a new lexical scope. */
   void enterScope();
 
-  /** Exits the current lexical scope. */
+  /** Exits the current lexical scope; the global scope is never exited. */
   void exitScope();
 
-  /** Declares a symbol in the current scope. */
-  bool declare(const std::string& name, const ast::TypeInfo& type);
+  /**
+   * Declares a symbol in the current scope; false if it is already declared
+   * there. `decl`, if given, is what resolve() returns for the name.
+   */
+  bool declare(support::Symbol name, const ast::Type* type,
+               const ast::ValueDecl* decl = nullptr);
+
+  /** Returns the type of the innermost visible binding, or null. */
+  const ast::Type* lookup(support::Symbol name) const;
 
-  /** Looks up a symbol through parent scopes. */
-  std::optional<ast::TypeInfo> lookup(const std::string& name) const;
+  /** Returns the declaration of the innermost visible binding, or null. */
+  const ast::ValueDecl* resolve(support::Symbol name) const;
+
+  /** Returns the number of enclosing scopes, zero for the global scope. */
+  std::size_t depth() const { return scope_marks_.size(); }
 
  private:
-  std::vector<std::unordered_map<std::string, ast::TypeInfo>> scopes_{{}};
+  static constexpr std::uint32_t kNone = UINT32_MAX;
+
+  struct Slot {
+    support::Symbol name;
+    /** Innermost binding of `name`, or kNone while it is out of scope. */
+    std::uint32_t binding = kNone;
+  };
+
+  struct Binding {
+    const ast::Type* type;
+    const ast::ValueDecl* decl;
+    std::uint32_t slot;
+    std::uint32_t depth;
+    /** Binding this one shadows; restored when the scope exits. */
+    std::uint32_t shadowed;
+  };
+
+  const Binding* find(support::Symbol name) const;
+  std::uint32_t findSlot(support::Symbol name) const;
+  std::uint32_t insertSlot(support::Symbol name);
+  void grow();
+
+  // Slots are never emptied, so probing needs no tombstones; the table only
+  // grows with the number of distinct names seen.
+  std::vector<Slot> slots_;
+  std::size_t used_ = 0;
+  std::vector<Binding> bindings_;
+  std::vector<std::uint32_t> scope_marks_;
 };
 
 }  // namespace compiler::sema
@@ -0,0 +1,53 @@
+#include "support/arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace compiler::support {
+
+Arena::~Arena() {
+  for (Cleanup* cleanup = cleanups_; cleanup != nullptr; cleanup = cleanup->next) {
+    cleanup->destroy(cleanup->object);
+  }
+  for (void* block : blocks_) {
+    std::free(block);
+  }
+}
+
+void* Arena::allocateSlow(std::size_t size, std::size_t align) {
+  const std::size_t needed = size + align;
+  std::size_t block_size = next_block_size_;
+  if (needed > block_size) {
+    block_size = needed;
+  } else {
+    next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+  }
+
+  void* block = std::malloc(block_size);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  blocks_.push_back(block);
+  bytes_reserved_ += block_size;
+
+  if (block_size != needed || cursor_ == nullptr) {
+    cursor_ = static_cast<char*>(block);
+    end_ = cursor_ + block_size;
+    return allocate(size, align);
+  }
+
+  // Oversized request: give it a dedicated block and keep bumping the current one.
+  auto aligned = (reinterpret_cast<std::uintptr_t>(block) + align - 1) &
+                 ~(static_cast<std::uintptr_t>(align) - 1);
+  return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::registerCleanup(void* object, void (*destroy)(void*)) {
+  auto* cleanup = static_cast<Cleanup*>(allocate(sizeof(Cleanup), alignof(Cleanup)));
+  cleanup->next = cleanups_;
+  cleanup->object = object;
+  cleanup->destroy = destroy;
+  cleanups_ = cleanup;
+}
+
+}  // namespace compiler::support
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace compiler::support {
+
+/**
+ * Bump-pointer arena. Objects are carved out of large blocks and released all
+ * at once when the arena is destroyed; destructors of non-trivial objects run
+ * in reverse construction order at that point.
+ */
+class Arena {
+ public:
+  Arena() = default;
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /** Returns uninitialized storage with the requested size and alignment. */
+  void* allocate(std::size_t size, std::size_t align) {
+    auto current = reinterpret_cast<std::uintptr_t>(cursor_);
+    std::uintptr_t aligned = (current + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    if (cursor_ == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(end_)) {
+      return allocateSlow(size, align);
+    }
+    cursor_ = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  /** Constructs a T inside the arena. */
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    void* storage = allocate(sizeof(T), alignof(T));
+    T* object = new (storage) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      registerCleanup(object, [](void* ptr) { static_cast<T*>(ptr)->~T(); });
+    }
+    return object;
+  }
+
+  /** Returns the number of bytes reserved from the system allocator. */
+  std::size_t bytesReserved() const { return bytes_reserved_; }
+
+  /** Returns the number of blocks obtained from the system allocator. */
+  std::size_t blockCount() const { return blocks_.size(); }
+
+ private:
+  struct Cleanup {
+    Cleanup* next;
+    void* object;
+    void (*destroy)(void*);
+  };
+
+  static constexpr std::size_t kInitialBlockSize = 64 * 1024;
+  static constexpr std::size_t kMaxBlockSize = 4 * 1024 * 1024;
+
+  void* allocateSlow(std::size_t size, std::size_t align);
+  void registerCleanup(void* object, void (*destroy)(void*));
+
+  std::vector<void*> blocks_;
+  char* cursor_ = nullptr;
+  char* end_ = nullptr;
+  Cleanup* cleanups_ = nullptr;
+  std::size_t next_block_size_ = kInitialBlockSize;
+  std::size_t bytes_reserved_ = 0;
+};
+
+}  // namespace compiler::support
@@ -0,0 +1,42 @@
+#include "support/buffered_writer.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace compiler::support {
+
+BufferedWriter::BufferedWriter(std::string& target) : out_(&target) {}
+
+BufferedWriter::BufferedWriter(std::FILE* file) : out_(&buffer_), file_(file) {
+  buffer_.reserve(kChunkSize + kChunkSize / 4);
+}
+
+BufferedWriter::~BufferedWriter() { flush(); }
+
+void BufferedWriter::writeInt(long long value) {
+  char digits[24];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  write(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+}
+
+void BufferedWriter::writeDouble(double value, int precision) {
+  // Sign, 17 digits, point and a four-character exponent fit with room to spare.
+  char digits[32];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value,
+                                    std::chars_format::general, std::min(precision, 17));
+  write(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+}
+
+bool BufferedWriter::flush() {
+  if (file_ == nullptr || buffer_.empty()) {
+    return !failed_;
+  }
+  if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size() ||
+      std::fflush(file_) != 0) {
+    failed_ = true;
+  }
+  buffer_.clear();
+  return !failed_;
+}
+
+}  // namespace compiler::support
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace compiler::support {
+
+/**
+ * Append-only output sink for bulk writers such as the AST dumper. Text
+ * accumulates in one contiguous buffer, and numbers are formatted in place,
+ * so no stream state or per-call locking is involved. A writer targets
+ * either a string, which simply grows, or a FILE*, which receives the buffer
+ * in large chunks whenever kChunkSize bytes are pending and on destruction.
+ */
+class BufferedWriter {
+ public:
+  static constexpr std::size_t kChunkSize = 64 * 1024;
+
+  /** Appends everything written to `target`. */
+  explicit BufferedWriter(std::string& target);
+
+  /** Writes to `file`, which must stay open for the writer's lifetime. */
+  explicit BufferedWriter(std::FILE* file);
+
+  ~BufferedWriter();
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+  void write(std::string_view bytes) {
+    out_->append(bytes.data(), bytes.size());
+    maybeFlush();
+  }
+
+  void put(char c) {
+    out_->push_back(c);
+    maybeFlush();
+  }
+
+  /** Writes `count` copies of `c`, e.g. for indentation. */
+  void fill(char c, std::size_t count) {
+    out_->append(count, c);
+    maybeFlush();
+  }
+
+  void writeInt(long long value);
+
+  /**
+   * Writes `value` as printf's %.<precision>g would. Precision is capped at
+   * 17 digits, which already round-trips every double.
+   */
+  void writeDouble(double value, int precision = 6);
+
+  /** Hands pending bytes to the file; false once any write has failed. */
+  bool flush();
+
+ private:
+  void maybeFlush() {
+    if (file_ != nullptr && out_->size() >= kChunkSize) {
+      flush();
+    }
+  }
+
+  std::string buffer_;
+  std::string* out_;
+  std::FILE* file_ = nullptr;
+  bool failed_ = false;
+};
+
+}  // namespace compiler::support
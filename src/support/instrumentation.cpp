@@ -0,0 +1,288 @@
+#include "support/instrumentation.h"
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// Plain integers so the allocator hooks never trigger TLS initialization.
+thread_local std::uint64_t t_allocations = 0;
+thread_local std::uint64_t t_allocated_bytes = 0;
+thread_local std::uint32_t t_thread_id = 0;
+std::atomic<std::uint32_t> g_next_thread_id{1};
+
+std::uint32_t currentThreadId() {
+  if (t_thread_id == 0) {
+    t_thread_id = g_next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  }
+  return t_thread_id;
+}
+
+void* allocate(std::size_t size, std::size_t align) {
+  ++t_allocations;
+  t_allocated_bytes += size;
+  if (size == 0) {
+    size = 1;
+  }
+  for (;;) {
+    void* ptr = nullptr;
+    if (align <= alignof(std::max_align_t)) {
+      ptr = std::malloc(size);
+    } else if (posix_memalign(&ptr, align, size) != 0) {
+      ptr = nullptr;
+    }
+    if (ptr != nullptr) {
+      return ptr;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+}  // namespace
+
+// Replacing the global allocation functions is the only way to count the
+// allocations made inside LLVM and the standard library. The nothrow forms
+// forward to these in libstdc++ and libc++, so they are counted as well.
+void* operator new(std::size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t align) {
+  return allocate(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align) {
+  return allocate(size, static_cast<std::size_t>(align));
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace compiler::support {
+
+namespace {
+
+double millis(std::uint64_t micros) { return static_cast<double>(micros) / 1000.0; }
+
+void writeJsonString(std::ostream& out, std::string_view text) {
+  out << '"';
+  for (const char c : text) {
+    switch (c) {
+      case '"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\n': out << "\\n"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out << escaped;
+        } else {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+std::uint64_t threadAllocationCount() { return t_allocations; }
+
+std::uint64_t threadAllocatedBytes() { return t_allocated_bytes; }
+
+std::uint64_t peakResidentKilobytes() {
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<std::uint64_t>(usage.ru_maxrss) / 1024;  // Reported in bytes.
+#else
+  return static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+}
+
+std::uint64_t threadCpuMicros() {
+  timespec ts{};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000 +
+         static_cast<std::uint64_t>(ts.tv_nsec) / 1000;
+}
+
+Instrumentation::Instrumentation() : origin_(std::chrono::steady_clock::now()) {}
+
+Instrumentation::~Instrumentation() { uninstall(); }
+
+void Instrumentation::install() { active_.store(this, std::memory_order_release); }
+
+void Instrumentation::uninstall() {
+  Instrumentation* expected = this;
+  active_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+}
+
+std::uint64_t Instrumentation::elapsedMicros() const {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now() - origin_)
+                                        .count());
+}
+
+void Instrumentation::record(TraceEvent event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(std::move(event));
+}
+
+std::vector<TraceEvent> Instrumentation::events() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return events_;
+}
+
+void Instrumentation::writeReport(std::ostream& out) const {
+  struct Totals {
+    std::string name;
+    std::uint64_t first_start = 0;
+    std::size_t count = 0;
+    std::uint64_t wall_us = 0;
+    std::uint64_t cpu_us = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t allocated_bytes = 0;
+    std::uint64_t peak_rss_kb = 0;
+  };
+
+  std::vector<TraceEvent> snapshot = events();
+  std::vector<Totals> phases;
+  std::unordered_map<std::string, std::size_t> index;
+  std::vector<const TraceEvent*> functions;
+  for (const TraceEvent& event : snapshot) {
+    if (event.per_function) {
+      functions.push_back(&event);
+      continue;
+    }
+    auto [it, inserted] = index.emplace(event.name, phases.size());
+    if (inserted) {
+      phases.push_back({event.name, event.start_us});
+    }
+    Totals& totals = phases[it->second];
+    totals.first_start = std::min(totals.first_start, event.start_us);
+    totals.count += 1;
+    totals.wall_us += event.wall_us;
+    totals.cpu_us += event.cpu_us;
+    totals.allocations += event.allocations;
+    totals.allocated_bytes += event.allocated_bytes;
+    totals.peak_rss_kb = std::max(totals.peak_rss_kb, event.peak_rss_kb);
+  }
+  std::stable_sort(phases.begin(), phases.end(), [](const Totals& lhs, const Totals& rhs) {
+    return lhs.first_start < rhs.first_start;
+  });
+
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "===" << std::string(73, '-') << "===\n"
+      << "                          Compiler phase time report\n"
+      << "===" << std::string(73, '-') << "===\n"
+      << "  Total elapsed: " << millis(elapsedMicros()) << " ms\n"
+      << "  Units compiled in parallel overlap; nested phases count toward their parent.\n\n";
+  out << std::left << "  " << std::setw(12) << "Phase" << std::right << std::setw(7) << "Count"
+      << std::setw(14) << "Wall (ms)" << std::setw(14) << "CPU (ms)" << std::setw(12) << "Allocs"
+      << std::setw(14) << "Alloc (KB)" << std::setw(16) << "Peak RSS (KB)" << "\n";
+  for (const Totals& phase : phases) {
+    out << std::left << "  " << std::setw(12) << phase.name << std::right << std::setw(7)
+        << phase.count << std::setw(14) << millis(phase.wall_us) << std::setw(14)
+        << millis(phase.cpu_us) << std::setw(12) << phase.allocations << std::setw(14)
+        << phase.allocated_bytes / 1024 << std::setw(16) << phase.peak_rss_kb << "\n";
+  }
+
+  if (!functions.empty()) {
+    constexpr std::size_t kMaxFunctions = 10;
+    std::stable_sort(functions.begin(), functions.end(),
+                     [](const TraceEvent* lhs, const TraceEvent* rhs) {
+                       return lhs->wall_us > rhs->wall_us;
+                     });
+    out << "\n  Slowest functions\n"
+        << std::left << "  " << std::setw(12) << "Phase" << std::setw(24) << "Function"
+        << std::right << std::setw(14) << "Wall (ms)" << std::setw(14) << "CPU (ms)"
+        << std::setw(12) << "Allocs" << "\n";
+    for (std::size_t i = 0; i < std::min(functions.size(), kMaxFunctions); ++i) {
+      const TraceEvent& fn = *functions[i];
+      out << std::left << "  " << std::setw(12) << fn.name << std::setw(24) << fn.detail
+          << std::right << std::setw(14) << millis(fn.wall_us) << std::setw(14)
+          << millis(fn.cpu_us) << std::setw(12) << fn.allocations << "\n";
+    }
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void Instrumentation::writeTrace(std::ostream& out) const {
+  std::vector<TraceEvent> snapshot = events();
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (const TraceEvent& event : snapshot) {
+    out << (first ? "\n" : ",\n");
+    first = false;
+    // Function events are named after the function so they read well in the
+    // timeline; the phase moves into the arguments.
+    out << "{\"name\":";
+    writeJsonString(out, event.per_function ? event.detail : event.name);
+    out << ",\"cat\":\"" << (event.per_function ? "function" : "phase") << "\""
+        << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start_us
+        << ",\"dur\":" << event.wall_us << ",\"args\":{";
+    out << (event.per_function ? "\"phase\":" : "\"detail\":");
+    writeJsonString(out, event.per_function ? event.name : event.detail);
+    out << ",\"cpu_us\":" << event.cpu_us << ",\"allocations\":" << event.allocations
+        << ",\"allocated_bytes\":" << event.allocated_bytes
+        << ",\"peak_rss_kb\":" << event.peak_rss_kb << "}}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+TimeScope::TimeScope(const char* name, std::string_view detail, bool per_function)
+    : sink_(Instrumentation::active()), name_(name), per_function_(per_function) {
+  if (sink_ == nullptr) {
+    return;
+  }
+  detail_ = std::string(detail);
+  start_us_ = sink_->elapsedMicros();
+  cpu_start_us_ = threadCpuMicros();
+  allocations_start_ = threadAllocationCount();
+  allocated_bytes_start_ = threadAllocatedBytes();
+}
+
+TimeScope::~TimeScope() {
+  if (sink_ == nullptr) {
+    return;
+  }
+  TraceEvent event;
+  event.name = name_;
+  event.detail = std::move(detail_);
+  event.per_function = per_function_;
+  event.thread = currentThreadId();
+  event.start_us = start_us_;
+  event.wall_us = sink_->elapsedMicros() - start_us_;
+  event.cpu_us = threadCpuMicros() - cpu_start_us_;
+  event.allocations = threadAllocationCount() - allocations_start_;
+  event.allocated_bytes = threadAllocatedBytes() - allocated_bytes_start_;
+  event.peak_rss_kb = peakResidentKilobytes();
+  sink_->record(std::move(event));
+}
+
+}  // namespace compiler::support
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace compiler::support {
+
+/** Returns the number of heap allocations made so far by the calling thread. */
+std::uint64_t threadAllocationCount();
+
+/** Returns the bytes requested by those allocations; frees do not subtract. */
+std::uint64_t threadAllocatedBytes();
+
+/** Returns the peak resident set size of the process, in kilobytes. */
+std::uint64_t peakResidentKilobytes();
+
+/** Returns the CPU time consumed so far by the calling thread, in microseconds. */
+std::uint64_t threadCpuMicros();
+
+/** One timed region: a whole compiler phase, or one function within a phase. */
+struct TraceEvent {
+  /** Phase name, e.g. "parse" or "codegen". */
+  std::string name;
+  /** Input file or function name the region worked on. */
+  std::string detail;
+  bool per_function = false;
+  std::uint32_t thread = 0;
+  std::uint64_t start_us = 0;
+  std::uint64_t wall_us = 0;
+  std::uint64_t cpu_us = 0;
+  std::uint64_t allocations = 0;
+  std::uint64_t allocated_bytes = 0;
+  /** Process high-water mark when the region ended. */
+  std::uint64_t peak_rss_kb = 0;
+};
+
+/**
+ * Collects trace events from every thread of a compilation. Instrumented code
+ * finds the collector through active(), so it costs a single atomic load when
+ * no collector is installed.
+ */
+class Instrumentation {
+ public:
+  Instrumentation();
+  ~Instrumentation();
+
+  Instrumentation(const Instrumentation&) = delete;
+  Instrumentation& operator=(const Instrumentation&) = delete;
+
+  /** Returns the installed collector, or null when instrumentation is off. */
+  static Instrumentation* active() { return active_.load(std::memory_order_acquire); }
+
+  /** Makes this the collector that TimeScope records into. */
+  void install();
+  void uninstall();
+
+  /** Microseconds since the collector was created; the trace's time origin. */
+  std::uint64_t elapsedMicros() const;
+
+  void record(TraceEvent event);
+
+  /** Returns a snapshot of the events recorded so far. */
+  std::vector<TraceEvent> events() const;
+
+  /** Writes the -ftime-report tables: totals per phase, then the slowest functions. */
+  void writeReport(std::ostream& out) const;
+
+  /** Writes Chrome trace-event JSON, loadable in Perfetto or chrome://tracing. */
+  void writeTrace(std::ostream& out) const;
+
+ private:
+  static inline std::atomic<Instrumentation*> active_{nullptr};
+
+  std::chrono::steady_clock::time_point origin_;
+  mutable std::mutex mutex_;
+  std::vector<TraceEvent> events_;
+};
+
+/**
+ * Records the enclosing block as a TraceEvent in the active collector. Does
+ * nothing, not even read a clock, when no collector is installed.
+ */
+class TimeScope {
+ public:
+  explicit TimeScope(const char* name, std::string_view detail = {}, bool per_function = false);
+  ~TimeScope();
+
+  TimeScope(const TimeScope&) = delete;
+  TimeScope& operator=(const TimeScope&) = delete;
+
+ private:
+  Instrumentation* sink_;
+  const char* name_;
+  std::string detail_;
+  bool per_function_;
+  std::uint64_t start_us_ = 0;
+  std::uint64_t cpu_start_us_ = 0;
+  std::uint64_t allocations_start_ = 0;
+  std::uint64_t allocated_bytes_start_ = 0;
+};
+
+}  // namespace compiler::support
@@ -0,0 +1,94 @@
+#include "support/source_buffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace compiler::support {
+
+SourceBuffer::~SourceBuffer() { release(); }
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      owned_(std::move(other.owned_)) {}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+  if (this != &other) {
+    release();
+    mapping_ = std::exchange(other.mapping_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    owned_ = std::move(other.owned_);
+  }
+  return *this;
+}
+
+void SourceBuffer::release() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, size_);
+    mapping_ = nullptr;
+  }
+  size_ = 0;
+  owned_.clear();
+}
+
+bool SourceBuffer::open(const std::string& path, std::string& error) {
+  release();
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error = std::strerror(errno);
+    return false;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      madvise(mapping, size, MADV_SEQUENTIAL);
+      mapping_ = mapping;
+      size_ = size;
+      ::close(fd);
+      return true;
+    }
+  }
+
+  char chunk[64 * 1024];
+  for (;;) {
+    const ssize_t count = ::read(fd, chunk, sizeof(chunk));
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error = std::strerror(errno);
+      ::close(fd);
+      return false;
+    }
+    if (count == 0) {
+      break;
+    }
+    owned_.append(chunk, static_cast<std::size_t>(count));
+  }
+  ::close(fd);
+  return true;
+}
+
+SourceBuffer SourceBuffer::fromString(std::string text) {
+  SourceBuffer buffer;
+  buffer.owned_ = std::move(text);
+  return buffer;
+}
+
+std::string_view SourceBuffer::contents() const {
+  if (mapping_ != nullptr) {
+    return std::string_view(static_cast<const char*>(mapping_), size_);
+  }
+  return owned_;
+}
+
+}  // namespace compiler::support
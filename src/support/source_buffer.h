@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace compiler::support {
+
+/**
+ * Read-only view of a source file. Regular files are memory-mapped; anything
+ * that cannot be mapped (pipes, empty files) is read into an owned string.
+ */
+class SourceBuffer {
+ public:
+  SourceBuffer() = default;
+  ~SourceBuffer();
+
+  SourceBuffer(SourceBuffer&& other) noexcept;
+  SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+  /** Opens `path`; returns false and fills `error` on failure. */
+  bool open(const std::string& path, std::string& error);
+
+  /** Wraps an in-memory copy of `text`. */
+  static SourceBuffer fromString(std::string text);
+
+  /** Returns the file contents. */
+  std::string_view contents() const;
+
+  /** Returns true when the contents are backed by a memory mapping. */
+  bool isMapped() const { return mapping_ != nullptr; }
+
+ private:
+  void release();
+
+  void* mapping_ = nullptr;
+  std::size_t size_ = 0;
+  std::string owned_;
+};
+
+}  // namespace compiler::support
@@ -0,0 +1,67 @@
+#include "support/string_interner.h"
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+namespace compiler::support {
+
+std::ostream& operator<<(std::ostream& out, Symbol symbol) { return out << symbol.str(); }
+
+std::size_t StringInterner::hashText(std::string_view text) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (const char c : text) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<std::size_t>(hash);
+}
+
+Symbol StringInterner::intern(std::string_view text) {
+  if (text.empty()) {
+    return Symbol();
+  }
+  if ((count_ + 1) * 4 > slots_.size() * 3) {
+    grow();
+  }
+
+  const std::size_t hash = hashText(text);
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Symbol::Entry* entry = slots_[i];
+    if (entry == nullptr) {
+      auto* fresh = static_cast<Symbol::Entry*>(
+          arena_.allocate(offsetof(Symbol::Entry, data) + text.size() + 1, alignof(Symbol::Entry)));
+      fresh->hash = hash;
+      fresh->length = static_cast<std::uint32_t>(text.size());
+      std::memcpy(fresh->data, text.data(), text.size());
+      fresh->data[text.size()] = '\0';
+      slots_[i] = fresh;
+      ++count_;
+      return Symbol(fresh);
+    }
+    if (entry->hash == hash && entry->length == text.size() &&
+        std::memcmp(entry->data, text.data(), text.size()) == 0) {
+      return Symbol(entry);
+    }
+  }
+}
+
+void StringInterner::grow() {
+  std::vector<const Symbol::Entry*> old = std::move(slots_);
+  slots_.assign(old.empty() ? 256 : old.size() * 2, nullptr);
+  const std::size_t mask = slots_.size() - 1;
+  for (const Symbol::Entry* entry : old) {
+    if (entry == nullptr) {
+      continue;
+    }
+    std::size_t i = entry->hash & mask;
+    while (slots_[i] != nullptr) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = entry;
+  }
+}
+
+}  // namespace compiler::support
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+#include "support/arena.h"
+
+namespace compiler::support {
+
+class StringInterner;
+
+/**
+ * Handle to an interned string. Two symbols from the same interner are equal
+ * exactly when their text is equal, so comparison and hashing are O(1).
+ */
+class Symbol {
+ public:
+  Symbol() = default;
+
+  /** Returns the interned text; valid for the lifetime of the interner. */
+  std::string_view str() const {
+    return entry_ == nullptr ? std::string_view() : std::string_view(entry_->data, entry_->length);
+  }
+
+  bool empty() const { return entry_ == nullptr; }
+
+  /** Returns the hash computed once at interning time. */
+  std::size_t hash() const { return entry_ == nullptr ? 0 : entry_->hash; }
+
+  friend bool operator==(Symbol lhs, Symbol rhs) { return lhs.entry_ == rhs.entry_; }
+  friend bool operator!=(Symbol lhs, Symbol rhs) { return lhs.entry_ != rhs.entry_; }
+
+ private:
+  friend class StringInterner;
+
+  struct Entry {
+    std::size_t hash;
+    std::uint32_t length;
+    char data[1];
+  };
+
+  explicit Symbol(const Entry* entry) : entry_(entry) {}
+
+  const Entry* entry_ = nullptr;
+};
+
+/** Compares the symbol's text against an arbitrary string. */
+inline bool operator==(Symbol lhs, std::string_view rhs) { return lhs.str() == rhs; }
+inline bool operator!=(Symbol lhs, std::string_view rhs) { return lhs.str() != rhs; }
+
+std::ostream& operator<<(std::ostream& out, Symbol symbol);
+
+/**
+ * Open-addressing string interner. Entries live in an arena and are never
+ * freed individually. Not thread-safe; each translation unit owns one.
+ */
+class StringInterner {
+ public:
+  StringInterner() = default;
+
+  StringInterner(const StringInterner&) = delete;
+  StringInterner& operator=(const StringInterner&) = delete;
+
+  /** Returns the unique symbol for `text`, inserting it on first use. */
+  Symbol intern(std::string_view text);
+
+  /** Returns the number of distinct strings interned so far. */
+  std::size_t size() const { return count_; }
+
+ private:
+  static std::size_t hashText(std::string_view text);
+  void grow();
+
+  Arena arena_;
+  std::vector<const Symbol::Entry*> slots_;
+  std::size_t count_ = 0;
+};
+
+}  // namespace compiler::support
+
+namespace std {
+
+template <>
+struct hash<compiler::support::Symbol> {
+  std::size_t operator()(compiler::support::Symbol symbol) const { return symbol.hash(); }
+};
+
+}  // namespace std
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "ast/ast.h"
+#include "ast/fingerprint.h"
+#include "parser/parser.h"
+#include "sema/sema.h"
+
+TEST(FingerprintTest, ChangesOnlyWithWhatTheFunctionLowersTo) {
+  const auto fingerprintOf = [](const std::string& source, const char* name) {
+    compiler::parser::Parser parser;
+    auto unit = parser.parse(source);
+    EXPECT_NE(unit, nullptr);
+    compiler::sema::SemanticAnalyzer analyzer;
+    EXPECT_TRUE(analyzer.analyze(*unit));
+    for (auto* decl : unit->decls) {
+      auto* fn = compiler::ast::dyn_cast<compiler::ast::FunctionDecl>(decl);
+      if (fn != nullptr && fn->name.str() == name) {
+        return compiler::ast::fingerprint(*fn);
+      }
+    }
+    ADD_FAILURE() << "no function " << name;
+    return std::string();
+  };
+
+  const std::string base =
+      "struct P { int x; int y; };\n"
+      "int get(struct P* p) { return p->y; }\n"
+      "int add(int a, int b) { return a + b; }\n"
+      "int main() { return add(1, 2); }\n";
+  const std::string main_fp = fingerprintOf(base, "main");
+  const std::string get_fp = fingerprintOf(base, "get");
+
+  // Moving a function or editing another body leaves it alone.
+  EXPECT_EQ(fingerprintOf("\n\n" + base, "main"), main_fp);
+  EXPECT_EQ(fingerprintOf("struct P { int x; int y; };\n"
+                          "int get(struct P* p) { return p->y; }\n"
+                          "int add(int a, int b) { return a - b; }\n"
+                          "int main() { return add(1, 2); }\n",
+                          "main"),
+            main_fp);
+
+  // A callee's prototype or a struct's layout is part of it.
+  EXPECT_NE(fingerprintOf("struct P { int x; int y; };\n"
+                          "int get(struct P* p) { return p->y; }\n"
+                          "int add(int a, float b) { return a + b; }\n"
+                          "int main() { return add(1, 2); }\n",
+                          "main"),
+            main_fp);
+  EXPECT_NE(fingerprintOf("struct P { char x; int y; };\n"
+                          "int get(struct P* p) { return p->y; }\n"
+                          "int main() { return 0; }\n",
+                          "get"),
+            get_fp);
+  EXPECT_NE(fingerprintOf("struct P { int x; int y; };\n"
+                          "int get(struct P* p) { return p->x; }\n"
+                          "int main() { return 0; }\n",
+                          "get"),
+            get_fp);
+}
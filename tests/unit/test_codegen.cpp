@@ -1,3 +1,195 @@
 #include <gtest/gtest.h>
 
-TEST(CodegenScaffoldTest, Placeholder) { EXPECT_TRUE(true); }
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "codegen/codegen.h"
+#include "codegen/emitter.h"
+#include "parser/parser.h"
+#include "sema/sema.h"
+
+namespace {
+
+using compiler::codegen::CodeGenerator;
+using compiler::codegen::EmitKind;
+using compiler::parser::Parser;
+using compiler::sema::SemanticAnalyzer;
+
+std::string printModule(llvm::Module& module) {
+  std::string text;
+  llvm::raw_string_ostream out(text);
+  module.print(out, nullptr);
+  return out.str();
+}
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TEST(CodegenTest, LowersFunctionsAndControlFlow) {
+  Parser parser;
+  auto unit = parser.parse(
+      "int counter = 3;\n"
+      "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+      "float scale(float x) { return x * 2.5; }\n"
+      "int main() {\n"
+      "  int total = 0;\n"
+      "  for (int i = 0; i < 10; i += 1) { total += fib(i); }\n"
+      "  while (total > 100 && counter != 0) { total = total - 7; counter -= 1; }\n"
+      "  if (!total || total % 2 == 0) { total = -total; } else { total = total / 3; }\n"
+      "  printf(\"%d %f\\n\", total, scale(1.0));\n"
+      "  return total;\n"
+      "}\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+
+  llvm::LLVMContext context;
+  CodeGenerator generator(context, "control_flow");
+  ASSERT_TRUE(generator.generate(*unit)) << generator.errors().front().message;
+
+  llvm::Module& module = generator.module();
+  ASSERT_NE(module.getFunction("fib"), nullptr);
+  EXPECT_FALSE(module.getFunction("fib")->isDeclaration());
+  EXPECT_TRUE(module.getFunction("printf")->isVarArg());
+  EXPECT_NE(module.getGlobalVariable("counter"), nullptr);
+  const std::string ir = printModule(module);
+  EXPECT_NE(ir.find("for.cond"), std::string::npos);
+  EXPECT_NE(ir.find("land.rhs"), std::string::npos);
+  EXPECT_NE(ir.find("fmul float"), std::string::npos);
+  EXPECT_NE(ir.find("fpext float"), std::string::npos);
+}
+
+TEST(CodegenTest, LowersStructsArraysAndPointers) {
+  Parser parser;
+  auto unit = parser.parse(
+      "struct Point { int x; int y; int tags[4]; };\n"
+      "int sum(struct Point* p) { return p->x + p->y + p->tags[2]; }\n"
+      "int main() {\n"
+      "  struct Point pt;\n"
+      "  int grid[3][3];\n"
+      "  int* cursor = &grid[1][0];\n"
+      "  pt.x = 1;\n"
+      "  pt.y = 2;\n"
+      "  pt.tags[2] = 4;\n"
+      "  *(cursor + 1) = sum(&pt);\n"
+      "  return grid[1][1];\n"
+      "}\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+
+  llvm::LLVMContext context;
+  CodeGenerator generator(context, "aggregates");
+  ASSERT_TRUE(generator.generate(*unit)) << generator.errors().front().message;
+  const std::string ir = printModule(generator.module());
+  EXPECT_NE(ir.find("%struct.Point = type { i32, i32, [4 x i32] }"), std::string::npos);
+  EXPECT_NE(ir.find("[3 x [3 x i32]]"), std::string::npos);
+}
+
+TEST(CodegenTest, StructBodiesMatchTheSharedLayout) {
+  Parser parser;
+  auto unit = parser.parse(
+      "struct Inner { char tag; float weights[3]; };\n"
+      "struct Outer { char c; struct Inner in; struct Outer* next; int n; };\n"
+      "struct Outer root;\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+
+  llvm::LLVMContext context;
+  CodeGenerator generator(context, "layout");
+  ASSERT_TRUE(generator.generate(*unit)) << generator.errors().front().message;
+
+  // LP64 data layout, as on the x86-64 and AArch64 targets we emit for.
+  const llvm::DataLayout layout("e-m:e-p:64:64-i64:64-n8:16:32:64-S128");
+  for (const char* name : {"Inner", "Outer"}) {
+    const auto* type = unit->context->types().structNamed(unit->context->intern(name));
+    auto* lowered = llvm::StructType::getTypeByName(context, std::string("struct.") + name);
+    ASSERT_NE(lowered, nullptr) << name;
+    const llvm::StructLayout* expected = layout.getStructLayout(lowered);
+    EXPECT_EQ(type->size(), expected->getSizeInBytes()) << name;
+    for (const auto& field : type->fields()) {
+      EXPECT_EQ(field.offset, expected->getElementOffset(field.index)) << name;
+    }
+  }
+}
+
+TEST(CodegenTest, LowersImplicitConversionsFromSema) {
+  Parser parser;
+  auto unit = parser.parse(
+      "float mix(char c, float f) { int i = f; f = c; f += i; return c + i; }\n"
+      "int main() { int a[4]; int* p = a; p += 2; return p - a; }\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+
+  llvm::LLVMContext context;
+  CodeGenerator generator(context, "conversions");
+  ASSERT_TRUE(generator.generate(*unit)) << generator.errors().front().message;
+  const std::string ir = printModule(generator.module());
+  EXPECT_NE(ir.find("fptosi float"), std::string::npos);
+  EXPECT_NE(ir.find("sitofp i8"), std::string::npos);
+  EXPECT_NE(ir.find("sext i8"), std::string::npos);
+  EXPECT_NE(ir.find("fadd float"), std::string::npos);
+  EXPECT_NE(ir.find("getelementptr inbounds [4 x i32]"), std::string::npos);
+  EXPECT_NE(ir.find("sdiv exact i64"), std::string::npos);
+}
+
+TEST(CodegenTest, RejectsUnanalyzedUnitsAndNonConstantGlobals) {
+  Parser parser;
+  auto unit = parser.parse("int seed = 3;\nint derived = seed;\n");
+  ASSERT_NE(unit, nullptr);
+
+  llvm::LLVMContext context;
+  CodeGenerator unanalyzed(context, "unanalyzed");
+  EXPECT_FALSE(unanalyzed.generate(*unit));
+  ASSERT_EQ(unanalyzed.errors().size(), 1U);
+  EXPECT_NE(unanalyzed.errors()[0].message.find("not been semantically analyzed"),
+            std::string::npos);
+
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+  CodeGenerator generator(context, "globals");
+  EXPECT_FALSE(generator.generate(*unit));
+  ASSERT_EQ(generator.errors().size(), 1U);
+  EXPECT_EQ(generator.errors()[0].line, 2);
+  EXPECT_NE(generator.errors()[0].message.find("not a compile-time constant"), std::string::npos);
+}
+
+TEST(CodegenTest, EmitsObjectIRAndBitcode) {
+  Parser parser;
+  auto unit = parser.parse("int square(int x) { return x * x; }\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+  ASSERT_TRUE(SemanticAnalyzer().analyze(*unit));
+
+  llvm::LLVMContext context;
+  CodeGenerator generator(context, "emit");
+  ASSERT_TRUE(generator.generate(*unit));
+
+  std::string error;
+  std::unique_ptr<llvm::TargetMachine> target = compiler::codegen::createHostTargetMachine(error);
+  ASSERT_NE(target, nullptr) << error;
+  compiler::codegen::configureModule(generator.module(), *target);
+
+  const std::string base = ::testing::TempDir() + "codegen_emit";
+  ASSERT_TRUE(compiler::codegen::emitModule(generator.module(), EmitKind::Object, base + ".o",
+                                            target.get(), error))
+      << error;
+  ASSERT_TRUE(compiler::codegen::emitModule(generator.module(), EmitKind::LLVMIR, base + ".ll",
+                                            nullptr, error));
+  ASSERT_TRUE(compiler::codegen::emitModule(generator.module(), EmitKind::Bitcode, base + ".bc",
+                                            nullptr, error));
+
+  EXPECT_FALSE(readFile(base + ".o").empty());
+  EXPECT_NE(readFile(base + ".ll").find("define i32 @square(i32"), std::string::npos);
+  EXPECT_EQ(readFile(base + ".bc").substr(0, 2), "BC");
+}
@@ -0,0 +1,623 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "driver/compile_cache.h"
+#include "driver/compile_server.h"
+#include "driver/driver.h"
+#include "driver/thread_pool.h"
+
+namespace {
+
+using compiler::driver::CompileCache;
+using compiler::driver::CompileServer;
+using compiler::driver::Driver;
+using compiler::driver::DriverOptions;
+using compiler::driver::ThreadPool;
+
+std::string writeTempSource(const std::string& name, const std::string& contents) {
+  const std::string path = ::testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary);
+  out << contents;
+  return path;
+}
+
+std::string runDriver(const std::vector<std::string>& inputs, unsigned jobs, int& status) {
+  DriverOptions options;
+  options.inputs = inputs;
+  options.jobs = jobs;
+  Driver driver(options);
+  std::ostringstream diag;
+  status = driver.run(diag);
+  return diag.str();
+}
+
+}  // namespace
+
+TEST(ThreadPoolTest, RunsEveryTaskIncludingNestedSubmissions) {
+  ThreadPool pool(4);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 64; ++i) {
+    pool.submit([&pool, &count] {
+      for (int j = 0; j < 8; ++j) {
+        pool.submit([&count] { count.fetch_add(1); });
+      }
+      count.fetch_add(1);
+    });
+  }
+  pool.wait();
+  EXPECT_EQ(count.load(), 64 * 9);
+}
+
+TEST(ThreadPoolTest, ResolvesDefaultConcurrency) {
+  EXPECT_EQ(ThreadPool::defaultConcurrency(3), 3U);
+  EXPECT_GE(ThreadPool::defaultConcurrency(0), 1U);
+}
+
+TEST(DriverTest, ParsesJobsAndInputs) {
+  DriverOptions options;
+  std::string error;
+  ASSERT_TRUE(compiler::driver::parseArguments({"-j", "4", "a.c", "-j2", "b.c"}, options, error));
+  EXPECT_EQ(options.jobs, 2U);
+  EXPECT_EQ(options.inputs, (std::vector<std::string>{"a.c", "b.c"}));
+
+  DriverOptions bad;
+  EXPECT_FALSE(compiler::driver::parseArguments({"-o", "out", "a.c", "b.c"}, bad, error));
+  EXPECT_FALSE(compiler::driver::parseArguments({"-j"}, bad, error));
+}
+
+TEST(DriverTest, DiagnosticsAreIndependentOfJobCount) {
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 40; ++i) {
+    std::string src = "int f" + std::to_string(i) + "(int a) { return a * " +
+                      std::to_string(i) + "; }\n";
+    if (i % 3 == 0) {
+      src += "int broken( {\n";
+    }
+    inputs.push_back(writeTempSource("driver_unit" + std::to_string(i) + ".c", src));
+  }
+  inputs.push_back(::testing::TempDir() + "does_not_exist.c");
+
+  int serial_status = 0;
+  int parallel_status = 0;
+  const std::string serial = runDriver(inputs, 1, serial_status);
+  const std::string parallel = runDriver(inputs, 8, parallel_status);
+
+  EXPECT_EQ(serial, parallel);
+  EXPECT_EQ(serial_status, 1);
+  EXPECT_EQ(parallel_status, 1);
+  EXPECT_NE(serial.find("driver_unit0.c"), std::string::npos);
+  EXPECT_NE(serial.find("cannot open"), std::string::npos);
+}
+
+TEST(DriverTest, SucceedsOnValidInput) {
+  const std::string path = writeTempSource("driver_ok.c", "int main() { return 0; }\n");
+  int status = 1;
+  EXPECT_EQ(runDriver({path}, 0, status), "");
+  EXPECT_EQ(status, 0);
+}
+
+TEST(DriverTest, WritesTimeReportAndTrace) {
+  const std::string path =
+      writeTempSource("driver_trace.c", "int helper(int x) { return x * 2; }\n"
+                                        "int main() { return helper(3); }\n");
+  const std::string trace = ::testing::TempDir() + "driver_trace.json";
+  DriverOptions options;
+  std::string error;
+  ASSERT_TRUE(compiler::driver::parseArguments(
+      {"-ftime-report", "-ftime-trace=" + trace, "-emit-llvm", "-O2", path}, options, error))
+      << error;
+  EXPECT_TRUE(options.time_report);
+  EXPECT_EQ(options.time_trace_path, trace);
+
+  Driver driver(options);
+  std::ostringstream diag;
+  EXPECT_EQ(driver.run(diag), 0) << diag.str();
+  for (const char* phase : {"compile", "parse", "sema", "fold", "codegen", "optimize", "emit"}) {
+    EXPECT_NE(diag.str().find(std::string("\n  ") + phase + " "), std::string::npos) << phase;
+  }
+
+  std::ifstream in(trace);
+  std::stringstream json;
+  json << in.rdbuf();
+  EXPECT_NE(json.str().find("\"name\":\"helper\""), std::string::npos);
+  EXPECT_NE(json.str().find("\"name\":\"optimize\""), std::string::npos);
+}
+
+TEST(DriverTest, DumpsAnnotatedASTAsJSON) {
+  const std::string path = writeTempSource("driver_dump.c", "int main() { return 'a' + 1; }\n");
+  const std::string output = ::testing::TempDir() + "driver_dump.json";
+  DriverOptions options;
+  std::string error;
+  ASSERT_TRUE(
+      compiler::driver::parseArguments({"-ast-dump=json", "-o", output, path}, options, error))
+      << error;
+  EXPECT_TRUE(options.ast_dump);
+  EXPECT_EQ(options.ast_dump_format, compiler::ast::DumpFormat::JSON);
+
+  Driver driver(options);
+  std::ostringstream diag;
+  EXPECT_EQ(driver.run(diag), 0) << diag.str();
+
+  std::ifstream in(output);
+  std::stringstream json;
+  json << in.rdbuf();
+  EXPECT_EQ(json.str().rfind("{\"kind\":\"TranslationUnit\"", 0), 0U) << json.str();
+  EXPECT_NE(json.str().find("\"kind\":\"ImplicitCastExpr\""), std::string::npos) << json.str();
+  EXPECT_NE(json.str().find("\"type\":\"int\""), std::string::npos) << json.str();
+
+  EXPECT_FALSE(compiler::driver::parseArguments({"-ast-dump=yaml", path}, options, error));
+}
+
+TEST(DriverTest, CompilesFromEmittedAST) {
+  const std::string path = writeTempSource(
+      "driver_ast.c", "int square(int x) { return x * x; }\nint main() { return square(7); }\n");
+  const std::string ast = ::testing::TempDir() + "driver_ast.ast";
+  const std::string from_source = ::testing::TempDir() + "driver_ast_source.ll";
+  const std::string from_ast = ::testing::TempDir() + "driver_ast_loaded.ll";
+
+  for (const auto& args : std::vector<std::vector<std::string>>{
+           {"-emit-ast", "-o", ast, path},
+           {"-emit-llvm", "-o", from_source, path},
+           {"-load-ast", "-emit-llvm", "-o", from_ast, ast},
+       }) {
+    DriverOptions options;
+    std::string error;
+    ASSERT_TRUE(compiler::driver::parseArguments(args, options, error)) << error;
+    Driver driver(options);
+    std::ostringstream diag;
+    ASSERT_EQ(driver.run(diag), 0) << diag.str();
+  }
+
+  const auto read = [](const std::string& file) {
+    std::ifstream in(file);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+  };
+  // The module is named after the input, so compare from the first definition on.
+  const std::string loaded_ir = read(from_ast);
+  const std::string source_ir = read(from_source);
+  ASSERT_NE(loaded_ir.find("define"), std::string::npos);
+  EXPECT_EQ(loaded_ir.substr(loaded_ir.find("define")),
+            source_ir.substr(source_ir.find("define")));
+
+  DriverOptions options;
+  options.inputs = {path};
+  options.load_ast = true;
+  std::ostringstream diag;
+  EXPECT_EQ(Driver(options).run(diag), 1);
+  EXPECT_NE(diag.str().find("not a serialized AST"), std::string::npos) << diag.str();
+}
+
+TEST(DriverTest, ReusesCachedOutputs) {
+  const std::string cache_dir = ::testing::TempDir() + "driver_cache";
+  std::filesystem::remove_all(cache_dir);
+  const std::string path = writeTempSource("driver_cached.c", "int main() { return 6 * 7; }\n");
+  const std::string output = ::testing::TempDir() + "driver_cached.ll";
+
+  DriverOptions options;
+  std::string error;
+  ASSERT_TRUE(compiler::driver::parseArguments(
+      {"-emit-llvm", "-fcache-dir=" + cache_dir, "-fcache-size=64M", "-o", output, path}, options,
+      error))
+      << error;
+  EXPECT_EQ(options.cache_limit, std::uint64_t{64} << 20);
+  EXPECT_FALSE(compiler::driver::parseArguments({"-fcache-size=12X", path}, options, error));
+
+  const auto compile = [&](const DriverOptions& opts) {
+    std::filesystem::remove(output);
+    const compiler::driver::UnitResult result = Driver(opts).compileUnit(path);
+    EXPECT_TRUE(result.success) << result.diagnostics;
+    std::ifstream in(output);
+    std::stringstream text;
+    text << in.rdbuf();
+    return std::make_pair(result.cache_hit, text.str());
+  };
+
+  const auto first = compile(options);
+  EXPECT_FALSE(first.first);
+  EXPECT_NE(first.second.find("define"), std::string::npos);
+  const auto second = compile(options);
+  EXPECT_TRUE(second.first);
+  EXPECT_EQ(second.second, first.second);
+
+  // Anything that changes the output changes the key.
+  options.opt_level = compiler::optimizer::OptLevel::O2;
+  EXPECT_FALSE(compile(options).first);
+  writeTempSource("driver_cached.c", "int main() { return 6 * 9; }\n");
+  EXPECT_FALSE(compile(options).first);
+  EXPECT_TRUE(compile(options).first);
+
+  // Units only store; run() trims the cache once after the whole batch.
+  const auto entries = [&] {
+    int count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir)) {
+      count += entry.path().filename() != "lock" ? 1 : 0;
+    }
+    return count;
+  };
+  options.cache_limit = 1;
+  options.opt_level = compiler::optimizer::OptLevel::O1;
+  EXPECT_TRUE(Driver(options).compileUnit(path).cache_stored);
+  EXPECT_EQ(entries(), 4);
+  options.inputs = {path};
+  options.opt_level = compiler::optimizer::OptLevel::O3;
+  std::ostringstream diag;
+  EXPECT_EQ(Driver(options).run(diag), 0) << diag.str();
+  EXPECT_EQ(entries(), 0);
+
+  // Standard output is not a file the cache can copy from or to.
+  options.output = "-";
+  for (int i = 0; i < 2; ++i) {
+    const compiler::driver::UnitResult result = Driver(options).compileUnit(path);
+    EXPECT_TRUE(result.success) << result.diagnostics;
+    EXPECT_FALSE(result.cache_hit);
+    EXPECT_FALSE(result.cache_stored);
+  }
+  EXPECT_EQ(entries(), 0);
+}
+
+TEST(DriverTest, CompileCacheEvictsLeastRecentlyUsed) {
+  namespace fs = std::filesystem;
+  const std::string dir = ::testing::TempDir() + "driver_cache_lru";
+  fs::remove_all(dir);
+  const std::string blob = writeTempSource("driver_cache_blob", std::string(100, 'x'));
+  const CompileCache cache(dir, 250);
+  std::string error;
+
+  const std::string a = CompileCache::key("a", "config");
+  const std::string b = CompileCache::key("b", "config");
+  const std::string c = CompileCache::key("c", "config");
+  EXPECT_EQ(a.size(), 32U);
+  EXPECT_NE(a, CompileCache::key("a", "other config"));
+  ASSERT_TRUE(cache.store(a, blob, error)) << error;
+  ASSERT_TRUE(cache.store(b, blob, error)) << error;
+
+  const auto now = fs::file_time_type::clock::now();
+  fs::last_write_time(fs::path(dir) / a, now - std::chrono::seconds(20));
+  fs::last_write_time(fs::path(dir) / b, now - std::chrono::seconds(10));
+  const std::string stale = dir + "/" + c + ".tmp.1.0";
+  const std::string fresh = dir + "/" + c + ".tmp.2.0";
+  std::ofstream(stale) << "interrupted";
+  std::ofstream(fresh) << "in progress";
+  fs::last_write_time(stale, now - std::chrono::hours(2));
+
+  // The hit makes `a` the most recently used, so trimming after storing `c` evicts `b`.
+  EXPECT_TRUE(cache.fetch(a, ::testing::TempDir() + "driver_cache_hit"));
+  EXPECT_FALSE(cache.fetch(c, ::testing::TempDir() + "driver_cache_miss"));
+  ASSERT_TRUE(cache.store(c, blob, error)) << error;
+  EXPECT_TRUE(fs::exists(fs::path(dir) / b));
+  cache.trim();
+  EXPECT_TRUE(fs::exists(fs::path(dir) / a));
+  EXPECT_FALSE(fs::exists(fs::path(dir) / b));
+  EXPECT_TRUE(fs::exists(fs::path(dir) / c));
+  EXPECT_FALSE(fs::exists(stale));
+  EXPECT_TRUE(fs::exists(fresh));
+}
+
+TEST(DriverTest, RebuildsOnlyChangedFunctions) {
+  const std::string cache_dir = ::testing::TempDir() + "driver_incremental";
+  std::filesystem::remove_all(cache_dir);
+  const std::string output = ::testing::TempDir() + "driver_incremental.ll";
+  const auto source = [](const std::string& answer) {
+    return "int counter = 1;\n"
+           "int twice(int x) { return 2 * x; }\n"
+           "int answer() { return " + answer + "; }\n"
+           "int main() { counter = twice(counter); return answer() + counter; }\n";
+  };
+  const std::string path = writeTempSource("driver_incremental.c", source("6 * 7"));
+
+  DriverOptions options;
+  std::string error;
+  EXPECT_FALSE(compiler::driver::parseArguments({"-fincremental", path}, options, error));
+  EXPECT_NE(error.find("-fcache-dir"), std::string::npos) << error;
+  options = DriverOptions();
+  ASSERT_TRUE(compiler::driver::parseArguments(
+      {"-O1", "-emit-llvm", "-fincremental", "-fcache-dir=" + cache_dir, "-o", output, path},
+      options, error))
+      << error;
+
+  const auto compile = [&] {
+    const compiler::driver::UnitResult result = Driver(options).compileUnit(path);
+    EXPECT_TRUE(result.success) << result.diagnostics;
+    EXPECT_FALSE(result.cache_hit);
+    std::ifstream in(output);
+    std::stringstream text;
+    text << in.rdbuf();
+    return std::make_pair(result.functions_reused, text.str());
+  };
+
+  const auto first = compile();
+  EXPECT_EQ(first.first, 0U);
+  EXPECT_NE(first.second.find("@counter = global i32 1"), std::string::npos) << first.second;
+  EXPECT_NE(first.second.find("ret i32 42"), std::string::npos) << first.second;
+
+  // Only answer() changed; twice() and main() come from the cache.
+  writeTempSource("driver_incremental.c", source("6 * 9"));
+  const auto second = compile();
+  EXPECT_EQ(second.first, 2U);
+  EXPECT_NE(second.second.find("ret i32 54"), std::string::npos) << second.second;
+  EXPECT_NE(second.second.find("define i32 @main()"), std::string::npos) << second.second;
+  EXPECT_NE(second.second.find("define i32 @twice(i32"), std::string::npos) << second.second;
+}
+
+TEST(DriverTest, GeneratesCodeInPartitions) {
+  const std::string path = writeTempSource(
+      "driver_partitions.c",
+      "int counter = 1;\n"
+      "char* greeting = \"hi\";\n"
+      "int twice(int x) { return 2 * x; }\n"
+      "int thrice(int x) { return 3 * x; }\n"
+      "int length(char* s) { int n = 0; while (s[n]) n = n + 1; return n; }\n"
+      "int main() { return twice(counter) + thrice(length(greeting)); }\n");
+  const std::string output = ::testing::TempDir() + "driver_partitions.ll";
+  const auto read = [](const std::string& file) {
+    std::ifstream in(file);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+  };
+  const auto count = [](const std::string& text, const std::string& needle) {
+    std::size_t found = 0;
+    for (auto at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+      ++found;
+    }
+    return found;
+  };
+
+  DriverOptions options;
+  std::string error;
+  EXPECT_FALSE(compiler::driver::parseArguments({"-fsplit-objects", path}, options, error));
+  EXPECT_NE(error.find("-fcodegen-partitions"), std::string::npos) << error;
+  options = DriverOptions();
+  ASSERT_TRUE(compiler::driver::parseArguments(
+      {"-emit-llvm", "-fcodegen-partitions=3", "-o", output, path}, options, error))
+      << error;
+  compiler::driver::UnitResult result = Driver(options).compileUnit(path);
+  ASSERT_TRUE(result.success) << result.diagnostics;
+
+  // Linked back together, every function and global is defined exactly once.
+  const std::string linked = read(output);
+  for (const char* name : {"@twice(", "@thrice(", "@length(", "@main("}) {
+    EXPECT_EQ(count(linked, std::string("define i32 ") + name), 1U) << name << "\n" << linked;
+  }
+  EXPECT_EQ(count(linked, "@counter = global i32 1"), 1U) << linked;
+  EXPECT_EQ(count(linked, "c\"hi\\00\""), 1U) << linked;
+
+  // Split, the first partition owns the globals and the others refer to them.
+  options.split_objects = true;
+  result = Driver(options).compileUnit(path);
+  ASSERT_TRUE(result.success) << result.diagnostics;
+  const std::string first = read(::testing::TempDir() + "driver_partitions.0.ll");
+  const std::string last = read(::testing::TempDir() + "driver_partitions.2.ll");
+  EXPECT_NE(first.find("@counter = global i32 1"), std::string::npos) << first;
+  EXPECT_NE(first.find("define i32 @twice("), std::string::npos) << first;
+  EXPECT_NE(last.find("@counter = external global i32"), std::string::npos) << last;
+  EXPECT_NE(last.find("define i32 @main("), std::string::npos) << last;
+  EXPECT_EQ(last.find("define i32 @twice("), std::string::npos) << last;
+  EXPECT_EQ(last.find("c\"hi\\00\""), std::string::npos) << last;
+
+  // Every partition lowers the globals, but their errors are reported once.
+  const std::string bad = writeTempSource(
+      "driver_partitions_bad.c",
+      "int one() { return 1; }\nint two = one();\nint main() { return two; }\n");
+  options = DriverOptions();
+  options.codegen_partitions = 2;
+  options.emit = compiler::codegen::EmitKind::LLVMIR;
+  result = Driver(options).compileUnit(bad);
+  EXPECT_FALSE(result.success);
+  EXPECT_EQ(count(result.diagnostics, "not a compile-time constant"), 1U) << result.diagnostics;
+}
+
+TEST(DriverTest, RunsMainInProcess) {
+  const std::string path = writeTempSource(
+      "driver_run.c",
+      "int twice(int x) { return 2 * x; }\n"
+      "int main(int argc, char** argv) { return twice(argc) + abs(-30) + argv[2][0] - 'a'; }\n");
+
+  DriverOptions options;
+  std::string error;
+  ASSERT_TRUE(compiler::driver::parseArguments({"-O2", "-run", path, "--", "x", "d"}, options,
+                                               error))
+      << error;
+  EXPECT_EQ(options.inputs, std::vector<std::string>{path});
+  EXPECT_EQ(options.run_args, (std::vector<std::string>{"x", "d"}));
+
+  // argv is the input path then the arguments after "--"; abs comes from libc.
+  std::ostringstream diag;
+  EXPECT_EQ(Driver(options).run(diag), 2 * 3 + 30 + 3) << diag.str();
+  EXPECT_EQ(diag.str(), "");
+
+  const std::string no_main = writeTempSource("driver_run_lib.c", "int f() { return 1; }\n");
+  options = DriverOptions();
+  options.inputs = {no_main};
+  options.run = true;
+  const compiler::driver::UnitResult result = Driver(options).compileUnit(no_main);
+  EXPECT_FALSE(result.success);
+  EXPECT_NE(result.diagnostics.find("no 'main' function"), std::string::npos)
+      << result.diagnostics;
+
+  EXPECT_FALSE(compiler::driver::parseArguments({path, "--", "x"}, options, error));
+  EXPECT_NE(error.find("-run"), std::string::npos) << error;
+}
+
+TEST(CompileServerTest, CompilesRequestsFromClients) {
+  const std::string socket = ::testing::TempDir() + "compile_server.sock";
+  const std::string path = writeTempSource("server_input.c", "int main() { return 6 * 7; }\n");
+  const std::string ir = ::testing::TempDir() + "server_output.ll";
+  const std::string object = ::testing::TempDir() + "server_output.o";
+  std::filesystem::remove(ir);
+  std::filesystem::remove(object);
+
+  int status = -1;
+  std::string diagnostics;
+  std::string error;
+  {
+    CompileServer server(socket);
+    ASSERT_TRUE(server.open(error)) << error;
+    using std::filesystem::perms;
+    const perms mode = std::filesystem::status(socket).permissions();
+    EXPECT_EQ(mode & (perms::group_all | perms::others_all), perms::none);
+    std::thread serving([&server] { server.serve(); });
+    const auto request = [&](const std::vector<std::string>& args) {
+      status = -1;
+      diagnostics.clear();
+      EXPECT_TRUE(compiler::driver::sendCompileRequest(socket, args, status, diagnostics, error))
+          << error;
+    };
+
+    request({"-emit-llvm", "-o", ir, path});
+    EXPECT_EQ(status, 0) << diagnostics;
+    EXPECT_TRUE(std::filesystem::exists(ir));
+
+    // Later requests reuse the target machine the first object compile made.
+    for (int i = 0; i < 2; ++i) {
+      request({"-O2", "-o", object, path});
+      EXPECT_EQ(status, 0) << diagnostics;
+      EXPECT_TRUE(std::filesystem::exists(object));
+    }
+
+    request({"-bogus", path});
+    EXPECT_EQ(status, 1);
+    EXPECT_NE(diagnostics.find("unknown option '-bogus'"), std::string::npos) << diagnostics;
+
+    request({"-run", path});
+    EXPECT_EQ(status, 1);
+    EXPECT_NE(diagnostics.find("not available"), std::string::npos) << diagnostics;
+
+    // Standard output would be the server's, not the client's.
+    request({"-emit-llvm", "-o", "-", path});
+    EXPECT_EQ(status, 1);
+    EXPECT_NE(diagnostics.find("'-o -' is not available"), std::string::npos) << diagnostics;
+
+    // A second server must not take the socket from a live one.
+    CompileServer second(socket);
+    EXPECT_FALSE(second.open(error));
+    EXPECT_NE(error.find("in use"), std::string::npos) << error;
+    request({"-emit-llvm", "-o", ir, path});
+    EXPECT_EQ(status, 0) << diagnostics;
+
+    server.stop();
+    serving.join();
+  }
+
+  EXPECT_FALSE(std::filesystem::exists(socket));
+  EXPECT_FALSE(
+      compiler::driver::sendCompileRequest(socket, {path}, status, diagnostics, error));
+  EXPECT_NE(error.find("cannot connect"), std::string::npos) << error;
+}
+
+TEST(CompileServerTest, ResolvesARelativeSocketPathOnce) {
+  const std::filesystem::path home = std::filesystem::current_path();
+  const std::filesystem::path client = std::filesystem::path(::testing::TempDir()) / "client";
+  std::filesystem::create_directories(client);
+  std::ofstream(client / "relative.c") << "int main() { return 0; }\n";
+  std::filesystem::current_path(::testing::TempDir());
+  const std::filesystem::path socket = std::filesystem::absolute("relative_server.sock");
+
+  int status = -1;
+  std::string diagnostics;
+  std::string error;
+  {
+    CompileServer server("relative_server.sock");
+    ASSERT_TRUE(server.open(error)) << error;
+    std::thread serving([&server] { server.serve(); });
+
+    // The request runs in the client's directory and leaves the server in its own.
+    std::filesystem::current_path(client);
+    EXPECT_TRUE(compiler::driver::sendCompileRequest(
+        socket.string(), {"-emit-llvm", "-o", "relative.ll", "relative.c"}, status, diagnostics,
+        error))
+        << error;
+    EXPECT_EQ(status, 0) << diagnostics;
+    EXPECT_TRUE(std::filesystem::exists(client / "relative.ll"));
+    EXPECT_TRUE(std::filesystem::equivalent(std::filesystem::current_path(), client));
+
+    server.stop();
+    serving.join();
+  }
+
+  EXPECT_FALSE(std::filesystem::exists(socket));
+  std::filesystem::current_path(home);
+}
+
+TEST(CompileServerTest, DropsOversizedAndStalledRequests) {
+  const std::string socket = ::testing::TempDir() + "compile_server_stall.sock";
+  const auto connectRaw = [&socket] {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    socket.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_EQ(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    return fd;
+  };
+
+  std::string error;
+  CompileServer server(socket);
+  ASSERT_TRUE(server.open(error)) << error;
+  std::thread serving([&server] { server.serve(); });
+
+  // An argument count no command line reaches is dropped before any of them is read.
+  const int oversized = connectRaw();
+  const std::uint32_t count = 64u << 20;
+  ASSERT_EQ(::write(oversized, &count, sizeof(count)), static_cast<ssize_t>(sizeof(count)));
+  char reply = 0;
+  EXPECT_EQ(::read(oversized, &reply, 1), 0);
+  ::close(oversized);
+
+  // A client that never finishes its request does not keep stop() from returning.
+  const int stalled = connectRaw();
+  const std::uint32_t partial = 2;
+  ASSERT_EQ(::write(stalled, &partial, sizeof(partial)), static_cast<ssize_t>(sizeof(partial)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const auto stopped = std::chrono::steady_clock::now();
+  server.stop();
+  serving.join();
+  EXPECT_LT(std::chrono::steady_clock::now() - stopped, std::chrono::seconds(5));
+  ::close(stalled);
+}
+
+TEST(CompileServerTest, ReplacesOnlyStaleSockets) {
+  const std::string socket = ::testing::TempDir() + "compile_server_stale.sock";
+  std::filesystem::remove(socket);
+
+  // A server that died without cleaning up leaves a socket nobody accepts on.
+  {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    socket.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    ::close(fd);
+  }
+  ASSERT_TRUE(std::filesystem::is_socket(socket));
+  std::string error;
+  {
+    CompileServer server(socket);
+    EXPECT_TRUE(server.open(error)) << error;
+  }
+
+  // Anything else at the path, such as a source file, is left alone.
+  const std::string source = writeTempSource("compile_server_source.c", "int main;\n");
+  CompileServer server(source);
+  EXPECT_FALSE(server.open(error));
+  EXPECT_NE(error.find("is not a socket"), std::string::npos) << error;
+  std::ifstream in(source);
+  std::stringstream text;
+  text << in.rdbuf();
+  EXPECT_EQ(text.str(), "int main;\n");
+}
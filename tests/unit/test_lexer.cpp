@@ -1,13 +1,23 @@
 #include <gtest/gtest.h>
 
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <random>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #include "lexer/lexer.h"
+#include "support/instrumentation.h"
 
 namespace {
 
 using compiler::lexer::Lexer;
+using compiler::lexer::ScannerKind;
 using compiler::lexer::Token;
 
 std::vector<Token::Kind> kinds(const std::vector<Token>& tokens) {
@@ -18,6 +28,53 @@ std::vector<Token::Kind> kinds(const std::vector<Token>& tokens) {
   return out;
 }
 
+std::string makeSource(std::size_t seed) {
+  std::string src = "/* unit " + std::to_string(seed) + " */\n";
+  for (std::size_t i = 0; i < 20 + seed % 17; ++i) {
+    src += "int f" + std::to_string(i) + "(int a, float b) {\n";
+    src += "  char c = 'x'; // line comment\n";
+    src += "  while (a >= " + std::to_string(seed * i) + ") { a -= 1; b = b * 2.5; }\n";
+    src += "  return a + \"s" + std::to_string(i) + "\" != 0;\n}\n";
+  }
+  if (seed % 5 == 0) {
+    src += "int @ bad;\n";
+  }
+  if (seed % 7 == 0) {
+    src += "\"unterminated\n";
+  }
+  return src;
+}
+
+/** Flattens tokens and diagnostics into a comparable string. */
+std::string describe(const std::vector<Token>& tokens, const Lexer& lexer) {
+  std::string out;
+  for (const auto& token : tokens) {
+    out += std::to_string(static_cast<int>(token.kind)) + ":" + std::string(token.lexeme) +
+           "@" + std::to_string(token.line) + " ";
+  }
+  for (const auto& err : lexer.errors()) {
+    out += "\n" + err.filename + ":" + std::to_string(err.line) + ": " + err.message;
+  }
+  return out;
+}
+
+/** Like describe, with literal values spelled out too. */
+std::string scan(const std::string& source, ScannerKind scanner) {
+  Lexer lexer(nullptr, scanner);
+  const auto tokens = lexer.tokenize(source, "scan.c");
+  std::string out = describe(tokens, lexer) + "\n";
+  for (const auto& token : tokens) {
+    char value[64] = "";
+    if (token.kind == Token::Kind::IntLiteral || token.kind == Token::Kind::CharLiteral) {
+      std::snprintf(value, sizeof(value), "%lld ", token.value.int_val);
+    } else if (token.kind == Token::Kind::FloatLiteral) {
+      std::snprintf(value, sizeof(value), "%a ", token.value.float_val);
+    }
+    out += value;
+  }
+  return out;
+}
+
 }  // namespace
 
 TEST(LexerTest, TokenizesAllKeywords) {
@@ -100,6 +157,25 @@ TEST(LexerTest, TokenizesNumericCharAndStringLiterals) {
   EXPECT_EQ(tokens[3].lexeme, "hello");
 }
 
+TEST(LexerTest, LexemesViewTheSourceBuffer) {
+  const std::string src = "while (count >= 10) x = \"a\\\"b\";";
+  Lexer lexer;
+  auto tokens = lexer.tokenize(src);
+  ASSERT_TRUE(lexer.errors().empty());
+
+  for (const auto& token : tokens) {
+    if (token.kind == Token::Kind::EndOfFile) {
+      continue;
+    }
+    EXPECT_GE(token.lexeme.data(), src.data());
+    EXPECT_LE(token.lexeme.data() + token.lexeme.size(), src.data() + src.size());
+  }
+  EXPECT_EQ(tokens[2].lexeme, "count");
+  EXPECT_EQ(tokens[3].lexeme, ">=");
+  EXPECT_EQ(tokens[8].kind, Token::Kind::StringLiteral);
+  EXPECT_EQ(tokens[8].lexeme, "a\\\"b");
+}
+
 TEST(LexerTest, SkipsCommentsAndTracksLines) {
   Lexer lexer;
   auto tokens = lexer.tokenize("int x; // one\n/* two */\nreturn x;");
@@ -140,3 +216,191 @@ TEST(LexerTest, ReportsInvalidToken) {
   EXPECT_NE(lexer.errors()[0].message.find("invalid token"), std::string::npos);
   EXPECT_EQ(tokens[1].kind, Token::Kind::Invalid);
 }
+
+TEST(TokenStreamTest, RejectsInputsTooLargeForFlex) {
+  // Reserve address space only; the scanner must reject the input without reading it.
+  const std::size_t size = (std::size_t{1} << 31) + 1;
+  void* bytes = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1,
+                       0);
+  if (bytes == MAP_FAILED) {
+    GTEST_SKIP() << "cannot reserve " << size << " bytes of address space";
+  }
+  {
+    compiler::lexer::TokenStream stream(std::string_view(static_cast<const char*>(bytes), size),
+                                        "huge.c");
+    EXPECT_EQ(stream.next().kind, Token::Kind::EndOfFile);
+    EXPECT_EQ(stream.next().kind, Token::Kind::EndOfFile);
+    ASSERT_EQ(stream.errors().size(), 1U);
+    EXPECT_EQ(stream.errors()[0].filename, "huge.c");
+    EXPECT_NE(stream.errors()[0].message.find("input too large"), std::string::npos);
+  }
+  ::munmap(bytes, size);
+}
+
+TEST(LexerTest, ReservesTheTokenBufferOnce) {
+  // Seeds that are multiples of 5 or 7 add diagnostics, which allocate.
+  std::string src;
+  for (std::size_t i = 1; src.size() < (std::size_t{1} << 20); ++i) {
+    if (i % 5 != 0 && i % 7 != 0) {
+      src += makeSource(i);
+    }
+  }
+  for (const ScannerKind scanner : {ScannerKind::Flex, ScannerKind::Fast}) {
+    Lexer lexer(nullptr, scanner);
+    const std::uint64_t before = compiler::support::threadAllocationCount();
+    const auto tokens = lexer.tokenize(src, "big.c");
+    const std::uint64_t allocations = compiler::support::threadAllocationCount() - before;
+
+    // Growing one token at a time would reallocate about twenty times.
+    EXPECT_EQ(tokens.capacity(), src.size() / 3 + 1);
+    EXPECT_GT(tokens.size(), src.size() / 8);
+    EXPECT_LE(allocations, 10U);
+  }
+}
+
+TEST(LexerTest, ConcurrentTokenizeMatchesSerial) {
+  constexpr std::size_t kFiles = 300;
+  std::vector<std::string> sources;
+  std::vector<std::string> expected;
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    sources.push_back(makeSource(i));
+    Lexer lexer;
+    auto tokens = lexer.tokenize(sources.back(), "file" + std::to_string(i) + ".c");
+    expected.push_back(describe(tokens, lexer));
+  }
+
+  std::vector<std::string> actual(kFiles);
+  std::atomic<std::size_t> next{0};
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < 8; ++t) {
+    pool.emplace_back([&] {
+      Lexer lexer;
+      for (std::size_t i = next++; i < kFiles; i = next++) {
+        auto tokens = lexer.tokenize(sources[i], "file" + std::to_string(i) + ".c");
+        actual[i] = describe(tokens, lexer);
+      }
+    });
+  }
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    EXPECT_EQ(actual[i], expected[i]) << "file" << i;
+  }
+}
+
+TEST(TokenStreamTest, MatchesBatchTokenizationWithLookahead) {
+  const std::string src = makeSource(35);
+  Lexer lexer;
+  const auto batch = lexer.tokenize(src, "stream.c");
+
+  compiler::lexer::TokenStream stream(src, "stream.c");
+  std::vector<Token> streamed;
+  for (;;) {
+    const Token ahead = stream.peek(2);
+    const Token& token = stream.next();
+    streamed.push_back(token);
+    if (token.kind == Token::Kind::EndOfFile) {
+      break;
+    }
+    const std::size_t lookahead_index = streamed.size() + 1;
+    if (lookahead_index < batch.size()) {
+      EXPECT_EQ(ahead.lexeme, batch[lookahead_index].lexeme);
+    }
+  }
+
+  ASSERT_EQ(streamed.size(), batch.size());
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_EQ(streamed[i].kind, batch[i].kind) << i;
+    EXPECT_EQ(streamed[i].lexeme, batch[i].lexeme) << i;
+    EXPECT_EQ(streamed[i].line, batch[i].line) << i;
+  }
+  ASSERT_EQ(stream.errors().size(), lexer.errors().size());
+  EXPECT_EQ(stream.next().kind, Token::Kind::EndOfFile);
+}
+
+TEST(ScannerTest, MatchesFlexOnEdgeCases) {
+  const std::vector<std::string> sources = {
+      "",
+      "int float char void struct if else while for return",
+      "integer floats iff _if returns Int x1 _ a_b9",
+      "== != <= >= && || += -= *= /= -> + - * / % < > ! = & ( ) { } [ ] ; , .",
+      "a|b a||b a/=b a//c\nb a/*c*/b a/ *b",
+      "0 42 007 1. .5 1.5 1e5 1E+5 2e-3 1.5e 1e 1e+ 3.e2 1..2 .e 9223372036854775808",
+      "'a' '\\n' '\\0' '\\'' '\\\\' ''' 'ab' ' '\\q' '",
+      "\"plain\" \"esc\\\"aped\" \"back\\\\\" \"\"",
+      "\"broken\nint x;",
+      "\"open at end",
+      "/* one\ntwo\nthree */ x /* ** / **/ y /*/ z",
+      "/* unterminated\n\n",
+      "// trailing comment without newline",
+      "int @ $ # ` \x7f \xc3\xa9 \v \f x",
+      std::string(100, ' ') + "\n\t\r\n" + std::string(50, '\n') + "x",
+      std::string(70, 'z') + " " + std::string(40, '_') + "1",
+      "/*" + std::string(100, '*') + "/ /*" + std::string(90, '\n') + "*/ end",
+      "\"" + std::string(100, 's') + "\\\"" + std::string(40, 't') + "\" q",
+  };
+  for (const std::string& source : sources) {
+    EXPECT_EQ(scan(source, ScannerKind::Fast), scan(source, ScannerKind::Flex)) << source;
+  }
+}
+
+TEST(ScannerTest, MatchesFlexOnBackslashesBeforeLineEnds) {
+  const std::vector<std::string> sources = {
+      "\"split\\\nint x;", "\"open\\", "\"\\", "\"pair\\\\\nx", "a \"\\\r\n\"b\"",
+  };
+  for (const std::string& source : sources) {
+    EXPECT_EQ(scan(source, ScannerKind::Fast), scan(source, ScannerKind::Flex)) << source;
+  }
+
+  Lexer lexer;
+  const auto tokens = lexer.tokenize("\"split\\\nint x;", "split.c");
+  ASSERT_EQ(lexer.errors().size(), 1u);
+  EXPECT_EQ(lexer.errors()[0].line, 1);
+  ASSERT_FALSE(tokens.empty());
+  EXPECT_EQ(tokens[0].kind, Token::Kind::KwInt);
+  EXPECT_EQ(tokens[0].line, 2);
+}
+
+TEST(ScannerTest, MatchesFlexOnRandomInputs) {
+  const std::vector<std::string> fragments = {
+      "int", "float", "char", "void", "struct", "if", "else", "while", "for", "return",
+      "x", "_y1", "whilex", "e", "E", "0", "12", "3.", ".5", "1e", "+", "-", "*", "/",
+      "%", "=", "!", "<", ">", "&", "|", "(", ")", "{", "}", "[", "]", ";", ",", ".",
+      "'", "'c'", "'\\n'", "\"", "\"str\"", "\\\"", "\\", "/*", "*/", "//", " ", "\n", "\t",
+      "\r", "@", "\x80", std::string(37, ' '), std::string(33, 'k'),
+      "/*\n" + std::string(40, '-')};
+  std::mt19937 random(12345);
+  std::uniform_int_distribution<std::size_t> pick(0, fragments.size() - 1);
+  for (int i = 0; i < 2000; ++i) {
+    std::string source;
+    for (int j = 0; j < 60; ++j) {
+      source += fragments[pick(random)];
+    }
+    ASSERT_EQ(scan(source, ScannerKind::Fast), scan(source, ScannerKind::Flex)) << source;
+  }
+}
+
+TEST(ScannerTest, StreamsAndInternsLikeFlex) {
+  const std::string src = makeSource(35);
+  compiler::support::StringInterner flex_names;
+  compiler::support::StringInterner fast_names;
+  compiler::lexer::TokenStream flex(src, "stream.c", &flex_names);
+  compiler::lexer::TokenStream fast(src, "stream.c", &fast_names, ScannerKind::Fast);
+  for (;;) {
+    EXPECT_EQ(fast.peek(3).lexeme, flex.peek(3).lexeme);
+    const Token expected = flex.next();
+    const Token& actual = fast.next();
+    ASSERT_EQ(actual.kind, expected.kind);
+    EXPECT_EQ(actual.lexeme, expected.lexeme);
+    EXPECT_EQ(actual.line, expected.line);
+    if (expected.kind == Token::Kind::Identifier) {
+      EXPECT_EQ(actual.symbol.str(), expected.symbol.str());
+    }
+    if (expected.kind == Token::Kind::EndOfFile) {
+      break;
+    }
+  }
+  EXPECT_EQ(fast.errors().size(), flex.errors().size());
+}
@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+
+#include "ast/ast.h"
+#include "codegen/codegen.h"
+#include "driver/driver.h"
+#include "optimizer/constant_folder.h"
+#include "optimizer/optimizer.h"
+#include "parser/parser.h"
+#include "sema/sema.h"
+
+namespace {
+
+using compiler::optimizer::ConstantFolder;
+using compiler::optimizer::FoldStats;
+using compiler::optimizer::OptLevel;
+using compiler::optimizer::Optimizer;
+
+/** Parses and analyzes `source`; null if either step reports an error. */
+std::unique_ptr<compiler::ast::TranslationUnit> analyze(const std::string& source) {
+  compiler::parser::Parser parser;
+  auto unit = parser.parse(source);
+  if (unit == nullptr || !compiler::sema::SemanticAnalyzer().analyze(*unit)) {
+    return nullptr;
+  }
+  return unit;
+}
+
+std::unique_ptr<llvm::Module> compile(llvm::LLVMContext& context, const std::string& source) {
+  auto unit = analyze(source);
+  if (unit == nullptr) {
+    return nullptr;
+  }
+  compiler::codegen::CodeGenerator generator(context, "opt_test");
+  if (!generator.generate(*unit)) {
+    return nullptr;
+  }
+  return generator.takeModule();
+}
+
+bool hasAlloca(const llvm::Function& fn) {
+  for (const auto& block : fn) {
+    for (const auto& inst : block) {
+      if (llvm::isa<llvm::AllocaInst>(inst)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/** Folds `source` and returns its dump, for comparison with a hand-folded equivalent. */
+std::string foldAndPrint(const std::string& source, FoldStats* stats = nullptr) {
+  auto unit = analyze(source);
+  if (unit == nullptr) {
+    return "<error>";
+  }
+  const FoldStats result = ConstantFolder().run(*unit);
+  if (stats != nullptr) {
+    *stats = result;
+  }
+  return compiler::ast::prettyPrint(*unit);
+}
+
+std::string print(const std::string& source) {
+  auto unit = analyze(source);
+  return unit == nullptr ? "<error>" : compiler::ast::prettyPrint(*unit);
+}
+
+const char* kProgram =
+    "int product() { int a = 2; int b = 3; return a * b; }\n"
+    "int sum(int n) { int s = 0; for (int i = 0; i < n; i += 1) { s += i; } return s; }\n"
+    "int twice(int x) { return x + x; }\n"
+    "int main() { return sum(10) + product() + twice(4); }\n";
+
+}  // namespace
+
+TEST(OptimizerTest, LevelZeroLeavesAllocasInPlace) {
+  llvm::LLVMContext context;
+  auto module = compile(context, kProgram);
+  ASSERT_NE(module, nullptr);
+
+  std::string error;
+  ASSERT_TRUE(Optimizer({OptLevel::O0, ""}).run(*module, error)) << error;
+  EXPECT_TRUE(hasAlloca(*module->getFunction("product")));
+}
+
+TEST(OptimizerTest, LevelTwoFoldsConstantsAcrossLocals) {
+  llvm::LLVMContext context;
+  auto module = compile(context, kProgram);
+  ASSERT_NE(module, nullptr);
+
+  std::string error;
+  ASSERT_TRUE(Optimizer({OptLevel::O2, ""}).run(*module, error)) << error;
+  llvm::Function* product = module->getFunction("product");
+  ASSERT_NE(product, nullptr);
+  EXPECT_FALSE(hasAlloca(*product));
+  auto* ret = llvm::dyn_cast<llvm::ReturnInst>(product->getEntryBlock().getTerminator());
+  ASSERT_NE(ret, nullptr);
+  auto* value = llvm::dyn_cast<llvm::ConstantInt>(ret->getReturnValue());
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(value->getSExtValue(), 6);
+}
+
+TEST(OptimizerTest, RunsCustomPipelinesAndRejectsInvalidOnes) {
+  llvm::LLVMContext context;
+  auto module = compile(context, kProgram);
+  ASSERT_NE(module, nullptr);
+
+  std::string error;
+  ASSERT_TRUE(Optimizer({OptLevel::O0, "mem2reg"}).run(*module, error)) << error;
+  EXPECT_FALSE(hasAlloca(*module->getFunction("sum")));
+
+  EXPECT_FALSE(Optimizer({OptLevel::O0, "no-such-pass"}).run(*module, error));
+  EXPECT_NE(error.find("no-such-pass"), std::string::npos);
+}
+
+TEST(OptimizerTest, ParallelPartitionsRelinkIntoOneModule) {
+  llvm::LLVMContext context;
+  auto module = compile(context, kProgram);
+  ASSERT_NE(module, nullptr);
+
+  std::string error;
+  auto merged = Optimizer({OptLevel::O2, ""}).runParallel(std::move(module), 4, error);
+  ASSERT_NE(merged, nullptr) << error;
+  EXPECT_FALSE(llvm::verifyModule(*merged, &llvm::errs()));
+  for (const char* name : {"product", "sum", "twice", "main"}) {
+    const llvm::Function* fn = merged->getFunction(name);
+    ASSERT_NE(fn, nullptr) << name;
+    EXPECT_FALSE(fn->isDeclaration()) << name;
+    EXPECT_FALSE(hasAlloca(*fn)) << name;
+  }
+}
+
+TEST(OptimizerTest, DriverParsesOptimizationFlags) {
+  compiler::driver::DriverOptions options;
+  std::string error;
+  ASSERT_TRUE(compiler::driver::parseArguments({"-O3", "-fpasses=instcombine", "a.c"}, options,
+                                               error));
+  EXPECT_EQ(options.opt_level, OptLevel::O3);
+  EXPECT_EQ(options.passes, "instcombine");
+
+  ASSERT_TRUE(compiler::driver::parseArguments({"-Os", "a.c"}, options, error));
+  EXPECT_EQ(options.opt_level, OptLevel::Os);
+  EXPECT_FALSE(compiler::driver::parseArguments({"-O7", "a.c"}, options, error));
+}
+
+TEST(ConstantFolderTest, FoldsLiteralArithmetic) {
+  FoldStats stats;
+  EXPECT_EQ(foldAndPrint("int f() { return (2 + 3) * 4 - -1 + 'a' + !0 + (7 < 9); }", &stats),
+            print("int f() { return 120; }"));
+  EXPECT_EQ(stats.folded, 9U);
+  // Sixteen written nodes plus the cast sema wrapped around 'a'.
+  EXPECT_EQ(stats.nodes_removed, 17U);
+
+  EXPECT_EQ(foldAndPrint("float g() { return 1.5 * 2 + 0.25; }"),
+            print("float g() { return 3.25; }"));
+  EXPECT_EQ(foldAndPrint("int h() { return 2147483647 + 1; }"),
+            foldAndPrint("int h() { return -2147483647 - 1; }"));
+}
+
+TEST(ConstantFolderTest, LeavesTrappingAndEffectfulExpressionsAlone) {
+  const std::string division = "int f() { return 1 / 0 + 5 % 0; }";
+  EXPECT_EQ(foldAndPrint(division), print(division));
+
+  // `g() * 0` still has to call g; `f * 1` may be a float, where identities do not hold.
+  const std::string effects =
+      "int g() { return 1; }\n"
+      "float k(float f) { return f * 1 + f * 0; }\n"
+      "int main() { return g() * 0; }\n";
+  EXPECT_EQ(foldAndPrint(effects), print(effects));
+}
+
+TEST(ConstantFolderTest, SimplifiesIntegerIdentities) {
+  FoldStats stats;
+  EXPECT_EQ(foldAndPrint("int f(int x, char c) { return (x*1 + 0) * (1*c - 0) + x*0 + 0/x; }",
+                         &stats),
+            print("int f(int x, char c) { return x * c + 0 / x; }"));
+  EXPECT_EQ(stats.simplified, 6U);
+}
+
+TEST(ConstantFolderTest, PrunesBranchesWithConstantConditions) {
+  FoldStats stats;
+  EXPECT_EQ(foldAndPrint("int f(int x) {\n"
+                         "  if (1 < 2) { x = 1; } else { x = 2; }\n"
+                         "  if (0) { x = 3; }\n"
+                         "  while (2 - 2) { x = x + 1; }\n"
+                         "  for (int i = 0; 0; i += 1) { x = i; }\n"
+                         "  if (x && 0) { x = 4; } else if (0 || 1) x = 5;\n"
+                         "  return x;\n"
+                         "}\n",
+                         &stats),
+            print("int f(int x) {\n"
+                  "  { x = 1; }\n"
+                  "  { int i = 0; }\n"
+                  "  if (x && 0) { x = 4; } else x = 5;\n"
+                  "  return x;\n"
+                  "}\n"));
+  EXPECT_EQ(stats.pruned, 5U);
+  EXPECT_GT(stats.nodes_removed, 20U);
+}
+
+TEST(ConstantFolderTest, FoldedProgramsStillLowerToValidIR) {
+  auto unit = analyze(
+      "int g = 4 * 8 - 2;\n"
+      "float h = 3 / 2;\n"
+      "char c = 'a' + 1;\n"
+      "int main() { int x = g; if (!1) { return 1; } while (0) { x = 0; } return x * 1 + 0; }\n");
+  ASSERT_NE(unit, nullptr);
+  ConstantFolder().run(*unit);
+
+  llvm::LLVMContext context;
+  compiler::codegen::CodeGenerator generator(context, "folded");
+  ASSERT_TRUE(generator.generate(*unit)) << generator.errors().front().message;
+  auto* global = generator.module().getGlobalVariable("g");
+  ASSERT_NE(global, nullptr);
+  EXPECT_EQ(llvm::cast<llvm::ConstantInt>(global->getInitializer())->getSExtValue(), 30);
+  // Conversions sema inserted around folded initializers are applied as well.
+  const auto* h = generator.module().getGlobalVariable("h")->getInitializer();
+  EXPECT_EQ(llvm::cast<llvm::ConstantFP>(h)->getValueAPF().convertToFloat(), 1.0F);
+  const auto* c = generator.module().getGlobalVariable("c")->getInitializer();
+  EXPECT_EQ(llvm::cast<llvm::ConstantInt>(c)->getSExtValue(), 'b');
+}
@@ -2,32 +2,50 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "ast/ast.h"
+#include "ast/serialization.h"
 #include "parser/parser.h"
+#include "support/buffered_writer.h"
 
 namespace {
 
 using compiler::ast::BinaryExpr;
+using compiler::ast::BinaryOp;
 using compiler::ast::CompoundStmt;
 using compiler::ast::ForStmt;
 using compiler::ast::FunctionDecl;
 using compiler::ast::IfStmt;
+using compiler::ast::NodeKind;
 using compiler::ast::ReturnStmt;
 using compiler::ast::StructDecl;
 using compiler::ast::TranslationUnit;
 using compiler::ast::VarDecl;
+using compiler::ast::VarRef;
+using compiler::parser::ParseMode;
 using compiler::parser::Parser;
+using compiler::parser::ParserKind;
 
 const FunctionDecl* findFunction(const TranslationUnit& tu, const std::string& name) {
   for (const auto& decl : tu.decls) {
-    if (const auto* fn = dynamic_cast<const FunctionDecl*>(decl.get()); fn && fn->name == name) {
+    if (const auto* fn = dynamic_cast<const FunctionDecl*>(decl); fn && fn->name == name) {
       return fn;
     }
   }
   return nullptr;
 }
 
+std::string dumpJSON(const TranslationUnit& unit) {
+  std::string json;
+  {
+    compiler::support::BufferedWriter out(json);
+    compiler::ast::dump(unit, out, compiler::ast::DumpFormat::JSON);
+  }
+  return json;
+}
+
 }  // namespace
 
 TEST(ParserTest, ParsesDeclarationForms) {
@@ -42,9 +60,32 @@ TEST(ParserTest, ParsesDeclarationForms) {
   ASSERT_TRUE(parser.errors().empty());
   ASSERT_EQ(unit->decls.size(), 3U);
 
-  EXPECT_NE(dynamic_cast<StructDecl*>(unit->decls[0].get()), nullptr);
-  EXPECT_NE(dynamic_cast<VarDecl*>(unit->decls[1].get()), nullptr);
-  EXPECT_NE(dynamic_cast<FunctionDecl*>(unit->decls[2].get()), nullptr);
+  EXPECT_NE(dynamic_cast<StructDecl*>(unit->decls[0]), nullptr);
+  EXPECT_NE(dynamic_cast<VarDecl*>(unit->decls[1]), nullptr);
+  EXPECT_NE(dynamic_cast<FunctionDecl*>(unit->decls[2]), nullptr);
+}
+
+TEST(ParserTest, ParsesPointerAndArrayDeclarators) {
+  Parser parser;
+  auto unit = parser.parse(
+      "struct Node { int keys[4]; struct Node** kids; };\n"
+      "int grid[3][8];\n"
+      "char* name(struct Node* n) { return 0; }\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(parser.errors().empty());
+
+  const auto* node = dynamic_cast<StructDecl*>(unit->decls[0]);
+  ASSERT_NE(node, nullptr);
+  EXPECT_EQ(node->fields[0].type->str(), "int[4]");
+  EXPECT_EQ(node->fields[1].type->str(), "struct Node**");
+  EXPECT_EQ(dynamic_cast<VarDecl*>(unit->decls[1])->type->str(), "int[3][8]");
+  const FunctionDecl* fn = findFunction(*unit, "name");
+  ASSERT_NE(fn, nullptr);
+  EXPECT_EQ(fn->return_type->str(), "char*");
+  EXPECT_EQ(fn->params[0].type->str(), "struct Node*");
+  // Types are uniqued, so the same spelling always yields the same object.
+  EXPECT_EQ(node->fields[1].type->element(), fn->params[0].type);
+  EXPECT_EQ(fn->params[0].type->element(), unit->context->types().structNamed(node->name));
 }
 
 TEST(ParserTest, HonorsExpressionPrecedenceAndAssociativity) {
@@ -58,14 +99,14 @@ TEST(ParserTest, HonorsExpressionPrecedenceAndAssociativity) {
   ASSERT_NE(fn->body, nullptr);
   ASSERT_EQ(fn->body->stmts.size(), 1U);
 
-  const auto* ret = dynamic_cast<ReturnStmt*>(fn->body->stmts[0].get());
+  const auto* ret = dynamic_cast<ReturnStmt*>(fn->body->stmts[0]);
   ASSERT_NE(ret, nullptr);
-  const auto* add = dynamic_cast<BinaryExpr*>(ret->value.get());
+  const auto* add = dynamic_cast<BinaryExpr*>(ret->value);
   ASSERT_NE(add, nullptr);
-  EXPECT_EQ(add->op, "+");
-  const auto* mul = dynamic_cast<BinaryExpr*>(add->rhs.get());
+  EXPECT_EQ(add->op, BinaryOp::Add);
+  const auto* mul = dynamic_cast<BinaryExpr*>(add->rhs);
   ASSERT_NE(mul, nullptr);
-  EXPECT_EQ(mul->op, "*");
+  EXPECT_EQ(mul->op, BinaryOp::Mul);
 }
 
 TEST(ParserTest, ResolvesDanglingElseToNearestIf) {
@@ -79,11 +120,11 @@ TEST(ParserTest, ResolvesDanglingElseToNearestIf) {
   ASSERT_NE(fn, nullptr);
   ASSERT_EQ(fn->body->stmts.size(), 2U);
 
-  const auto* outer_if = dynamic_cast<IfStmt*>(fn->body->stmts[0].get());
+  const auto* outer_if = dynamic_cast<IfStmt*>(fn->body->stmts[0]);
   ASSERT_NE(outer_if, nullptr);
   EXPECT_EQ(outer_if->else_branch, nullptr);
 
-  const auto* inner_if = dynamic_cast<IfStmt*>(outer_if->then_branch.get());
+  const auto* inner_if = dynamic_cast<IfStmt*>(outer_if->then_branch);
   ASSERT_NE(inner_if, nullptr);
   EXPECT_NE(inner_if->else_branch, nullptr);
 }
@@ -106,7 +147,7 @@ TEST(ParserTest, ParsesLoopsAndPostfixExpressions) {
   const auto* fn = findFunction(*unit, "main");
   ASSERT_NE(fn, nullptr);
   ASSERT_GE(fn->body->stmts.size(), 3U);
-  EXPECT_NE(dynamic_cast<ForStmt*>(fn->body->stmts[1].get()), nullptr);
+  EXPECT_NE(dynamic_cast<ForStmt*>(fn->body->stmts[1]), nullptr);
 }
 
 TEST(ParserTest, ReportsMultipleErrorsViaRecovery) {
@@ -140,3 +181,284 @@ TEST(ParserTest, PrettyPrintsDistanceProgram) {
   EXPECT_NE(printed.find("VarDecl dx:int"), std::string::npos);
   EXPECT_NE(printed.find("BinaryExpr +"), std::string::npos);
 }
+
+TEST(ParserTest, TagsNodesWithTheirKind) {
+  Parser parser;
+  auto unit = parser.parse("int f(int a) { if (a) return a + 1; return 0; }", "kinds.c");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(parser.errors().empty());
+  EXPECT_EQ(unit->kind(), NodeKind::TranslationUnit);
+
+  const auto* fn = findFunction(*unit, "f");
+  ASSERT_NE(fn, nullptr);
+  EXPECT_TRUE(compiler::ast::isa<FunctionDecl>(fn));
+  EXPECT_FALSE(compiler::ast::isa<VarDecl>(fn));
+  EXPECT_FALSE(compiler::ast::isa<IfStmt>(nullptr));
+
+  const auto* branch = compiler::ast::dyn_cast<IfStmt>(fn->body->stmts[0]);
+  ASSERT_NE(branch, nullptr);
+  EXPECT_EQ(compiler::ast::dyn_cast<ReturnStmt>(fn->body->stmts[0]), nullptr);
+  const auto& ret = compiler::ast::cast<ReturnStmt>(*branch->then_branch);
+  EXPECT_TRUE(compiler::ast::isa<compiler::ast::Expr>(ret.value));
+  EXPECT_EQ(ret.value->kind(), NodeKind::BinaryExpr);
+  EXPECT_STREQ(compiler::ast::spelling(ret.value->kind()), "BinaryExpr");
+}
+
+TEST(ParserTest, DumpsCompactJSON) {
+  Parser parser;
+  auto unit = parser.parse("int g = 2;\nchar* s = \"a\\\"b\";\nint main() { return g; }\n",
+                           "json.c");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(parser.errors().empty());
+
+  std::string json;
+  {
+    compiler::support::BufferedWriter out(json);
+    compiler::ast::dump(*unit, out, compiler::ast::DumpFormat::JSON);
+  }
+  EXPECT_EQ(json.rfind("{\"kind\":\"TranslationUnit\"", 0), 0U) << json;
+  EXPECT_EQ(json.back(), '\n');
+  EXPECT_EQ(json.find('\n'), json.size() - 1);
+  EXPECT_NE(json.find("{\"kind\":\"VarDecl\",\"line\":1,\"name\":\"g\""), std::string::npos)
+      << json;
+  // String literals keep their source spelling, so the backslash is escaped too.
+  EXPECT_NE(json.find("\"value\":\"a\\\\\\\"b\""), std::string::npos) << json;
+  EXPECT_NE(json.find("{\"kind\":\"ReturnStmt\",\"line\":3"), std::string::npos) << json;
+
+  std::string text;
+  {
+    compiler::support::BufferedWriter out(text);
+    compiler::ast::dump(*unit, out);
+  }
+  EXPECT_EQ(text, compiler::ast::prettyPrint(*unit));
+}
+
+TEST(ParserTest, InternsRepeatedIdentifiers) {
+  Parser parser;
+  auto unit = parser.parse("int twice(int a) { return a + a; }", "intern.c");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(parser.errors().empty());
+
+  const auto* fn = findFunction(*unit, "twice");
+  ASSERT_NE(fn, nullptr);
+  const auto* ret = dynamic_cast<ReturnStmt*>(fn->body->stmts[0]);
+  ASSERT_NE(ret, nullptr);
+  const auto* add = dynamic_cast<BinaryExpr*>(ret->value);
+  ASSERT_NE(add, nullptr);
+  const auto* lhs = dynamic_cast<VarRef*>(add->lhs);
+  const auto* rhs = dynamic_cast<VarRef*>(add->rhs);
+  ASSERT_NE(lhs, nullptr);
+  ASSERT_NE(rhs, nullptr);
+  EXPECT_EQ(lhs->name, rhs->name);
+  EXPECT_EQ(lhs->name, fn->params[0].name);
+  EXPECT_EQ(fn->return_type, unit->context->types().intType());
+}
+
+TEST(ParserTest, StreamingAndBatchModesAgree) {
+  const std::vector<std::string> sources = {
+      "struct Point { int x; int y; };\nint g = 10;\nint add(int a, int b) { return a + b; }\n",
+      "int main(){ if(a) if(b) return 1; else return 2; return 3; }",
+      "int main( {\n  int x = ;\n  return ;\n}\n",
+      "int main() { int @ x = \"open\n; return 0; }",
+  };
+
+  for (const auto& src : sources) {
+    Parser streaming(ParseMode::Streaming);
+    Parser batch(ParseMode::Batch);
+    auto streamed = streaming.parse(src, "modes.c");
+    auto batched = batch.parse(src, "modes.c");
+
+    ASSERT_EQ(streamed == nullptr, batched == nullptr) << src;
+    if (streamed != nullptr) {
+      EXPECT_EQ(compiler::ast::prettyPrint(*streamed), compiler::ast::prettyPrint(*batched));
+    }
+    ASSERT_EQ(streaming.errors().size(), batch.errors().size()) << src;
+    for (std::size_t i = 0; i < batch.errors().size(); ++i) {
+      EXPECT_EQ(streaming.errors()[i].line, batch.errors()[i].line);
+      EXPECT_EQ(streaming.errors()[i].message, batch.errors()[i].message);
+    }
+  }
+}
+
+TEST(ParserTest, RecursiveDescentParserMatchesBison) {
+  const std::vector<std::string> sources = {
+      "struct Point { int x; int y; };\nint g = 10;\nint add(int a, int b) { return a + b; }\n",
+      "struct Node { int keys[4]; struct Node** kids; };\nint grid[3][8];\n"
+      "char* name(struct Node* n) { return 0; }\n",
+      "int main() { return 1 + 2 * 3; }",
+      "int main(){ if(a) if(b) return 1; else return 2; return 3; }",
+      "int main(){\n  int i = 0;\n  for(i = 0; i < 10; i += 1) {\n"
+      "    while(i < 5) { i = arr[i].x->y; }\n  }\n  return foo(i, 2);\n}",
+      "int distance(int x1, int y1, int x2, int y2) {\n  int dx = x2 - x1;\n"
+      "  int dy = y2 - y1;\n  return dx * dx + dy * dy;\n}",
+      "int g = 2;\nchar* s = \"a\\\"b\";\nint main() { return g; }\n",
+      "float f(float x, char c) {\n  float* p = &x;\n  *p -= 1.5;\n  x *= -x / 2.0;\n"
+      "  c = 'q';\n  ;\n  for (;;) { return a = b = !c; }\n"
+      "  for (int j = 0; ; ) x /= j % 3;\n  if (a || b && c == d != e <= f) {} else\n"
+      "    while (x > 1\n      >= 2 - 3) {}\n  return (p)[1]->v.w;\n}\n",
+      "int main( {\n  int x = ;\n  return ;\n}\n",
+      "int main() { int @ x = \"open\n; return 0; }",
+      "int f() { a + b = c; (1)(2); return 0; }\nint 5;\nint g() { return; }\n",
+      "int f() { if (x) {\n",
+  };
+
+  for (const auto& src : sources) {
+    Parser bison(ParseMode::Streaming, compiler::lexer::ScannerKind::Flex, ParserKind::Bison);
+    Parser rd(ParseMode::Streaming, compiler::lexer::ScannerKind::Flex,
+              ParserKind::RecursiveDescent);
+    auto expected = bison.parse(src, "rd.c");
+    auto actual = rd.parse(src, "rd.c");
+
+    ASSERT_EQ(expected == nullptr, actual == nullptr) << src;
+    if (expected != nullptr) {
+      EXPECT_EQ(compiler::ast::prettyPrint(*expected), compiler::ast::prettyPrint(*actual));
+      // The JSON dump also carries every node's line.
+      EXPECT_EQ(dumpJSON(*expected), dumpJSON(*actual)) << src;
+    }
+    // Messages name fewer expected tokens than Bison's, but land on the same lines.
+    ASSERT_EQ(bison.errors().size(), rd.errors().size()) << src;
+    for (std::size_t i = 0; i < bison.errors().size(); ++i) {
+      EXPECT_EQ(bison.errors()[i].line, rd.errors()[i].line) << src;
+      EXPECT_EQ(bison.errors()[i].message.substr(0, 12), rd.errors()[i].message.substr(0, 12))
+          << bison.errors()[i].message << " vs " << rd.errors()[i].message;
+    }
+  }
+}
+
+TEST(ParserTest, RecursiveDescentParserLimitsNesting) {
+  const auto nested = [](const std::string& open, std::size_t depth, const std::string& close) {
+    std::string src = "int f() { return ";
+    for (std::size_t i = 0; i < depth; ++i) {
+      src += open;
+    }
+    src += "1";
+    for (std::size_t i = 0; i < depth && !close.empty(); ++i) {
+      src += close;
+    }
+    return src + "; }\nint g() { return 2; }\n";
+  };
+
+  // Ordinary nesting parses as Bison does; hostile nesting is an error, not a crash.
+  for (const auto& [open, close] : {std::pair<std::string, std::string>{"(", ")"}, {"-", ""}}) {
+    Parser bison(ParseMode::Streaming, compiler::lexer::ScannerKind::Flex, ParserKind::Bison);
+    Parser rd(ParseMode::Streaming, compiler::lexer::ScannerKind::Flex,
+              ParserKind::RecursiveDescent);
+    const std::string shallow = nested(open, 100, close);
+    auto expected = bison.parse(shallow, "nested.c");
+    auto actual = rd.parse(shallow, "nested.c");
+    ASSERT_NE(actual, nullptr);
+    EXPECT_TRUE(rd.errors().empty());
+    EXPECT_EQ(compiler::ast::prettyPrint(*expected), compiler::ast::prettyPrint(*actual));
+
+    // The statement is skipped like any other malformed one, and g() parses.
+    EXPECT_EQ(rd.parse(nested(open, 200000, close), "nested.c"), nullptr);
+    ASSERT_EQ(rd.errors().size(), 2U);
+    EXPECT_EQ(rd.errors()[0].message, "syntax error, nesting exceeds 1000 levels");
+    EXPECT_EQ(rd.errors()[1].message, "invalid statement");
+  }
+
+  Parser rd(ParseMode::Streaming, compiler::lexer::ScannerKind::Flex,
+            ParserKind::RecursiveDescent);
+  rd.parse("int f() " + std::string(200000, '{'), "nested.c");
+  ASSERT_FALSE(rd.errors().empty());
+  EXPECT_EQ(rd.errors()[0].message, "syntax error, nesting exceeds 1000 levels");
+}
+
+TEST(ParserTest, SerializedASTRoundTrips) {
+  Parser parser;
+  const std::string src =
+      "struct Node { int value; struct Node* next; char tag[4]; };\n"
+      "float scale = 2.5;\n"
+      "char* greeting = \"hi\\n\";\n"
+      "int sum(struct Node* head, int limit) {\n"
+      "  int total = -9000000000;\n"
+      "  struct Node local;\n"
+      "  local.value = 'x';\n"
+      "  for (int i = 0; i < limit && head; i += 1) {\n"
+      "    total += head->value * -1;\n"
+      "    head = head->next;\n"
+      "  }\n"
+      "  while (!total) { ; }\n"
+      "  if (total >= 0) return total; else return *&total;\n"
+      "  return local.tag[0] + printf(\"%d\", sum(head, limit - 1));\n"
+      "}\n";
+  auto unit = parser.parse(src, "roundtrip.c");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(parser.errors().empty());
+
+  std::string bytes;
+  std::string error;
+  {
+    compiler::support::BufferedWriter out(bytes);
+    ASSERT_TRUE(compiler::ast::serialize(*unit, out, error)) << error;
+  }
+  EXPECT_LT(bytes.size(), src.size());
+
+  auto loaded = compiler::ast::deserialize(bytes, error);
+  ASSERT_NE(loaded, nullptr) << error;
+  EXPECT_EQ(compiler::ast::prettyPrint(*loaded), compiler::ast::prettyPrint(*unit));
+  const auto* fn = findFunction(*loaded, "sum");
+  ASSERT_NE(fn, nullptr);
+  EXPECT_EQ(fn->return_type, loaded->context->types().intType());
+  EXPECT_EQ(fn->params[0].type->str(), "struct Node*");
+
+  // Every truncation is rejected cleanly rather than read out of bounds.
+  for (std::size_t size = 0; size < bytes.size(); ++size) {
+    EXPECT_EQ(compiler::ast::deserialize(std::string_view(bytes).substr(0, size), error), nullptr)
+        << size;
+  }
+  EXPECT_EQ(compiler::ast::deserialize("int main() { return 0; }", error), nullptr);
+  EXPECT_EQ(error, "not a serialized AST");
+}
+
+TEST(ParserTest, RejectsDeeplyNestedSerializedAST) {
+  auto serializeSource = [](const std::string& src) {
+    Parser parser;
+    auto unit = parser.parse(src, "nested.c");
+    std::string bytes;
+    std::string error;
+    {
+      compiler::support::BufferedWriter out(bytes);
+      EXPECT_TRUE(compiler::ast::serialize(*unit, out, error)) << error;
+    }
+    return bytes;
+  };
+  // The two encodings differ only by the negation's node header.
+  const std::string plain = serializeSource("int x = a;");
+  const std::string negated = serializeSource("int x = -a;");
+  std::size_t at = 0;
+  while (plain[at] == negated[at]) {
+    ++at;
+  }
+  const std::string unary = negated.substr(at, negated.size() - plain.size());
+  auto nest = [&](std::size_t depth) {
+    std::string bytes = plain.substr(0, at);
+    for (std::size_t i = 0; i < depth; ++i) {
+      bytes += unary;
+    }
+    return bytes + plain.substr(at);
+  };
+
+  std::string error;
+  EXPECT_NE(compiler::ast::deserialize(nest(1000), error), nullptr) << error;
+  EXPECT_EQ(compiler::ast::deserialize(nest(200000), error), nullptr);
+  EXPECT_EQ(error, "corrupt AST file: nesting too deep");
+}
+
+TEST(ParserTest, SavesAndMapsASTFiles) {
+  Parser parser;
+  auto unit = parser.parse("int twice(int a) { return a + a; }", "saved.c");
+  ASSERT_NE(unit, nullptr);
+
+  const std::string path = ::testing::TempDir() + "saved.ast";
+  std::string error;
+  ASSERT_TRUE(compiler::ast::saveAST(*unit, path, error)) << error;
+  auto loaded = compiler::ast::loadAST(path, error);
+  ASSERT_NE(loaded, nullptr) << error;
+  EXPECT_EQ(compiler::ast::prettyPrint(*loaded), compiler::ast::prettyPrint(*unit));
+
+  unit->analyzed = true;
+  EXPECT_FALSE(compiler::ast::saveAST(*unit, path, error));
+  EXPECT_EQ(error, "translation unit has already been semantically analyzed");
+  EXPECT_EQ(compiler::ast::loadAST(path + ".missing", error), nullptr);
+}
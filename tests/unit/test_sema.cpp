@@ -1,3 +1,271 @@
 #include <gtest/gtest.h>
 
-TEST(SemaScaffoldTest, Placeholder) { EXPECT_TRUE(true); }
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/type.h"
+#include "parser/parser.h"
+#include "sema/sema.h"
+#include "sema/symbol_table.h"
+#include "support/string_interner.h"
+
+namespace {
+
+using compiler::ast::CastKind;
+using compiler::ast::ImplicitCastExpr;
+using compiler::ast::StructDecl;
+using compiler::ast::Type;
+using compiler::ast::TypeContext;
+using compiler::sema::SemaError;
+using compiler::sema::SemanticAnalyzer;
+using compiler::sema::SymbolTable;
+using compiler::support::StringInterner;
+using compiler::support::Symbol;
+
+/** Analyzes `source` and returns the diagnostics, or a parse error marker. */
+std::vector<SemaError> diagnose(const std::string& source) {
+  compiler::parser::Parser parser;
+  auto unit = parser.parse(source);
+  if (unit == nullptr) {
+    return {{0, "<parse error>"}};
+  }
+  SemanticAnalyzer analyzer;
+  analyzer.analyze(*unit);
+  return analyzer.diagnostics();
+}
+
+template <typename T>
+T& as(compiler::ast::ASTNode* node) {
+  auto* typed = dynamic_cast<T*>(node);
+  EXPECT_NE(typed, nullptr);
+  return *typed;
+}
+
+}  // namespace
+
+TEST(SemanticAnalyzerTest, ReportsErrorsWithLines) {
+  const auto errors = diagnose(
+      "struct S { int a; };\n"
+      "int f(int a) { return a; }\n"
+      "int main() {\n"
+      "  struct S s;\n"
+      "  s.b = 1;\n"
+      "  return f(1, 2) + missing;\n"
+      "}\n");
+  ASSERT_EQ(errors.size(), 3U);
+  EXPECT_EQ(errors[0].line, 5);
+  EXPECT_NE(errors[0].message.find("no member named 'b'"), std::string::npos);
+  EXPECT_EQ(errors[1].line, 6);
+  EXPECT_NE(errors[1].message.find("too many arguments"), std::string::npos);
+  EXPECT_NE(errors[2].message.find("undeclared identifier 'missing'"), std::string::npos);
+}
+
+TEST(SemanticAnalyzerTest, RejectsIllTypedPrograms) {
+  const std::vector<std::pair<std::string, std::string>> cases = {
+      {"int f() { int x; int x; return 0; }", "redefinition of 'x'"},
+      {"int f() { return 0; } int f() { return 1; }", "redefinition of function 'f'"},
+      {"void f() { return 1; }", "void function should not return a value"},
+      {"int f() { return; }", "non-void function should return a value"},
+      {"int f(int* p) { float g = 1.0; p = g; return 0; }",
+       "cannot convert 'float' to 'int*'"},
+      {"int f(int* p) { p = 1; return 0; }", "cannot convert 'int' to 'int*'"},
+      {"int f() { 1 = 2; return 0; }", "expression is not assignable"},
+      {"int f() { int a[2]; int b[2]; a = b; return 0; }",
+       "array type 'int[2]' is not assignable"},
+      {"int f() { return &3; }", "cannot take the address of an rvalue"},
+      {"int f(int x) { return *x; }", "indirection requires a non-void pointer operand"},
+      {"float f(float x) { return x % 2; }", "invalid operands to binary '%'"},
+      {"struct S { int a; }; int f(struct S s) { if (s) { return 1; } return 0; }",
+       "used type 'struct S' where a scalar is required"},
+      {"int f(struct T* t) { return t->a; }", "member access into incomplete type"},
+      {"int f(int x) { return x->a; }", "is not a pointer to a struct"},
+      {"int f(int x) { return x[1]; }", "subscripted value is not an array or pointer"},
+  };
+  for (const auto& [source, message] : cases) {
+    const auto errors = diagnose(source);
+    ASSERT_FALSE(errors.empty()) << source;
+    EXPECT_NE(errors[0].message.find(message), std::string::npos)
+        << source << " -> " << errors[0].message;
+  }
+}
+
+TEST(SemanticAnalyzerTest, AnnotatesTypesDeclarationsAndConversions) {
+  compiler::parser::Parser parser;
+  auto unit = parser.parse(
+      "struct P { int x; float y; };\n"
+      "int f(struct P* p, char c) {\n"
+      "  int a[3];\n"
+      "  a[1] = c;\n"
+      "  return p->y + a[0];\n"
+      "}\n"
+      "int main() { char* s = \"hi\"; return f(0, 'a') + g(s[0]); }\n");
+  ASSERT_NE(unit, nullptr);
+  SemanticAnalyzer analyzer;
+  ASSERT_TRUE(analyzer.analyze(*unit)) << analyzer.diagnostics().front().message;
+  EXPECT_TRUE(unit->analyzed);
+  TypeContext& types = unit->context->types();
+  auto& f = as<compiler::ast::FunctionDecl>(unit->decls[1]);
+
+  // a[1] = c: the char is widened to the element type; `a` decays to int*.
+  auto& store = as<compiler::ast::BinaryExpr>(as<compiler::ast::ExprStmt>(f.body->stmts[1]).expr);
+  EXPECT_EQ(store.type, types.intType());
+  auto& widened = as<ImplicitCastExpr>(store.rhs);
+  EXPECT_EQ(widened.cast_kind, CastKind::IntegralCast);
+  EXPECT_EQ(as<compiler::ast::VarRef>(widened.operand).decl, &f.params[1]);
+  auto& subscript = as<compiler::ast::ArraySubscript>(store.lhs);
+  EXPECT_TRUE(subscript.is_lvalue);
+  EXPECT_EQ(as<ImplicitCastExpr>(subscript.array).cast_kind, CastKind::ArrayToPointerDecay);
+  EXPECT_EQ(as<ImplicitCastExpr>(subscript.array).type, types.pointerTo(types.intType()));
+
+  // return p->y + a[0]: computed in float, then truncated to the int result.
+  auto& ret = as<ImplicitCastExpr>(as<compiler::ast::ReturnStmt>(f.body->stmts[2]).value);
+  EXPECT_EQ(ret.cast_kind, CastKind::FloatingToIntegral);
+  EXPECT_EQ(ret.type, types.intType());
+  auto& sum = as<compiler::ast::BinaryExpr>(ret.operand);
+  EXPECT_EQ(sum.type, types.floatType());
+  auto& member = as<compiler::ast::MemberExpr>(sum.lhs);
+  ASSERT_NE(member.field, nullptr);
+  EXPECT_EQ(member.field->index, 1U);
+  EXPECT_EQ(member.type, types.floatType());
+  EXPECT_EQ(as<ImplicitCastExpr>(sum.rhs).cast_kind, CastKind::IntegralToFloating);
+
+  // f(0, 'a') binds to f; g is implicitly declared and its char argument promoted.
+  auto& main = as<compiler::ast::FunctionDecl>(unit->decls[2]);
+  auto& ret_main = as<compiler::ast::ReturnStmt>(main.body->stmts[1]);
+  auto& total = as<compiler::ast::BinaryExpr>(ret_main.value);
+  auto& call = as<compiler::ast::CallExpr>(total.lhs);
+  EXPECT_EQ(call.function, &f);
+  EXPECT_EQ(as<ImplicitCastExpr>(call.args[0]).cast_kind, CastKind::NullToPointer);
+  EXPECT_EQ(as<compiler::ast::CharLiteral>(call.args[1]).type, types.charType());
+  auto& implicit = as<compiler::ast::CallExpr>(total.rhs);
+  EXPECT_EQ(implicit.function, nullptr);
+  EXPECT_EQ(implicit.type, types.intType());
+  EXPECT_EQ(as<ImplicitCastExpr>(implicit.args[0]).type, types.intType());
+
+  // A second run sees the unit is already analyzed and leaves it alone.
+  EXPECT_TRUE(SemanticAnalyzer().analyze(*unit));
+  EXPECT_EQ(as<ImplicitCastExpr>(store.rhs).operand, widened.operand);
+}
+
+TEST(SymbolTableTest, ShadowsAndRestoresAcrossScopes) {
+  StringInterner interner;
+  TypeContext types;
+  const Symbol x = interner.intern("x");
+  const Symbol y = interner.intern("y");
+  const Type* char_ptr = types.pointerTo(types.charType());
+  SymbolTable table;
+
+  EXPECT_EQ(table.lookup(x), nullptr);
+  ASSERT_TRUE(table.declare(x, types.intType()));
+  EXPECT_FALSE(table.declare(x, types.floatType()));
+
+  table.enterScope();
+  EXPECT_EQ(table.depth(), 1U);
+  ASSERT_TRUE(table.declare(x, types.floatType()));
+  ASSERT_TRUE(table.declare(y, types.charType()));
+  table.enterScope();
+  EXPECT_EQ(table.lookup(x), types.floatType());
+  ASSERT_TRUE(table.declare(x, char_ptr));
+  EXPECT_EQ(table.lookup(x), char_ptr);
+  table.exitScope();
+
+  EXPECT_EQ(table.lookup(x), types.floatType());
+  table.exitScope();
+  EXPECT_EQ(table.lookup(x), types.intType());
+  EXPECT_EQ(table.lookup(y), nullptr);
+
+  // The global scope survives unbalanced exits.
+  table.exitScope();
+  EXPECT_EQ(table.depth(), 0U);
+  EXPECT_EQ(table.lookup(x), types.intType());
+  EXPECT_FALSE(table.declare(Symbol(), types.intType()));
+}
+
+TEST(SymbolTableTest, KeepsShadowChainsIntactWhileGrowing) {
+  StringInterner interner;
+  TypeContext types;
+  SymbolTable table;
+  std::vector<Symbol> names;
+  for (int i = 0; i < 5000; ++i) {
+    names.push_back(interner.intern("v" + std::to_string(i)));
+  }
+  const Type* outer = types.intType();
+  const Type* inner = types.floatType();
+
+  for (const Symbol name : names) {
+    ASSERT_TRUE(table.declare(name, outer));
+  }
+  table.enterScope();
+  // Shadow every other name, interleaved with fresh names that force rehashing.
+  for (std::size_t i = 0; i < names.size(); i += 2) {
+    ASSERT_TRUE(table.declare(names[i], inner));
+    ASSERT_TRUE(table.declare(interner.intern("w" + std::to_string(i)), inner));
+  }
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    EXPECT_EQ(table.lookup(names[i]), i % 2 == 0 ? inner : outer) << i;
+  }
+  table.exitScope();
+  for (const Symbol name : names) {
+    EXPECT_EQ(table.lookup(name), outer);
+  }
+  EXPECT_EQ(table.lookup(interner.intern("w0")), nullptr);
+}
+
+TEST(TypeContextTest, UniquesDerivedTypes) {
+  StringInterner interner;
+  TypeContext types;
+  const Type* grid = types.arrayOf(types.arrayOf(types.intType(), 8), 3);
+  EXPECT_EQ(grid, types.arrayOf(types.arrayOf(types.intType(), 8), 3));
+  EXPECT_NE(grid, types.arrayOf(types.arrayOf(types.intType(), 3), 8));
+  EXPECT_EQ(grid->str(), "int[3][8]");
+  EXPECT_EQ(grid->size(), 96U);
+  EXPECT_EQ(types.pointerTo(grid)->str(), "int(*)[3][8]");
+
+  const Type* node = types.structNamed(interner.intern("Node"));
+  EXPECT_EQ(node, types.structNamed(interner.intern("Node")));
+  EXPECT_EQ(types.pointerTo(types.pointerTo(node))->str(), "struct Node**");
+  EXPECT_FALSE(node->isComplete());
+  EXPECT_TRUE(types.pointerTo(node)->isComplete());
+
+  const Type* fn = types.functionType(types.intType(), {types.pointerTo(types.charType())}, true);
+  EXPECT_EQ(fn, types.functionType(types.intType(), {types.pointerTo(types.charType())}, true));
+  EXPECT_NE(fn, types.functionType(types.intType(), {types.pointerTo(types.charType())}, false));
+  EXPECT_EQ(fn->str(), "int(char*, ...)");
+}
+
+TEST(TypeContextTest, LaysOutStructsOnceAndRejectsRedefinition) {
+  compiler::parser::Parser parser;
+  auto unit = parser.parse(
+      "struct S { char c; int i; float f[3]; struct S* next; char tail; };\n"
+      "struct S { int other; };\n"
+      "struct Bad { struct Missing m; };\n");
+  ASSERT_NE(unit, nullptr);
+  ASSERT_TRUE(parser.errors().empty());
+  TypeContext& types = unit->context->types();
+  const auto& first = *dynamic_cast<StructDecl*>(unit->decls[0]);
+
+  std::string error;
+  ASSERT_TRUE(types.defineStruct(first, error)) << error;
+  // Every phase may ask again; the layout is computed only the first time.
+  ASSERT_TRUE(types.defineStruct(first, error));
+
+  const auto* s = types.structNamed(first.name);
+  ASSERT_TRUE(s->isComplete());
+  ASSERT_EQ(s->fields().size(), 5U);
+  EXPECT_EQ(s->fields()[0].offset, 0U);
+  EXPECT_EQ(s->fields()[1].offset, 4U);
+  EXPECT_EQ(s->fields()[2].offset, 8U);
+  EXPECT_EQ(s->fields()[3].offset, 24U);
+  EXPECT_EQ(s->fields()[4].offset, 32U);
+  EXPECT_EQ(s->fields()[3].type, types.pointerTo(s));
+  EXPECT_EQ(s->size(), 40U);
+  EXPECT_EQ(s->align(), 8U);
+  EXPECT_EQ(s->field(unit->context->intern("next"))->index, 3U);
+
+  EXPECT_FALSE(types.defineStruct(*dynamic_cast<StructDecl*>(unit->decls[1]), error));
+  EXPECT_EQ(error, "redefinition of 'struct S'");
+  EXPECT_FALSE(types.defineStruct(*dynamic_cast<StructDecl*>(unit->decls[2]), error));
+  EXPECT_EQ(error, "field 'm' has incomplete type 'struct Missing'");
+}
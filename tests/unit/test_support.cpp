@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "support/arena.h"
+#include "support/buffered_writer.h"
+#include "support/instrumentation.h"
+#include "support/source_buffer.h"
+#include "support/string_interner.h"
+
+namespace {
+
+using compiler::support::Arena;
+using compiler::support::BufferedWriter;
+using compiler::support::Instrumentation;
+using compiler::support::SourceBuffer;
+using compiler::support::StringInterner;
+using compiler::support::Symbol;
+using compiler::support::TimeScope;
+
+struct Tracked {
+  explicit Tracked(int* counter) : counter(counter) {}
+  ~Tracked() { ++*counter; }
+  int* counter;
+  std::string payload = "heap allocated payload that defeats small string storage";
+};
+
+}  // namespace
+
+TEST(ArenaTest, RunsDestructorsOnRelease) {
+  int destroyed = 0;
+  {
+    Arena arena;
+    for (int i = 0; i < 10000; ++i) {
+      arena.create<Tracked>(&destroyed);
+    }
+    EXPECT_GT(arena.blockCount(), 1U);
+  }
+  EXPECT_EQ(destroyed, 10000);
+}
+
+TEST(ArenaTest, HonorsAlignmentAndLargeAllocations) {
+  Arena arena;
+  arena.allocate(1, 1);
+  void* aligned = arena.allocate(64, 64);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0U);
+  void* big = arena.allocate(8 * 1024 * 1024, 16);
+  EXPECT_NE(big, nullptr);
+  void* after = arena.allocate(8, 8);
+  EXPECT_NE(after, nullptr);
+}
+
+TEST(BufferedWriterTest, FormatsIntoStrings) {
+  std::string out = "prefix ";
+  {
+    BufferedWriter writer(out);
+    writer.write("n=");
+    writer.writeInt(-9223372036854775807LL - 1);
+    writer.put(' ');
+    writer.writeDouble(0.1, 17);
+    writer.put(' ');
+    writer.writeDouble(2.5);
+    writer.fill('.', 3);
+  }
+  EXPECT_EQ(out, "prefix n=-9223372036854775808 0.10000000000000001 2.5...");
+}
+
+TEST(BufferedWriterTest, FormatsDoublesLikePrintf) {
+  const double values[] = {0.0,  -0.0,  1.0,    -2.5,  0.1,      1.0 / 3.0, 123456789.0,
+                           1e-7, 1e21,  5e-324, 100.0, 0.000123, 1.7976931348623157e308};
+  for (const double value : values) {
+    for (const int precision : {1, 6, 17}) {
+      char expected[64];
+      std::snprintf(expected, sizeof(expected), "%.*g", precision, value);
+      std::string out;
+      {
+        BufferedWriter writer(out);
+        writer.writeDouble(value, precision);
+      }
+      EXPECT_EQ(out, expected) << precision;
+    }
+  }
+}
+
+TEST(BufferedWriterTest, FlushesLargeOutputToFiles) {
+  const std::string path = ::testing::TempDir() + "buffered_writer.txt";
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  std::string expected;
+  {
+    BufferedWriter writer(file);
+    for (int i = 0; i < 50000; ++i) {
+      writer.writeInt(i);
+      writer.put('\n');
+      expected += std::to_string(i) + "\n";
+    }
+    EXPECT_TRUE(writer.flush());
+  }
+  std::fclose(file);
+  ASSERT_GT(expected.size(), BufferedWriter::kChunkSize);
+
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  EXPECT_EQ(contents.str(), expected);
+}
+
+TEST(StringInternerTest, DeduplicatesEqualStrings) {
+  StringInterner interner;
+  const Symbol a = interner.intern("counter");
+  const Symbol b = interner.intern(std::string("count") + "er");
+  const Symbol c = interner.intern("count");
+
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(a.str(), "counter");
+  EXPECT_TRUE(a == "counter");
+  EXPECT_EQ(interner.size(), 2U);
+  EXPECT_TRUE(interner.intern("").empty());
+}
+
+TEST(StringInternerTest, KeepsSymbolsStableAcrossGrowth) {
+  StringInterner interner;
+  std::vector<Symbol> symbols;
+  for (int i = 0; i < 20000; ++i) {
+    symbols.push_back(interner.intern("id" + std::to_string(i)));
+  }
+  std::unordered_set<Symbol> unique(symbols.begin(), symbols.end());
+  EXPECT_EQ(unique.size(), symbols.size());
+  for (int i = 0; i < 20000; ++i) {
+    EXPECT_EQ(interner.intern("id" + std::to_string(i)), symbols[i]);
+    EXPECT_EQ(symbols[i].str(), "id" + std::to_string(i));
+  }
+}
+
+TEST(SourceBufferTest, MapsRegularFiles) {
+  const std::string path = ::testing::TempDir() + "source_buffer.c";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "int main() { return 0; }\n";
+  }
+
+  SourceBuffer buffer;
+  std::string error;
+  ASSERT_TRUE(buffer.open(path, error)) << error;
+  EXPECT_TRUE(buffer.isMapped());
+  EXPECT_EQ(buffer.contents(), "int main() { return 0; }\n");
+
+  SourceBuffer moved = std::move(buffer);
+  EXPECT_EQ(moved.contents(), "int main() { return 0; }\n");
+  EXPECT_TRUE(buffer.contents().empty());
+}
+
+TEST(SourceBufferTest, ReportsMissingFiles) {
+  SourceBuffer buffer;
+  std::string error;
+  EXPECT_FALSE(buffer.open(::testing::TempDir() + "missing_source.c", error));
+  EXPECT_FALSE(error.empty());
+}
+
+TEST(InstrumentationTest, RecordsOnlyWhileInstalled) {
+  Instrumentation instrumentation;
+  { TimeScope ignored("parse", "a.c"); }
+  EXPECT_TRUE(instrumentation.events().empty());
+
+  instrumentation.install();
+  EXPECT_EQ(Instrumentation::active(), &instrumentation);
+  {
+    TimeScope phase("codegen", "a.c");
+    {
+      TimeScope function("codegen", "main", /*per_function=*/true);
+      for (int i = 0; i < 100; ++i) {
+        auto boxed = std::make_unique<int>(i);
+        EXPECT_EQ(*boxed, i);
+      }
+    }
+  }
+  instrumentation.uninstall();
+  EXPECT_EQ(Instrumentation::active(), nullptr);
+
+  const auto events = instrumentation.events();
+  ASSERT_EQ(events.size(), 2U);
+  EXPECT_EQ(events[0].detail, "main");
+  EXPECT_TRUE(events[0].per_function);
+  EXPECT_GE(events[0].allocations, 100U);
+  EXPECT_GE(events[0].allocated_bytes, 100 * sizeof(int));
+  EXPECT_EQ(events[1].name, "codegen");
+  EXPECT_GE(events[1].allocations, events[0].allocations);
+  EXPECT_GE(events[1].wall_us, events[0].wall_us);
+  EXPECT_LE(events[1].start_us, events[0].start_us);
+  EXPECT_GT(events[1].peak_rss_kb, 0U);
+}
+
+TEST(InstrumentationTest, WritesReportAndChromeTrace) {
+  Instrumentation instrumentation;
+  instrumentation.install();
+  {
+    TimeScope phase("parse", "dir/\"quoted\".c");
+    TimeScope function("fold", "helper", /*per_function=*/true);
+  }
+  instrumentation.uninstall();
+
+  std::ostringstream report;
+  instrumentation.writeReport(report);
+  EXPECT_NE(report.str().find("parse"), std::string::npos);
+  EXPECT_NE(report.str().find("Slowest functions"), std::string::npos);
+  EXPECT_NE(report.str().find("helper"), std::string::npos);
+  EXPECT_NE(report.str().find("Alloc (KB)"), std::string::npos);
+
+  std::ostringstream trace;
+  instrumentation.writeTrace(trace);
+  const std::string json = trace.str();
+  EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0U);
+  EXPECT_NE(json.find("\"name\":\"helper\",\"cat\":\"function\",\"ph\":\"X\""),
+            std::string::npos);
+  EXPECT_NE(json.find("\"detail\":\"dir/\\\"quoted\\\".c\""), std::string::npos);
+  EXPECT_NE(json.find("\"allocated_bytes\":"), std::string::npos);
+}